@@ -20,6 +20,8 @@
 
 #include "comm/alarm.h"
 
+#include <map>
+
 #include "comm/assert/__assert.h"
 #include "comm/thread/lock.h"
 #include "comm/time_utils.h"
@@ -28,8 +30,9 @@
 
 static Mutex sg_lock;
 static int64_t sg_seq = 1;
-const MessageQueue::MessageTitle_t KALARM_MESSAGETITLE(0x1F1FF);
-const MessageQueue::MessageTitle_t KALARM_SYSTEMTITLE(0x1F1F1E);
+#ifdef ANDROID
+static std::map<int64_t, Alarm*>& sg_alarms = *(new std::map<int64_t, Alarm*>);  // started alarms by seq, for the system alarm
+#endif
 
 #define MAX_LOCK_TIME (5000)
 #define INVAILD_SEQ (0)
@@ -43,22 +46,24 @@ bool Alarm::Start(int _after, bool _needWake) {
 
     int64_t seq = sg_seq++;
     uint64_t starttime = gettickcount();
-    broadcast_msg_id_ = MessageQueue::BroadcastMessage(MessageQueue::GetDefMessageQueue(), MessageQueue::Message(KALARM_MESSAGETITLE, (int64_t)seq, MessageQueue::GetDefMessageQueue(), "Alarm.broadcast"), MessageQueue::MessageTiming(_after));
 
-    if (MessageQueue::KNullPost == broadcast_msg_id_) {
-        xerror2(TSF"mq alarm return null post, id:%0, after:%1, seq:%2", (uintptr_t)this, _after, seq);
+    if (MessageQueue::KNullHandler == reg_async_.Get()) {
+        xerror2(TSF"mq alarm has no handler, id:%0, after:%1, seq:%2", (uintptr_t)this, _after, seq);
         return false;
     }
 
+    timer_id_ = MessageQueue::TimerService::Instance().Start(_after, reg_async_.Get(), boost::bind(&Alarm::OnAlarm, this, seq, false), "Alarm.timer");
+
 #ifdef ANDROID
 
     if (_needWake && !::startAlarm((int64_t) seq, _after)) {
         xerror2(TSF"startAlarm error, id:%0, after:%1, seq:%2", (uintptr_t)this, _after, seq);
-        MessageQueue::CancelMessage(broadcast_msg_id_);
-        broadcast_msg_id_ = MessageQueue::KNullPost;
+        MessageQueue::TimerService::Instance().Cancel(timer_id_);
+        timer_id_ = MessageQueue::TimerService::kInvalidTimer;
         return false;
     }
 
+    sg_alarms[seq] = this;
 #endif
 
     status_ = kStart;
@@ -66,21 +71,22 @@ bool Alarm::Start(int _after, bool _needWake) {
     endtime_ = 0;
     after_ = _after;
     seq_ = seq;
-    xinfo2(TSF"alarm id:%_, after:%_, seq:%_, po.reg.q:%_,po.reg.s:%_,po.s:%_, MQ:%_", (uintptr_t)this, _after, seq, broadcast_msg_id_.reg.queue, broadcast_msg_id_.reg.seq, broadcast_msg_id_.seq, MessageQueue::GetDefMessageQueue());
+    xinfo2(TSF"alarm id:%_, after:%_, seq:%_, timer:%_, MQ:%_", (uintptr_t)this, _after, seq, timer_id_, MessageQueue::Handler2Queue(reg_async_.Get()));
 
     return true;
 }
 
 bool Alarm::Cancel() {
     ScopedLock lock(sg_lock);
-    if (broadcast_msg_id_!=MessageQueue::KNullPost) {
-        MessageQueue::CancelMessage(broadcast_msg_id_);
-        broadcast_msg_id_=MessageQueue::KNullPost;
+    if (MessageQueue::TimerService::kInvalidTimer != timer_id_) {
+        MessageQueue::TimerService::Instance().Cancel(timer_id_);
+        timer_id_ = MessageQueue::TimerService::kInvalidTimer;
     }
     MessageQueue::CancelMessage(reg_async_.Get());
     if (INVAILD_SEQ == seq_) return true;
 
 #ifdef ANDROID
+    sg_alarms.erase(seq_);
 
     if (!::stopAlarm((int64_t)seq_)) {
         xwarn2(TSF"stopAlarm error, id:%0, seq:%1", (uintptr_t)this, seq_);
@@ -118,31 +124,17 @@ int64_t Alarm::ElapseTime() const {
     return endtime_ -  starttime_;
 }
 
-void Alarm::OnAlarm(const MessageQueue::MessagePost_t& _id, MessageQueue::Message& _message) {
-    if (KALARM_MESSAGETITLE != _message.title && KALARM_SYSTEMTITLE != _message.title) return;
-
+// posted to reg_async_ by the timer service, or by onAlarmImpl for the system alarm.
+void Alarm::OnAlarm(int64_t _seq, bool _is_system_alarm) {
     ScopedLock lock(sg_lock);
 
-    if (MessageQueue::CurrentThreadMessageQueue() != MessageQueue::Handler2Queue(reg_async_.Get())) {
-        MessageQueue::AsyncInvoke(boost::bind(&Alarm::OnAlarm, this, _id, _message), (MessageQueue::MessageTitle_t)this, reg_async_.Get(), "Alarm::OnAlarm");
-        return;
-    }
-
-    bool isSystemAlarm = (KALARM_SYSTEMTITLE == _message.title);
-    MessageQueue::MessageQueue_t fromMQ = boost::any_cast<MessageQueue::MessageQueue_t>(_message.body2);
-
-    if (seq_ != boost::any_cast<int64_t>(_message.body1) || fromMQ != MessageQueue::GetDefMessageQueue()) {
-        if(fromMQ != MessageQueue::GetDefMessageQueue()) {
-            xinfo2(TSF"not match:(%_, %_), (%_, %_)", seq_, boost::any_cast<int64_t>(_message.body1), MessageQueue::GetDefMessageQueue(), fromMQ);
-        }
-        return;
-    }
+    if (seq_ != _seq) return;
 
     uint64_t  curtime = gettickcount();
     int64_t   elapseTime = curtime - starttime_;
     int64_t   missTime = after_ - elapseTime;
     xgroup2_define(group);
-    xinfo2(TSF"OnAlarm id:%_, seq:%_, elapsed:%_, after:%_, miss:%_, android alarm:%_, MQ:%_", (uintptr_t)this, seq_, elapseTime, after_, -missTime, isSystemAlarm, MessageQueue::GetDefMessageQueue()) >> group;
+    xinfo2(TSF"OnAlarm id:%_, seq:%_, elapsed:%_, after:%_, miss:%_, android alarm:%_, MQ:%_", (uintptr_t)this, seq_, elapseTime, after_, -missTime, _is_system_alarm, MessageQueue::Handler2Queue(reg_async_.Get())) >> group;
 
 #ifdef ANDROID
 
@@ -169,10 +161,23 @@ void Alarm::OnAlarm(const MessageQueue::MessagePost_t& _id, MessageQueue::Messag
     seq_ = INVAILD_SEQ;
     endtime_ = curtime;
 
-    if (inthread_)
+    // the other of timer and system alarm may still be pending, its seq won't match any more.
+    if (MessageQueue::TimerService::kInvalidTimer != timer_id_) {
+        MessageQueue::TimerService::Instance().Cancel(timer_id_);
+        timer_id_ = MessageQueue::TimerService::kInvalidTimer;
+    }
+#ifdef ANDROID
+    sg_alarms.erase(_seq);
+#endif
+
+    if (inthread_) {
         runthread_.start();
-    else
-        MessageQueue::AsyncInvoke(boost::bind(&Alarm::__Run, this), (MessageQueue::MessageTitle_t)this, reg_async_.Get(), "Alarm::__Run");
+        return;
+    }
+
+    // already on reg_async_, no need to post again. the target may Start() this alarm, so unlocked.
+    lock.unlock();
+    __Run();
 }
 
 void Alarm::__Run() {
@@ -185,7 +190,14 @@ const Thread& Alarm::RunThread() const {
 
 #ifdef ANDROID
 void Alarm::onAlarmImpl(int64_t _id) {
-    xinfo2(TSF"onAlarm id:%_, MQ:%_", _id, MessageQueue::GetDefMessageQueue());
-    MessageQueue::BroadcastMessage(MessageQueue::GetDefMessageQueue(), MessageQueue::Message(KALARM_SYSTEMTITLE, _id, MessageQueue::GetDefMessageQueue(), "KALARM_SYSTEMTITLE.id"));
+    xinfo2(TSF"onAlarm id:%_", _id);
+
+    ScopedLock lock(sg_lock);
+    std::map<int64_t, Alarm*>::iterator it = sg_alarms.find(_id);
+    if (sg_alarms.end() == it) return;
+
+    // ~Alarm cancels its reg_async_ after Cancel() has taken it out of sg_alarms, so the post can't outlive it.
+    Alarm* alarm = it->second;
+    MessageQueue::AsyncInvoke(boost::bind(&Alarm::OnAlarm, alarm, _id, true), (MessageQueue::MessageTitle_t)alarm, alarm->reg_async_.Get(), "Alarm::onAlarmImpl");
 }
 #endif
@@ -23,6 +23,7 @@
 
 #include <boost/bind.hpp>
 #include "messagequeue/message_queue.h"
+#include "messagequeue/timer_service.h"
 #include "comm/xlogger/xlogger.h"
 
 #ifdef ANDROID
@@ -43,12 +44,11 @@ class Alarm {
     explicit Alarm(const T& _op, bool _inthread = true)
         : target_(detail::transform(_op))
         , reg_async_(MessageQueue::InstallAsyncHandler(MessageQueue::GetDefMessageQueue()))
-        , broadcast_msg_id_(MessageQueue::KNullPost)
+        , timer_id_(MessageQueue::TimerService::kInvalidTimer)
         , runthread_(boost::bind(&Alarm::__Run, this), "alarm")
         , inthread_(_inthread)
         , seq_(0), status_(kInit)
         , after_(0) , starttime_(0) , endtime_(0)
-        , reg_(MessageQueue::InstallMessageHandler(boost::bind(&Alarm::OnAlarm, this, _1, _2), true))
 #ifdef ANDROID
         , wakelock_(NULL)
 #endif
@@ -60,12 +60,11 @@ class Alarm {
     explicit Alarm(const T& _op, const MessageQueue::MessageQueue_t& _id)
         : target_(detail::transform(_op))
         , reg_async_(MessageQueue::InstallAsyncHandler(_id))
-        , broadcast_msg_id_(MessageQueue::KNullPost)
+        , timer_id_(MessageQueue::TimerService::kInvalidTimer)
         , runthread_(boost::bind(&Alarm::__Run, this), "alarm")
         , inthread_(false)
         , seq_(0), status_(kInit)
         , after_(0) , starttime_(0) , endtime_(0)
-        , reg_(MessageQueue::InstallMessageHandler(boost::bind(&Alarm::OnAlarm, this, _1, _2), true))
 #ifdef ANDROID
         , wakelock_(NULL)
 #endif
@@ -75,7 +74,6 @@ class Alarm {
 
     virtual ~Alarm() {
         Cancel();
-        reg_.CancelAndWait();
         reg_async_.CancelAndWait();
         runthread_.join();
         delete target_;
@@ -102,13 +100,13 @@ class Alarm {
     Alarm(const Alarm&);
     Alarm& operator=(const Alarm&);
 
-    void OnAlarm(const MessageQueue::MessagePost_t& _id, MessageQueue::Message& _message);
+    void OnAlarm(int64_t _seq, bool _is_system_alarm);
     virtual void    __Run();
 
   private:
     Runnable*                   target_;
-    MessageQueue::ScopeRegister reg_async_;
-    MessageQueue::MessagePost_t broadcast_msg_id_;
+    MessageQueue::ScopeRegister reg_async_;     // OnAlarm runs here
+    MessageQueue::TimerService::TimerId timer_id_;
     Thread                      runthread_;
     bool                        inthread_;
 
@@ -118,8 +116,6 @@ class Alarm {
     int                         after_;
     uint64_t          			starttime_;
     uint64_t          			endtime_;
-
-    MessageQueue::ScopeRegister reg_;
 #ifdef ANDROID
     WakeUpLock*                 wakelock_;
 #endif
@@ -147,6 +147,32 @@ typename boost::result_of< F()>::type MessageInvoke(const F& _func) {
     return result.Result();
 }
 
+// runs _func on _handler, a task pool for what blocks, and resumes when it is done. the coroutine's thread runs others meanwhile.
+template <typename F>
+typename boost::disable_if<typename boost::is_void<typename boost::result_of<F()>::type>, typename boost::result_of<F()>::type>::type
+MessageInvoke(const F& _func, const mq::MessageHandler_t& _handler) {
+    boost::intrusive_ptr<Wrapper> wrapper = RunningCoroutine();
+    
+    typedef typename boost::result_of<F()>::type R;
+    // resumed from the callback, it runs once the result is stored.
+    mq::AsyncResult<R> result(_func, [wrapper](const R&, bool) { Resume(wrapper); });
+    
+    mq::AsyncInvoke(result, _handler);
+    Yield();
+    return result.Result();
+}
+
+template <typename F>
+typename boost::enable_if<typename boost::is_void<typename boost::result_of<F()>::type>>::type
+MessageInvoke(const F& _func, const mq::MessageHandler_t& _handler) {
+    boost::intrusive_ptr<Wrapper> wrapper = RunningCoroutine();
+    
+    mq::AsyncResult<void> result(_func, [wrapper](bool) { Resume(wrapper); });
+    
+    mq::AsyncInvoke(result, _handler);
+    Yield();
+}
+
 }
 
 #endif
@@ -161,6 +161,7 @@ static void __Coro_Poll(int _msec, ::SocketPoll& _socket_poll) {
     
 int SocketSelect::Select(int _msec) {
     __Coro_Poll(_msec, Poll());
+    if (autoclear_) Breaker().Clear();
     return Ret();
 }
     
@@ -33,8 +33,8 @@ int     block_socket_recv(SOCKET _sock, AutoBuffer& _buffer, size_t _max_size, S
     
 class SocketSelect : public ::SocketSelect {
 public:
-    SocketSelect(SocketBreaker& _breaker)
-    : ::SocketSelect(_breaker, false) {}
+    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false)
+    : ::SocketSelect(_breaker, false), autoclear_(_autoclear) {}
     virtual ~SocketSelect() {}
     
     virtual int Select(int _msec);
@@ -43,6 +43,9 @@ public:
 private:
     SocketSelect(const SocketSelect&);
     SocketSelect& operator=(const SocketSelect&);
+    
+private:
+    const bool autoclear_;  // the poll is handed to the multiplexing thread, the clear is done here
 };
     
 class SocketPoll : public ::SocketPoll {
@@ -84,10 +87,41 @@ private:
     
 }
 
+#include "mars/comm/socket/complexconnect.h"
 #define COMPLEX_CONNECT_NAMESPACE coroutine
 #include "mars/comm/socket/complexconnect.h"
 #undef COMPLEX_CONNECT_NAMESPACE
 
+namespace coroutine {
+
+// hands what coroutine::ComplexConnect reports on to an observer written for ::ComplexConnect.
+class ComplexConnectObserver : public MComplexConnect {
+public:
+    ComplexConnectObserver(::MComplexConnect& _observer): observer_(_observer) {}
+    
+    virtual void OnCreated(unsigned int _index, const socket_address& _addr, SOCKET _socket) { observer_.OnCreated(_index, _addr, _socket); }
+    virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket) { observer_.OnConnect(_index, _addr, _socket); }
+    virtual void OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt) { observer_.OnConnected(_index, _addr, _socket, _error, _rtt); }
+    
+    virtual bool OnShouldVerify(unsigned int _index, const socket_address& _addr) { return observer_.OnShouldVerify(_index, _addr); }
+    virtual bool OnVerifySend(unsigned int _index, const socket_address& _addr, SOCKET _socket, AutoBuffer& _buffer_send) { return observer_.OnVerifySend(_index, _addr, _socket, _buffer_send); }
+    virtual bool OnVerifyRecv(unsigned int _index, const socket_address& _addr, SOCKET _socket, const AutoBuffer& _buffer_recv) { return observer_.OnVerifyRecv(_index, _addr, _socket, _buffer_recv); }
+    virtual void OnVerifyTimeout(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _timeout) { observer_.OnVerifyTimeout(_index, _addr, _socket, _timeout); }
+    
+    virtual void OnFinished(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _conn_rtt, int _conn_totalcost, int _complex_totalcost) {
+        observer_.OnFinished(_index, _addr, _socket, _error, _conn_rtt, _conn_totalcost, _complex_totalcost);
+    }
+    
+private:
+    ComplexConnectObserver(const ComplexConnectObserver&);
+    ComplexConnectObserver& operator=(const ComplexConnectObserver&);
+    
+private:
+    ::MComplexConnect& observer_;
+};
+    
+}
+
 #include "./dns.h"
 
 #endif //MMNET_ASYNC_SOCKET_H_H
@@ -19,6 +19,7 @@
 
 #include "mars/comm/messagequeue/message_queue.h"
 #include "mars/comm/assert/__assert.h"
+#include "mars/comm/coroutine/stack_pool.h"
 
 namespace coroutine {
 
@@ -39,7 +40,7 @@ public:
     , push_obj_([_func, this](pull_coro_t& sink){
         this->pull_obj_ptr_ = &sink;
         _func();
-    })
+    }, boost::coroutines::attributes(), PooledStackAllocator())
     {}
 
 private:
@@ -0,0 +1,146 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * stack_pool.cc
+ *
+ *  Created on: 2026-10-18
+ */
+
+#include "stack_pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "mars/comm/xlogger/xlogger.h"
+
+namespace coroutine {
+
+static const size_t kDefaultMaxIdle = 64;
+
+static size_t __PageSize() {
+    return boost::coroutines::stack_traits::page_size();
+}
+
+// rounded up to whole pages, plus the guard page.
+static size_t __MapSize(size_t _size) {
+    size_t page = __PageSize();
+    return (_size + page - 1) / page * page + page;
+}
+
+static void* __Map(size_t _size) {
+    size_t map_size = __MapSize(_size);
+#ifndef _WIN32
+    void* base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (MAP_FAILED == base) {
+        xerror2(TSF"mmap size:%_, errno:(%_, %_)", map_size, errno, strerror(errno));
+        return NULL;
+    }
+    mprotect(base, __PageSize(), PROT_NONE);
+#else
+    void* base = malloc(map_size);
+    if (NULL == base) return NULL;
+#endif
+    return (char*)base + map_size;    // stacks grow down, the top is what boost wants
+}
+
+static void __Unmap(void* _top, size_t _size) {
+    size_t map_size = __MapSize(_size);
+#ifndef _WIN32
+    munmap((char*)_top - map_size, map_size);
+#else
+    free((char*)_top - map_size);
+#endif
+}
+
+StackPool& StackPool::Instance() {
+    static StackPool* s_instance = new StackPool;
+    return *s_instance;
+}
+
+StackPool::StackPool(): idle_count_(0), max_idle_(kDefaultMaxIdle), mapped_(0) {}
+
+StackPool::~StackPool() {
+    ASSERT(false);  // lives until exit
+}
+
+void StackPool::Allocate(boost::coroutines::stack_context& _ctx, size_t _size) {
+    ScopedLock lock(mutex_);
+
+    std::vector<void*>& idle = idle_[_size];
+    void* top = NULL;
+    if (!idle.empty()) {
+        top = idle.back();
+        idle.pop_back();
+        --idle_count_;
+    } else {
+        lock.unlock();
+        top = __Map(_size);
+        xassert2(NULL != top, TSF"size:%_", _size);
+        lock.lock();
+        if (NULL != top) ++mapped_;
+    }
+
+    _ctx.size = _size;
+    _ctx.sp = top;
+}
+
+void StackPool::Deallocate(boost::coroutines::stack_context& _ctx) {
+    if (NULL == _ctx.sp) return;
+
+    ScopedLock lock(mutex_);
+    if (idle_count_ < max_idle_) {
+        idle_[_ctx.size].push_back(_ctx.sp);
+        ++idle_count_;
+        return;
+    }
+
+    --mapped_;
+    lock.unlock();
+    __Unmap(_ctx.sp, _ctx.size);
+}
+
+void StackPool::SetMaxIdle(size_t _max_idle) {
+    std::vector<std::pair<void*, size_t> > unmap;
+
+    ScopedLock lock(mutex_);
+    max_idle_ = _max_idle;
+
+    for (std::map<size_t, std::vector<void*> >::iterator it = idle_.begin(); it != idle_.end() && idle_count_ > max_idle_; ++it) {
+        while (!it->second.empty() && idle_count_ > max_idle_) {
+            unmap.push_back(std::make_pair(it->second.back(), it->first));
+            it->second.pop_back();
+            --idle_count_;
+            --mapped_;
+        }
+    }
+    lock.unlock();
+
+    for (size_t i = 0; i < unmap.size(); ++i) __Unmap(unmap[i].first, unmap[i].second);
+}
+
+size_t StackPool::Idle() {
+    ScopedLock lock(mutex_);
+    return idle_count_;
+}
+
+size_t StackPool::Mapped() {
+    ScopedLock lock(mutex_);
+    return mapped_;
+}
+
+}
@@ -0,0 +1,81 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * stack_pool.h
+ *
+ *  Created on: 2026-10-18
+ */
+
+#ifndef COROUTINE_STACK_POOL_H_
+#define COROUTINE_STACK_POOL_H_
+
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+#include <boost/coroutine/stack_context.hpp>
+#include <boost/coroutine/stack_traits.hpp>
+
+#include "mars/comm/thread/lock.h"
+
+namespace coroutine {
+
+/*
+ * Stacks of finished coroutines, kept for the next ones: a coroutine per connection comes and goes
+ * with the connection, a stack from here costs no mmap/munmap.
+ * A stack is mapped with a guard page below it, the pages above are only touched as the coroutine uses them.
+ */
+class StackPool {
+  public:
+    static StackPool& Instance();
+
+  public:
+    void Allocate(boost::coroutines::stack_context& _ctx, size_t _size);
+    void Deallocate(boost::coroutines::stack_context& _ctx);
+
+    void SetMaxIdle(size_t _max_idle);
+    size_t Idle();
+    size_t Mapped();    // stacks mapped and not unmapped yet, idle or in use
+
+  private:
+    StackPool();
+    ~StackPool();
+
+  private:
+    StackPool(const StackPool&);
+    StackPool& operator=(const StackPool&);
+
+  private:
+    Mutex mutex_;
+    std::map<size_t, std::vector<void*> > idle_;    // by size, the top of each stack
+    size_t idle_count_;
+    size_t max_idle_;
+    size_t mapped_;
+};
+
+// the StackAllocator boost::coroutines takes, for stacks from StackPool.
+struct PooledStackAllocator {
+    typedef boost::coroutines::stack_traits traits_type;
+
+    void allocate(boost::coroutines::stack_context& _ctx, size_t _size = traits_type::default_size()) {
+        StackPool::Instance().Allocate(_ctx, _size);
+    }
+
+    void deallocate(boost::coroutines::stack_context& _ctx) {
+        StackPool::Instance().Deallocate(_ctx);
+    }
+};
+
+}
+
+#endif /* COROUTINE_STACK_POOL_H_ */
@@ -19,13 +19,21 @@
  */
 
 #include "dns/dns.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "boost/bind.hpp"
+
 #include "socket/unix_socket.h"
 #include "xlogger/xlogger.h"
 #include "time_utils.h"
 #include "socket/socket_address.h"
 #include "thread/condition.h"
-#include "thread/thread.h"
 #include "thread/lock.h"
+#include "messagequeue/message_queue.h"
+#include "dns/dns_stub_resolver.h"
 
 #include "network/getdnssvraddrs.h"
 #include "socket/local_ipstack.h"
@@ -37,43 +45,47 @@ enum {
     kGetIPFail,
 };
 
-struct dnsinfo {
-    thread_tid      threadid;
+// for getaddrinfo and a DNSFunc, which don't tell the record ttl. the stub resolver does, kept within [kDNSMinTTL, kDNSMaxTTL].
+static const uint64_t kDNSCacheTTL = 60 * 1000;
+static const uint64_t kDNSMinTTL = 10 * 1000;
+static const uint64_t kDNSMaxTTL = 10 * 60 * 1000;
+static const uint64_t kDNSNegativeTTL = 5 * 1000;
+static const uint64_t kDNSStaleTime = 5 * 60 * 1000;    // past its ttl, a result is still answered while it is refreshed
+static const size_t kDNSCacheMaxSize = 256;
+static const int kDNSResolverThreads = 4;
+static const long kDNSStubTimeout = 3 * 1000;
+
+typedef std::pair<DNS::DNSFunc, std::string> dnskey;
+
+struct dnscache {
+    dnscache(): expire(0), stale_expire(0), resolving(false), cleared(false), generation(0), waiters(0) {}
+    std::vector<std::string> result;    // empty for a failed resolution
+    uint64_t expire;
+    uint64_t stale_expire;
+    bool resolving;
+    bool cleared;                       // ClearCache came while resolving, the result is of the old network and goes to the waiters only
+    unsigned int generation;            // one more for every resolution done
+    int waiters;                        // GetHostByName calls waiting for the next generation, the entry isn't dropped under them
+};
+
+struct dnswaiter {
     DNS*            dns;
-    DNS::DNSFunc    dns_func;
     std::string     host_name;
-    std::vector<std::string> result;
     int status;
 };
 
-static std::string DNSInfoToString(const struct dnsinfo& _info) {
-    XMessage msg;
-    msg(TSF"info:%_, threadid:%_, dns:%_, host_name:%_, status:%_", &_info, _info.threadid, _info.dns, _info.host_name, _info.status);
-    return msg.Message();
-}
-static std::vector<dnsinfo> sg_dnsinfo_vec;
+static std::map<dnskey, dnscache> sg_dnscache;
+static std::set<dnswaiter*> sg_dnswaiters;
 static Condition sg_condition;
 static Mutex sg_mutex;
+static uint64_t sg_cache_ttl = kDNSCacheTTL;
+static uint64_t sg_negative_ttl = kDNSNegativeTTL;
+static uint64_t sg_stale_time = kDNSStaleTime;
 
-static void __GetIP() {
+static std::vector<std::string> __GetIP(const std::string& host_name, DNS::DNSFunc dnsfunc) {
     xverbose_function();
 
-
-    std::string host_name;
-    DNS::DNSFunc dnsfunc = NULL;
-
-    ScopedLock lock(sg_mutex);
-    std::vector<dnsinfo>::iterator iter = sg_dnsinfo_vec.begin();
-
-    for (; iter != sg_dnsinfo_vec.end(); ++iter) {
-        if (iter->threadid == ThreadUtil::currentthreadid()) {
-            host_name = iter->host_name;
-            dnsfunc = iter->dns_func;
-            break;
-        }
-    }
-
-    lock.unlock();
+    std::vector<std::string> ips;
 
     if (NULL == dnsfunc) {
         
@@ -101,80 +113,159 @@ static void __GetIP() {
         } else {
             error = getaddrinfo(host_name.c_str(), NULL, /*&hints*/NULL, &result);
         }
-           
-        lock.lock();
-
-        iter = sg_dnsinfo_vec.begin();
-        for (; iter != sg_dnsinfo_vec.end(); ++iter) {
-            if (iter->threadid == ThreadUtil::currentthreadid()) {
-                break;
-            }
-        }
 
         if (error != 0) {
             xwarn2(TSF"error, error:%_/%_, hostname:%_, ipstack:%_", error, strerror(error), host_name.c_str(), ipstack);
+            return ips;
+        }
 
-            if (iter != sg_dnsinfo_vec.end()) iter->status = kGetIPFail;
-
-            sg_condition.notifyAll();
-            return;
-        } else {
-            if (iter == sg_dnsinfo_vec.end()) {
-                freeaddrinfo(result);
-                return;
-            }
-
-            for (single = result; single; single = single->ai_next) {
-                // In Indonesia, if there is no ipv6's ip, operators return 0.0.0.0.
-                if (PF_INET == single->ai_family) {
-                    sockaddr_in* addr_in = (sockaddr_in*)single->ai_addr;
-//                    struct in_addr convertAddr;
-                    if (INADDR_ANY == addr_in->sin_addr.s_addr || INADDR_NONE == addr_in->sin_addr.s_addr) {
-                        xwarn2(TSF"hehe, addr_in->sin_addr.s_addr:%0", addr_in->sin_addr.s_addr);
-                        continue;
-                    }
-                }
-
-
-//                convertAddr.s_addr = addr_in->sin_addr.s_addr;
-                socket_address sock_addr(single->ai_addr);
-                const char* ip = sock_addr.ip();
-
-                if (!socket_address(ip, 0).valid_server_address(false, true)) {
-                    xerror2(TSF"ip is invalid, ip:%0", ip);
+        for (single = result; single; single = single->ai_next) {
+            // In Indonesia, if there is no ipv6's ip, operators return 0.0.0.0.
+            if (PF_INET == single->ai_family) {
+                sockaddr_in* addr_in = (sockaddr_in*)single->ai_addr;
+                if (INADDR_ANY == addr_in->sin_addr.s_addr || INADDR_NONE == addr_in->sin_addr.s_addr) {
+                    xwarn2(TSF"hehe, addr_in->sin_addr.s_addr:%0", addr_in->sin_addr.s_addr);
                     continue;
                 }
-
-                iter->result.push_back(ip);
             }
-            
-            //
-            xgroup2_define(ip_group);
-            xinfo2(TSF"host %_ resolved iplist: ", host_name) >> ip_group;
-            for(auto ip : iter->result){
-                xinfo2(TSF"%_,", ip) >> ip_group;
+
+            socket_address sock_addr(single->ai_addr);
+            const char* ip = sock_addr.ip();
+
+            if (!socket_address(ip, 0).valid_server_address(false, true)) {
+                xerror2(TSF"ip is invalid, ip:%0", ip);
+                continue;
             }
-            
-            freeaddrinfo(result);
-            iter->status = kGetIPSuc;
-            sg_condition.notifyAll();
+
+            ips.push_back(ip);
         }
-    } else {
-        std::vector<std::string> ips = dnsfunc(host_name);
-        lock.lock();
         
-        iter = sg_dnsinfo_vec.begin();
-        for (; iter != sg_dnsinfo_vec.end(); ++iter) {
-            if (iter->threadid == ThreadUtil::currentthreadid()) {
-                break;
-            }
+        //
+        xgroup2_define(ip_group);
+        xinfo2(TSF"host %_ resolved iplist: ", host_name) >> ip_group;
+        for(auto ip : ips){
+            xinfo2(TSF"%_,", ip) >> ip_group;
         }
         
-        if (iter != sg_dnsinfo_vec.end()) {
-            iter->status = ips.empty()? kGetIPFail:kGetIPSuc;
-            iter->result = ips;
+        freeaddrinfo(result);
+    } else {
+        ips = dnsfunc(host_name);
+    }
+
+    return ips;
+}
+
+// _ttl 0 for a resolution that doesn't tell the record ttl.
+static void __OnResolved(const dnskey& _key, std::vector<std::string>& _result, uint64_t _ttl) {
+    ScopedLock lock(sg_mutex);
+    dnscache& cache = sg_dnscache[_key];
+    uint64_t now = gettickcount();
+
+    cache.resolving = false;
+    ++cache.generation;
+
+    if (cache.cleared) {
+        // the waiters take it, the next lookup resolves again on the new network.
+        cache.cleared = false;
+        cache.result.swap(_result);
+        cache.expire = 0;
+        cache.stale_expire = 0;
+    } else if (!_result.empty()) {
+        cache.result.swap(_result);
+        cache.expire = now + (0 == _ttl ? sg_cache_ttl : _ttl);
+        cache.stale_expire = cache.expire + sg_stale_time;
+    } else if (!cache.result.empty() && now < cache.stale_expire) {
+        // a failed refresh keeps the stale result, and is not tried again for a while.
+        cache.expire = std::min(now + sg_negative_ttl, cache.stale_expire);
+    } else {
+        cache.result.clear();
+        cache.expire = now + sg_negative_ttl;
+        cache.stale_expire = cache.expire;
+    }
+
+    xinfo2(TSF"dns resolved host:%_, func:%_, ips:%_, ttl:%_", _key.second, _key.first, cache.result.size(), _ttl);
+    sg_condition.notifyAll();
+}
+
+static void __GetIPResolve(const dnskey& _key) {
+    std::vector<std::string> result = __GetIP(_key.second, _key.first);
+    __OnResolved(_key, result, 0);
+}
+
+static void __OnStubResolved(const dnskey& _key, int _status, const std::vector<std::string>& _ips, uint32_t _ttl) {
+    if (DNSStubResolver::kResolveOK != _status) {
+        // the hosts file, search domains, or no server known: getaddrinfo still knows.
+        xinfo2(TSF"dns stub status:%_, host:%_, fall back to getaddrinfo", _status, _key.second);
+        __GetIPResolve(_key);
+        return;
+    }
+
+    // the same filter as the getaddrinfo path, a server answering with an unusable ip is not trusted.
+    std::vector<std::string> result;
+    for (std::vector<std::string>::const_iterator it = _ips.begin(); it != _ips.end(); ++it) {
+        if (!socket_address(it->c_str(), 0).valid_server_address(false, true)) {
+            xerror2(TSF"ip is invalid, ip:%0", *it);
+            continue;
+        }
+
+        result.push_back(*it);
+    }
+
+    if (result.empty()) {
+        xinfo2(TSF"dns stub no valid ip in %_, host:%_, fall back to getaddrinfo", _ips.size(), _key.second);
+        __GetIPResolve(_key);
+        return;
+    }
+
+    __OnResolved(_key, result, std::max(kDNSMinTTL, std::min(kDNSMaxTTL, (uint64_t)_ttl * 1000)));
+}
+
+static const mq::MessageHandler_t& __ResolverHandler();
+
+static void __Resolve(const dnskey& _key) {
+    struct in6_addr addr6;
+    struct in_addr addr;
+    bool literal = 0 < socket_inet_pton(AF_INET, _key.second.c_str(), &addr) || 0 < socket_inet_pton(AF_INET6, _key.second.c_str(), &addr6);
+
+    if (NULL != _key.first || literal) {
+        __GetIPResolve(_key);
+        return;
+    }
+
+    // the queries go out from the stub resolver thread, no pool thread waits on them.
+    static DNSStubResolver* s_stub = new DNSStubResolver;
+    int family = ELocalIPStack_IPv4 == local_ipstack_detect() ? AF_INET : AF_UNSPEC;
+    s_stub->Resolve(_key.second, family, kDNSStubTimeout, boost::bind(&__OnStubResolved, _key, _1, _2, _3), __ResolverHandler());
+}
+
+static const mq::MessageHandler_t& __ResolverHandler() {
+    static mq::MessageHandler_t s_handler = mq::DefAsyncInvokeHandler(mq::CreateTaskPool(kDNSResolverThreads, "dns_resolver"));
+    return s_handler;
+}
+
+// with sg_mutex held
+static bool __StartResolve(const dnskey& _key, dnscache& _cache) {
+    if (_cache.resolving) return true;
+
+    if (mq::KNullPost == mq::AsyncInvoke(boost::bind(&__Resolve, _key), __ResolverHandler())) {
+        xerror2(TSF"post dns resolve fail, host:%_", _key.second);
+        return false;
+    }
+
+    _cache.resolving = true;
+    return true;
+}
+
+// with sg_mutex held
+static void __ShrinkCache(uint64_t _now) {
+    if (sg_dnscache.size() < kDNSCacheMaxSize) return;
+
+    for (std::map<dnskey, dnscache>::iterator it = sg_dnscache.begin(); it != sg_dnscache.end();) {
+        if (!it->second.resolving && 0 == it->second.waiters && _now >= it->second.stale_expire) {
+            sg_dnscache.erase(it++);
+        } else {
+            ++it;
         }
-        sg_condition.notifyAll();
     }
 }
 
@@ -199,105 +290,75 @@ bool DNS::GetHostByName(const std::string& _host_name, std::vector<std::string>&
 
     if (_breaker && _breaker->isbreak) return false;
 
-    Thread thread(&__GetIP, _host_name.c_str());
-    int startRet = thread.start();
+    uint64_t now = gettickcount();
+    __ShrinkCache(now);
 
-    if (startRet != 0) {
-        xerror2(TSF"start the thread fail");
-        return false;
+    dnskey key(dnsfunc_, _host_name);
+    dnscache& cache = sg_dnscache[key];
+
+    if (!cache.result.empty() && now < cache.stale_expire) {
+        if (now >= cache.expire) __StartResolve(key, cache);
+        ips = cache.result;
+        return true;
     }
 
-    dnsinfo info;
-    info.threadid = thread.tid();
-    info.host_name = _host_name;
-    info.dns_func = dnsfunc_;
-    info.dns = this;
-    info.status = kGetIPDoing;
-    sg_dnsinfo_vec.push_back(info);
+    if (now < cache.expire && !cache.resolving) {
+        xinfo2(TSF"dns negative cache host:%_, func:%_", _host_name, dnsfunc_);
+        return false;
+    }
 
-    if (_breaker) _breaker->dnsstatus = &(sg_dnsinfo_vec.back().status);
+    if (!__StartResolve(key, cache)) return false;
 
-    uint64_t time_end = gettickcount() + (uint64_t)millsec;
+    // a waited on entry stays in the map, so the reference and its generation hold across the wait.
+    unsigned int generation = cache.generation;
+    ++cache.waiters;
 
-    while (true) {
-        uint64_t time_cur = gettickcount();
-        uint64_t time_wait = time_end > time_cur ? time_end - time_cur : 0;
+    dnswaiter waiter;
+    waiter.dns = this;
+    waiter.host_name = _host_name;
+    waiter.status = kGetIPDoing;
+    sg_dnswaiters.insert(&waiter);
 
-        int wait_ret = sg_condition.wait(lock, (long)time_wait);
+    if (_breaker) _breaker->dnsstatus = &waiter.status;
 
-        std::vector<dnsinfo>::iterator it = sg_dnsinfo_vec.begin();
+    uint64_t time_end = now + (uint64_t)millsec;
 
-        for (; it != sg_dnsinfo_vec.end(); ++it) {
-            if (info.threadid == it->threadid)
-                break;
+    while (kGetIPDoing == waiter.status) {
+        if (cache.generation != generation) {
+            waiter.status = cache.result.empty() ? kGetIPFail : kGetIPSuc;
+            if (kGetIPSuc == waiter.status) ips = cache.result;
+            break;
         }
 
-        xassert2(it != sg_dnsinfo_vec.end());
-        
-        if (it != sg_dnsinfo_vec.end()){
-
-            if (ETIMEDOUT == wait_ret) {
-                it->status = kGetIPTimeout;
-            }
-
-            if (kGetIPDoing == it->status) {
-                continue;
-            }
-
-            if (kGetIPSuc == it->status) {
-                if (_host_name==it->host_name) {
-                    ips = it->result;
-
-                    if (_breaker) _breaker->dnsstatus = NULL;
-
-                    sg_dnsinfo_vec.erase(it);
-                    return true;
-                } else {
-                    std::vector<dnsinfo>::iterator iter = sg_dnsinfo_vec.begin();
-                    int i = 0;
-                    for (; iter != sg_dnsinfo_vec.end(); ++iter) {
-                        xerror2(TSF"sg_info_vec[%_]:%_", i++, DNSInfoToString(*iter));
-                    }
-                    if (monitor_func_)
-                        monitor_func_(kDNSThreadIDError);
-                    xassert2(false, TSF"_host_name:%_, it->host_name:%_", _host_name, it->host_name);
-                    return false;
-                }
-            }
-
-            if (kGetIPTimeout == it->status || kGetIPCancel == it->status || kGetIPFail == it->status) {
-                if (_breaker) _breaker->dnsstatus = NULL;
-
-                xinfo2(TSF "dns get ip status:%_ host:%_, func:%_", it->status, it->host_name, it->dns_func);
-                sg_dnsinfo_vec.erase(it);
-                return false;
-            }
+        uint64_t time_cur = gettickcount();
+        uint64_t time_wait = time_end > time_cur ? time_end - time_cur : 0;
 
-            xassert2(false, "%d", it->status);
+        if (0 == time_wait || ETIMEDOUT == sg_condition.wait(lock, (long)time_wait)) {
+            // the resolution goes on, and it fills the cache for the next one.
+            if (kGetIPDoing == waiter.status) waiter.status = kGetIPTimeout;
+        }
+    }
 
-            if (_breaker) _breaker->dnsstatus = NULL;
+    if (_breaker) _breaker->dnsstatus = NULL;
+    sg_dnswaiters.erase(&waiter);
+    --cache.waiters;
 
-            sg_dnsinfo_vec.erase(it);
-        }
-        return false;
+    if (kGetIPSuc != waiter.status) {
+        xinfo2(TSF "dns get ip status:%_ host:%_, func:%_", waiter.status, _host_name, dnsfunc_);
     }
 
-    return false;
+    return kGetIPSuc == waiter.status;
 }
 
 void DNS::Cancel(const std::string& _host_name) {
     xverbose_function();
     ScopedLock lock(sg_mutex);
 
-    for (unsigned int i = 0; i < sg_dnsinfo_vec.size(); ++i) {
-        dnsinfo& info = sg_dnsinfo_vec.at(i);
-
-        if (_host_name.empty() && info.dns == this) {
-            info.status = kGetIPCancel;
-        }
+    for (std::set<dnswaiter*>::iterator it = sg_dnswaiters.begin(); it != sg_dnswaiters.end(); ++it) {
+        dnswaiter& waiter = **it;
 
-        if (info.host_name.compare(_host_name) == 0 && info.dns == this) {
-            info.status = kGetIPCancel;
+        if (waiter.dns == this && (_host_name.empty() || waiter.host_name == _host_name)) {
+            waiter.status = kGetIPCancel;
         }
     }
 
@@ -312,3 +373,27 @@ void DNS::Cancel(DNSBreaker& _breaker) {
 
     sg_condition.notifyAll();
 }
+
+void DNS::SetCacheTime(uint64_t _ttl, uint64_t _negative_ttl, uint64_t _stale_time) {
+    ScopedLock lock(sg_mutex);
+    sg_cache_ttl = 0 == _ttl ? kDNSCacheTTL : _ttl;
+    sg_negative_ttl = 0 == _negative_ttl ? kDNSNegativeTTL : _negative_ttl;
+    sg_stale_time = 0 == _stale_time ? kDNSStaleTime : _stale_time;
+}
+
+void DNS::ClearCache() {
+    xinfo_function();
+    ScopedLock lock(sg_mutex);
+
+    for (std::map<dnskey, dnscache>::iterator it = sg_dnscache.begin(); it != sg_dnscache.end();) {
+        if (it->second.resolving || 0 < it->second.waiters) {
+            // the resolution in flight, or the one just done, still reports to its waiters. nobody else is answered from it.
+            it->second.cleared = it->second.resolving;
+            it->second.expire = 0;
+            it->second.stale_expire = 0;
+            ++it;
+        } else {
+            sg_dnscache.erase(it++);
+        }
+    }
+}
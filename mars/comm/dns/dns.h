@@ -21,6 +21,7 @@
 #ifndef COMM_COMM_DNS_H_
 #define COMM_COMM_DNS_H_
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,12 @@ struct DNSBreaker {
     }
 };
 
+/*
+ * Lookups share a process-wide cache keyed by (DNSFunc, host): a result lives its record ttl (kDNSCacheTTL when unknown),
+ * a failure kDNSNegativeTTL, and an expired result is still answered for kDNSStaleTime while one refresh runs behind it.
+ * Lookups of a host in flight wait on one resolution, done on a small resolver pool instead of a thread each.
+ * With no DNSFunc, the system servers are asked by DNSStubResolver, getaddrinfo is the fallback.
+ */
 class DNS {
   public:
    typedef std::vector<std::string> (*DNSFunc)(const std::string& host);
@@ -49,6 +56,10 @@ class DNS {
     bool GetHostByName(const std::string& _host_name, std::vector<std::string>& ips, long millsec = 2 * 1000, DNSBreaker* _breaker = NULL);
     void Cancel(const std::string& _host_name = std::string());
     void Cancel(DNSBreaker& _breaker);
+
+    static void ClearCache();   // when the network changes
+    // the ttl of a result without a record ttl, of a failure, and how long past its ttl a result is still answered, 0 for the default.
+    static void SetCacheTime(uint64_t _ttl, uint64_t _negative_ttl, uint64_t _stale_time);
     
     void SetMonitorFunc(const boost::function<void (int _key)>& _monitor_func) {
     	monitor_func_ = _monitor_func;
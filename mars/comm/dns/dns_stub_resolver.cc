@@ -0,0 +1,506 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * dns_stub_resolver.cc
+ *
+ *  Created on: 2026-10-18
+ */
+
+#include "dns/dns_stub_resolver.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+
+#include "boost/bind.hpp"
+
+#include "comm/socket/unix_socket.h"
+#include "comm/network/getdnssvraddrs.h"
+#include "comm/time_utils.h"
+#include "comm/xlogger/xlogger.h"
+
+static const uint64_t kRetryInterval = 400;        // then the next server is asked too
+static const uint64_t kResolutionDelay = 50;       // rfc 8305 5, how long one answer waits for the other
+static const size_t kMaxRounds = 2;                 // each server is asked this many times at most
+static const size_t kMaxMessageSize = 1500;         // no EDNS0, 512 by rfc 1035, but some servers send more
+
+static const uint16_t kTypeA = 1;
+static const uint16_t kTypeCNAME = 5;
+static const uint16_t kTypeAAAA = 28;
+static const uint16_t kClassIN = 1;
+
+enum {
+    kA,
+    kAAAA,
+    kTypeCount,
+};
+
+static const uint16_t sg_qtypes[kTypeCount] = {kTypeA, kTypeAAAA};
+
+struct DNSStubResolver::Query {
+    Query(): id(0), family(AF_UNSPEC), sock4(INVALID_SOCKET), sock6(INVALID_SOCKET), ttl(0xFFFFFFFF)
+        , sent(0), next_send(0), deadline(0), grace_end(0), cancelled(false) {
+        for (int i = 0; i < kTypeCount; ++i) {
+            qid[i] = 0;
+            pending[i] = false;
+            errors[i] = 0;
+        }
+    }
+
+    uint32_t id;
+    std::string host;
+    int family;
+    Callback callback;
+    mq::MessageHandler_t handler;
+    std::vector<socket_address> servers;
+
+    SOCKET sock4;
+    SOCKET sock6;
+
+    std::string packet[kTypeCount];
+    uint16_t qid[kTypeCount];
+    bool pending[kTypeCount];
+    size_t errors[kTypeCount];
+    std::vector<std::string> ips[kTypeCount];
+    uint32_t ttl;
+
+    size_t sent;
+    uint64_t next_send;
+    uint64_t deadline;
+    uint64_t grace_end;
+    bool cancelled;
+};
+
+static uint16_t __Read16(const uint8_t* _p) {
+    return (uint16_t)((_p[0] << 8) | _p[1]);
+}
+
+static uint32_t __Read32(const uint8_t* _p) {
+    return ((uint32_t)_p[0] << 24) | ((uint32_t)_p[1] << 16) | ((uint32_t)_p[2] << 8) | _p[3];
+}
+
+static void __Write16(std::string& _out, uint16_t _v) {
+    _out.push_back((char)(_v >> 8));
+    _out.push_back((char)(_v & 0xFF));
+}
+
+static uint16_t __RandomId() {
+    static Mutex s_mutex;
+    static std::mt19937 s_engine((unsigned int)(std::random_device()() ^ gettickcount()));
+    ScopedLock lock(s_mutex);
+    return (uint16_t)s_engine();
+}
+
+// rfc 1035 3.1, "www.qq.com" to "\3www\2qq\3com\0".
+static bool __EncodeName(const std::string& _host, std::string& _qname) {
+    _qname.clear();
+
+    size_t begin = 0;
+    while (begin < _host.size()) {
+        size_t end = _host.find('.', begin);
+        if (std::string::npos == end) end = _host.size();
+
+        size_t len = end - begin;
+        if (0 == len || 63 < len) return false;
+
+        _qname.push_back((char)len);
+        _qname.append(_host, begin, len);
+        begin = end + 1;
+    }
+
+    _qname.push_back('\0');
+    return 1 < _qname.size() && 255 >= _qname.size();
+}
+
+// compression pointers are followed in place, nothing of the message is copied.
+static bool __SkipName(const uint8_t* _msg, size_t _len, size_t& _offset) {
+    while (_offset < _len) {
+        uint8_t label = _msg[_offset];
+
+        if (0 == label) {
+            _offset += 1;
+            return true;
+        }
+
+        if (0xC0 == (label & 0xC0)) {
+            _offset += 2;
+            return _offset <= _len;
+        }
+
+        if (0 != (label & 0xC0)) return false;
+        _offset += 1 + label;
+    }
+
+    return false;
+}
+
+static bool __NameEqual(const uint8_t* _msg, size_t _len, size_t _offset, const std::string& _qname) {
+    size_t pos = 0;
+    int jumps = 0;
+
+    while (_offset < _len && pos < _qname.size()) {
+        uint8_t label = _msg[_offset];
+
+        if (0xC0 == (label & 0xC0)) {
+            if (_offset + 1 >= _len || 16 < ++jumps) return false;
+            _offset = ((label & 0x3F) << 8) | _msg[_offset + 1];
+            continue;
+        }
+
+        if (label != (uint8_t)_qname[pos]) return false;
+        if (0 == label) return true;
+        if (_offset + 1 + label > _len) return false;
+
+        for (uint8_t i = 1; i <= label; ++i) {
+            if (tolower(_msg[_offset + i]) != tolower((uint8_t)_qname[pos + i])) return false;
+        }
+
+        _offset += 1 + label;
+        pos += 1 + label;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////
+
+DNSStubResolver::DNSStubResolver(const std::vector<socket_address>& _servers)
+    : servers_(_servers)
+    , thread_(boost::bind(&DNSStubResolver::__Run, this), XLOGGER_TAG "::dns_stub")
+    , next_id_(0)
+    , stop_(false) {
+}
+
+DNSStubResolver::~DNSStubResolver() {
+    ScopedLock lock(mutex_);
+    stop_ = true;
+    breaker_.Break();
+    lock.unlock();
+
+    thread_.join();
+
+    for (std::list<Query*>::iterator it = queries_.begin(); it != queries_.end(); ++it) {
+        if (INVALID_SOCKET != (*it)->sock4) socket_close((*it)->sock4);
+        if (INVALID_SOCKET != (*it)->sock6) socket_close((*it)->sock6);
+        delete *it;
+    }
+    queries_.clear();
+}
+
+uint32_t DNSStubResolver::Resolve(const std::string& _host, int _family, long _timeout_ms, const Callback& _callback, const mq::MessageHandler_t& _handler) {
+    xverbose_function();
+
+    Query* query = new Query;
+    query->host = _host;
+    query->family = _family;
+    query->callback = _callback;
+    query->handler = _handler;
+
+    std::vector<socket_address> servers = servers_;
+    if (servers.empty()) mars::comm::getdnssvraddrs(servers);
+
+    for (std::vector<socket_address>::iterator it = servers.begin(); it != servers.end(); ++it) {
+        socket_address server = 0 == it->port() ? socket_address(it->isv6() ? it->ipv6() : it->ip(), 53) : *it;
+        // a local resolver, such as 127.0.0.53, is a server all the same.
+        if (server.valid_server_address(true)) query->servers.push_back(server);
+    }
+
+    std::string qname;
+    int status = kResolveOK;
+
+    if (query->servers.empty()) {
+        status = kResolveNoServer;
+    } else if (!__EncodeName(_host, qname)) {
+        xerror2(TSF"bad host name:%_", _host);
+        status = kResolveFail;
+    }
+
+    for (int i = 0; i < kTypeCount && kResolveOK == status; ++i) {
+        if (kAAAA == i && AF_INET == _family) continue;
+
+        // rfc 1035 4.1.1, recursion desired.
+        query->qid[i] = __RandomId();
+        query->pending[i] = true;
+        std::string& packet = query->packet[i];
+        __Write16(packet, query->qid[i]);
+        __Write16(packet, 0x0100);
+        __Write16(packet, 1);
+        __Write16(packet, 0);
+        __Write16(packet, 0);
+        __Write16(packet, 0);
+        packet.append(qname);
+        __Write16(packet, sg_qtypes[i]);
+        __Write16(packet, kClassIN);
+    }
+
+    ScopedLock lock(mutex_);
+    query->id = ++next_id_;
+    uint32_t id = query->id;
+
+    if (kResolveOK != status) {
+        __Finish(*query, status);
+        delete query;
+        return id;
+    }
+
+    query->deadline = gettickcount() + (uint64_t)_timeout_ms;
+    queries_.push_back(query);
+
+    thread_.start();
+    breaker_.Break();
+    return id;
+}
+
+void DNSStubResolver::Cancel(uint32_t _id) {
+    ScopedLock lock(mutex_);
+
+    for (std::list<Query*>::iterator it = queries_.begin(); it != queries_.end(); ++it) {
+        if (_id != (*it)->id) continue;
+
+        (*it)->cancelled = true;
+        breaker_.Break();
+        return;
+    }
+}
+
+void DNSStubResolver::__Run() {
+    SocketSelect sel(breaker_, true);
+    uint8_t buffer[kMaxMessageSize];
+
+    ScopedLock lock(mutex_);
+
+    while (!stop_) {
+        uint64_t now = gettickcount();
+        uint64_t wakeup = now + 60 * 1000;
+
+        for (std::list<Query*>::iterator it = queries_.begin(); it != queries_.end();) {
+            if (__Step(**it, now, wakeup)) {
+                delete *it;
+                it = queries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // sockets are only opened and closed on this thread, they stay valid through the select.
+        sel.PreSelect();
+        for (std::list<Query*>::iterator it = queries_.begin(); it != queries_.end(); ++it) {
+            if (INVALID_SOCKET != (*it)->sock4) sel.Read_FD_SET((*it)->sock4);
+            if (INVALID_SOCKET != (*it)->sock6) sel.Read_FD_SET((*it)->sock6);
+        }
+
+        lock.unlock();
+        int ret = sel.Select((int)(wakeup > now ? wakeup - now : 0));
+        lock.lock();
+
+        if (0 > ret) {
+            xerror2(TSF"select error:%_", sel.Errno());
+            continue;
+        }
+
+        now = gettickcount();
+
+        for (std::list<Query*>::iterator it = queries_.begin(); it != queries_.end(); ++it) {
+            Query& query = **it;
+            SOCKET socks[] = {query.sock4, query.sock6};
+
+            for (size_t i = 0; i < sizeof(socks) / sizeof(socks[0]); ++i) {
+                if (INVALID_SOCKET == socks[i] || !sel.Read_FD_ISSET(socks[i])) continue;
+
+                while (true) {
+                    sockaddr_storage from;
+                    socklen_t from_len = sizeof(from);
+                    int len = (int)recvfrom(socks[i], (char*)buffer, sizeof(buffer), 0, (sockaddr*)&from, &from_len);
+                    if (0 > len) break;
+
+                    __OnDatagram(query, buffer, (size_t)len, socket_address((sockaddr*)&from), now);
+                }
+            }
+        }
+    }
+}
+
+bool DNSStubResolver::__Step(Query& _query, uint64_t _now, uint64_t& _wakeup) {
+    if (_query.cancelled) {
+        __Finish(_query, kResolveFail);
+        return true;
+    }
+
+    bool answered = !_query.ips[kA].empty() || !_query.ips[kAAAA].empty();
+
+    if (!_query.pending[kA] && !_query.pending[kAAAA]) {
+        __Finish(_query, answered ? kResolveOK : kResolveFail);
+        return true;
+    }
+
+    if (0 != _query.grace_end && _now >= _query.grace_end) {
+        __Finish(_query, kResolveOK);
+        return true;
+    }
+
+    if (_now >= _query.deadline) {
+        __Finish(_query, answered ? kResolveOK : kResolveTimeout);
+        return true;
+    }
+
+    size_t max_send = _query.servers.size() * kMaxRounds;
+    if (_now >= _query.next_send && _query.sent < max_send) __Send(_query, _now);
+
+    _wakeup = std::min(_wakeup, _query.deadline);
+    if (_query.sent < max_send) _wakeup = std::min(_wakeup, _query.next_send);
+    if (0 != _query.grace_end) _wakeup = std::min(_wakeup, _query.grace_end);
+    return false;
+}
+
+void DNSStubResolver::__Send(Query& _query, uint64_t _now) {
+    size_t rounds = _query.sent / _query.servers.size();
+    const socket_address& server = _query.servers[_query.sent % _query.servers.size()];
+    ++_query.sent;
+    _query.next_send = _now + kRetryInterval * (1 + rounds);
+
+    SOCKET& sock = server.isv6() ? _query.sock6 : _query.sock4;
+
+    if (INVALID_SOCKET == sock) {
+        // a socket of its own per lookup, a random source port each.
+        sock = socket(server.isv6() ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+
+        if (INVALID_SOCKET != sock && 0 != socket_set_nobio(sock)) {
+            socket_close(sock);
+            sock = INVALID_SOCKET;
+        }
+    }
+
+    for (int i = 0; i < kTypeCount; ++i) {
+        if (!_query.pending[i]) continue;
+
+        if (INVALID_SOCKET == sock
+                || 0 > sendto(sock, _query.packet[i].data(), _query.packet[i].size(), 0, &server.address(), server.address_length())) {
+            xwarn2(TSF"send dns query fail, host:%_, server:%_, err:%_", _query.host, server.url(), socket_strerror(socket_errno));
+            ++_query.errors[i];
+            _query.next_send = _now;
+        }
+    }
+}
+
+void DNSStubResolver::__OnDatagram(Query& _query, const uint8_t* _msg, size_t _len, const socket_address& _from, uint64_t _now) {
+    if (12 > _len) return;
+
+    bool from_server = false;
+    for (std::vector<socket_address>::const_iterator it = _query.servers.begin(); it != _query.servers.end(); ++it) {
+        if (it->is_ipport_equal(_from)) from_server = true;
+    }
+    if (!from_server) return;
+
+    uint16_t id = __Read16(_msg);
+    uint16_t flags = __Read16(_msg + 2);
+    int type = kTypeCount;
+
+    for (int i = 0; i < kTypeCount; ++i) {
+        if (_query.pending[i] && id == _query.qid[i]) type = i;
+    }
+
+    // an answer, to the one question we asked.
+    if (kTypeCount == type || 0 == (flags & 0x8000) || 1 != __Read16(_msg + 4)) return;
+
+    size_t offset = 12;
+    std::string qname(_query.packet[type], 12, _query.packet[type].size() - 12 - 4);
+    if (!__NameEqual(_msg, _len, offset, qname) || !__SkipName(_msg, _len, offset) || offset + 4 > _len) return;
+    if (sg_qtypes[type] != __Read16(_msg + offset) || kClassIN != __Read16(_msg + offset + 2)) return;
+    offset += 4;
+
+    int rcode = flags & 0x000F;
+    bool truncated = 0 != (flags & 0x0200);
+    size_t max_send = _query.servers.size() * kMaxRounds;
+
+    // NXDOMAIN is the final word, a server in trouble (SERVFAIL, REFUSED) hands over to the next one.
+    if (3 != rcode && 0 != rcode) {
+        xwarn2(TSF"dns server:%_ rcode:%_, host:%_", _from.url(), rcode, _query.host);
+        if (++_query.errors[type] >= _query.sent && _query.sent >= max_send) _query.pending[type] = false;
+        _query.next_send = _now;
+        return;
+    }
+
+    std::vector<std::string> ips;
+    uint32_t ttl = _query.ttl;
+
+    for (uint16_t count = 0 == rcode ? __Read16(_msg + 6) : 0; 0 < count; --count) {
+        if (!__SkipName(_msg, _len, offset) || offset + 10 > _len) break;
+
+        uint16_t rtype = __Read16(_msg + offset);
+        uint16_t rclass = __Read16(_msg + offset + 2);
+        uint32_t rttl = __Read32(_msg + offset + 4);
+        uint16_t rdlength = __Read16(_msg + offset + 8);
+        offset += 10;
+
+        if (offset + rdlength > _len) break;    // cut by the truncation
+
+        // the records of the cname chain are all in the answer, the address ones are what we want.
+        if (kClassIN == rclass && kTypeCNAME == rtype) ttl = std::min(ttl, rttl);
+
+        if (kClassIN == rclass && kTypeA == rtype && kTypeA == sg_qtypes[type] && 4 == rdlength) {
+            in_addr addr;
+            memcpy(&addr, _msg + offset, sizeof(addr));
+
+            // In Indonesia, if there is no ipv6's ip, operators return 0.0.0.0.
+            if (INADDR_ANY != addr.s_addr && INADDR_NONE != addr.s_addr) {
+                ips.push_back(socket_address(addr).ip());
+                ttl = std::min(ttl, rttl);
+            }
+        }
+
+        if (kClassIN == rclass && kTypeAAAA == rtype && kTypeAAAA == sg_qtypes[type] && 16 == rdlength) {
+            in6_addr addr;
+            memcpy(&addr, _msg + offset, sizeof(addr));
+            ips.push_back(socket_address(addr).ip());
+            ttl = std::min(ttl, rttl);
+        }
+
+        offset += rdlength;
+    }
+
+    // no tcp retry: what a truncated answer holds is used, an empty one goes to the next server.
+    if (truncated && ips.empty()) {
+        xwarn2(TSF"dns server:%_ truncated, host:%_", _from.url(), _query.host);
+        if (++_query.errors[type] >= _query.sent && _query.sent >= max_send) _query.pending[type] = false;
+        _query.next_send = _now;
+        return;
+    }
+
+    _query.pending[type] = false;
+    _query.ips[type].swap(ips);
+    if (!_query.ips[type].empty()) _query.ttl = ttl;
+
+    int other = kA == type ? kAAAA : kA;
+    if (!_query.ips[type].empty() && _query.pending[other] && 0 == _query.grace_end) _query.grace_end = _now + kResolutionDelay;
+}
+
+void DNSStubResolver::__Finish(Query& _query, int _status) {
+    if (INVALID_SOCKET != _query.sock4) socket_close(_query.sock4);
+    if (INVALID_SOCKET != _query.sock6) socket_close(_query.sock6);
+    _query.sock4 = INVALID_SOCKET;
+    _query.sock6 = INVALID_SOCKET;
+
+    if (_query.cancelled) return;
+
+    std::vector<std::string> ips;
+    if (kResolveOK == _status) {
+        ips = _query.ips[kAAAA];
+        ips.insert(ips.end(), _query.ips[kA].begin(), _query.ips[kA].end());
+    }
+
+    xinfo2(TSF"dns stub resolved host:%_, status:%_, ips:%_, ttl:%_, sent:%_", _query.host, _status, ips.size(), _query.ttl, _query.sent);
+    mq::AsyncInvoke(boost::bind(_query.callback, _status, ips, kResolveOK == _status ? _query.ttl : 0), _query.handler);
+}
@@ -0,0 +1,85 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * dns_stub_resolver.h
+ *
+ *  Created on: 2026-10-18
+ */
+
+#ifndef COMM_DNS_DNS_STUB_RESOLVER_H_
+#define COMM_DNS_DNS_STUB_RESOLVER_H_
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "boost/function.hpp"
+
+#include "comm/messagequeue/message_queue.h"
+#include "comm/socket/socket_address.h"
+#include "comm/socket/socketselect.h"
+#include "comm/thread/lock.h"
+#include "comm/thread/thread.h"
+
+/*
+ * A non-blocking stub resolver: the A and AAAA queries of a lookup go out together over UDP, one thread
+ * waits on the sockets of every lookup. A server that has not answered in kRetryInterval is raced by the next one,
+ * and an AAAA answer waits no more than kResolutionDelay for the A answer (or the other way round).
+ * The result is posted to the message queue of the caller, it is all the callback runs on.
+ */
+class DNSStubResolver {
+  public:
+    enum {
+        kResolveOK,
+        kResolveFail,       // every server said no (NXDOMAIN or no record), or the lookup can't be sent
+        kResolveTimeout,
+        kResolveNoServer,
+    };
+
+    // _ttl: the least of the records, in seconds.
+    typedef boost::function<void (int _status, const std::vector<std::string>& _ips, uint32_t _ttl)> Callback;
+
+    // no _servers: ask getdnssvraddrs for every lookup.
+    DNSStubResolver(const std::vector<socket_address>& _servers = std::vector<socket_address>());
+    ~DNSStubResolver();
+
+    // _family: AF_INET for A only, AF_UNSPEC for both, AAAA listed first. returns the id for Cancel.
+    uint32_t Resolve(const std::string& _host, int _family, long _timeout_ms, const Callback& _callback, const mq::MessageHandler_t& _handler);
+    void Cancel(uint32_t _id);      // the callback doesn't come, unless it is posted already
+
+  public:
+    struct Query;
+
+  private:
+    void __Run();
+    bool __Step(Query& _query, uint64_t _now, uint64_t& _wakeup);
+    void __Send(Query& _query, uint64_t _now);
+    void __OnDatagram(Query& _query, const uint8_t* _msg, size_t _len, const socket_address& _from, uint64_t _now);
+    void __Finish(Query& _query, int _status);
+
+  private:
+    DNSStubResolver(const DNSStubResolver&);
+    DNSStubResolver& operator=(const DNSStubResolver&);
+
+  private:
+    std::vector<socket_address> servers_;
+    Thread thread_;
+    Mutex mutex_;
+    SocketBreaker breaker_;
+    std::list<Query*> queries_;
+    uint32_t next_id_;
+    bool stop_;
+};
+
+#endif /* COMM_DNS_DNS_STUB_RESOLVER_H_ */
@@ -19,7 +19,9 @@
  */
 
 #include <map>
+#include <set>
 #include <list>
+#include <vector>
 #include <string>
 #include <algorithm>
 #ifndef _WIN32
@@ -30,8 +32,10 @@
 #include "boost/bind.hpp"
 
 #include "comm/thread/lock.h"
+#include "comm/thread/atomic_oper.h"
 #include "comm/anr.h"
 #include "comm/messagequeue/message_queue.h"
+#include "comm/messagequeue/task_pool.h"
 #include "comm/time_utils.h"
 #include "comm/bootrun.h"
 #ifdef __APPLE__
@@ -49,23 +53,22 @@ namespace MessageQueue {
 #define MAX_MQ_SIZE 5000
 
 static unsigned int __MakeSeq() {
-    static unsigned int s_seq = 0;
+    static uint32_t s_seq = 0;
 
-    return ++s_seq;
+    // queues are locked separately, posts to different queues may get here together.
+    return atomic_inc32(&s_seq) + 1;
 }
 
 struct MessageWrapper {
     MessageWrapper(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing, unsigned int _seq)
         : message(_message), timing(_timing) {
-        postid.reg = _handlerid;
-        postid.seq = _seq;
-        periodstatus = kImmediately;
-        record_time = 0;
+        __Init(_handlerid, _seq);
+    }
 
-        if (kImmediately != _timing.type) {
-            periodstatus = kAfter;
-            record_time = ::gettickcount();
-        }
+    MessageWrapper(const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name,
+                   const MessageTiming& _timing, unsigned int _seq)
+        : message(_title, boost::any(), boost::any(), _name), task(std::move(_task)), timing(_timing) {
+        __Init(_handlerid, _seq);
     }
 
     ~MessageWrapper() {
@@ -75,11 +78,44 @@ struct MessageWrapper {
 
     MessagePost_t postid;
     Message message;
+    MessageTask task;       // set for PostTask, then run instead of the handler
 
     MessageTiming timing;
     TMessageTiming periodstatus;
     uint64_t record_time;
     boost::shared_ptr<Condition> wait_end_cond;
+
+    uint64_t deadline;      // tick count to run at, for kAfter and kPeriod
+    uint64_t order;         // post order in the queue, messages due together run in it
+    size_t heap_index;
+    MessageWrapper* list_prev;      // links of the immediate FIFO
+    MessageWrapper* list_next;
+    MessageWrapper* index_next;     // chain of the seq index bucket
+
+  private:
+    void __Init(const MessageHandler_t& _handlerid, unsigned int _seq) {
+        deadline = 0;
+        order = 0;
+        heap_index = 0;
+        list_prev = NULL;
+        list_next = NULL;
+        index_next = NULL;
+
+        postid.reg = _handlerid;
+        postid.seq = _seq;
+        periodstatus = kImmediately;
+        record_time = 0;
+
+        if (kImmediately != timing.type) {
+            periodstatus = kAfter;
+            record_time = ::gettickcount();
+            deadline = record_time + (0 < timing.after ? timing.after : 0);
+        }
+    }
+
+  private:
+    MessageWrapper(const MessageWrapper&);
+    MessageWrapper& operator=(const MessageWrapper&);
 };
 
 struct HandlerWrapper {
@@ -100,7 +136,7 @@ struct RunLoopInfo {
     boost::shared_ptr<Condition> runing_cond;
     MessagePost_t runing_message_id;
     Message* runing_message;
-    std::list <MessageHandler_t> runing_handler;
+    std::vector<MessageHandler_t> runing_handler;
 };
     
 class Cond : public RunloopCond {
@@ -127,90 +163,392 @@ private:
     Condition cond_;
 };
     
+/*
+ * Immediate messages wait in a FIFO, kAfter and kPeriod ones in a min-heap on their deadline,
+ * so the runloop doesn't walk every pending timer to find the next message.
+ * Messages are also indexed by post seq for WaitMessage and CancelMessage.
+ *
+ * The FIFO and the index are intrusive and wrapper memory is recycled, so once warmed up a post allocates nothing here.
+ */
 struct MessageQueueContent {
-    MessageQueueContent(): breakflag(false) {}
+    MessageQueueContent(): breakflag(false), released(false), message_head(NULL), message_tail(NULL), message_count(0)
+        , index_buckets(kMinIndexBuckets, (MessageWrapper*)NULL), index_size(0), next_order(0), free_wrappers(NULL), free_count(0) {}
 
-#if defined(ANDROID)
-    MessageQueueContent(const MessageQueueContent&): breakflag(false) { /*ASSERT(false);*/ }
-#endif
+    ~MessageQueueContent() {
+        ForEachMessage([this](MessageWrapper* _wrapper) { DeleteMessage(_wrapper); });
+
+        for (std::list<HandlerWrapper*>::iterator it = lst_handler.begin(); it != lst_handler.end(); ++it) {
+            delete(*it);
+        }
+
+        while (NULL != free_wrappers) {
+            FreeWrapper* next = free_wrappers->next;
+            ::operator delete(free_wrappers);
+            free_wrappers = next;
+        }
+    }
 
+    // memory for a MessageWrapper, construct with placement new and release with DeleteMessage.
+    void* AllocMessage() {
+        if (NULL == free_wrappers) return ::operator new(sizeof(MessageWrapper));
+
+        FreeWrapper* wrapper = free_wrappers;
+        free_wrappers = wrapper->next;
+        --free_count;
+        return wrapper;
+    }
+
+    void FreeMessage(void* _memory) {
+        if (free_count >= kMaxFreeWrappers) {
+            ::operator delete(_memory);
+            return;
+        }
+
+        FreeWrapper* wrapper = (FreeWrapper*)_memory;
+        wrapper->next = free_wrappers;
+        free_wrappers = wrapper;
+        ++free_count;
+    }
+
+    void DeleteMessage(MessageWrapper* _message) {
+        _message->~MessageWrapper();
+        FreeMessage(_message);
+    }
+
+    size_t MessageSize() const { return message_count + timer_heap.size(); }
+
+    void AddMessage(MessageWrapper* _message) {
+        _message->order = ++next_order;
+        __IndexInsert(_message);
+
+        if (kImmediately == _message->timing.type) {
+            _message->list_prev = message_tail;
+            _message->list_next = NULL;
+            if (NULL != message_tail) message_tail->list_next = _message;
+            else message_head = _message;
+            message_tail = _message;
+            ++message_count;
+        } else {
+            __PushTimer(_message);
+        }
+    }
+
+    void RemoveMessage(MessageWrapper* _message) {
+        __IndexErase(_message);
+
+        if (kImmediately == _message->timing.type) {
+            if (NULL != _message->list_prev) _message->list_prev->list_next = _message->list_next;
+            else message_head = _message->list_next;
+            if (NULL != _message->list_next) _message->list_next->list_prev = _message->list_prev;
+            else message_tail = _message->list_prev;
+            _message->list_prev = NULL;
+            _message->list_next = NULL;
+            --message_count;
+        } else {
+            __RemoveTimer(_message);
+        }
+    }
+
+    MessageWrapper* FindMessage(const MessagePost_t& _postid) const {
+        for (MessageWrapper* it = index_buckets[_postid.seq & (index_buckets.size() - 1)]; NULL != it; it = it->index_next) {
+            if (_postid.seq == it->postid.seq) return _postid == it->postid ? it : NULL;
+        }
+        return NULL;
+    }
+
+    // the next message to run, or NULL with _wait_time set to the time before the nearest timer.
+    MessageWrapper* PopMessage(uint64_t _now, int64_t& _wait_time, bool& _delmessage) {
+        MessageWrapper* timer = timer_heap.empty() ? NULL : timer_heap.front();
+        bool timer_due = NULL != timer && timer->deadline <= _now;
+
+        if (NULL != message_head && (!timer_due || message_head->order < timer->order)) {
+            MessageWrapper* message = message_head;
+            RemoveMessage(message);
+            _delmessage = true;
+            return message;
+        }
+
+        if (!timer_due) {
+            if (NULL != timer) _wait_time = std::min(_wait_time, (int64_t)(timer->deadline - _now));
+            return NULL;
+        }
+
+        if (kAfter == timer->timing.type) {
+            RemoveMessage(timer);
+            _delmessage = true;
+            return timer;
+        }
+
+        // a period message stays in the queue and runs again one period after this run.
+        __RemoveTimer(timer);
+        timer->record_time = _now;
+        timer->periodstatus = kPeriod;
+        timer->deadline = _now + (0 < timer->timing.period ? timer->timing.period : 0);
+        timer->order = ++next_order;
+        __PushTimer(timer);
+        _delmessage = false;
+        return timer;
+    }
+
+    void ClearMessages() {
+        message_head = NULL;
+        message_tail = NULL;
+        message_count = 0;
+        timer_heap.clear();
+        std::fill(index_buckets.begin(), index_buckets.end(), (MessageWrapper*)NULL);
+        index_size = 0;
+    }
+
+    // _func may delete the message it is given, but must not add or remove others.
+    template <typename F>
+    void ForEachMessage(F _func) const {
+        for (size_t i = 0; i < index_buckets.size(); ++i) {
+            MessageWrapper* it = index_buckets[i];
+            while (NULL != it) {
+                MessageWrapper* next = it->index_next;
+                _func(it);
+                it = next;
+            }
+        }
+    }
+
+    Mutex mutex;    // guards everything below, each queue has its own
     MessageHandler_t invoke_reg;
     bool breakflag;
+    bool released;  // the runloop has exited, a late post must not land here
     boost::shared_ptr<RunloopCond> breaker;
-    std::list<MessageWrapper*> lst_message;
+    MessageWrapper* message_head;
+    MessageWrapper* message_tail;
+    size_t message_count;
+    std::vector<MessageWrapper*> timer_heap;
+    std::vector<MessageWrapper*> index_buckets;     // seq -> message, the size is a power of 2
+    size_t index_size;
+    uint64_t next_order;
     std::list<HandlerWrapper*> lst_handler;
     
     std::list<RunLoopInfo> lst_runloop_info;
     
 private:
-    void operator=(const MessageQueueContent&);
-    
-#if !defined(ANDROID)
+    static const size_t kMinIndexBuckets = 64;
+    static const size_t kMaxFreeWrappers = 64;
+
+    struct FreeWrapper {
+        FreeWrapper* next;
+    };
+
+    FreeWrapper* free_wrappers;
+    size_t free_count;
+
+private:
     MessageQueueContent(const MessageQueueContent&);
-#endif
+    void operator=(const MessageQueueContent&);
+
+    // seqs are handed out in order, so the low bits spread them over the buckets evenly.
+    void __IndexInsert(MessageWrapper* _message) {
+        if (index_size >= index_buckets.size()) __IndexRehash(index_buckets.size() * 2);
+
+        MessageWrapper*& bucket = index_buckets[_message->postid.seq & (index_buckets.size() - 1)];
+        _message->index_next = bucket;
+        bucket = _message;
+        ++index_size;
+    }
+
+    void __IndexErase(MessageWrapper* _message) {
+        MessageWrapper** it = &index_buckets[_message->postid.seq & (index_buckets.size() - 1)];
+        while (NULL != *it && _message != *it) it = &(*it)->index_next;
+
+        ASSERT(NULL != *it);
+        if (NULL == *it) return;
+
+        *it = _message->index_next;
+        _message->index_next = NULL;
+        --index_size;
+    }
+
+    void __IndexRehash(size_t _bucket_count) {
+        std::vector<MessageWrapper*> buckets(_bucket_count, (MessageWrapper*)NULL);
+
+        for (size_t i = 0; i < index_buckets.size(); ++i) {
+            MessageWrapper* it = index_buckets[i];
+            while (NULL != it) {
+                MessageWrapper* next = it->index_next;
+                MessageWrapper*& bucket = buckets[it->postid.seq & (_bucket_count - 1)];
+                it->index_next = bucket;
+                bucket = it;
+                it = next;
+            }
+        }
+
+        index_buckets.swap(buckets);
+    }
+
+    static bool __Before(const MessageWrapper* _l, const MessageWrapper* _r) {
+        return _l->deadline != _r->deadline ? _l->deadline < _r->deadline : _l->order < _r->order;
+    }
+
+    void __SetTimer(size_t _index, MessageWrapper* _message) {
+        timer_heap[_index] = _message;
+        _message->heap_index = _index;
+    }
+
+    void __SiftUp(size_t _index) {
+        MessageWrapper* message = timer_heap[_index];
+        while (0 < _index && __Before(message, timer_heap[(_index - 1) / 2])) {
+            __SetTimer(_index, timer_heap[(_index - 1) / 2]);
+            _index = (_index - 1) / 2;
+        }
+        __SetTimer(_index, message);
+    }
+
+    void __SiftDown(size_t _index) {
+        MessageWrapper* message = timer_heap[_index];
+        size_t size = timer_heap.size();
+        while (true) {
+            size_t child = _index * 2 + 1;
+            if (child >= size) break;
+            if (child + 1 < size && __Before(timer_heap[child + 1], timer_heap[child])) ++child;
+            if (!__Before(timer_heap[child], message)) break;
+            __SetTimer(_index, timer_heap[child]);
+            _index = child;
+        }
+        __SetTimer(_index, message);
+    }
+
+    void __PushTimer(MessageWrapper* _message) {
+        timer_heap.push_back(_message);
+        __SiftUp(timer_heap.size() - 1);
+    }
+
+    void __RemoveTimer(MessageWrapper* _message) {
+        size_t index = _message->heap_index;
+        ASSERT(index < timer_heap.size() && _message == timer_heap[index]);
+
+        MessageWrapper* last = timer_heap.back();
+        timer_heap.pop_back();
+        if (last == _message) return;
+
+        __SetTimer(index, last);
+        if (0 < index && __Before(last, timer_heap[(index - 1) / 2])) {
+            __SiftUp(index);
+        } else {
+            __SiftDown(index);
+        }
+    }
+
 };
 
-#define sg_messagequeue_map_mutex messagequeue_map_mutex()
-static Mutex& messagequeue_map_mutex() {
-    static Mutex* mutex = new Mutex;
-    return *mutex;
-}
-#define sg_messagequeue_map messagequeue_map()
-static std::map<MessageQueue_t, MessageQueueContent>& messagequeue_map() {
-    static std::map<MessageQueue_t, MessageQueueContent>* mq_map = new std::map<MessageQueue_t, MessageQueueContent>;
-    return *mq_map;
+/*
+ * Queue id -> content, split into shards so that lookups for different queues rarely take the same lock.
+ * The shard lock is only held for the lookup, the caller keeps the content alive and then locks the content itself.
+ */
+class MessageQueueTable {
+  public:
+    boost::shared_ptr<MessageQueueContent> Find(const MessageQueue_t& _id) {
+        Shard& shard = __GetShard(_id);
+        ScopedLock lock(shard.mutex);
+
+        std::map<MessageQueue_t, boost::shared_ptr<MessageQueueContent> >::iterator pos = shard.contents.find(_id);
+        if (shard.contents.end() == pos) return boost::shared_ptr<MessageQueueContent>();
+        return pos->second;
+    }
+
+    bool Contains(const MessageQueue_t& _id) {
+        Shard& shard = __GetShard(_id);
+        ScopedLock lock(shard.mutex);
+        return shard.contents.end() != shard.contents.find(_id);
+    }
+
+    // keeps the existing content if the queue was created already.
+    bool Insert(const MessageQueue_t& _id, const boost::shared_ptr<MessageQueueContent>& _content) {
+        Shard& shard = __GetShard(_id);
+        ScopedLock lock(shard.mutex);
+        return shard.contents.insert(std::make_pair(_id, _content)).second;
+    }
+
+    void Erase(const MessageQueue_t& _id, const MessageQueueContent* _content) {
+        Shard& shard = __GetShard(_id);
+        ScopedLock lock(shard.mutex);
+
+        std::map<MessageQueue_t, boost::shared_ptr<MessageQueueContent> >::iterator pos = shard.contents.find(_id);
+        if (shard.contents.end() != pos && _content == pos->second.get()) shard.contents.erase(pos);
+    }
+
+  private:
+    static const size_t kShardCount = 16;
+
+    struct Shard {
+        Mutex mutex;
+        std::map<MessageQueue_t, boost::shared_ptr<MessageQueueContent> > contents;
+        char padding[64];   // keeps neighbouring shard locks off one cache line
+    };
+
+    Shard& __GetShard(const MessageQueue_t& _id) {
+        // queue ids are thread ids, whose low bits are often aligned.
+        uint64_t hash = (uint64_t)_id;
+        hash ^= hash >> 17;
+        hash *= 0x9E3779B97F4A7C15ULL;
+        return shards_[(hash >> 32) % kShardCount];
+    }
+
+  private:
+    Shard shards_[kShardCount];
+};
+
+#define sg_messagequeue_table messagequeue_table()
+static MessageQueueTable& messagequeue_table() {
+    static MessageQueueTable* mq_table = new MessageQueueTable;
+    return *mq_table;
 }
 
 
-static std::string DumpMessage(const std::list<MessageWrapper*>& _message_lst) {
+static std::string DumpMessage(const MessageQueueContent& _content) {
     XMessage xmsg;
-    xmsg(TSF"**************Dump MQ Message**************size:%_\n", _message_lst.size());
+    xmsg(TSF"**************Dump MQ Message**************size:%_\n", _content.MessageSize());
     int index = 0;
-    for (auto msg : _message_lst) {
+    _content.ForEachMessage([&xmsg, &index](const MessageWrapper* msg) {
+        if (index++ > 50) return;
         xmsg(TSF"postid:%_, timing:%_, record_time:%_, message:%_\n", msg->postid.ToString(), msg->timing.ToString(), msg->record_time, msg->message.ToString());
-        if (++index>50)
-            break;
-    }
+    });
     return xmsg.String();
 }
 std::string DumpMQ(const MessageQueue_t& _msq_queue_id) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _msq_queue_id;
     
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         //ASSERT2(false, "%" PRIu64, id);
         xinfo2(TSF"message queue not found.");
         return "";
     }
     
-    MessageQueueContent& content = pos->second;
-    return DumpMessage(content.lst_message);
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    return DumpMessage(content);
 }
 
 MessageQueue_t CurrentThreadMessageQueue() {
-    ScopedLock lock(sg_messagequeue_map_mutex);
+    TaskPool* pool = TaskPool::Current();
+    if (NULL != pool) return pool->Id();
+
     MessageQueue_t id = (MessageQueue_t)ThreadUtil::currentthreadid();
 
-    if (sg_messagequeue_map.end() == sg_messagequeue_map.find(id)) id = KInvalidQueueID;
+    if (!sg_messagequeue_table.Contains(id)) id = KInvalidQueueID;
 
     return id;
 }
 
 MessageQueue_t TID2MessageQueue(thread_tid _tid) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     MessageQueue_t id = (MessageQueue_t)_tid;
 
-    if (sg_messagequeue_map.end() == sg_messagequeue_map.find(id))id = KInvalidQueueID;
+    if (!sg_messagequeue_table.Contains(id)) id = KInvalidQueueID;
 
     return id;
 }
     
 thread_tid  MessageQueue2TID(MessageQueue_t _id) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     MessageQueue_t& id = _id;
     
-    if (sg_messagequeue_map.end() == sg_messagequeue_map.find(id)) return 0;
+    if (!sg_messagequeue_table.Contains(id)) return 0;
     
     return (thread_tid)id;
 }
@@ -218,12 +556,18 @@ thread_tid  MessageQueue2TID(MessageQueue_t _id) {
 void WaitForRunningLockEnd(const MessagePost_t&  _message) {
     if (Handler2Queue(Post2Handler(_message)) == CurrentThreadMessageQueue()) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = Handler2Queue(Post2Handler(_message));
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return;
-    MessageQueueContent& content = pos->second;
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        pool->Wait(_message, -1);
+        return;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
     
     if (content.lst_runloop_info.empty()) return;
     
@@ -238,13 +582,15 @@ void WaitForRunningLockEnd(const MessagePost_t&  _message) {
 
 void WaitForRunningLockEnd(const MessageQueue_t&  _messagequeueid) {
     if (_messagequeueid == CurrentThreadMessageQueue()) return;
+    // a pool has no single running message.
+    if (NULL != TaskPool::Find(_messagequeueid)) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _messagequeueid;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return;
-    MessageQueueContent& content = pos->second;
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
 
     if (content.lst_runloop_info.empty()) return;
     if (KNullPost == content.lst_runloop_info.front().runing_message_id) return;
@@ -256,12 +602,18 @@ void WaitForRunningLockEnd(const MessageQueue_t&  _messagequeueid) {
 void WaitForRunningLockEnd(const MessageHandler_t&  _handler) {
     if (Handler2Queue(_handler) == CurrentThreadMessageQueue()) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = Handler2Queue(_handler);
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) { return; }
-    MessageQueueContent& content = pos->second;
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        pool->WaitForRunningEnd(_handler);
+        return;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) { return; }
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
     if (content.lst_runloop_info.empty()) return;
 
     for(auto& i : content.lst_runloop_info) {
@@ -277,34 +629,45 @@ void WaitForRunningLockEnd(const MessageHandler_t&  _handler) {
 
 void BreakMessageQueueRunloop(const MessageQueue_t&  _messagequeueid) {
     ASSERT(0 != _messagequeueid);
+    ASSERT2(NULL == TaskPool::Find(_messagequeueid), "use ReleaseTaskPool");
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _messagequeueid;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         //ASSERT2(false, "%llu", (unsigned long long)id);
         return;
     }
 
-    pos->second.breakflag = true;
-    pos->second.breaker->Notify(lock);
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    content.breakflag = true;
+    content.breaker->Notify(lock);
 }
 
 MessageHandler_t InstallMessageHandler(const MessageHandler& _handler, bool _recvbroadcast, const MessageQueue_t& _messagequeueid) {
     ASSERT(bool(_handler));
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _messagequeueid;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        ASSERT2(!_recvbroadcast, "task pool has no broadcast");
+        return pool->InstallHandler(_handler);
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         ASSERT2(false, "%llu", (unsigned long long)id);
         return KNullHandler;
     }
 
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullHandler;
+
     HandlerWrapper* handler = new HandlerWrapper(_handler, _recvbroadcast, _messagequeueid, __MakeSeq());
-    pos->second.lst_handler.push_back(handler);
+    content.lst_handler.push_back(handler);
     return handler->reg;
 }
 
@@ -314,13 +677,19 @@ void UnInstallMessageHandler(const MessageHandler_t& _handlerid) {
 
     if (0 == _handlerid.queue || 0 == _handlerid.seq) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return;
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        pool->UnInstallHandler(_handlerid);
+        return;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return;
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
 
     for (std::list<HandlerWrapper*>::iterator it = content.lst_handler.begin(); it != content.lst_handler.end(); ++it) {
         if (_handlerid == (*it)->reg) {
@@ -332,78 +701,127 @@ void UnInstallMessageHandler(const MessageHandler_t& _handlerid) {
 }
 
 MessagePost_t PostMessage(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) return pool->Post(_handlerid, _message, _timing);
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         //ASSERT2(false, "%" PRIu64, id);
         return KNullPost;
     }
 
-    MessageQueueContent& content = pos->second;
-    if(content.lst_message.size() >= MAX_MQ_SIZE) {
-        xwarn2(TSF"%_", DumpMessage(content.lst_message));
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullPost;
+    if(content.MessageSize() >= MAX_MQ_SIZE) {
+        xwarn2(TSF"%_", DumpMessage(content));
         ASSERT2(false, "Over MAX_MQ_SIZE");
         return KNullPost;
     }
 
-    MessageWrapper* messagewrapper = new MessageWrapper(_handlerid, _message, _timing, __MakeSeq());
+    MessageWrapper* messagewrapper = new (content.AllocMessage()) MessageWrapper(_handlerid, _message, _timing, __MakeSeq());
 
-    content.lst_message.push_back(messagewrapper);
+    content.AddMessage(messagewrapper);
     content.breaker->Notify(lock);
     return messagewrapper->postid;
 }
 
+MessagePost_t PostTask(const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name, const MessageTiming& _timing) {
+    ASSERT(bool(_task));
+    ASSERT2(kPeriod != _timing.type, "PostTask doesn't support kPeriod");
+    if (kPeriod == _timing.type) return KNullPost;
+
+    const MessageQueue_t& id = _handlerid.queue;
+
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) return pool->Post(_handlerid, std::move(_task), _title, _name, _timing);
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return KNullPost;
+
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullPost;
+    if(content.MessageSize() >= MAX_MQ_SIZE) {
+        xwarn2(TSF"%_", DumpMessage(content));
+        ASSERT2(false, "Over MAX_MQ_SIZE");
+        return KNullPost;
+    }
+
+    MessageWrapper* messagewrapper = new (content.AllocMessage()) MessageWrapper(_handlerid, std::move(_task), _title, _name, _timing, __MakeSeq());
+
+    content.AddMessage(messagewrapper);
+    content.breaker->Notify(lock);
+    return messagewrapper->postid;
+}
+
+static MessageWrapper* __FindMessage(const MessageQueueContent& _content, const MessageHandler_t& _handlerid, const Message& _message) {
+    MessageWrapper* found = NULL;
+    _content.ForEachMessage([&](MessageWrapper* _wrapper) {
+        if (NULL == found && _wrapper->postid.reg == _handlerid && _wrapper->message == _message) found = _wrapper;
+    });
+    return found;
+}
+
 MessagePost_t SingletonMessage(bool _replace, const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return KNullPost;
+    if (NULL != TaskPool::Find(id)) {
+        ASSERT2(false, "not supported by task pool");
+        return KNullPost;
+    }
 
-    MessageQueueContent& content = pos->second;
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return KNullPost;
+
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullPost;
 
     MessagePost_t post_id;
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-        if ((*it)->postid.reg == _handlerid && (*it)->message == _message) {
-            if (_replace) {
-                post_id = (*it)->postid;
-                delete(*it);
-                content.lst_message.erase(it);
-                break;
-            } else {
-                return (*it)->postid;
-            }
-        }
+    MessageWrapper* exist = __FindMessage(content, _handlerid, _message);
+    if (NULL != exist) {
+        if (!_replace) return exist->postid;
+
+        post_id = exist->postid;
+        content.RemoveMessage(exist);
+        content.DeleteMessage(exist);
     }
     
-    if(content.lst_message.size() >= MAX_MQ_SIZE) {
-        xwarn2(TSF"%_", DumpMessage(content.lst_message));
+    if(content.MessageSize() >= MAX_MQ_SIZE) {
+        xwarn2(TSF"%_", DumpMessage(content));
         ASSERT2(false, "Over MAX_MQ_SIZE");
         return KNullPost;
     }
 
-    MessageWrapper* messagewrapper = new MessageWrapper(_handlerid, _message, _timing, 0 != post_id.seq ? post_id.seq : __MakeSeq());
-    content.lst_message.push_back(messagewrapper);
+    MessageWrapper* messagewrapper = new (content.AllocMessage()) MessageWrapper(_handlerid, _message, _timing, 0 != post_id.seq ? post_id.seq : __MakeSeq());
+    content.AddMessage(messagewrapper);
     content.breaker->Notify(lock);
     return messagewrapper->postid;
 }
 
 MessagePost_t BroadcastMessage(const MessageQueue_t& _messagequeueid,  const Message& _message, const MessageTiming& _timing) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _messagequeueid;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    if (NULL != TaskPool::Find(id)) {
+        ASSERT2(false, "not supported by task pool");
+        return KNullPost;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         ASSERT2(false, "%" PRIu64, id);
         return KNullPost;
     }
 
-    MessageQueueContent& content = pos->second;
-    if(content.lst_message.size() >= MAX_MQ_SIZE) {
-        xwarn2(TSF"%_", DumpMessage(content.lst_message));
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullPost;
+    if(content.MessageSize() >= MAX_MQ_SIZE) {
+        xwarn2(TSF"%_", DumpMessage(content));
         ASSERT2(false, "Over MAX_MQ_SIZE");
         return KNullPost;
     }
@@ -411,9 +829,9 @@ MessagePost_t BroadcastMessage(const MessageQueue_t& _messagequeueid,  const Mes
     MessageHandler_t reg;
     reg.queue = _messagequeueid;
     reg.seq = 0;
-    MessageWrapper* messagewrapper = new MessageWrapper(reg, _message, _timing, __MakeSeq());
+    MessageWrapper* messagewrapper = new (content.AllocMessage()) MessageWrapper(reg, _message, _timing, __MakeSeq());
 
-    content.lst_message.push_back(messagewrapper);
+    content.AddMessage(messagewrapper);
     content.breaker->Notify(lock);
     return messagewrapper->postid;
 }
@@ -440,37 +858,41 @@ static int64_t __ComputerWaitTime(const MessageWrapper& _wrap) {
 }
 
 MessagePost_t FasterMessage(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return KNullPost;
+    if (NULL != TaskPool::Find(id)) {
+        ASSERT2(false, "not supported by task pool");
+        return KNullPost;
+    }
 
-    MessageQueueContent& content = pos->second;
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return KNullPost;
 
-    MessageWrapper* messagewrapper = new MessageWrapper(_handlerid, _message, _timing, __MakeSeq());
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return KNullPost;
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-        if ((*it)->postid.reg == _handlerid && (*it)->message == _message) {
-            if (__ComputerWaitTime(**it) < __ComputerWaitTime(*messagewrapper)) {
-                delete messagewrapper;
-                return (*it)->postid;
-            }
+    MessageWrapper* messagewrapper = new (content.AllocMessage()) MessageWrapper(_handlerid, _message, _timing, __MakeSeq());
 
-            messagewrapper->postid = (*it)->postid;
-            delete(*it);
-            content.lst_message.erase(it);
-            break;
+    MessageWrapper* exist = __FindMessage(content, _handlerid, _message);
+    if (NULL != exist) {
+        if (__ComputerWaitTime(*exist) < __ComputerWaitTime(*messagewrapper)) {
+            content.DeleteMessage(messagewrapper);
+            return exist->postid;
         }
+
+        messagewrapper->postid = exist->postid;
+        content.RemoveMessage(exist);
+        content.DeleteMessage(exist);
     }
 
-    if(content.lst_message.size() >= MAX_MQ_SIZE) {
-        xwarn2(TSF"%_", DumpMessage(content.lst_message));
+    if(content.MessageSize() >= MAX_MQ_SIZE) {
+        xwarn2(TSF"%_", DumpMessage(content));
         ASSERT2(false, "Over MAX_MQ_SIZE");
-        delete messagewrapper;
+        content.DeleteMessage(messagewrapper);
         return KNullPost;
     }
-    content.lst_message.push_back(messagewrapper);
+    content.AddMessage(messagewrapper);
     content.breaker->Notify(lock);
     return messagewrapper->postid;
 }
@@ -478,18 +900,23 @@ MessagePost_t FasterMessage(const MessageHandler_t& _handlerid, const Message& _
 bool WaitMessage(const MessagePost_t& _message, long _timeoutInMs) {
     bool is_in_mq = Handler2Queue(Post2Handler(_message)) == CurrentThreadMessageQueue();
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = Handler2Queue(Post2Handler(_message));
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return false;
-    MessageQueueContent& content = pos->second;
-
-    auto find_it = std::find_if(content.lst_message.begin(), content.lst_message.end(),
-                                [&_message](const MessageWrapper * const &_v) {
-                                    return _message == _v->postid;
-                                });
-    
-    if (find_it == content.lst_message.end()) {
+
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        // a worker can't spin a runloop for it, but the other workers keep going.
+        return pool->Wait(_message, _timeoutInMs);
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return false;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    if (content.released) return false;
+
+    MessageWrapper* wrapper = content.FindMessage(_message);
+
+    if (NULL == wrapper) {
         auto find_it = std::find_if(content.lst_runloop_info.begin(), content.lst_runloop_info.end(),
                      [&_message](const RunLoopInfo& _v){ return _message == _v.runing_message_id; });
         
@@ -508,18 +935,14 @@ bool WaitMessage(const MessagePost_t& _message, long _timeoutInMs) {
         
         if (is_in_mq) {
             lock.unlock();
-            RunLoop( [&_message](){
-                        MessageQueueContent& content = sg_messagequeue_map[Handler2Queue(Post2Handler(_message))];
-                        return content.lst_message.end() == std::find_if(content.lst_message.begin(), content.lst_message.end(),
-                                                                [&_message](const MessageWrapper *  const &_v) {
-                                                                    return _message == _v->postid;
-                                                                });
+            RunLoop( [&_message, content_ptr](){
+                        return NULL == content_ptr->FindMessage(_message);
             }).Run();
             
         } else {
-            if (!((*find_it)->wait_end_cond))(*find_it)->wait_end_cond = boost::make_shared<Condition>();
+            if (!(wrapper->wait_end_cond)) wrapper->wait_end_cond = boost::make_shared<Condition>();
 
-            boost::shared_ptr<Condition> wait_end_cond = (*find_it)->wait_end_cond;
+            boost::shared_ptr<Condition> wait_end_cond = wrapper->wait_end_cond;
             if(_timeoutInMs < 0) {
                 wait_end_cond->wait(lock);
             } else {
@@ -533,12 +956,15 @@ bool WaitMessage(const MessagePost_t& _message, long _timeoutInMs) {
 }
 
 bool FoundMessage(const MessagePost_t& _message) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = Handler2Queue(Post2Handler(_message));
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return false;
-    MessageQueueContent& content = pos->second;
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) return pool->Found(_message);
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return false;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
     if (content.lst_runloop_info.empty()) return false;
 
     auto find_it = std::find_if(content.lst_runloop_info.begin(), content.lst_runloop_info.end(),
@@ -546,11 +972,18 @@ bool FoundMessage(const MessagePost_t& _message) {
     
     if (find_it != content.lst_runloop_info.end())  { return true; }
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-        if (_message == (*it)->postid) { return true;}
-    }
+    return NULL != content.FindMessage(_message);
+}
 
-    return false;
+template <typename F>
+static void __CancelMessages(MessageQueueContent& _content, F _match) {
+    std::vector<MessageWrapper*> matched;
+    _content.ForEachMessage([&](MessageWrapper* _wrapper) { if (_match(_wrapper)) matched.push_back(_wrapper); });
+
+    for (std::vector<MessageWrapper*>::iterator it = matched.begin(); it != matched.end(); ++it) {
+        _content.RemoveMessage(*it);
+        _content.DeleteMessage(*it);
+    }
 }
 
 bool CancelMessage(const MessagePost_t& _postid) {
@@ -560,26 +993,26 @@ bool CancelMessage(const MessagePost_t& _postid) {
     // 0==_postid.reg.seq for BroadcastMessage
     if (0 == _postid.reg.queue || 0 == _postid.seq) return false;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _postid.reg.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) return pool->Cancel(_postid);
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         ASSERT2(false, "%" PRIu64, id);
         return false;
     }
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-        if (_postid == (*it)->postid) {
-            delete(*it);
-            content.lst_message.erase(it);
-            return true;
-        }
-    }
+    MessageWrapper* wrapper = content.FindMessage(_postid);
+    if (NULL == wrapper) return false;
 
-    return false;
+    content.RemoveMessage(wrapper);
+    content.DeleteMessage(wrapper);
+    return true;
 }
 
 void CancelMessage(const MessageHandler_t& _handlerid) {
@@ -588,25 +1021,24 @@ void CancelMessage(const MessageHandler_t& _handlerid) {
     // 0==_handlerid.seq for BroadcastMessage
     if (0 == _handlerid.queue) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        pool->Cancel(_handlerid);
+        return;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         //        ASSERT2(false, "%lu", id);
         return;
     }
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end();) {
-        if (_handlerid == (*it)->postid.reg) {
-            delete(*it);
-            it = content.lst_message.erase(it);
-        } else {
-            ++it;
-        }
-    }
+    __CancelMessages(content, [&_handlerid](const MessageWrapper* _wrapper) { return _handlerid == _wrapper->postid.reg; });
 }
 
 void CancelMessage(const MessageHandler_t& _handlerid, const MessageTitle_t& _title) {
@@ -615,37 +1047,39 @@ void CancelMessage(const MessageHandler_t& _handlerid, const MessageTitle_t& _ti
     // 0==_handlerid.seq for BroadcastMessage
     if (0 == _handlerid.queue) return;
 
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _handlerid.queue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) {
+        pool->Cancel(_handlerid, _title);
+        return;
+    }
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         ASSERT2(false, "%" PRIu64, id);
         return;
     }
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
 
-    for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end();) {
-        if (_handlerid == (*it)->postid.reg && _title == (*it)->message.title) {
-            delete(*it);
-            it = content.lst_message.erase(it);
-        } else {
-            ++it;
-        }
-    }
+    __CancelMessages(content, [&_handlerid, &_title](const MessageWrapper* _wrapper) {
+        return _handlerid == _wrapper->postid.reg && _title == _wrapper->message.title;
+    });
 }
     
 const Message& RunningMessage() {
     MessageQueue_t id = (MessageQueue_t)ThreadUtil::currentthreadid();
-    ScopedLock lock(sg_messagequeue_map_mutex);
     
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) {
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) {
         return KNullMessage;
     }
     
-    Message* runing_message = pos->second.lst_runloop_info.back().runing_message;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
+    Message* runing_message = content.lst_runloop_info.back().runing_message;
     return runing_message? *runing_message: KNullMessage;
 }
     
@@ -655,17 +1089,25 @@ MessagePost_t RunningMessageID() {
 }
 
 MessagePost_t RunningMessageID(const MessageQueue_t& _id) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(_id);
-    if (sg_messagequeue_map.end() == pos) {
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(_id);
+    if (!content_ptr) {
         return KNullPost;
     }
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
     return content.lst_runloop_info.back().runing_message_id;
 }
 
+const char* InternMessageName(const std::string& _name) {
+    static Mutex* s_mutex = new Mutex;
+    static std::set<std::string>* s_names = new std::set<std::string>;
+
+    ScopedLock lock(*s_mutex);
+    return s_names->insert(_name).first->c_str();
+}
+
 static void __AsyncInvokeHandler(const MessagePost_t& _id, Message& _message) {
     (*boost::any_cast<boost::shared_ptr<AsyncInvokeFunction> >(_message.body1))();
 }
@@ -677,42 +1119,34 @@ MessageHandler_t InstallAsyncHandler(const MessageQueue_t& id) {
     
 
 static MessageQueue_t __CreateMessageQueueInfo(boost::shared_ptr<RunloopCond>& _breaker, thread_tid _tid) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
-
     MessageQueue_t id = (MessageQueue_t)_tid;
 
-    if (sg_messagequeue_map.end() == sg_messagequeue_map.find(id)) {
-        MessageQueueContent& content = sg_messagequeue_map[id];
-        HandlerWrapper* handler = new HandlerWrapper(&__AsyncInvokeHandler, false, id, __MakeSeq());
-        content.lst_handler.push_back(handler);
-        content.invoke_reg = handler->reg;
-        if (_breaker)
-            content.breaker = _breaker;
-        else
-            content.breaker = boost::make_shared<Cond>();
-    }
-
+    boost::shared_ptr<MessageQueueContent> content_ptr = boost::make_shared<MessageQueueContent>();
+    MessageQueueContent& content = *content_ptr;
+    HandlerWrapper* handler = new HandlerWrapper(&__AsyncInvokeHandler, false, id, __MakeSeq());
+    content.lst_handler.push_back(handler);
+    content.invoke_reg = handler->reg;
+    if (_breaker)
+        content.breaker = _breaker;
+    else
+        content.breaker = boost::make_shared<Cond>();
+
+    sg_messagequeue_table.Insert(id, content_ptr);
     return id;
 }
     
-static void __ReleaseMessageQueueInfo() {
-
-    MessageQueue_t id = (MessageQueue_t)ThreadUtil::currentthreadid();
-
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() != pos) {
-        MessageQueueContent& content = pos->second;
-
-        for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-            delete(*it);
-        }
-
-        for (std::list<HandlerWrapper*>::iterator it = content.lst_handler.begin(); it != content.lst_handler.end(); ++it) {
-            delete(*it);
-        }
-
-        sg_messagequeue_map.erase(id);
+// called by the queue's thread with its lock held, posts that already found it are dropped with the content.
+static void __ReleaseMessageQueueInfo(const MessageQueue_t& _id, MessageQueueContent& _content) {
+    _content.released = true;
+    _content.ForEachMessage([&_content](MessageWrapper* _wrapper) { _content.DeleteMessage(_wrapper); });
+    _content.ClearMessages();
+
+    for (std::list<HandlerWrapper*>::iterator it = _content.lst_handler.begin(); it != _content.lst_handler.end(); ++it) {
+        delete(*it);
     }
+    _content.lst_handler.clear();
+
+    sg_messagequeue_table.Erase(_id, &_content);
 }
 
     
@@ -767,16 +1201,27 @@ BOOT_RUN_EXIT(__UnregisterANRCheckCallback);
 void RunLoop::Run() {
     MessageQueue_t id = CurrentThreadMessageQueue();
     ASSERT(0 != id);
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return;
+
+    MessageQueueContent& content = *content_ptr;
     {
-        ScopedLock lock(sg_messagequeue_map_mutex);
-        sg_messagequeue_map[id].lst_runloop_info.push_back(RunLoopInfo());
+        ScopedLock lock(content.mutex);
+        content.lst_runloop_info.push_back(RunLoopInfo());
     }
     
     xinfo_function(TSF"messagequeue id:%_", id);
 
+    std::vector<HandlerWrapper> fit_handler;
+    void* finished_wrapper = NULL;     // destroyed outside the lock, its memory goes back to the queue here
+
     while (true) {
-        ScopedLock lock(sg_messagequeue_map_mutex);
-        MessageQueueContent& content = sg_messagequeue_map[id];
+        ScopedLock lock(content.mutex);
+        if (NULL != finished_wrapper) {
+            content.FreeMessage(finished_wrapper);
+            finished_wrapper = NULL;
+        }
+
         content.lst_runloop_info.back().runing_message_id = KNullPost;
         content.lst_runloop_info.back().runing_message = NULL;
         content.lst_runloop_info.back().runing_handler.clear();
@@ -787,67 +1232,20 @@ void RunLoop::Run() {
         if ((content.breakflag || (breaker_func_ && breaker_func_()))) {
             content.lst_runloop_info.pop_back();
             if (content.lst_runloop_info.empty())
-                __ReleaseMessageQueueInfo();
+                __ReleaseMessageQueueInfo(id, content);
             break;
         }
 
         int64_t wait_time = 10 * 60 * 1000;
-        MessageWrapper* messagewrapper = NULL;
         bool delmessage = true;
-
-        for (std::list<MessageWrapper*>::iterator it = content.lst_message.begin(); it != content.lst_message.end(); ++it) {
-            if (kImmediately == (*it)->timing.type) {
-                messagewrapper = *it;
-                content.lst_message.erase(it);
-                break;
-            } else if (kAfter == (*it)->timing.type) {
-                int64_t time_cost = ::gettickspan((*it)->record_time);
-
-                if ((*it)->timing.after <= time_cost) {
-                    messagewrapper = *it;
-                    content.lst_message.erase(it);
-                    break;
-                } else {
-                    wait_time = std::min(wait_time, (*it)->timing.after - time_cost);
-                }
-            } else if (kPeriod == (*it)->timing.type) {
-                if (kAfter == (*it)->periodstatus) {
-                    int64_t time_cost = ::gettickspan((*it)->record_time);
-
-                    if ((*it)->timing.after <= time_cost) {
-                        messagewrapper = *it;
-                        (*it)->record_time = ::gettickcount();
-                        (*it)->periodstatus = kPeriod;
-                        delmessage = false;
-                        break;
-                    } else {
-                        wait_time = std::min(wait_time, (*it)->timing.after - time_cost);
-                    }
-                } else if (kPeriod == (*it)->periodstatus) {
-                    int64_t time_cost = ::gettickspan((*it)->record_time);
-
-                    if ((*it)->timing.period <= time_cost) {
-                        messagewrapper = *it;
-                        (*it)->record_time = ::gettickcount();
-                        delmessage = false;
-                        break;
-                    } else {
-                        wait_time = std::min(wait_time, (*it)->timing.period - time_cost);
-                    }
-                } else {
-                    ASSERT(false);
-                }
-            } else {
-                ASSERT(false);
-            }
-        }
+        MessageWrapper* messagewrapper = content.PopMessage(::gettickcount(), wait_time, delmessage);
 
         if (NULL == messagewrapper) {
             content.breaker->Wait(lock, (long)wait_time);
             continue;
         }
 
-        std::list<HandlerWrapper> fit_handler;
+        fit_handler.clear();
 
         for (std::list<HandlerWrapper*>::iterator it = content.lst_handler.begin(); it != content.lst_handler.end(); ++it) {
             if (messagewrapper->postid.reg == (*it)->reg || ((*it)->recvbroadcast && messagewrapper->postid.reg.isbroadcast())) {
@@ -862,31 +1260,38 @@ void RunLoop::Run() {
         lock.unlock();
 
         messagewrapper->message.execute_time = ::gettickcount();
-        for (std::list<HandlerWrapper>::iterator it = fit_handler.begin(); it != fit_handler.end(); ++it) {
+        for (std::vector<HandlerWrapper>::iterator it = fit_handler.begin(); it != fit_handler.end(); ++it) {
             SCOPE_ANR_AUTO((int)anr_timeout, kMQCallANRId, &(*it).reg);
             uint64_t timestart = ::clock_app_monotonic();
-            (*it).handler(messagewrapper->postid, messagewrapper->message);
+            if (messagewrapper->task) {
+                messagewrapper->task();
+            } else {
+                (*it).handler(messagewrapper->postid, messagewrapper->message);
+            }
             uint64_t timeend = ::clock_app_monotonic();
 #if defined(DEBUG) && defined(__APPLE__)
 
             if (!isDebuggerPerforming())
 #endif
                 ASSERT2(0 >= anr_timeout || anr_timeout >= (int64_t)(timeend - timestart), "anr_timeout:%" PRId64 " < cost:%" PRIu64", timestart:%" PRIu64", timeend:%" PRIu64, anr_timeout, timeend - timestart, timestart, timeend);
+
+            if (messagewrapper->task) break;    // a task runs once whatever handler it was posted to
         }
 
         if (delmessage) {
-            delete messagewrapper;
+            messagewrapper->~MessageWrapper();
+            finished_wrapper = messagewrapper;
         }
     }
 }
 
 boost::shared_ptr<RunloopCond> RunloopCond::CurrentCond() {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     MessageQueue_t id = (MessageQueue_t)ThreadUtil::currentthreadid();
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() != pos) {
-        MessageQueueContent& content = pos->second;
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (content_ptr) {
+        MessageQueueContent& content = *content_ptr;
+        ScopedLock lock(content.mutex);
         return content.breaker;
     } else {
         return boost::shared_ptr<RunloopCond>();
@@ -997,14 +1402,32 @@ MessageQueue_t GetDefTaskQueue() {
     return s_deftaskqueue->CreateMessageQueue();
 }
 
+MessageQueue_t CreateTaskPool(int _thread_count, const char* _name) {
+    TaskPool* pool = TaskPool::Create(_thread_count, NULL == _name ? "task_pool" : _name, &__AsyncInvokeHandler);
+    return NULL == pool ? KInvalidQueueID : pool->Id();
+}
+
+void ReleaseTaskPool(MessageQueue_t _pool_id) {
+    TaskPool* pool = TaskPool::Find(_pool_id);
+    if (NULL != pool) pool->Release();
+}
+
+MessageQueue_t GetDefTaskPool() {
+    static MessageQueue_t s_deftaskpool = CreateTaskPool(0, "def_task_pool");
+    return s_deftaskpool;
+}
+
 MessageHandler_t DefAsyncInvokeHandler(const MessageQueue_t& _messagequeue) {
-    ScopedLock lock(sg_messagequeue_map_mutex);
     const MessageQueue_t& id = _messagequeue;
 
-    std::map<MessageQueue_t, MessageQueueContent>::iterator pos = sg_messagequeue_map.find(id);
-    if (sg_messagequeue_map.end() == pos) return KNullHandler;
+    TaskPool* pool = TaskPool::Find(id);
+    if (NULL != pool) return pool->InvokeReg();
+
+    boost::shared_ptr<MessageQueueContent> content_ptr = sg_messagequeue_table.Find(id);
+    if (!content_ptr) return KNullHandler;
 
-    MessageQueueContent& content = pos->second;
+    MessageQueueContent& content = *content_ptr;
+    ScopedLock lock(content.mutex);
     return content.invoke_reg;
 }
 
@@ -46,6 +46,7 @@
 #include "mars/comm/time_utils.h"
 #include "mars/comm/xlogger/xlogger.h"
 #include "mars/comm/strutil.h"
+#include "mars/comm/messagequeue/message_task.h"
 namespace MessageQueue {
 
 typedef uint64_t MessageQueue_t;
@@ -86,15 +87,24 @@ struct MessageTitle_t {
 };
 
 
+// the interned copy lives until exit, so names are kept per call site rather than per message.
+const char* InternMessageName(const std::string& _name);
+
+struct MessageName {
+    MessageName(const char* _name): name(_name) {}   // kept as is, must be in static storage, e.g. a literal
+    MessageName(const std::string& _name): name(InternMessageName(_name)) {}
+    const char* name;
+};
+
 struct Message {
-    Message(): title(0), anr_timeout(0), create_time(0), execute_time(0) {}
-    Message(const MessageTitle_t& _title, const boost::any& _body1, const boost::any& _body2, const std::string& _name = "")
-    : title(_title), body1(_body1), body2(_body2), anr_timeout(10*60*1000), msg_name(_name), create_time(::gettickcount()),
+    Message(): title(0), anr_timeout(0), msg_name(""), create_time(0), execute_time(0) {}
+    Message(const MessageTitle_t& _title, const boost::any& _body1, const boost::any& _body2, const MessageName& _name = "")
+    : title(_title), body1(_body1), body2(_body2), anr_timeout(10*60*1000), msg_name(_name.name), create_time(::gettickcount()),
     execute_time(0){}
     
     template <class F>
-    Message(const MessageTitle_t& _title, const F& _func, const std::string& _name = "")
-    : title(_title), body1(boost::make_shared<AsyncInvokeFunction>()), body2(), anr_timeout(10*60*1000), msg_name(_name), create_time(::gettickcount()), execute_time(0) {
+    Message(const MessageTitle_t& _title, const F& _func, const MessageName& _name = "")
+    : title(_title), body1(boost::make_shared<AsyncInvokeFunction>()), body2(), anr_timeout(10*60*1000), msg_name(_name.name), create_time(::gettickcount()), execute_time(0) {
         *boost::any_cast<boost::shared_ptr<AsyncInvokeFunction> >(body1) = _func;
     }
     
@@ -112,7 +122,7 @@ struct Message {
     boost::any      body2;
     int64_t         anr_timeout;
     
-    std::string     msg_name;
+    const char*     msg_name;       // static storage, a literal or an interned name, never freed
     uint64_t        create_time;
     uint64_t        execute_time;
 };
@@ -194,6 +204,13 @@ MessageQueue_t   GetDefMessageQueue();
 MessageQueue_t   GetDefTaskQueue();
 MessageHandler_t DefAsyncInvokeHandler(const MessageQueue_t& _messagequeue = CurrentThreadMessageQueue());
 
+// a queue whose messages run on _thread_count workers (0: one per core), see task_pool.h.
+// AsyncInvoke to DefAsyncInvokeHandler(pool) runs in parallel, an installed handler keeps its messages in order.
+// on a worker CurrentThreadMessageQueue() is the pool, so WaitInvoke there calls the function inline.
+MessageQueue_t CreateTaskPool(int _thread_count = 0, const char* _name = NULL);
+void ReleaseTaskPool(MessageQueue_t _pool_id);  // block api, don't call it from a worker of the pool
+MessageQueue_t GetDefTaskPool();
+
 void WaitForRunningLockEnd(const MessagePost_t&  _message);
 void WaitForRunningLockEnd(const MessageHandler_t&  _handler);
 void WaitForRunningLockEnd(const MessageQueue_t&  _messagequeueid);
@@ -206,6 +223,10 @@ MessagePost_t PostMessage(const MessageHandler_t& _handlerid, const Message& _me
 MessagePost_t SingletonMessage(bool _replace, const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing = KDefTiming);
 MessagePost_t BroadcastMessage(const MessageQueue_t& _messagequeueid,  const Message& _message, const MessageTiming& _timing = KDefTiming);
 MessagePost_t FasterMessage(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing = KDefTiming);
+// what AsyncInvoke posts: the task runs in place of the handler, the Message seen by RunningMessage() has empty bodies.
+// _name isn't copied, a const char* must point to static storage such as a literal; a std::string is interned.
+// kPeriod isn't supported, a period message must stay alive while it cancels itself, see AsyncInvokePeriod.
+MessagePost_t PostTask(const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name, const MessageTiming& _timing = KDefTiming);
 
 bool WaitMessage(const MessagePost_t& _message, long _timeoutInMs = -1);
 bool FoundMessage(const MessagePost_t& _message);
@@ -221,31 +242,31 @@ MessageHandler_t InstallAsyncHandler(const MessageQueue_t& id);
 //---with message name
     //no title
 template<class F>
-    MessagePost_t AsyncInvoke(const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
-    return PostMessage(_handlerid, Message(0, _func, _msg_name));
+    MessagePost_t AsyncInvoke(const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
+    return PostTask(_handlerid, MessageTask(_func), 0, _msg_name);
 }
 template<class F>
-MessagePost_t  AsyncInvokeAfter(int64_t _after, const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
-    return PostMessage(_handlerid, Message(0, _func, _msg_name), MessageTiming(kAfter, _after, 0));
+MessagePost_t  AsyncInvokeAfter(int64_t _after, const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
+    return PostTask(_handlerid, MessageTask(_func), 0, _msg_name, MessageTiming(kAfter, _after, 0));
 }
 template<class F>
-MessagePost_t  AsyncInvokePeriod(int64_t _after, int64_t _period, const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
+MessagePost_t  AsyncInvokePeriod(int64_t _after, int64_t _period, const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
     return PostMessage(_handlerid, Message(0, _func, _msg_name), MessageTiming(kPeriod, _after, _period));
 }
     //~no title
     //title
 template<class F>
-MessagePost_t  AsyncInvoke(const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
-    return PostMessage(_handlerid, Message(_title, _func, _msg_name));
+MessagePost_t  AsyncInvoke(const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
+    return PostTask(_handlerid, MessageTask(_func), _title, _msg_name);
 }
 
 template<class F>
-MessagePost_t  AsyncInvokeAfter(int64_t _after, const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
-    return PostMessage(_handlerid, Message(_title, _func, _msg_name), MessageTiming(kAfter, _after, 0));
+MessagePost_t  AsyncInvokeAfter(int64_t _after, const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
+    return PostTask(_handlerid, MessageTask(_func), _title, _msg_name, MessageTiming(kAfter, _after, 0));
 }
 
 template<class F>
-MessagePost_t  AsyncInvokePeriod(int64_t _after, int64_t _period, const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name = "default_name") {
+MessagePost_t  AsyncInvokePeriod(int64_t _after, int64_t _period, const F& _func, const MessageTitle_t& _title, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
     return PostMessage(_handlerid, Message(_title, _func, _msg_name), MessageTiming(kPeriod, _after, _period));
 }
     //~title
@@ -596,7 +617,7 @@ class AsyncResult <const R&> {
 };
 
 template <typename R>
-    R& WaitInvoke(const AsyncResult<R>& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name="default_name") {
+    R& WaitInvoke(const AsyncResult<R>& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
     
     if (CurrentThreadMessageQueue() == Handler2Queue(_handlerid)) {
         _func();
@@ -607,41 +628,64 @@ template <typename R>
     }
 }
     
+// result slot of WaitInvoke, shared with the posted task since a timed wait may return before the task runs.
+template <typename R>
+struct InvokeResult {
+    InvokeResult(): value() {}
+    template <typename F> void Invoke(F& _func) { value = _func(); }
+    R Get() const { return value; }
+    R value;
+};
+
+template <typename R>
+struct InvokeResult<R&> {
+    InvokeResult(): value(NULL) {}
+    template <typename F> void Invoke(F& _func) { value = &_func(); }
+    R& Get() const { return *value; }
+    R* value;
+};
+
+template <>
+struct InvokeResult<void> {
+    template <typename F> void Invoke(F& _func) { _func(); }
+    void Get() const {}
+};
+
 template <typename F>
-typename boost::result_of< F()>::type  WaitInvoke(const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name="default_name") {
+typename boost::result_of< F()>::type  WaitInvoke(const F& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
     
     if (CurrentThreadMessageQueue() == Handler2Queue(_handlerid)) {
         return _func();
     } else {
         
         typedef typename boost::result_of<F()>::type R;
-        MessageQueue::AsyncResult<R> result(_func);
+        boost::shared_ptr<InvokeResult<R> > result = boost::make_shared<InvokeResult<R> >();
         
-        WaitMessage(AsyncInvoke(result, _handlerid, _msg_name));
-        return result.Result();
+        WaitMessage(PostTask(_handlerid, MessageTask([result, _func]() mutable { result->Invoke(_func); }), 0, _msg_name));
+        return result->Get();
     }
 }
     
 template <typename F, typename R>
-    R  WaitInvoke(const F& _func, R _ret, long _timeout = -1, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name="default_name") {
+    R  WaitInvoke(const F& _func, R _ret, long _timeout = -1, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
     
     if (CurrentThreadMessageQueue() == Handler2Queue(_handlerid)) {
         return _func();
     } else {
         // typedef typename boost::result_of<F()>::type R;
-        MessageQueue::AsyncResult<R> result(_func);
+        boost::shared_ptr<InvokeResult<R> > result = boost::make_shared<InvokeResult<R> >();
         
-        bool hasRun = WaitMessage(AsyncInvoke(result, _handlerid, _msg_name), _timeout);
+        bool hasRun = WaitMessage(PostTask(_handlerid, MessageTask([result, _func]() mutable { result->Invoke(_func); }), 0, _msg_name), _timeout);
         if(hasRun)
-            return result.Result();
+            return result->Get();
         else
             return _ret;
     }
 }
 
 template <typename R>
-MessagePost_t  AsyncInvoke(const AsyncResult<R>& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const std::string& _msg_name="default_name") {
-    return PostMessage(_handlerid, Message(0, _func, _msg_name));
+MessagePost_t  AsyncInvoke(const AsyncResult<R>& _func, const MessageHandler_t& _handlerid = DefAsyncInvokeHandler(), const MessageName& _msg_name = "default_name") {
+    return PostTask(_handlerid, MessageTask(_func), 0, _msg_name);
 }
     
 class ScopeRegister {
@@ -663,7 +707,10 @@ private:
 
 //------
     
-#define MESSAGE_NAME(file, function) (strutil::GetFileNameFromPath(file)+":"+function)
+// built and interned once per call site.
+#define MESSAGE_NAME(file, function) ([](const char* _file, const char* _function) -> const char* { \
+    static const char* s_name = MessageQueue::InternMessageName(strutil::GetFileNameFromPath(_file) + ":" + _function); \
+    return s_name; }(file, function))
 #define ASYNC_BLOCK_END_MSGNAME(msg_name)  }, AYNC_HANDLER, msg_name);
 
 #define ASYNC_BLOCK_START MessageQueue::AsyncInvoke([=] () {
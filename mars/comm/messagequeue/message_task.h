@@ -0,0 +1,139 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * message_task.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef MESSAGE_TASK_H_
+#define MESSAGE_TASK_H_
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace MessageQueue {
+
+/*
+ * A move-only void() callable for AsyncInvoke.
+ * Functors up to kInlineSize bytes (lambdas with a few captures, boost::bind results, boost::function) are kept
+ * in place, so posting one doesn't allocate. Bigger ones go to the heap.
+ */
+class MessageTask {
+  public:
+    static const size_t kInlineSize = 64;
+
+    MessageTask(): invoker_(NULL), manager_(NULL) {}
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, MessageTask>::value>::type>
+    MessageTask(F&& _func): invoker_(NULL), manager_(NULL) {
+        typedef typename std::decay<F>::type Functor;
+        __Init<Functor>(std::forward<F>(_func), std::integral_constant<bool, __IsInline<Functor>::value>());
+    }
+
+    MessageTask(MessageTask&& _other): invoker_(NULL), manager_(NULL) { __MoveFrom(_other); }
+
+    MessageTask& operator=(MessageTask&& _other) {
+        if (this != &_other) {
+            __Destroy();
+            __MoveFrom(_other);
+        }
+        return *this;
+    }
+
+    ~MessageTask() { __Destroy(); }
+
+    void operator()() { invoker_(storage_); }
+    explicit operator bool() const { return NULL != invoker_; }
+
+  private:
+    typedef std::aligned_storage<kInlineSize>::type Storage;
+    enum TOperation { kMove, kDestroy };
+
+    typedef void (*Invoker)(Storage& _storage);
+    typedef void (*Manager)(TOperation _op, Storage& _dst, Storage& _src);
+
+    template <typename F>
+    struct __IsInline {
+        static const bool value = sizeof(F) <= sizeof(Storage) && 0 == alignof(Storage) % alignof(F);
+    };
+
+    template <typename F, typename A>
+    void __Init(A&& _func, std::true_type) {
+        new (&storage_) F(std::forward<A>(_func));
+        invoker_ = &__InvokeInline<F>;
+        manager_ = &__ManageInline<F>;
+    }
+
+    template <typename F, typename A>
+    void __Init(A&& _func, std::false_type) {
+        *reinterpret_cast<F**>(&storage_) = new F(std::forward<A>(_func));
+        invoker_ = &__InvokeHeap<F>;
+        manager_ = &__ManageHeap<F>;
+    }
+
+    template <typename F>
+    static void __InvokeInline(Storage& _storage) { (*reinterpret_cast<F*>(&_storage))(); }
+
+    template <typename F>
+    static void __InvokeHeap(Storage& _storage) { (**reinterpret_cast<F**>(&_storage))(); }
+
+    template <typename F>
+    static void __ManageInline(TOperation _op, Storage& _dst, Storage& _src) {
+        F* src = reinterpret_cast<F*>(&_src);
+        if (kMove == _op) new (&_dst) F(std::move(*src));
+        src->~F();
+    }
+
+    template <typename F>
+    static void __ManageHeap(TOperation _op, Storage& _dst, Storage& _src) {
+        if (kMove == _op) {
+            *reinterpret_cast<F**>(&_dst) = *reinterpret_cast<F**>(&_src);
+        } else {
+            delete *reinterpret_cast<F**>(&_src);
+        }
+    }
+
+    void __MoveFrom(MessageTask& _other) {
+        if (NULL == _other.manager_) return;
+
+        _other.manager_(kMove, storage_, _other.storage_);
+        invoker_ = _other.invoker_;
+        manager_ = _other.manager_;
+        _other.invoker_ = NULL;
+        _other.manager_ = NULL;
+    }
+
+    void __Destroy() {
+        if (NULL == manager_) return;
+
+        manager_(kDestroy, storage_, storage_);
+        invoker_ = NULL;
+        manager_ = NULL;
+    }
+
+  private:
+    MessageTask(const MessageTask&);
+    MessageTask& operator=(const MessageTask&);
+
+  private:
+    Storage storage_;
+    Invoker invoker_;
+    Manager manager_;
+};
+
+}
+
+#endif /* MESSAGE_TASK_H_ */
@@ -0,0 +1,696 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * task_pool.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "comm/messagequeue/task_pool.h"
+
+#include <errno.h>
+#include <algorithm>
+#include <thread>
+
+#include "boost/bind.hpp"
+#include "boost/make_shared.hpp"
+
+#include "comm/thread/atomic_oper.h"
+#include "comm/thread/thread.h"
+#include "comm/thread/tss.h"
+#include "comm/time_utils.h"
+#include "comm/xlogger/xlogger.h"
+
+namespace MessageQueue {
+
+static const size_t kMaxTaskPools = 16;
+static const int kStrandBatch = 16;     // messages a strand runs before giving the worker to other jobs
+static const long kIdleWait = 10 * 60 * 1000;
+
+struct TaskPool::Item {
+    Item(const Message& _message, const MessageTiming& _timing)
+        : message(_message), timing(_timing), deadline(0), heap_index(0), in_timer(false), running(false), cancelled(false), waited(false) {}
+
+    Item(MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name, const MessageTiming& _timing)
+        : message(_title, boost::any(), boost::any(), _name), task(std::move(_task)), timing(_timing)
+        , deadline(0), heap_index(0), in_timer(false), running(false), cancelled(false), waited(false) {}
+
+    MessagePost_t postid;
+    Message message;
+    MessageTask task;
+    MessageTiming timing;
+    boost::shared_ptr<Strand> strand;   // empty for the invoke handler
+
+    uint64_t deadline;
+    size_t heap_index;
+    bool in_timer;      // under timer_mutex_, the heap owns the item
+
+    // under the index shard lock
+    bool running;
+    bool cancelled;
+    bool waited;
+};
+
+struct TaskPool::Strand {
+    Strand(const MessageHandler& _handler): handler(_handler), scheduled(false), running(false), running_tid(0), removed(false) {}
+
+    MessageHandler_t reg;
+    MessageHandler handler;
+
+    Mutex mutex;
+    std::deque<Item*> items;
+    bool scheduled;     // a job for this strand is queued or running
+    bool running;
+    thread_tid running_tid;
+    Condition idle_cond;
+    bool removed;       // uninstalled, takes no more posts
+};
+
+struct TaskPool::Worker {
+    Worker(TaskPool* _pool): pool(_pool), thread(NULL) {}
+
+    TaskPool* pool;
+    Thread* thread;
+    Mutex mutex;
+    std::deque<Job> jobs;
+    char padding[64];   // keeps neighbouring worker locks off one cache line
+};
+
+struct TaskPool::IndexShard {
+    Mutex mutex;
+    Condition cond;     // a waited message finished or was cancelled
+    std::map<unsigned int, Item*> items;    // pending and running messages, by seq
+    char padding[64];
+};
+
+static TaskPool* volatile sg_task_pools[kMaxTaskPools] = {NULL};
+static uint32_t sg_task_pool_count = 0;
+
+static Mutex& __TaskPoolsMutex() {
+    static Mutex* mutex = new Mutex;
+    return *mutex;
+}
+
+static Tss& __CurrentWorker() {
+    static Tss* tss = new Tss(NULL);
+    return *tss;
+}
+
+TaskPool* TaskPool::Create(int _thread_count, const char* _name, const MessageHandler& _invoke_handler) {
+    if (0 >= _thread_count) _thread_count = (int)std::thread::hardware_concurrency();
+    if (0 >= _thread_count) _thread_count = 1;
+
+    ScopedLock lock(__TaskPoolsMutex());
+    ASSERT2(sg_task_pool_count < kMaxTaskPools, "too many task pools:%u", sg_task_pool_count);
+    if (sg_task_pool_count >= kMaxTaskPools) return NULL;
+
+    TaskPool* pool = new TaskPool(_thread_count, _name, _invoke_handler);
+    sg_task_pools[sg_task_pool_count] = pool;
+    atomic_inc32(&sg_task_pool_count);
+    xinfo2(TSF"create task pool id:%_, threads:%_", pool->Id(), _thread_count);
+    return pool;
+}
+
+TaskPool* TaskPool::Find(const MessageQueue_t& _id) {
+    uint32_t count = atomic_read32(&sg_task_pool_count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (sg_task_pools[i]->Id() == _id) return sg_task_pools[i];
+    }
+    return NULL;
+}
+
+TaskPool* TaskPool::Current() {
+    Worker* worker = (Worker*)__CurrentWorker().get();
+    return NULL == worker ? NULL : worker->pool;
+}
+
+TaskPool::TaskPool(int _thread_count, const char* _name, const MessageHandler& _invoke_handler)
+    : invoke_handler_(_invoke_handler), next_seq_(0), released_(0), next_worker_(0), sleepers_(0), searching_(0), pending_wakes_(0), stopping_(false)
+    , next_deadline_(UINT64_MAX), index_(new IndexShard[kIndexShards]) {
+    invoke_reg_.queue = Id();
+    invoke_reg_.seq = atomic_inc32(&next_seq_) + 1;
+
+    for (int i = 0; i < _thread_count; ++i) {
+        Worker* worker = new Worker(this);
+        worker->thread = new Thread(boost::bind(&TaskPool::__WorkerLoop, this, worker), _name);
+        workers_.push_back(worker);
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread->start();
+    }
+}
+
+TaskPool::~TaskPool() {
+    ASSERT(false);  // never deleted, see Release()
+}
+
+void TaskPool::Release() {
+    if (0 != atomic_cas32(&released_, 1, 0)) return;
+
+    {
+        ScopedLock lock(sleep_mutex_);
+        stopping_ = true;
+        sleep_cond_.notifyAll(lock);
+    }
+
+    Worker* current = (Worker*)__CurrentWorker().get();
+    ASSERT2(NULL == current || this != current->pool, "release a task pool from its own worker");
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (current != workers_[i]) workers_[i]->thread->join();
+    }
+
+    // nothing runs any more, drop what is left. the strands and the timer heap own their items, the index doesn't.
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        ScopedLock lock(workers_[i]->mutex);
+        for (std::deque<Job>::iterator it = workers_[i]->jobs.begin(); it != workers_[i]->jobs.end(); ++it) {
+            if (NULL != it->item) delete it->item;
+        }
+        workers_[i]->jobs.clear();
+    }
+
+    {
+        ScopedLock lock(handler_mutex_);
+        for (std::map<unsigned int, boost::shared_ptr<Strand> >::iterator it = strands_.begin(); it != strands_.end(); ++it) {
+            ScopedLock strand_lock(it->second->mutex);
+            for (std::deque<Item*>::iterator item = it->second->items.begin(); item != it->second->items.end(); ++item) {
+                delete *item;
+            }
+            it->second->items.clear();
+        }
+        strands_.clear();
+    }
+
+    {
+        ScopedLock lock(timer_mutex_);
+        for (std::vector<Item*>::iterator it = timer_heap_.begin(); it != timer_heap_.end(); ++it) {
+            delete *it;
+        }
+        timer_heap_.clear();
+        next_deadline_ = UINT64_MAX;
+    }
+
+    for (size_t i = 0; i < kIndexShards; ++i) {
+        ScopedLock lock(index_[i].mutex);
+        index_[i].items.clear();
+        index_[i].cond.notifyAll(lock);
+    }
+}
+
+MessageHandler_t TaskPool::InstallHandler(const MessageHandler& _handler) {
+    if (atomic_read32(&released_)) return KNullHandler;
+
+    boost::shared_ptr<Strand> strand = boost::make_shared<Strand>(_handler);
+    strand->reg.queue = Id();
+    strand->reg.seq = atomic_inc32(&next_seq_) + 1;
+
+    ScopedLock lock(handler_mutex_);
+    strands_[strand->reg.seq] = strand;
+    return strand->reg;
+}
+
+void TaskPool::UnInstallHandler(const MessageHandler_t& _handlerid) {
+    {
+        ScopedLock lock(handler_mutex_);
+        std::map<unsigned int, boost::shared_ptr<Strand> >::iterator it = strands_.find(_handlerid.seq);
+        if (strands_.end() == it) return;
+
+        // a scheduled strand stays findable for WaitForRunningEnd, its last job erases it.
+        ScopedLock strand_lock(it->second->mutex);
+        it->second->removed = true;
+        if (!it->second->scheduled) strands_.erase(it);
+    }
+
+    // queued messages of the strand are dropped when it drains.
+    Cancel(_handlerid);
+}
+
+MessagePost_t TaskPool::Post(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing) {
+    return __Post(new Item(_message, _timing), _handlerid);
+}
+
+MessagePost_t TaskPool::Post(const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name, const MessageTiming& _timing) {
+    return __Post(new Item(std::move(_task), _title, _name, _timing), _handlerid);
+}
+
+MessagePost_t TaskPool::__Post(Item* _item, const MessageHandler_t& _handlerid) {
+    if (atomic_read32(&released_)) {
+        delete _item;
+        return KNullPost;
+    }
+
+    if (_handlerid.seq != invoke_reg_.seq) {
+        ScopedLock lock(handler_mutex_);
+        std::map<unsigned int, boost::shared_ptr<Strand> >::iterator it = strands_.find(_handlerid.seq);
+        if (strands_.end() == it || it->second->removed) {
+            lock.unlock();
+            delete _item;
+            return KNullPost;
+        }
+        _item->strand = it->second;
+    }
+
+    _item->postid.reg = _handlerid;
+    _item->postid.seq = atomic_inc32(&next_seq_) + 1;
+    MessagePost_t postid = _item->postid;
+
+    {
+        IndexShard& shard = __Shard(postid.seq);
+        ScopedLock lock(shard.mutex);
+        shard.items[postid.seq] = _item;
+    }
+
+    if (kImmediately == _item->timing.type) {
+        __Dispatch(_item);
+    } else {
+        _item->deadline = ::gettickcount() + (0 < _item->timing.after ? _item->timing.after : 0);
+        __AddTimer(_item);
+    }
+
+    return postid;
+}
+
+void TaskPool::__Dispatch(Item* _item) {
+    Job job;
+
+    if (_item->strand) {
+        Strand& strand = *_item->strand;
+        ScopedLock lock(strand.mutex);
+        strand.items.push_back(_item);
+        if (strand.scheduled) return;
+
+        strand.scheduled = true;
+        job.strand = _item->strand;
+    } else {
+        job.item = _item;
+    }
+
+    __Push(job);
+}
+
+void TaskPool::__Push(const Job& _job) {
+    Worker* worker = (Worker*)__CurrentWorker().get();
+    if (NULL == worker || this != worker->pool) {
+        worker = workers_[atomic_inc32(&next_worker_) % workers_.size()];
+    }
+
+    {
+        ScopedLock lock(worker->mutex);
+        worker->jobs.push_back(_job);
+    }
+
+    __Notify();
+}
+
+// wakes a sleeper unless some worker is already searching, that one will pick the job up.
+// the atomics are full barriers, so a searcher that gives up after this read still sees the job when it rechecks.
+void TaskPool::__Notify() {
+    if (0 != atomic_add32(&searching_, 0) || 0 == atomic_add32(&sleepers_, 0)) return;
+
+    ScopedLock lock(sleep_mutex_);
+    if (0 != atomic_read32(&searching_) || atomic_read32(&sleepers_) <= pending_wakes_) return;
+
+    // counted as searching from now on, so the posts that follow don't wake the others too.
+    ++pending_wakes_;
+    atomic_inc32(&searching_);
+    sleep_cond_.notifyOne(lock);
+}
+
+void TaskPool::__WorkerLoop(Worker* _worker) {
+    __CurrentWorker().set(_worker);
+    bool searching = false;
+
+    while (!atomic_read32(&released_)) {
+        if (UINT64_MAX != next_deadline_ && ::gettickcount() >= next_deadline_) __FireTimers();
+
+        Job job;
+        if (__PopLocal(_worker, job) || __Steal(_worker, job)) {
+            // the last searcher found work, there may be more, let one more worker look.
+            if (searching) {
+                searching = false;
+                if (1 == atomic_dec32(&searching_)) __Notify();
+            }
+
+            __RunJob(_worker, job);
+            continue;
+        }
+
+        if (searching) {
+            searching = false;
+            atomic_dec32(&searching_);
+        }
+
+        ScopedLock lock(sleep_mutex_);
+        if (stopping_) break;
+
+        atomic_inc32(&sleepers_);
+        if (!__HasWork()) {
+            uint64_t deadline = next_deadline_;
+            uint64_t now = ::gettickcount();
+            long wait = UINT64_MAX == deadline ? kIdleWait : (deadline > now ? (long)std::min<uint64_t>(deadline - now, kIdleWait) : 0);
+            if (0 < wait) sleep_cond_.wait(lock, wait);
+        }
+        atomic_dec32(&sleepers_);
+
+        // woken by __Notify, which counted us already, or by a timeout.
+        if (0 < pending_wakes_) {
+            --pending_wakes_;
+        } else {
+            atomic_inc32(&searching_);
+        }
+        searching = true;
+
+        if (stopping_) break;
+    }
+
+    __CurrentWorker().set(NULL);
+}
+
+bool TaskPool::__PopLocal(Worker* _worker, Job& _job) {
+    ScopedLock lock(_worker->mutex);
+    if (_worker->jobs.empty()) return false;
+
+    _job = _worker->jobs.front();
+    _worker->jobs.pop_front();
+    return true;
+}
+
+bool TaskPool::__Steal(Worker* _worker, Job& _job) {
+    size_t self = std::find(workers_.begin(), workers_.end(), _worker) - workers_.begin();
+
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker* victim = workers_[(self + i) % workers_.size()];
+        ScopedLock lock(victim->mutex);
+        if (victim->jobs.empty()) continue;
+
+        _job = victim->jobs.back();
+        victim->jobs.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+bool TaskPool::__HasWork() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        ScopedLock lock(workers_[i]->mutex);
+        if (!workers_[i]->jobs.empty()) return true;
+    }
+
+    return UINT64_MAX != next_deadline_ && ::gettickcount() >= next_deadline_;
+}
+
+void TaskPool::__FireTimers() {
+    uint64_t now = ::gettickcount();
+
+    while (true) {
+        Item* item = NULL;
+        {
+            ScopedLock lock(timer_mutex_);
+            if (timer_heap_.empty() || timer_heap_.front()->deadline > now) return;
+
+            item = timer_heap_.front();
+            __RemoveTimer(item);
+        }
+        __Dispatch(item);
+    }
+}
+
+void TaskPool::__RunJob(Worker* _worker, const Job& _job) {
+    if (NULL != _job.item) {
+        __RunItem(_job.item);
+        return;
+    }
+
+    Strand& strand = *_job.strand;
+    for (int i = 0; i < kStrandBatch; ++i) {
+        Item* item = NULL;
+        {
+            ScopedLock lock(strand.mutex);
+            if (strand.items.empty()) break;
+
+            item = strand.items.front();
+            strand.items.pop_front();
+            strand.running = true;
+            strand.running_tid = ThreadUtil::currentthreadid();
+        }
+
+        __RunItem(item);
+
+        ScopedLock lock(strand.mutex);
+        strand.running = false;
+        strand.running_tid = 0;
+        strand.idle_cond.notifyAll(lock);
+    }
+
+    {
+        ScopedLock lock(strand.mutex);
+        if (!strand.items.empty()) {
+            lock.unlock();
+
+            // still busy, go to the back so the other jobs of this worker get a turn.
+            ScopedLock worker_lock(_worker->mutex);
+            _worker->jobs.push_back(_job);
+            return;
+        }
+
+        strand.scheduled = false;
+        if (!strand.removed) return;
+    }
+
+    // the last job of an uninstalled strand.
+    ScopedLock lock(handler_mutex_);
+    std::map<unsigned int, boost::shared_ptr<Strand> >::iterator it = strands_.find(strand.reg.seq);
+    if (strands_.end() == it || it->second != _job.strand) return;
+
+    ScopedLock strand_lock(strand.mutex);
+    if (!strand.scheduled) strands_.erase(it);
+}
+
+void TaskPool::__RunItem(Item* _item) {
+    {
+        IndexShard& shard = __Shard(_item->postid.seq);
+        ScopedLock lock(shard.mutex);
+        if (_item->cancelled) {
+            lock.unlock();
+            delete _item;
+            return;
+        }
+        _item->running = true;
+    }
+
+    if (_item->task) {
+        _item->task();
+    } else if (_item->strand) {
+        _item->strand->handler(_item->postid, _item->message);
+    } else {
+        invoke_handler_(_item->postid, _item->message);
+    }
+
+    __Finish(_item);
+}
+
+void TaskPool::__Finish(Item* _item) {
+    IndexShard& shard = __Shard(_item->postid.seq);
+    ScopedLock lock(shard.mutex);
+    _item->running = false;
+
+    // a period message is queued again one period after the run ends, so its runs never overlap.
+    if (kPeriod == _item->timing.type && !_item->cancelled && !atomic_read32(&released_)) {
+        _item->deadline = ::gettickcount() + (0 < _item->timing.period ? _item->timing.period : 0);
+        lock.unlock();
+        __AddTimer(_item);
+        return;
+    }
+
+    if (!_item->cancelled) shard.items.erase(_item->postid.seq);
+    if (_item->waited) shard.cond.notifyAll(lock);
+    lock.unlock();
+
+    delete _item;
+}
+
+TaskPool::IndexShard& TaskPool::__Shard(unsigned int _seq) {
+    return index_[_seq % kIndexShards];
+}
+
+// returns false for a message that is already running and won't come back.
+bool TaskPool::__CancelLocked(IndexShard& _shard, Item* _item) {
+    if (_item->running && kPeriod != _item->timing.type) return false;
+
+    _item->cancelled = true;
+    _shard.items.erase(_item->postid.seq);
+    if (_item->waited) _shard.cond.notifyAll();
+
+    if (_item->running) return true;
+
+    // a timer is deleted here, a queued message when a worker gets to it.
+    ScopedLock lock(timer_mutex_);
+    if (_item->in_timer) {
+        __RemoveTimer(_item);
+        delete _item;
+    }
+    return true;
+}
+
+bool TaskPool::Wait(const MessagePost_t& _postid, long _timeout_ms) {
+    IndexShard& shard = __Shard(_postid.seq);
+    ScopedLock lock(shard.mutex);
+    uint64_t start = ::gettickcount();
+
+    while (true) {
+        std::map<unsigned int, Item*>::iterator it = shard.items.find(_postid.seq);
+        if (shard.items.end() == it || !(_postid == it->second->postid)) return true;
+
+        it->second->waited = true;
+        if (0 > _timeout_ms) {
+            shard.cond.wait(lock);
+            continue;
+        }
+
+        int64_t left = _timeout_ms - (int64_t)(::gettickcount() - start);
+        if (0 >= left || ETIMEDOUT == shard.cond.wait(lock, (long)left)) {
+            it = shard.items.find(_postid.seq);
+            return shard.items.end() == it || !(_postid == it->second->postid);
+        }
+    }
+}
+
+bool TaskPool::Found(const MessagePost_t& _postid) {
+    IndexShard& shard = __Shard(_postid.seq);
+    ScopedLock lock(shard.mutex);
+    std::map<unsigned int, Item*>::iterator it = shard.items.find(_postid.seq);
+    return shard.items.end() != it && _postid == it->second->postid;
+}
+
+bool TaskPool::Cancel(const MessagePost_t& _postid) {
+    IndexShard& shard = __Shard(_postid.seq);
+    ScopedLock lock(shard.mutex);
+    std::map<unsigned int, Item*>::iterator it = shard.items.find(_postid.seq);
+    if (shard.items.end() == it || !(_postid == it->second->postid)) return false;
+
+    return __CancelLocked(shard, it->second);
+}
+
+void TaskPool::Cancel(const MessageHandler_t& _handlerid) {
+    for (size_t i = 0; i < kIndexShards; ++i) {
+        ScopedLock lock(index_[i].mutex);
+        std::vector<Item*> matched;
+        for (std::map<unsigned int, Item*>::iterator it = index_[i].items.begin(); it != index_[i].items.end(); ++it) {
+            if (_handlerid == it->second->postid.reg) matched.push_back(it->second);
+        }
+
+        for (std::vector<Item*>::iterator it = matched.begin(); it != matched.end(); ++it) {
+            __CancelLocked(index_[i], *it);
+        }
+    }
+}
+
+void TaskPool::Cancel(const MessageHandler_t& _handlerid, const MessageTitle_t& _title) {
+    for (size_t i = 0; i < kIndexShards; ++i) {
+        ScopedLock lock(index_[i].mutex);
+        std::vector<Item*> matched;
+        for (std::map<unsigned int, Item*>::iterator it = index_[i].items.begin(); it != index_[i].items.end(); ++it) {
+            if (_handlerid == it->second->postid.reg && _title == it->second->message.title) matched.push_back(it->second);
+        }
+
+        for (std::vector<Item*>::iterator it = matched.begin(); it != matched.end(); ++it) {
+            __CancelLocked(index_[i], *it);
+        }
+    }
+}
+
+void TaskPool::WaitForRunningEnd(const MessageHandler_t& _handlerid) {
+    // the invoke handler has no single running message to wait for, it isn't a strand.
+    boost::shared_ptr<Strand> strand;
+    {
+        ScopedLock lock(handler_mutex_);
+        std::map<unsigned int, boost::shared_ptr<Strand> >::iterator it = strands_.find(_handlerid.seq);
+        if (strands_.end() == it) return;
+        strand = it->second;
+    }
+
+    ScopedLock lock(strand->mutex);
+    while (strand->running && ThreadUtil::currentthreadid() != strand->running_tid) {
+        strand->idle_cond.wait(lock);
+    }
+}
+
+void TaskPool::__AddTimer(Item* _item) {
+    ScopedLock lock(timer_mutex_);
+    _item->in_timer = true;
+    timer_heap_.push_back(_item);
+    __SiftUp(timer_heap_.size() - 1);
+
+    bool earlier = timer_heap_.front() == _item;
+    __UpdateNextDeadline();
+    lock.unlock();
+
+    // a sleeping worker may be waiting for a later deadline.
+    if (earlier) __Notify();
+}
+
+void TaskPool::__RemoveTimer(Item* _item) {
+    size_t index = _item->heap_index;
+    ASSERT(_item->in_timer && index < timer_heap_.size() && _item == timer_heap_[index]);
+
+    _item->in_timer = false;
+    Item* last = timer_heap_.back();
+    timer_heap_.pop_back();
+
+    if (last != _item) {
+        timer_heap_[index] = last;
+        last->heap_index = index;
+        if (0 < index && last->deadline < timer_heap_[(index - 1) / 2]->deadline) {
+            __SiftUp(index);
+        } else {
+            __SiftDown(index);
+        }
+    }
+
+    __UpdateNextDeadline();
+}
+
+void TaskPool::__SiftUp(size_t _index) {
+    Item* item = timer_heap_[_index];
+    while (0 < _index && item->deadline < timer_heap_[(_index - 1) / 2]->deadline) {
+        timer_heap_[_index] = timer_heap_[(_index - 1) / 2];
+        timer_heap_[_index]->heap_index = _index;
+        _index = (_index - 1) / 2;
+    }
+    timer_heap_[_index] = item;
+    item->heap_index = _index;
+}
+
+void TaskPool::__SiftDown(size_t _index) {
+    Item* item = timer_heap_[_index];
+    size_t size = timer_heap_.size();
+    while (true) {
+        size_t child = _index * 2 + 1;
+        if (child >= size) break;
+        if (child + 1 < size && timer_heap_[child + 1]->deadline < timer_heap_[child]->deadline) ++child;
+        if (!(timer_heap_[child]->deadline < item->deadline)) break;
+        timer_heap_[_index] = timer_heap_[child];
+        timer_heap_[_index]->heap_index = _index;
+        _index = child;
+    }
+    timer_heap_[_index] = item;
+    item->heap_index = _index;
+}
+
+void TaskPool::__UpdateNextDeadline() {
+    next_deadline_ = timer_heap_.empty() ? UINT64_MAX : timer_heap_.front()->deadline;
+}
+
+}
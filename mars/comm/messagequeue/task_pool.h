@@ -0,0 +1,141 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * task_pool.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef TASK_POOL_H_
+#define TASK_POOL_H_
+
+#include <map>
+#include <deque>
+#include <vector>
+
+#include "boost/shared_ptr.hpp"
+
+#include "mars/comm/messagequeue/message_queue.h"
+#include "mars/comm/thread/lock.h"
+#include "mars/comm/thread/condition.h"
+
+namespace MessageQueue {
+
+/*
+ * The queue behind CreateTaskPool, its messages run on a set of worker threads instead of one runloop.
+ *
+ * Every worker takes jobs from its own deque first and steals from the others when that runs dry.
+ * A post made on a worker goes to that worker's deque, posts from other threads are spread round robin.
+ *
+ * Messages to the pool's DefAsyncInvokeHandler run in parallel, in no particular order.
+ * A handler installed on the pool (InstallMessageHandler, InstallAsyncHandler) is a strand:
+ * its messages run one at a time in post order, on whichever worker picks the strand up.
+ *
+ * Singleton/Faster/Broadcast messages, RunningMessage() and coroutines are not supported here.
+ */
+class TaskPool {
+  public:
+    static TaskPool* Create(int _thread_count, const char* _name, const MessageHandler& _invoke_handler);
+    static TaskPool* Find(const MessageQueue_t& _id);
+    static TaskPool* Current();     // the pool the calling thread works for, if any
+
+  public:
+    MessageQueue_t Id() const { return (MessageQueue_t)(uintptr_t)this; }
+    const MessageHandler_t& InvokeReg() const { return invoke_reg_; }
+    void Release();     // block api, pending messages are dropped. the object stays, so the id is never reused.
+
+    MessageHandler_t InstallHandler(const MessageHandler& _handler);
+    void UnInstallHandler(const MessageHandler_t& _handlerid);
+
+    MessagePost_t Post(const MessageHandler_t& _handlerid, const Message& _message, const MessageTiming& _timing);
+    MessagePost_t Post(const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageTitle_t& _title, const MessageName& _name, const MessageTiming& _timing);
+
+    // a worker waiting for a message of its own pool holds a thread the message may need, keep that for WaitInvoke, which runs inline there.
+    bool Wait(const MessagePost_t& _postid, long _timeout_ms);
+    bool Found(const MessagePost_t& _postid);
+    bool Cancel(const MessagePost_t& _postid);
+    void Cancel(const MessageHandler_t& _handlerid);
+    void Cancel(const MessageHandler_t& _handlerid, const MessageTitle_t& _title);
+    void WaitForRunningEnd(const MessageHandler_t& _handlerid);
+
+  private:
+    struct Strand;
+    struct Item;
+    struct Job {
+        Job(): item(NULL) {}
+        Item* item;                         // a message for the invoke handler
+        boost::shared_ptr<Strand> strand;   // or a strand with messages to run
+    };
+    struct Worker;
+    struct IndexShard;
+
+    TaskPool(int _thread_count, const char* _name, const MessageHandler& _invoke_handler);
+    ~TaskPool();
+
+    MessagePost_t __Post(Item* _item, const MessageHandler_t& _handlerid);
+    void __Dispatch(Item* _item);
+    void __Push(const Job& _job);
+    void __Notify();
+
+    void __WorkerLoop(Worker* _worker);
+    bool __PopLocal(Worker* _worker, Job& _job);
+    bool __Steal(Worker* _worker, Job& _job);
+    bool __HasWork();
+    void __FireTimers();
+    void __RunJob(Worker* _worker, const Job& _job);
+    void __RunItem(Item* _item);
+
+    IndexShard& __Shard(unsigned int _seq);
+    bool __CancelLocked(IndexShard& _shard, Item* _item);
+    void __Finish(Item* _item);
+
+    void __AddTimer(Item* _item);
+    void __RemoveTimer(Item* _item);
+    void __SiftUp(size_t _index);
+    void __SiftDown(size_t _index);
+    void __UpdateNextDeadline();
+
+  private:
+    TaskPool(const TaskPool&);
+    TaskPool& operator=(const TaskPool&);
+
+  private:
+    static const size_t kIndexShards = 16;
+
+    MessageHandler invoke_handler_;
+    MessageHandler_t invoke_reg_;
+    volatile uint32_t next_seq_;
+    volatile uint32_t released_;
+
+    std::vector<Worker*> workers_;
+    volatile uint32_t next_worker_;
+    volatile uint32_t sleepers_;
+    volatile uint32_t searching_;   // awake workers looking for a job
+    uint32_t pending_wakes_;        // notified sleepers that haven't woken yet, under sleep_mutex_
+    Mutex sleep_mutex_;
+    Condition sleep_cond_;
+    bool stopping_;
+
+    Mutex handler_mutex_;
+    std::map<unsigned int, boost::shared_ptr<Strand> > strands_;
+
+    Mutex timer_mutex_;
+    std::vector<Item*> timer_heap_;
+    volatile uint64_t next_deadline_;   // read without the lock as a hint, the heap decides
+
+    IndexShard* index_;
+};
+
+}
+
+#endif /* TASK_POOL_H_ */
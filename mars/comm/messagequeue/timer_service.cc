@@ -0,0 +1,269 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * timer_service.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "comm/messagequeue/timer_service.h"
+
+#include "boost/bind.hpp"
+
+#include "comm/time_utils.h"
+#include "comm/xlogger/xlogger.h"
+
+namespace MessageQueue {
+
+struct TimerService::Entry {
+    Entry(uint32_t _index): index(_index), generation(0), expire(0), level(-1), slot(0), prev(NULL), next(NULL), name("") {}
+
+    TimerId Id() const { return ((uint64_t)generation << 32) | index; }
+
+    uint32_t index;
+    uint32_t generation;    // bumped on free, so a stale id doesn't match the next timer in this entry
+    uint64_t expire;
+    int level;              // -1 when not in the wheel
+    int slot;
+    Entry* prev;
+    Entry* next;
+
+    MessageHandler_t handler;
+    MessageTask task;
+    const char* name;
+};
+
+struct TimerService::Due {
+    Due(const MessageHandler_t& _handler, MessageTask&& _task, const char* _name): handler(_handler), task(std::move(_task)), name(_name) {}
+    Due(Due&& _other): handler(_other.handler), task(std::move(_other.task)), name(_other.name) {}
+
+    MessageHandler_t handler;
+    MessageTask task;
+    const char* name;
+};
+
+TimerService& TimerService::Instance() {
+    static TimerService* s_instance = new TimerService;
+    return *s_instance;
+}
+
+TimerService::TimerService()
+    : handler_(InstallAsyncHandler(GetDefMessageQueue())), tick_seq_(0)
+    , now_tick_(::gettickcount()), wake_tick_(0), wakeups_(0), size_(0) {
+    for (int level = 0; level < kLevels; ++level) {
+        for (int slot = 0; slot < kSlots; ++slot) wheel_[level][slot] = NULL;
+        occupied_[level] = 0;
+    }
+
+    // entry 0 is never handed out, so no id is 0.
+    entries_.push_back(NULL);
+}
+
+TimerService::~TimerService() {
+    ASSERT(false);  // lives until exit
+}
+
+TimerService::TimerId TimerService::Start(int64_t _after, const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageName& _name) {
+    ASSERT(bool(_task));
+
+    ScopedLock lock(mutex_);
+
+    Entry* entry = NULL;
+    if (!free_.empty()) {
+        entry = entries_[free_.back()];
+        free_.pop_back();
+    } else {
+        entry = new Entry((uint32_t)entries_.size());
+        entries_.push_back(entry);
+    }
+
+    // the slot of now_tick_ is done, the earliest a new timer can go is the next one.
+    uint64_t expire = ::gettickcount() + (0 < _after ? _after : 0);
+    entry->expire = expire > now_tick_ ? expire : now_tick_ + 1;
+    entry->handler = _handlerid;
+    entry->task = std::move(_task);
+    entry->name = _name.name;
+    __Insert(entry);
+    ++size_;
+    __Schedule();
+
+    return entry->Id();
+}
+
+bool TimerService::Cancel(TimerId _id) {
+    uint32_t index = (uint32_t)_id;
+
+    ScopedLock lock(mutex_);
+    if (0 == index || index >= entries_.size()) return false;
+
+    Entry* entry = entries_[index];
+    if (entry->Id() != _id || 0 > entry->level) return false;
+
+    __Unlink(entry);
+    __Free(entry);
+    --size_;
+    return true;
+}
+
+size_t TimerService::Size() {
+    ScopedLock lock(mutex_);
+    return size_;
+}
+
+uint64_t TimerService::Wakeups() {
+    ScopedLock lock(mutex_);
+    return wakeups_;
+}
+
+void TimerService::__OnTick(uint64_t _tick_seq) {
+    std::vector<Due> due;
+
+    ScopedLock lock(mutex_);
+    if (_tick_seq != tick_seq_) return;
+
+    wake_tick_ = 0;
+    ++wakeups_;
+    __Advance(::gettickcount(), due);
+    __Schedule();
+    lock.unlock();
+
+    // posted outside the lock, the target queue's lock isn't taken under ours.
+    // on the default message queue they run right after this, on the same thread.
+    for (std::vector<Due>::iterator it = due.begin(); it != due.end(); ++it) {
+        PostTask(it->handler, std::move(it->task), 0, it->name);
+    }
+}
+
+// posts the wakeup for the next tick with work, unless the one posted already comes no later.
+void TimerService::__Schedule() {
+    uint64_t next = __NextTick();
+    if (UINT64_MAX == next || (0 != wake_tick_ && wake_tick_ <= next)) return;
+
+    // a wakeup that can't be cancelled any more is running, its tick_seq_ is old and it does nothing.
+    if (0 != wake_tick_) CancelMessage(tick_);
+
+    uint64_t now = ::gettickcount();
+    wake_tick_ = next;
+    tick_ = PostTask(handler_, boost::bind(&TimerService::__OnTick, this, ++tick_seq_), (MessageTitle_t)this, "TimerService.tick",
+                     MessageTiming(next > now ? (int64_t)(next - now) : 0));
+}
+
+void TimerService::__Insert(Entry* _entry) {
+    uint64_t delta = _entry->expire > now_tick_ ? _entry->expire - now_tick_ : 0;
+
+    int level = 0;
+    while (level < kLevels - 1 && delta >= ((uint64_t)1 << (kSlotBits * (level + 1)))) ++level;
+
+    int shift = kSlotBits * level;
+    uint64_t position = _entry->expire >> shift;
+    // beyond the last level: park in the slot that comes round last, it's put back in the wheel from there.
+    if (delta >= ((uint64_t)1 << (kSlotBits * kLevels))) position = (now_tick_ >> shift) + kSlots;
+
+    int slot = (int)(position & (kSlots - 1));
+    _entry->level = level;
+    _entry->slot = slot;
+    _entry->prev = NULL;
+    _entry->next = wheel_[level][slot];
+    if (NULL != _entry->next) _entry->next->prev = _entry;
+    wheel_[level][slot] = _entry;
+    occupied_[level] |= (uint64_t)1 << slot;
+}
+
+void TimerService::__Unlink(Entry* _entry) {
+    if (NULL != _entry->prev) {
+        _entry->prev->next = _entry->next;
+    } else {
+        wheel_[_entry->level][_entry->slot] = _entry->next;
+    }
+    if (NULL != _entry->next) _entry->next->prev = _entry->prev;
+
+    if (NULL == wheel_[_entry->level][_entry->slot]) occupied_[_entry->level] &= ~((uint64_t)1 << _entry->slot);
+
+    _entry->level = -1;
+    _entry->prev = NULL;
+    _entry->next = NULL;
+}
+
+void TimerService::__Free(Entry* _entry) {
+    _entry->task = MessageTask();
+    ++_entry->generation;
+    free_.push_back(_entry->index);
+}
+
+// the first tick after now_tick_ with work: a level 0 slot to fire or a higher slot to spread to the levels below.
+uint64_t TimerService::__NextTick() const {
+    uint64_t next = UINT64_MAX;
+
+    for (int level = 0; level < kLevels; ++level) {
+        if (0 == occupied_[level]) continue;
+
+        int shift = kSlotBits * level;
+        uint64_t base = now_tick_ >> shift;
+        for (int slot = 0; slot < kSlots; ++slot) {
+            if (0 == (occupied_[level] & ((uint64_t)1 << slot))) continue;
+
+            uint64_t distance = (slot - base) & (kSlots - 1);
+            if (0 == distance) distance = kSlots;
+
+            uint64_t tick = (base + distance) << shift;
+            if (tick < next) next = tick;
+        }
+    }
+
+    return next;
+}
+
+// runs the wheel up to _now, jumping straight from one tick with work to the next.
+void TimerService::__Advance(uint64_t _now, std::vector<Due>& _due) {
+    while (true) {
+        uint64_t tick = __NextTick();
+        if (tick > _now) break;
+
+        now_tick_ = tick;
+
+        for (int level = 1; level < kLevels; ++level) {
+            int shift = kSlotBits * level;
+            if (0 != (tick & (((uint64_t)1 << shift) - 1))) break;
+
+            int slot = (int)((tick >> shift) & (kSlots - 1));
+            Entry* entry = wheel_[level][slot];
+            wheel_[level][slot] = NULL;
+            occupied_[level] &= ~((uint64_t)1 << slot);
+
+            while (NULL != entry) {
+                Entry* next = entry->next;
+                __Insert(entry);
+                entry = next;
+            }
+        }
+
+        int slot = (int)(tick & (kSlots - 1));
+        Entry* entry = wheel_[0][slot];
+        wheel_[0][slot] = NULL;
+        occupied_[0] &= ~((uint64_t)1 << slot);
+
+        while (NULL != entry) {
+            Entry* next = entry->next;
+            ASSERT2(entry->expire <= tick, "expire:%llu, tick:%llu", (unsigned long long)entry->expire, (unsigned long long)tick);
+            entry->level = -1;
+            _due.push_back(Due(entry->handler, std::move(entry->task), entry->name));
+            __Free(entry);
+            --size_;
+            entry = next;
+        }
+    }
+
+    if (now_tick_ < _now) now_tick_ = _now;
+}
+
+}
@@ -0,0 +1,96 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * timer_service.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef TIMER_SERVICE_H_
+#define TIMER_SERVICE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "mars/comm/messagequeue/message_queue.h"
+#include "mars/comm/thread/lock.h"
+
+namespace MessageQueue {
+
+/*
+ * The timers of the whole process, used by Alarm.
+ *
+ * Timers sit in a hierarchical wheel: 4 levels of 64 slots, 1ms, 64ms, 4s and 4.4min a slot.
+ * Start and Cancel are O(1), a timer further out than the wheel (~4.6h) is parked in the last level until it gets close.
+ * The wheel has no thread of its own: one delayed message on the default message queue wakes it at the next slot with timers,
+ * it then posts each due task to its handler with PostTask.
+ */
+class TimerService {
+  public:
+    typedef uint64_t TimerId;   // 0 is never a valid id
+    static const TimerId kInvalidTimer = 0;
+
+    static TimerService& Instance();
+
+  public:
+    TimerId Start(int64_t _after, const MessageHandler_t& _handlerid, MessageTask&& _task, const MessageName& _name = "TimerService");
+    // false if the timer has fired (its task may still be on the way to the queue) or the id is unknown.
+    bool Cancel(TimerId _id);
+
+    size_t Size();
+    uint64_t Wakeups();     // times the wheel was run, for tests and benchmarks
+
+  private:
+    struct Entry;
+    struct Due;
+
+    TimerService();
+    ~TimerService();
+
+    void __OnTick(uint64_t _tick_seq);
+    void __Schedule();
+    void __Insert(Entry* _entry);
+    void __Unlink(Entry* _entry);
+    void __Advance(uint64_t _now, std::vector<Due>& _due);
+    uint64_t __NextTick() const;
+    void __Free(Entry* _entry);
+
+  private:
+    TimerService(const TimerService&);
+    TimerService& operator=(const TimerService&);
+
+  private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+
+    Mutex mutex_;
+    MessageHandler_t handler_;  // on the default message queue
+    MessagePost_t tick_;
+    uint64_t tick_seq_;     // of the wakeup posted last, the ones it replaced do nothing
+
+    uint64_t now_tick_;     // the wheel has run up to here
+    uint64_t wake_tick_;    // the wakeup posted is for this tick, 0 when none is
+    uint64_t wakeups_;
+
+    Entry* wheel_[kLevels][kSlots];
+    uint64_t occupied_[kLevels];    // a bit per non-empty slot
+
+    std::vector<Entry*> entries_;   // by TimerId low 32 bits, reused through free_
+    std::vector<uint32_t> free_;
+    size_t size_;
+};
+
+}
+
+#endif /* TIMER_SERVICE_H_ */
@@ -19,6 +19,8 @@
 
 #include "comm/network/getdnssvraddrs.h"
 
+#include <stdio.h>
+
 namespace mars {
     namespace comm {
 #ifdef ANDROID
@@ -85,6 +87,22 @@ void getdnssvraddrs(std::vector<socket_address>& _dnssvraddrs) {
     
     return;
 }
+#elif defined __linux__
+void getdnssvraddrs(std::vector<socket_address>& _dnssvraddrs) {
+    FILE* fp = fopen("/etc/resolv.conf", "r");
+    if (NULL == fp) return;
+
+    char line[256];
+    char ip[64];
+
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        if (1 == sscanf(line, " nameserver %63s", ip)) {
+            _dnssvraddrs.push_back(socket_address(ip, 53));
+        }
+    }
+
+    fclose(fp);
+}
 #else
 void getdnssvraddrs(std::vector<socket_address>& _dnssvraddrs) {
 }
@@ -27,6 +27,7 @@
 
 #include <limits.h>
 #include <algorithm>
+#include <map>
 #include <math.h>
 
 #include "comm/xlogger/xlogger.h"
@@ -38,12 +39,17 @@
 #include "comm/time_utils.h"
 #include "comm/crypt/ibase64.h"
 #include "comm/platform_comm.h"
+#include "comm/thread/lock.h"
 
 #ifdef COMPLEX_CONNECT_NAMESPACE
 namespace COMPLEX_CONNECT_NAMESPACE {
 #endif
 
 static const unsigned int kTimeoutModeIncreaseInterval = 1000;
+static const unsigned int kMinConnectDelay = 100;               // rfc 8305 5, the least connection attempt delay
+static const unsigned int kConnectDelayRttFactor = 2;
+static const uint64_t kConnectHistoryExpire = 10 * 60 * 1000;
+static const size_t kConnectHistoryMaxSize = 256;
     
 ComplexConnect::ComplexConnect(unsigned int _timeout, unsigned int _interval)
     : timeout_(_timeout), interval_(_interval), error_interval_(_interval), max_connect_(3), trycount_(0), index_(-1), errcode_(0)
@@ -64,6 +70,20 @@ ComplexConnect::ComplexConnect(unsigned int _timeout /*ms*/, unsigned int _inter
 ComplexConnect::~ComplexConnect()
 {}
 
+int ComplexConnect::__ConnectDelay(unsigned int _started, int _srtt, bool _lasterror) const {
+    unsigned int delay = _lasterror ? error_interval_ : interval_;
+
+    if (each_IP_timeout_mode_ == EachIPConnectTimoutMode::MODE_INCREASE) {
+        unsigned int timeout_interval = (unsigned int)(kTimeoutModeIncreaseInterval * pow(2, _started));
+        delay = std::min(timeout_interval, interval_);
+    }
+
+    // the configured interval is the most a connect waits before the next starts, less when connects are known to be fast.
+    if (0 <= _srtt) delay = std::min(delay, std::max(std::min(kMinConnectDelay, delay), kConnectDelayRttFactor * (unsigned int)_srtt));
+
+    return (int)delay;
+}
+
 int ComplexConnect::__ConnectTime(unsigned int _index) const {
     return _index * interval_;
 }
@@ -444,6 +464,129 @@ private:
 
 
 static bool __isconnecting(const ConnectCheckFSM* _ref) { return NULL != _ref && INVALID_SOCKET != _ref->Socket(); }
+
+struct ConnectHistory {
+    ConnectHistory(): srtt(0), failures(0), time(0) {}
+    unsigned int srtt;
+    unsigned int failures;
+    uint64_t time;
+};
+
+// connect rtt by ip:port, and of all of them, what ConnectImpatient orders addresses and spaces connects by.
+class ConnectHistoryTable {
+  public:
+    ConnectHistoryTable(): srtt_(-1) {}
+
+    void OnConnected(const socket_address& _addr, unsigned int _rtt) {
+        ScopedLock lock(mutex_);
+        ConnectHistory& history = __Get(_addr);
+        history.srtt = 0 == history.time || 0 < history.failures ? _rtt : (7 * history.srtt + _rtt) / 8;
+        history.failures = 0;
+        history.time = gettickcount();
+        srtt_ = 0 > srtt_ ? (int)_rtt : (int)((7 * (unsigned int)srtt_ + _rtt) / 8);
+    }
+
+    void OnFailed(const socket_address& _addr) {
+        ScopedLock lock(mutex_);
+        ConnectHistory& history = __Get(_addr);
+        ++history.failures;
+        history.time = gettickcount();
+    }
+
+    bool Find(const socket_address& _addr, ConnectHistory& _history) {
+        ScopedLock lock(mutex_);
+        std::map<std::string, ConnectHistory>::iterator it = table_.find(_addr.url());
+        if (it == table_.end() || gettickcount() - it->second.time > kConnectHistoryExpire) return false;
+        _history = it->second;
+        return true;
+    }
+
+    int Srtt() {
+        ScopedLock lock(mutex_);
+        return srtt_;
+    }
+
+    void Clear() {
+        ScopedLock lock(mutex_);
+        table_.clear();
+        srtt_ = -1;
+    }
+
+  private:
+    ConnectHistory& __Get(const socket_address& _addr) {
+        if (kConnectHistoryMaxSize <= table_.size() && table_.end() == table_.find(_addr.url())) {
+            std::map<std::string, ConnectHistory>::iterator oldest = table_.begin();
+            for (std::map<std::string, ConnectHistory>::iterator it = table_.begin(); it != table_.end(); ++it) {
+                if (it->second.time < oldest->second.time) oldest = it;
+            }
+            table_.erase(oldest);
+        }
+
+        return table_[_addr.url()];
+    }
+
+  private:
+    Mutex mutex_;
+    std::map<std::string, ConnectHistory> table_;
+    int srtt_;
+};
+
+static ConnectHistoryTable& __HistoryTable() {
+    static ConnectHistoryTable* s_table = new ConnectHistoryTable;
+    return *s_table;
+}
+
+struct ConnectCandidate {
+    unsigned int index;
+    int rank;       // 0 connected before, 1 no history, 2 failed last time
+    unsigned int key;
+};
+
+static bool __CandidateLess(const ConnectCandidate& _l, const ConnectCandidate& _r) {
+    return _l.rank != _r.rank ? _l.rank < _r.rank : _l.key < _r.key;
+}
+
+/*
+ * rfc 8305 4: the addresses that connected fast before go first, then the ones without history in the given order,
+ * the ones that failed last. From there ipv6 and ipv4 take turns, the family of the first address starting.
+ */
+static void __ScheduleOrder(const std::vector<socket_address>& _vecaddr, std::vector<unsigned int>& _order, std::vector<int>& _srtt) {
+    std::vector<ConnectCandidate> candidates;
+
+    for (unsigned int i = 0; i < _vecaddr.size(); ++i) {
+        ConnectCandidate candidate = {i, 1, i};
+        ConnectHistory history;
+
+        if (__HistoryTable().Find(_vecaddr[i], history)) {
+            candidate.rank = 0 < history.failures ? 2 : 0;
+            candidate.key = 0 < history.failures ? history.failures : history.srtt;
+            if (0 == history.failures) _srtt[i] = (int)history.srtt;
+        }
+
+        candidates.push_back(candidate);
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), &__CandidateLess);
+
+    std::vector<unsigned int> v6, v4;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        (_vecaddr[candidates[i].index].isv6() ? v6 : v4).push_back(candidates[i].index);
+    }
+
+    std::vector<unsigned int>& first = _vecaddr[candidates.front().index].isv6() ? v6 : v4;
+    std::vector<unsigned int>& second = &first == &v6 ? v4 : v6;
+
+    for (size_t i = 0; i < std::max(first.size(), second.size()); ++i) {
+        if (i < first.size()) _order.push_back(first[i]);
+        if (i < second.size()) _order.push_back(second[i]);
+    }
+}
+}
+
+// the rtts and failures were of the old network's paths, they say nothing of the new one.
+void ComplexConnect::ClearHistory() {
+    xinfo2(TSF"clear connect history");
+    __HistoryTable().Clear();
 }
 
 SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _vecaddr,
@@ -471,6 +614,22 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
     uint64_t  starttime = gettickcount();
     std::vector<ConnectCheckFSM*> vecsocketfsm;
 
+    // through a proxy, every connect goes to the proxy, no history of the addresses is kept.
+    bool direct = NULL == _proxy_addr || (mars::comm::kProxyHttpTunel != _proxy_type && mars::comm::kProxySocks5 != _proxy_type);
+    std::vector<unsigned int> order;
+    std::vector<int> srtt(_vecaddr.size(), -1);
+    int all_srtt = __HistoryTable().Srtt();
+
+    if (direct) {
+        __ScheduleOrder(_vecaddr, order, srtt);
+    } else {
+        for (unsigned int i = 0; i < _vecaddr.size(); ++i) order.push_back(i);
+    }
+
+    for (unsigned int i = 0; i < srtt.size(); ++i) {
+        if (0 > srtt[i]) srtt[i] = all_srtt;
+    }
+
     for (unsigned int i = 0; i < _vecaddr.size(); ++i) {
         xinfo2(TSF"complex.conn %_", _vecaddr[i].url());
 
@@ -507,47 +666,44 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
         SocketSelect sel(_breaker);
         sel.PreSelect();
 
-        int next_connect_timeout = 0;
-        if (each_IP_timeout_mode_ == EachIPConnectTimoutMode::MODE_INCREASE) {
-            unsigned int timeout_interval = (unsigned int)(kTimeoutModeIncreaseInterval * pow(2, index));
-            int connect_internal = std::min(timeout_interval, interval_);
-            next_connect_timeout = int(connect_internal - (curtime - laststart_connecttime));
-        } else {
-            next_connect_timeout = int(((0 == lasterror) ? interval_ : error_interval_) - (curtime - laststart_connecttime));
-        }
+        int next_connect_timeout = int(__ConnectDelay(index, 0 < index ? srtt[order[index - 1]] : -1, 0 != lasterror) - (curtime - laststart_connecttime));
 
         xinfo2(TSF"next_connect_timeout %_", next_connect_timeout);
 
         int timeout = (int)timeout_;
         unsigned int runing_count = (unsigned int)std::count_if(vecsocketfsm.begin(), vecsocketfsm.end(), &__isconnecting);
 
+        // one is connected and being verified, no more connects start behind it.
+        bool connected = false;
+        for (unsigned int k = 0; k < index; ++k) {
+            if (NULL != vecsocketfsm[order[k]] && TcpClientFSM::EReadWrite == vecsocketfsm[order[k]]->Status()) connected = true;
+        }
+
         if (index < vecsocketfsm.size()
                 && 0 < next_connect_timeout
-                && runing_count < max_connect_) {
+                && runing_count < max_connect_
+                && !connected) {
             timeout = std::min(timeout, next_connect_timeout);
         }
 
         // connect
         if (index < vecsocketfsm.size()
                 && 0 >= next_connect_timeout
-                && runing_count < max_connect_) {
-            if (runing_count + 1 < max_connect_) {
-                if (each_IP_timeout_mode_ == EachIPConnectTimoutMode::MODE_INCREASE) {
-                    unsigned int timeout_interval = (unsigned int)(kTimeoutModeIncreaseInterval * pow(2, index));
-                    timeout = std::min(timeout, (int)std::min(interval_, timeout_interval));
-                } else {
-                    timeout = std::min(timeout, (int)interval_);
-                }
-            }
-
+                && runing_count < max_connect_
+                && !connected) {
             laststart_connecttime = gettickcount();
             lasterror = 0;
 
             trycount_ = (unsigned int)(index + 1);
             ++index;
+
+            if (runing_count + 1 < max_connect_) {
+                timeout = std::min(timeout, __ConnectDelay(index, srtt[order[index - 1]], false));
+            }
         }
 
-        for (unsigned int i = 0; i < index; ++i) {
+        for (unsigned int k = 0; k < index; ++k) {
+            unsigned int i = order[k];
             if (NULL == vecsocketfsm[i]) continue;
 
             xgroup2_define(group);
@@ -587,7 +743,8 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
         }
 
         // socket
-        for (unsigned int i = 0; i < index; ++i) {
+        for (unsigned int k = 0; k < index; ++k) {
+            unsigned int i = order[k];
             if (NULL == vecsocketfsm[i]) continue;
 
             xgroup2_define(group);
@@ -595,6 +752,7 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
             xgroup2_if(!group.Empty(), TSF"index:%_, @%_, ", i, this) << group;
 
             if (TcpClientFSM::EEnd == vecsocketfsm[i]->Status()) {
+                if (direct) __HistoryTable().OnFailed(_vecaddr[i]);
                 if (_observer) _observer->OnFinished(i, socket_address(&vecsocketfsm[i]->Address()), vecsocketfsm[i]->Socket(), vecsocketfsm[i]->Error(),
                                                          vecsocketfsm[i]->Rtt(), vecsocketfsm[i]->TotalRtt(), (int)(gettickcount() - starttime));
 
@@ -607,6 +765,7 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
             }
 
             if (TcpClientFSM::EReadWrite == vecsocketfsm[i]->Status() && ConnectCheckFSM::ECheckFail == vecsocketfsm[i]->CheckStatus()) {
+                if (direct) __HistoryTable().OnFailed(_vecaddr[i]);
                 if (_observer) _observer->OnFinished(i, socket_address(&vecsocketfsm[i]->Address()), vecsocketfsm[i]->Socket(), vecsocketfsm[i]->Error(),
                                                          vecsocketfsm[i]->Rtt(), vecsocketfsm[i]->TotalRtt(), (int)(gettickcount() - starttime));
 
@@ -619,6 +778,7 @@ SOCKET ComplexConnect::ConnectImpatient(const std::vector<socket_address>& _veca
             }
 
             if (TcpClientFSM::EReadWrite == vecsocketfsm[i]->Status() && ConnectCheckFSM::ECheckOK == vecsocketfsm[i]->CheckStatus()) {
+                if (direct) __HistoryTable().OnConnected(_vecaddr[i], vecsocketfsm[i]->Rtt());
                 if (_observer) _observer->OnFinished(i, socket_address(&vecsocketfsm[i]->Address()), vecsocketfsm[i]->Socket(), vecsocketfsm[i]->Error(),
                                                          vecsocketfsm[i]->Rtt(), vecsocketfsm[i]->TotalRtt(), (int)(gettickcount() - starttime));
 
@@ -18,8 +18,21 @@
  *      Author: yerungui
  */
 
+// included once plain and once more with COMPLEX_CONNECT_NAMESPACE (coroutine/coro_socket.h), a guard for each.
+#ifdef COMPLEX_CONNECT_NAMESPACE
+#ifndef COMPLEXCONNECT_NAMESPACE_H_
+#define COMPLEXCONNECT_NAMESPACE_H_
+#define COMPLEXCONNECT_DECLARE_
+#endif
+#else
 #ifndef COMPLEXCONNECT_H_
 #define COMPLEXCONNECT_H_
+#define COMPLEXCONNECT_DECLARE_
+#endif
+#endif
+
+#ifdef COMPLEXCONNECT_DECLARE_
+#undef COMPLEXCONNECT_DECLARE_
 
 #include <stddef.h>
 #include <vector>
@@ -66,10 +79,16 @@ class ComplexConnect {
     ComplexConnect(unsigned int _timeout /*ms*/, unsigned int _interval /*ms*/, EachIPConnectTimoutMode _mode);
     ~ComplexConnect();
 
+    /*
+     * Happy Eyeballs (rfc 8305): addresses that connected fast before go first, ipv6 and ipv4 take turns,
+     * and the next connect starts twice the connect rtt after the last (at most the interval) when it is known.
+     */
     SOCKET ConnectImpatient(const std::vector<socket_address>& _vecaddr, SocketBreaker& _breaker, MComplexConnect* _observer = NULL,
                             mars::comm::ProxyType _proxy_type = mars::comm::kProxyNone, const socket_address* _proxy_addr = NULL,
                             const std::string& _proxy_username = "", const std::string& _proxy_pwd = "");
 
+    static void ClearHistory();     // when the network changes
+
     unsigned int TryCount() const { return trycount_;}
     int Index() const { return index_;}
     int ErrorCode() const { return errcode_;}
@@ -80,6 +99,7 @@ class ComplexConnect {
     bool IsInterrupted() const{ return is_interrupted_;};
 
   private:
+    int __ConnectDelay(unsigned int _started, int _srtt, bool _lasterror) const;
     int __ConnectTime(unsigned int _index) const;
     int __ConnectTimeout(unsigned int _index) const;
 
@@ -0,0 +1,339 @@
+#include "comm/socket/complexconnect.h"
+#include "comm/socket/socket_address.h"
+#include "comm/socket/socketbreaker.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "autobuffer.h"
+#include "boost/bind.hpp"
+#include "thread/lock.h"
+#include "thread/thread.h"
+#include "time_utils.h"
+
+namespace
+{
+
+/*
+ * A loopback listener. kGood accepts, kRefused is closed again so connects are refused,
+ * kBlackhole has its accept queue full so the syns are dropped, kSlow frees its queue after 300ms
+ * and the connect lands on the syn retransmit (about 1s), kVerify answers the verify packet after 300ms.
+ */
+class Listener {
+  public:
+	enum TKind { kGood, kRefused, kBlackhole, kSlow, kVerify };
+
+	Listener(TKind _kind, bool _v6 = false)
+	: kind_(_kind), v6_(_v6), fd_(-1), port_(0), running_(true), thread_(boost::bind(&Listener::__Run, this)) {
+		fd_ = socket(_v6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0);
+		__Bind(fd_);
+		listen(fd_, kBlackhole == kind_ || kSlow == kind_ ? 0 : 16);
+
+		if (kRefused == kind_) {
+			close(fd_);
+			fd_ = -1;
+			return;
+		}
+
+		if (kBlackhole == kind_ || kSlow == kind_) __FillBacklog();
+		thread_.start();
+	}
+
+	~Listener() {
+		{
+			ScopedLock lock(mutex_);
+			running_ = false;
+		}
+		if (thread_.isruning()) thread_.join();
+		for (size_t i = 0; i < fds_.size(); ++i) close(fds_[i]);
+		if (0 <= fd_) close(fd_);
+	}
+
+	socket_address Address() const { return socket_address(v6_ ? "::1" : "127.0.0.1", port_); }
+
+	// a listener that was connected to no longer is, the next connects are refused.
+	void Close() {
+		ScopedLock lock(mutex_);
+		if (0 > fd_) return;
+		shutdown(fd_, SHUT_RDWR);
+		close(fd_);
+		fd_ = -1;
+	}
+
+  private:
+	void __Bind(int _fd) {
+		if (v6_) {
+			sockaddr_in6 addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin6_family = AF_INET6;
+			addr.sin6_addr = in6addr_loopback;
+			bind(_fd, (sockaddr*)&addr, sizeof(addr));
+			socklen_t len = sizeof(addr);
+			getsockname(_fd, (sockaddr*)&addr, &len);
+			port_ = ntohs(addr.sin6_port);
+		} else {
+			sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bind(_fd, (sockaddr*)&addr, sizeof(addr));
+			socklen_t len = sizeof(addr);
+			getsockname(_fd, (sockaddr*)&addr, &len);
+			port_ = ntohs(addr.sin_port);
+		}
+	}
+
+	// connects nobody accepts until one of them hangs in syn sent.
+	void __FillBacklog() {
+		for (int i = 0; i < 8; ++i) {
+			int fd = socket(v6_ ? AF_INET6 : AF_INET, SOCK_STREAM, 0);
+			fcntl(fd, F_SETFL, O_NONBLOCK);
+			sockaddr_storage addr;
+			socklen_t len = sizeof(addr);
+			getsockname(fd_, (sockaddr*)&addr, &len);
+			connect(fd, (sockaddr*)&addr, len);
+			fds_.push_back(fd);
+
+			pollfd pfd = {fd, POLLOUT, 0};
+			if (0 == poll(&pfd, 1, 50)) return;
+		}
+	}
+
+	void __Run() {
+		uint64_t start = gettickcount();
+
+		while (true) {
+			{
+				ScopedLock lock(mutex_);
+				if (!running_ || 0 > fd_) return;
+			}
+
+			if (kBlackhole == kind_ || (kSlow == kind_ && gettickcount() - start < 300)) {
+				usleep(10 * 1000);
+				continue;
+			}
+
+			pollfd pfd = {fd_, POLLIN, 0};
+			if (0 >= poll(&pfd, 1, 20)) continue;
+
+			int fd = accept(fd_, NULL, NULL);
+			if (0 > fd) continue;
+			fds_.push_back(fd);
+
+			if (kVerify == kind_) {
+				char buf[16];
+				if (0 < recv(fd, buf, sizeof(buf), 0)) {
+					usleep(300 * 1000);
+					send(fd, "ok", 2, MSG_NOSIGNAL);
+				}
+			}
+		}
+	}
+
+  private:
+	TKind kind_;
+	bool v6_;
+	int fd_;
+	uint16_t port_;
+	std::vector<int> fds_;
+
+	Mutex mutex_;
+	bool running_;
+	Thread thread_;
+};
+
+// when each connect started, by the index of its address.
+class ConnectRecord : public MComplexConnect {
+  public:
+	ConnectRecord(bool _verify = false): verify_(_verify), start_(gettickcount()) {}
+
+	virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket) {
+		order.push_back(_index);
+		ticks.push_back((int)(gettickcount() - start_));
+	}
+
+	virtual bool OnShouldVerify(unsigned int _index, const socket_address& _addr) { return verify_; }
+	virtual bool OnVerifySend(unsigned int _index, const socket_address& _addr, SOCKET _socket, AutoBuffer& _buffer_send) {
+		_buffer_send.Write("hi", 2);
+		return true;
+	}
+	virtual bool OnVerifyRecv(unsigned int _index, const socket_address& _addr, SOCKET _socket, const AutoBuffer& _buffer_recv) { return true; }
+
+	std::vector<unsigned int> order;
+	std::vector<int> ticks;
+
+  private:
+	bool verify_;
+	uint64_t start_;
+};
+
+static std::vector<unsigned int> Order(unsigned int _a, unsigned int _b, int _c = -1, int _d = -1, int _e = -1) {
+	std::vector<unsigned int> order;
+	order.push_back(_a);
+	order.push_back(_b);
+	if (0 <= _c) order.push_back(_c);
+	if (0 <= _d) order.push_back(_d);
+	if (0 <= _e) order.push_back(_e);
+	return order;
+}
+
+// the long link's timeouts, the interval and error interval as given.
+static int Connect(const std::vector<socket_address>& _addrs, ConnectRecord& _record, unsigned int _interval = 4000, unsigned int _error_interval = 100) {
+	SocketBreaker breaker;
+	ComplexConnect conn(10 * 1000, _interval, _error_interval, 3);
+	SOCKET sock = conn.ConnectImpatient(_addrs, breaker, &_record);
+	if (INVALID_SOCKET != sock) close(sock);
+	return INVALID_SOCKET == sock ? -1 : conn.Index();
+}
+
+class ComplexConnectSchedule : public ::testing::Test {
+  protected:
+	virtual void SetUp() { ComplexConnect::ClearHistory(); }
+	virtual void TearDown() { ComplexConnect::ClearHistory(); }
+};
+
+}
+
+TEST_F(ComplexConnectSchedule, history_ranking)
+{
+	Listener fast(Listener::kGood), failed(Listener::kRefused), fresh(Listener::kRefused);
+
+	std::vector<socket_address> addrs;
+	addrs.push_back(failed.Address());
+	addrs.push_back(fast.Address());
+	ConnectRecord first;
+	EXPECT_EQ(1, Connect(addrs, first));
+	EXPECT_EQ(Order(0, 1), first.order);
+
+	Listener slow(Listener::kSlow);
+	ConnectRecord slow_record;
+	EXPECT_EQ(0, Connect(std::vector<socket_address>(1, slow.Address()), slow_record));
+
+	// connected before by rtt, then no history in the given order, failed last time at the end.
+	fast.Close();
+	slow.Close();
+	addrs.clear();
+	addrs.push_back(failed.Address());
+	addrs.push_back(fresh.Address());
+	addrs.push_back(slow.Address());
+	addrs.push_back(fast.Address());
+	ConnectRecord ranked;
+	EXPECT_EQ(-1, Connect(addrs, ranked));
+	EXPECT_EQ(Order(3, 2, 1, 0), ranked.order);
+}
+
+TEST_F(ComplexConnectSchedule, v6_v4_interleave)
+{
+	Listener v6a(Listener::kRefused, true), v6b(Listener::kRefused, true);
+	Listener v4a(Listener::kRefused), v4b(Listener::kRefused), v4c(Listener::kRefused);
+
+	std::vector<socket_address> addrs;
+	addrs.push_back(v6a.Address());
+	addrs.push_back(v6b.Address());
+	addrs.push_back(v4a.Address());
+	addrs.push_back(v4b.Address());
+	addrs.push_back(v4c.Address());
+
+	ConnectRecord record;
+	EXPECT_EQ(-1, Connect(addrs, record));
+	EXPECT_EQ(Order(0, 2, 1, 3, 4), record.order);
+
+	// the family of the first address starts.
+	std::swap(addrs[0], addrs[2]);
+	ConnectRecord swapped;
+	ComplexConnect::ClearHistory();
+	EXPECT_EQ(-1, Connect(addrs, swapped));
+	EXPECT_EQ(Order(0, 1, 3, 2, 4), swapped.order);
+}
+
+TEST_F(ComplexConnectSchedule, rtt_delay_clamped_to_interval)
+{
+	Listener blackhole(Listener::kBlackhole), good(Listener::kGood), known(Listener::kGood);
+
+	std::vector<socket_address> addrs;
+	addrs.push_back(blackhole.Address());
+	addrs.push_back(good.Address());
+
+	// no history, the next connect starts after the interval.
+	ConnectRecord none;
+	EXPECT_EQ(1, Connect(addrs, none, 600));
+	ASSERT_EQ(2u, none.ticks.size());
+	EXPECT_LE(550, none.ticks[1] - none.ticks[0]);
+	EXPECT_GE(800, none.ticks[1] - none.ticks[0]);
+
+	// loopback connects are fast, the next starts after the least delay...
+	ComplexConnect::ClearHistory();
+	ConnectRecord warm;
+	EXPECT_EQ(0, Connect(std::vector<socket_address>(1, known.Address()), warm));
+	ConnectRecord fast;
+	EXPECT_EQ(1, Connect(addrs, fast, 600));
+	ASSERT_EQ(2u, fast.ticks.size());
+	EXPECT_LE(80, fast.ticks[1] - fast.ticks[0]);
+	EXPECT_GE(300, fast.ticks[1] - fast.ticks[0]);
+
+	// ...but never more than the interval.
+	ComplexConnect::ClearHistory();
+	ConnectRecord warm_again;
+	EXPECT_EQ(0, Connect(std::vector<socket_address>(1, known.Address()), warm_again));
+	ConnectRecord short_interval;
+	EXPECT_EQ(1, Connect(addrs, short_interval, 40));
+	ASSERT_EQ(2u, short_interval.ticks.size());
+	EXPECT_GE(80, short_interval.ticks[1] - short_interval.ticks[0]);
+
+	// twice a slow rtt is past the interval, the interval is what it waits.
+	ComplexConnect::ClearHistory();
+	Listener slow(Listener::kSlow);
+	ConnectRecord slow_record;
+	EXPECT_EQ(0, Connect(std::vector<socket_address>(1, slow.Address()), slow_record));
+	ConnectRecord clamped;
+	EXPECT_EQ(1, Connect(addrs, clamped, 600));
+	ASSERT_EQ(2u, clamped.ticks.size());
+	EXPECT_LE(550, clamped.ticks[1] - clamped.ticks[0]);
+	EXPECT_GE(800, clamped.ticks[1] - clamped.ticks[0]);
+}
+
+TEST_F(ComplexConnectSchedule, no_new_connect_while_verifying)
+{
+	Listener verify(Listener::kVerify), good(Listener::kGood);
+
+	std::vector<socket_address> addrs;
+	addrs.push_back(verify.Address());
+	addrs.push_back(good.Address());
+
+	// the verify answer takes 300ms, with a 50ms interval the second address would have been tried long before.
+	ConnectRecord record(true);
+	EXPECT_EQ(0, Connect(addrs, record, 50, 50));
+	EXPECT_EQ(std::vector<unsigned int>(1, 0), record.order);
+}
+
+TEST_F(ComplexConnectSchedule, clear_history)
+{
+	Listener good(Listener::kGood), failed(Listener::kRefused);
+
+	std::vector<socket_address> addrs;
+	addrs.push_back(failed.Address());
+	addrs.push_back(good.Address());
+
+	ConnectRecord first;
+	EXPECT_EQ(1, Connect(addrs, first));
+	EXPECT_EQ(Order(0, 1), first.order);
+
+	ConnectRecord remembered;
+	EXPECT_EQ(1, Connect(addrs, remembered));
+	EXPECT_EQ(std::vector<unsigned int>(1, 1), remembered.order);
+
+	// a new network, the given order again.
+	ComplexConnect::ClearHistory();
+	ConnectRecord cleared;
+	EXPECT_EQ(1, Connect(addrs, cleared));
+	EXPECT_EQ(Order(0, 1), cleared.order);
+}
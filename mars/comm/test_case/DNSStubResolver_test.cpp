@@ -0,0 +1,277 @@
+
+#include "../dns/dns_stub_resolver.h"
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+#include "boost/bind.hpp"
+#include "socket/unix_socket.h"
+#include "thread/condition.h"
+#include "thread/thread.h"
+#include "time_utils.h"
+
+
+namespace
+{
+
+enum FakeMode {
+	kAnswer,		// an A and an AAAA record, behind a compressed cname
+	kSilent,
+	kTruncated,		// TC set, no record
+	kTruncatedPartial,
+	kNXDomain,
+	kServFail,
+};
+
+class FakeDNSServer {
+  public:
+	FakeDNSServer(FakeMode _mode)
+	: mode_(_mode), address_("127.0.0.1", 0), queries_(0), thread_(boost::bind(&FakeDNSServer::__Run, this)) {
+		sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(sock_, (sockaddr*)&addr, sizeof(addr));
+		socklen_t len = sizeof(addr);
+		getsockname(sock_, (sockaddr*)&addr, &len);
+		address_ = socket_address(addr);
+		thread_.start();
+	}
+
+	~FakeDNSServer() {
+		shutdown(sock_, SHUT_RDWR);
+		socket_close(sock_);
+		thread_.join();
+	}
+
+	const socket_address& Address() const { return address_; }
+	int Queries() const { return queries_; }
+
+  private:
+	void __Run() {
+		uint8_t buf[512];
+
+		while (true) {
+			sockaddr_in from;
+			socklen_t from_len = sizeof(from);
+			int len = (int)recvfrom(sock_, (char*)buf, sizeof(buf), 0, (sockaddr*)&from, &from_len);
+			if (12 > len) return;
+
+			++queries_;
+			if (kSilent == mode_) continue;
+
+			std::string resp = __Response(buf, len);
+			sendto(sock_, resp.data(), resp.size(), 0, (sockaddr*)&from, from_len);
+		}
+	}
+
+	std::string __Response(const uint8_t* _query, int _len) {
+		std::string resp((const char*)_query, _len);
+		uint16_t qtype = (_query[_len - 4] << 8) | _query[_len - 3];
+		uint16_t flags = 0x8180;
+		uint16_t ancount = 0;
+
+		if (kTruncated == mode_ || kTruncatedPartial == mode_) flags |= 0x0200;
+		if (kNXDomain == mode_) flags |= 3;
+		if (kServFail == mode_) flags |= 2;
+
+		if (kAnswer == mode_ || kTruncatedPartial == mode_) {
+			// the cname points back at the question name, its target is the owner of the address.
+			const uint8_t cname[] = {0xC0, 0x0C, 0, 5, 0, 1, 0, 0, 0, 100, 0, 6, 3, 'c', 'd', 'n', 0xC0, 0x0C};
+			resp.append((const char*)cname, sizeof(cname));
+			const uint8_t owner[] = {(uint8_t)(0xC0 | ((_len + 12) >> 8)), (uint8_t)(_len + 12)};
+			resp.append((const char*)owner, sizeof(owner));
+
+			if (1 == qtype) {
+				const uint8_t a[] = {0, 1, 0, 1, 0, 0, 0, 30, 0, 4, 10, 0, 0, 1};
+				resp.append((const char*)a, sizeof(a));
+			} else {
+				const uint8_t aaaa[] = {0, 28, 0, 1, 0, 0, 0, 60, 0, 16, 0x24, 0x08, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+				resp.append((const char*)aaaa, sizeof(aaaa));
+			}
+			ancount = 2;
+		}
+
+		resp[2] = (char)(flags >> 8);
+		resp[3] = (char)flags;
+		resp[6] = 0;
+		resp[7] = (char)ancount;
+		return resp;
+	}
+
+  private:
+	FakeMode mode_;
+	SOCKET sock_;
+	socket_address address_;
+	volatile int queries_;
+	Thread thread_;
+};
+
+class Result {
+  public:
+	Result(): done_(false), status_(-1), ttl_(0) {}
+
+	void OnResolved(int _status, const std::vector<std::string>& _ips, uint32_t _ttl) {
+		ScopedLock lock(mutex_);
+		status_ = _status;
+		ips_ = _ips;
+		ttl_ = _ttl;
+		done_ = true;
+		cond_.notifyAll(lock);
+	}
+
+	bool Wait(long _timeout) {
+		ScopedLock lock(mutex_);
+		uint64_t end = gettickcount() + _timeout;
+		while (!done_ && gettickcount() < end) cond_.wait(lock, (long)(end - gettickcount()));
+		return done_;
+	}
+
+	DNSStubResolver::Callback Callback() { return boost::bind(&Result::OnResolved, this, _1, _2, _3); }
+
+	int status_;
+	std::vector<std::string> ips_;
+	uint32_t ttl_;
+
+  private:
+	Mutex mutex_;
+	Condition cond_;
+	bool done_;
+};
+
+static mq::MessageHandler_t Handler() {
+	return mq::DefAsyncInvokeHandler(mq::GetDefMessageQueue());
+}
+
+}
+
+TEST(DNSStubResolver, answer)
+{
+	FakeDNSServer server(kAnswer);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	resolver.Resolve("www.qq.com", AF_UNSPEC, 2000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveOK, result.status_);
+	ASSERT_EQ(2u, result.ips_.size());
+	EXPECT_EQ("2408::1", result.ips_[0]);
+	EXPECT_EQ("10.0.0.1", result.ips_[1]);
+	EXPECT_EQ(30u, result.ttl_);
+	EXPECT_EQ(2, server.Queries());
+}
+
+TEST(DNSStubResolver, ipv4_only)
+{
+	FakeDNSServer server(kAnswer);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	resolver.Resolve("www.qq.com", AF_INET, 2000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	ASSERT_EQ(1u, result.ips_.size());
+	EXPECT_EQ("10.0.0.1", result.ips_[0]);
+	EXPECT_EQ(1, server.Queries());
+}
+
+TEST(DNSStubResolver, timeout)
+{
+	FakeDNSServer server(kSilent);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	uint64_t start = gettickcount();
+	resolver.Resolve("www.qq.com", AF_UNSPEC, 1000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveTimeout, result.status_);
+	EXPECT_LE(1000u, gettickcount() - start);
+	// asked again once, A and AAAA each time.
+	EXPECT_EQ(4, server.Queries());
+}
+
+TEST(DNSStubResolver, race_next_server)
+{
+	FakeDNSServer silent(kSilent);
+	FakeDNSServer server(kAnswer);
+	std::vector<socket_address> servers;
+	servers.push_back(silent.Address());
+	servers.push_back(server.Address());
+	DNSStubResolver resolver(servers);
+	Result result;
+
+	uint64_t start = gettickcount();
+	resolver.Resolve("www.qq.com", AF_UNSPEC, 3000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveOK, result.status_);
+	EXPECT_EQ(2u, result.ips_.size());
+	EXPECT_GT(1000u, gettickcount() - start);
+}
+
+TEST(DNSStubResolver, truncated)
+{
+	FakeDNSServer truncated(kTruncated);
+	FakeDNSServer server(kAnswer);
+	std::vector<socket_address> servers;
+	servers.push_back(truncated.Address());
+	servers.push_back(server.Address());
+	DNSStubResolver resolver(servers);
+	Result result;
+
+	uint64_t start = gettickcount();
+	resolver.Resolve("www.qq.com", AF_UNSPEC, 3000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveOK, result.status_);
+	EXPECT_EQ(2u, result.ips_.size());
+	// no wait for the retry interval, the truncated answer hands over at once.
+	EXPECT_GT(300u, gettickcount() - start);
+}
+
+TEST(DNSStubResolver, truncated_partial)
+{
+	FakeDNSServer server(kTruncatedPartial);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	resolver.Resolve("www.qq.com", AF_INET, 2000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveOK, result.status_);
+	ASSERT_EQ(1u, result.ips_.size());
+	EXPECT_EQ("10.0.0.1", result.ips_[0]);
+}
+
+TEST(DNSStubResolver, nxdomain)
+{
+	FakeDNSServer server(kNXDomain);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	uint64_t start = gettickcount();
+	resolver.Resolve("nothing.qq.com", AF_UNSPEC, 2000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveFail, result.status_);
+	EXPECT_GT(300u, gettickcount() - start);
+}
+
+TEST(DNSStubResolver, servfail)
+{
+	FakeDNSServer server(kServFail);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	resolver.Resolve("www.qq.com", AF_INET, 3000, result.Callback(), Handler());
+	ASSERT_TRUE(result.Wait(3000));
+	EXPECT_EQ(DNSStubResolver::kResolveFail, result.status_);
+	EXPECT_EQ(2, server.Queries());
+}
+
+TEST(DNSStubResolver, cancel)
+{
+	FakeDNSServer server(kSilent);
+	DNSStubResolver resolver(std::vector<socket_address>(1, server.Address()));
+	Result result;
+
+	uint32_t id = resolver.Resolve("www.qq.com", AF_UNSPEC, 500, result.Callback(), Handler());
+	resolver.Cancel(id);
+	EXPECT_FALSE(result.Wait(1000));
+}
@@ -0,0 +1,271 @@
+
+#include "../dns/dns.h"
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <map>
+#include <set>
+
+#include "boost/bind.hpp"
+#include "thread/condition.h"
+#include "thread/lock.h"
+#include "thread/thread.h"
+#include "time_utils.h"
+
+
+namespace
+{
+
+// the DNSFunc of the tests: answers what was set for the host, and holds the hosts that are blocked.
+class FakeResolver {
+  public:
+	static FakeResolver& Instance() {
+		static FakeResolver* s_instance = new FakeResolver;
+		return *s_instance;
+	}
+
+	static std::vector<std::string> Resolve(const std::string& _host) {
+		FakeResolver& fake = Instance();
+		ScopedLock lock(fake.mutex_);
+		++fake.calls_[_host];
+		fake.cond_.notifyAll(lock);
+
+		while (fake.blocked_.count(_host)) fake.cond_.wait(lock);
+		return fake.answers_[_host];
+	}
+
+	void SetAnswer(const std::string& _host, const std::string& _ip) {
+		ScopedLock lock(mutex_);
+		answers_[_host].clear();
+		if (!_ip.empty()) answers_[_host].push_back(_ip);
+	}
+
+	void Block(const std::string& _host) {
+		ScopedLock lock(mutex_);
+		blocked_.insert(_host);
+	}
+
+	void Unblock(const std::string& _host) {
+		ScopedLock lock(mutex_);
+		blocked_.erase(_host);
+		cond_.notifyAll(lock);
+	}
+
+	int Calls(const std::string& _host) {
+		ScopedLock lock(mutex_);
+		return calls_[_host];
+	}
+
+	bool WaitCalls(const std::string& _host, int _calls, long _timeout) {
+		uint64_t end = gettickcount() + _timeout;
+		ScopedLock lock(mutex_);
+		while (calls_[_host] < _calls) {
+			uint64_t now = gettickcount();
+			if (now >= end) return false;
+			cond_.wait(lock, (long)(end - now));
+		}
+		return true;
+	}
+
+  private:
+	Mutex mutex_;
+	Condition cond_;
+	std::map<std::string, std::vector<std::string> > answers_;
+	std::map<std::string, int> calls_;
+	std::set<std::string> blocked_;
+};
+
+struct Lookup {
+	Lookup(const std::string& _host): host(_host), ret(false), cost(0) {}
+
+	void Run() {
+		DNS dns(&FakeResolver::Resolve);
+		uint64_t start = gettickcount();
+		ret = dns.GetHostByName(host, ips, 3000);
+		cost = gettickcount() - start;
+	}
+
+	std::string host;
+	bool ret;
+	std::vector<std::string> ips;
+	uint64_t cost;
+};
+
+static std::string Resolve(const std::string& _host) {
+	DNS dns(&FakeResolver::Resolve);
+	std::vector<std::string> ips;
+	if (!dns.GetHostByName(_host, ips, 3000) || ips.empty()) return "";
+	return ips[0];
+}
+
+class DNSCache : public ::testing::Test {
+  protected:
+	virtual void SetUp() { DNS::ClearCache(); }
+	virtual void TearDown() {
+		DNS::SetCacheTime(0, 0, 0);
+		DNS::ClearCache();
+	}
+};
+
+}
+
+TEST_F(DNSCache, ttl_and_stale)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	DNS::SetCacheTime(300, 200, 1000);
+	const std::string host = "ttl.dns.test";
+
+	fake.SetAnswer(host, "10.0.0.1");
+	EXPECT_EQ("10.0.0.1", Resolve(host));
+	EXPECT_EQ("10.0.0.1", Resolve(host));
+	EXPECT_EQ(1, fake.Calls(host));
+
+	// past the ttl the old result is answered right away while one refresh runs behind it.
+	::usleep(350 * 1000);
+	fake.SetAnswer(host, "10.0.0.2");
+	EXPECT_EQ("10.0.0.1", Resolve(host));
+	ASSERT_TRUE(fake.WaitCalls(host, 2, 1000));
+
+	uint64_t start = gettickcount();
+	while ("10.0.0.2" != Resolve(host) && gettickcount() - start < 1000) ::usleep(10 * 1000);
+	EXPECT_EQ("10.0.0.2", Resolve(host));
+	EXPECT_EQ(2, fake.Calls(host));
+
+	// past the stale time too, the lookup waits for a new resolution.
+	::usleep(1400 * 1000);
+	fake.SetAnswer(host, "10.0.0.3");
+	EXPECT_EQ("10.0.0.3", Resolve(host));
+	EXPECT_EQ(3, fake.Calls(host));
+}
+
+TEST_F(DNSCache, negative)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	DNS::SetCacheTime(60 * 1000, 300, 1000);
+	const std::string host = "negative.dns.test";
+
+	fake.SetAnswer(host, "");
+	EXPECT_EQ("", Resolve(host));
+	EXPECT_EQ("", Resolve(host));
+	EXPECT_EQ(1, fake.Calls(host));
+
+	::usleep(350 * 1000);
+	fake.SetAnswer(host, "10.0.0.4");
+	EXPECT_EQ("10.0.0.4", Resolve(host));
+	EXPECT_EQ(2, fake.Calls(host));
+}
+
+TEST_F(DNSCache, failed_refresh_keeps_stale)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	DNS::SetCacheTime(200, 300, 2000);
+	const std::string host = "refresh.dns.test";
+
+	fake.SetAnswer(host, "10.0.0.5");
+	EXPECT_EQ("10.0.0.5", Resolve(host));
+
+	::usleep(250 * 1000);
+	fake.SetAnswer(host, "");
+	EXPECT_EQ("10.0.0.5", Resolve(host));
+	ASSERT_TRUE(fake.WaitCalls(host, 2, 1000));
+	::usleep(50 * 1000);
+
+	// the failed refresh isn't tried again for the negative ttl, the stale result is still answered.
+	EXPECT_EQ("10.0.0.5", Resolve(host));
+	EXPECT_EQ(2, fake.Calls(host));
+
+	::usleep(350 * 1000);
+	EXPECT_EQ("10.0.0.5", Resolve(host));
+	EXPECT_TRUE(fake.WaitCalls(host, 3, 1000));
+}
+
+TEST_F(DNSCache, waiters_share_one_resolution)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	const std::string host = "waiters.dns.test";
+	fake.SetAnswer(host, "10.0.0.6");
+	fake.Block(host);
+
+	const int kWaiters = 8;
+	std::vector<Lookup*> lookups;
+	std::vector<Thread*> threads;
+	for (int i = 0; i < kWaiters; ++i) {
+		lookups.push_back(new Lookup(host));
+		threads.push_back(new Thread(boost::bind(&Lookup::Run, lookups.back())));
+		threads.back()->start();
+	}
+
+	ASSERT_TRUE(fake.WaitCalls(host, 1, 1000));
+	::usleep(100 * 1000);
+	fake.Unblock(host);
+
+	for (int i = 0; i < kWaiters; ++i) {
+		threads[i]->join();
+		EXPECT_TRUE(lookups[i]->ret);
+		ASSERT_EQ(1u, lookups[i]->ips.size());
+		EXPECT_EQ("10.0.0.6", lookups[i]->ips[0]);
+		delete threads[i];
+		delete lookups[i];
+	}
+	EXPECT_EQ(1, fake.Calls(host));
+}
+
+TEST_F(DNSCache, clear_while_resolving)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	const std::string host = "clear.dns.test";
+	fake.SetAnswer(host, "10.0.0.7");
+	fake.Block(host);
+
+	Lookup lookup(host);
+	Thread thread(boost::bind(&Lookup::Run, &lookup));
+	thread.start();
+	ASSERT_TRUE(fake.WaitCalls(host, 1, 1000));
+
+	// the network changes while the old one is asked: the waiter takes the answer, nobody else does.
+	DNS::ClearCache();
+	fake.SetAnswer(host, "10.0.0.8");
+	fake.Unblock(host);
+	thread.join();
+
+	EXPECT_TRUE(lookup.ret);
+	EXPECT_GT((uint64_t)1000, lookup.cost);
+	EXPECT_EQ("10.0.0.8", Resolve(host));
+	EXPECT_EQ(2, fake.Calls(host));
+}
+
+TEST_F(DNSCache, shrink_keeps_resolving_entry)
+{
+	FakeResolver& fake = FakeResolver::Instance();
+	DNS::SetCacheTime(60 * 1000, 50, 50);
+	const std::string host = "waited.shrink.dns.test";
+	fake.SetAnswer(host, "10.0.0.9");
+	fake.Block(host);
+
+	Lookup lookup(host);
+	Thread thread(boost::bind(&Lookup::Run, &lookup));
+	thread.start();
+	ASSERT_TRUE(fake.WaitCalls(host, 1, 1000));
+
+	// failures fill the cache past its size and expire, the next lookup shrinks it.
+	for (int i = 0; i < 300; ++i) {
+		char failed[64];
+		snprintf(failed, sizeof(failed), "failed%d.shrink.dns.test", i);
+		EXPECT_EQ("", Resolve(failed));
+	}
+	::usleep(100 * 1000);
+	fake.SetAnswer("trigger.shrink.dns.test", "10.0.0.10");
+	EXPECT_EQ("10.0.0.10", Resolve("trigger.shrink.dns.test"));
+
+	// expired entries are resolved again, the one still resolving reports to its waiter.
+	EXPECT_EQ("", Resolve("failed0.shrink.dns.test"));
+	EXPECT_EQ(2, fake.Calls("failed0.shrink.dns.test"));
+
+	fake.Unblock(host);
+	thread.join();
+	EXPECT_TRUE(lookup.ret);
+	EXPECT_GT((uint64_t)2500, lookup.cost);
+	EXPECT_EQ(1, fake.Calls(host));
+}
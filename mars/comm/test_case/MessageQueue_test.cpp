@@ -4,6 +4,11 @@
 
 #include "boost/bind.hpp"
 #include "thread/thread.h"
+#include "thread/condition.h"
+#include "thread/lock.h"
+
+#include <string.h>
+#include <memory>
 
 
 namespace
@@ -323,3 +328,207 @@ TEST(MessageQueue_test, WaitMessage_SingletonMessage)
 	}
 
 }
+
+TEST(MessageQueue_test, PostCancelWait_TwoQueues)
+{
+	MessageQueue::MessageQueue_t queue1 = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_1");
+	MessageQueue::MessageQueue_t queue2 = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_2");
+	ASSERT_NE(queue1, MessageQueue::KInvalidQueueID);
+	ASSERT_NE(queue2, MessageQueue::KInvalidQueueID);
+
+	// a timer of queue2 cancelled from queue1, then queue1 waits for a message of queue2.
+	int timer_runs = 0;
+	int waited_runs = 0;
+	bool cancelled = false;
+	bool found_after_cancel = true;
+	MessageQueue::MessagePost_t timer = MessageQueue::AsyncInvokeAfter(60 * 1000, [&timer_runs]() { ++timer_runs; },
+		MessageQueue::DefAsyncInvokeHandler(queue2));
+
+	MessageQueue::MessagePost_t post = MessageQueue::AsyncInvoke([&]() {
+		cancelled = MessageQueue::CancelMessage(timer);
+		found_after_cancel = MessageQueue::FoundMessage(timer);
+		MessageQueue::WaitMessage(MessageQueue::AsyncInvoke([&waited_runs]() { ++waited_runs; }, MessageQueue::DefAsyncInvokeHandler(queue2)));
+	}, MessageQueue::DefAsyncInvokeHandler(queue1));
+
+	EXPECT_TRUE(MessageQueue::WaitMessage(post));
+	EXPECT_TRUE(cancelled);
+	EXPECT_FALSE(found_after_cancel);
+	EXPECT_EQ(1, waited_runs);
+	EXPECT_FALSE(MessageQueue::CancelMessage(timer));
+
+	// messages of the two queues run on their own threads, in post order per queue.
+	std::vector<int> order1, order2;
+	MessageQueue::MessagePost_t last1, last2;
+	for (int i = 0; i < 100; ++i) {
+		last1 = MessageQueue::AsyncInvoke([&order1, i]() { order1.push_back(i); }, MessageQueue::DefAsyncInvokeHandler(queue1));
+		last2 = MessageQueue::AsyncInvoke([&order2, i]() { order2.push_back(i); }, MessageQueue::DefAsyncInvokeHandler(queue2));
+	}
+	EXPECT_TRUE(MessageQueue::WaitMessage(last2));
+	EXPECT_TRUE(MessageQueue::WaitMessage(last1));
+	ASSERT_EQ(100u, order1.size());
+	ASSERT_EQ(100u, order2.size());
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_EQ(i, order1[i]);
+		EXPECT_EQ(i, order2[i]);
+	}
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue1);
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue2);
+	EXPECT_EQ(0, timer_runs);
+}
+
+namespace
+{
+
+struct Gate {
+	Gate(): open(false) {}
+
+	void Wait() {
+		ScopedLock lock(mutex);
+		while (!open) cond.wait(lock);
+	}
+
+	void Open() {
+		ScopedLock lock(mutex);
+		open = true;
+		cond.notifyAll(lock);
+	}
+
+	Mutex mutex;
+	Condition cond;
+	bool open;
+};
+
+static void WaitPendingMessage(MessageQueue::MessagePost_t _post, Gate* _done)
+{
+	MessageQueue::WaitMessage(_post);
+	_done->Open();
+}
+
+}
+
+TEST(MessageQueue_test, Release_PendingMessages)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_release");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+
+	Gate running, unblock;
+	MessageQueue::AsyncInvoke([&]() { running.Open(); unblock.Wait(); }, MessageQueue::DefAsyncInvokeHandler(queue));
+	running.Wait();
+
+	// queued behind the blocked message, dropped by the teardown together with what they captured.
+	int runs = 0;
+	boost::shared_ptr<int> token = boost::make_shared<int>(0);
+	MessageQueue::MessagePost_t pending = MessageQueue::AsyncInvoke([&runs, token]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(queue));
+	MessageQueue::AsyncInvokeAfter(60 * 1000, [&runs, token]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(queue));
+	MessageQueue::AsyncInvokePeriod(10, 10, [&runs, token]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(queue));
+	EXPECT_EQ(4, token.use_count());
+
+	Gate wait_done;
+	Thread waiter(boost::bind(&WaitPendingMessage, pending, &wait_done));
+	waiter.start();
+
+	MessageQueue::BreakMessageQueueRunloop(queue);
+	unblock.Open();
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+
+	// a waiter isn't left behind, whether it got to the queue before the teardown or after.
+	wait_done.Wait();
+	waiter.join();
+	EXPECT_EQ(0, runs);
+	EXPECT_EQ(1, token.use_count());
+
+	// the queue is gone, its posts and handlers are no longer accepted.
+	EXPECT_FALSE(MessageQueue::FoundMessage(pending));
+	EXPECT_FALSE(MessageQueue::WaitMessage(pending));
+	EXPECT_TRUE(MessageQueue::KNullPost == MessageQueue::AsyncInvoke([&runs]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(queue)));
+	EXPECT_EQ(0, runs);
+}
+
+namespace
+{
+
+struct BigFunctor {
+	BigFunctor(int* _runs, const boost::shared_ptr<int>& _token): runs(_runs), token(_token) { memset(pad, 0, sizeof(pad)); }
+	void operator()() { ++*runs; }
+
+	int* runs;
+	boost::shared_ptr<int> token;
+	char pad[MessageQueue::MessageTask::kInlineSize];
+};
+
+struct MoveOnlyFunctor {
+	MoveOnlyFunctor(std::unique_ptr<int> _value, int* _result): value(std::move(_value)), result(_result) {}
+	MoveOnlyFunctor(MoveOnlyFunctor&& _other): value(std::move(_other.value)), result(_other.result) {}
+	void operator()() { *result = *value; }
+
+	std::unique_ptr<int> value;
+	int* result;
+
+  private:
+	MoveOnlyFunctor(const MoveOnlyFunctor&);
+};
+
+}
+
+TEST(MessageQueue_test, AsyncInvoke_InlineTask)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_task");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+
+	int runs = 0;
+	boost::shared_ptr<int> token = boost::make_shared<int>(0);
+	auto func = [&runs, token]() { ++runs; };
+	EXPECT_LE(sizeof(func), (size_t)MessageQueue::MessageTask::kInlineSize);
+
+	MessageQueue::MessagePost_t post = MessageQueue::AsyncInvoke(func, MessageQueue::DefAsyncInvokeHandler(queue), "inline_task");
+	EXPECT_TRUE(MessageQueue::WaitMessage(post));
+	EXPECT_EQ(1, runs);
+
+	// a cancelled task is destroyed without running.
+	MessageQueue::CancelMessage(MessageQueue::AsyncInvokeAfter(60 * 1000, func, MessageQueue::DefAsyncInvokeHandler(queue), "inline_task"));
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+	EXPECT_EQ(1, runs);
+	EXPECT_EQ(2, token.use_count());    // token and func
+}
+
+TEST(MessageQueue_test, AsyncInvoke_HeapTask)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_task");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+
+	int runs = 0;
+	boost::shared_ptr<int> token = boost::make_shared<int>(0);
+	BigFunctor func(&runs, token);
+	EXPECT_GT(sizeof(func), (size_t)MessageQueue::MessageTask::kInlineSize);
+
+	MessageQueue::MessagePost_t post = MessageQueue::AsyncInvoke(func, MessageQueue::DefAsyncInvokeHandler(queue), "heap_task");
+	EXPECT_TRUE(MessageQueue::WaitMessage(post));
+	EXPECT_EQ(1, runs);
+
+	MessageQueue::CancelMessage(MessageQueue::AsyncInvokeAfter(60 * 1000, func, MessageQueue::DefAsyncInvokeHandler(queue), "heap_task"));
+	MessageQueue::AsyncInvokeAfter(60 * 1000, func, MessageQueue::DefAsyncInvokeHandler(queue), "heap_task");
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+	EXPECT_EQ(1, runs);
+	EXPECT_EQ(2, token.use_count());    // token and func
+}
+
+TEST(MessageQueue_test, PostTask_MoveOnly)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("mq_test_task");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+
+	int result = 0;
+	MessageQueue::MessageTask task(MoveOnlyFunctor(std::unique_ptr<int>(new int(42)), &result));
+	MessageQueue::MessageTask moved(std::move(task));
+	EXPECT_FALSE(task);
+	EXPECT_TRUE(moved);
+
+	MessageQueue::MessagePost_t post = MessageQueue::PostTask(MessageQueue::DefAsyncInvokeHandler(queue), std::move(moved), 0, "move_only_task");
+	EXPECT_TRUE(MessageQueue::WaitMessage(post));
+	EXPECT_EQ(42, result);
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+}
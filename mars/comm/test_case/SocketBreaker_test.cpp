@@ -0,0 +1,129 @@
+#include "comm/socket/socketbreaker.h"
+#include "comm/socket/socketselect.h"
+#include "gtest/gtest.h"
+
+#include "boost/bind.hpp"
+#include "thread/atomic_oper.h"
+#include "thread/thread.h"
+#include "time_utils.h"
+
+#include <sched.h>
+
+namespace
+{
+
+static const uint32_t kBreaksPerThread = 20000;
+static const int kProducers = 2;
+
+struct BreakRace {
+	BreakRace(): posted(0) {}
+
+	SocketBreaker breaker;
+	volatile uint32_t posted;
+};
+
+// the work is published before Break(), like a task queued for the loop before it is woken.
+static void Produce(BreakRace* _race)
+{
+	for (uint32_t i = 0; i < kBreaksPerThread; ++i) {
+		atomic_inc32(&_race->posted);
+		_race->breaker.Break();
+		if (0 == i % 64) sched_yield();
+	}
+}
+
+/*
+ * A Break() either writes the breaker or lands on one that is already broken and not cleared yet.
+ * Either way a Poll() that follows, or the Clear() of the one that is returning, covers it:
+ * the loop never sleeps out its timeout while there is published work it hasn't seen.
+ */
+static void RunBreakRace(bool _persistent)
+{
+	BreakRace race;
+	ASSERT_TRUE(race.breaker.IsCreateSuc());
+
+	SocketSelect select(race.breaker, true, _persistent);
+
+	Thread producers[kProducers];
+	for (int i = 0; i < kProducers; ++i) {
+		producers[i].start(boost::bind(&Produce, &race));
+	}
+
+	const uint32_t total = kBreaksPerThread * kProducers;
+	uint32_t seen = 0;
+	int wakeups = 0;
+	int lost = 0;
+
+	while (seen < total) {
+		select.PreSelect();
+		int ret = select.Select(2000);
+		ASSERT_LE(0, ret) << "errno:" << select.Errno();
+
+		// autoclear has cleared the breaker inside Select(), work published before that is visible now.
+		uint32_t posted = atomic_read32(&race.posted);
+		if (0 == ret && posted != seen) {
+			++lost;
+		} else if (0 < ret) {
+			EXPECT_TRUE(select.IsBreak());
+			++wakeups;
+		}
+		seen = posted;
+	}
+
+	for (int i = 0; i < kProducers; ++i) {
+		producers[i].join();
+	}
+
+	EXPECT_EQ(0, lost);
+	EXPECT_LT(0, wakeups);
+	EXPECT_GE((int)total, wakeups);
+
+	// nothing is left behind: a broken breaker is readable, a cleared one isn't.
+	select.PreSelect();
+	EXPECT_EQ(0, select.Select(0));
+	EXPECT_FALSE(race.breaker.IsBreak());
+	race.breaker.Break();
+	select.PreSelect();
+	EXPECT_LT(0, select.Select(0));
+	EXPECT_TRUE(select.IsBreak());
+	EXPECT_FALSE(race.breaker.IsBreak());   // autoclear
+}
+
+}
+
+TEST(SocketBreaker_test, BreakClear_RacesPoll)
+{
+	RunBreakRace(false);
+}
+
+TEST(SocketBreaker_test, BreakClear_RacesEpoll)
+{
+	RunBreakRace(true);
+}
+
+TEST(SocketBreaker_test, Break_WakesWaitingPoll)
+{
+	SocketBreaker breaker;
+	ASSERT_TRUE(breaker.IsCreateSuc());
+	SocketSelect select(breaker, false, true);
+
+	for (int i = 0; i < 100; ++i) {
+		Thread breaker_thread(boost::bind(&SocketBreaker::Break, &breaker));
+		uint64_t start = ::gettickcount();
+		breaker_thread.start();
+
+		select.PreSelect();
+		ASSERT_LT(0, select.Select(2000));
+		EXPECT_TRUE(select.IsBreak());
+		EXPECT_GT((uint64_t)1000, ::gettickcount() - start);
+		breaker_thread.join();
+
+		// without autoclear the breaker stays readable until cleared.
+		EXPECT_TRUE(breaker.IsBreak());
+		select.PreSelect();
+		EXPECT_LT(0, select.Select(0));
+		EXPECT_TRUE(breaker.Clear());
+		select.PreSelect();
+		EXPECT_EQ(0, select.Select(0));
+	}
+}
@@ -0,0 +1,172 @@
+#include "../messagequeue/message_queue.h"
+#include "../messagequeue/task_pool.h"
+#include "gtest/gtest.h"
+
+#include "boost/bind.hpp"
+#include "thread/atomic_oper.h"
+#include "thread/condition.h"
+#include "thread/lock.h"
+#include "thread/thread.h"
+
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+struct StrandState {
+	StrandState(): in_flight(0), overlapped(0) {}
+
+	volatile uint32_t in_flight;
+	volatile uint32_t overlapped;
+	std::vector<int> order;     // only touched by the strand's own jobs
+};
+
+static void StrandJob(StrandState* _state, int _index)
+{
+	if (0 != atomic_inc32(&_state->in_flight)) atomic_inc32(&_state->overlapped);
+	_state->order.push_back(_index);
+	for (volatile int i = 0; i < 200; ++i) {}
+	atomic_dec32(&_state->in_flight);
+}
+
+static void BusyJob()
+{
+	for (volatile int i = 0; i < 2000; ++i) {}
+}
+
+// posted on a worker, so its children land on that worker's deque and the idle workers steal them.
+static void FanOutJob(MessageQueue::MessageQueue_t _pool)
+{
+	for (int i = 0; i < 8; ++i) {
+		MessageQueue::AsyncInvoke(&BusyJob, MessageQueue::DefAsyncInvokeHandler(_pool));
+	}
+}
+
+struct Gate {
+	Gate(): open(false) {}
+
+	void Wait() {
+		ScopedLock lock(mutex);
+		while (!open) cond.wait(lock);
+	}
+
+	void Open() {
+		ScopedLock lock(mutex);
+		open = true;
+		cond.notifyAll(lock);
+	}
+
+	Mutex mutex;
+	Condition cond;
+	bool open;
+};
+
+}
+
+TEST(TaskPool_test, Strand_FifoWhileStealing)
+{
+	MessageQueue::MessageQueue_t pool = MessageQueue::CreateTaskPool(4, "task_pool_test");
+	ASSERT_NE(pool, MessageQueue::KInvalidQueueID);
+
+	StrandState state1, state2;
+	MessageQueue::MessageHandler_t strand1 = MessageQueue::InstallAsyncHandler(pool);
+	MessageQueue::MessageHandler_t strand2 = MessageQueue::InstallAsyncHandler(pool);
+
+	const int kCount = 2000;
+	MessageQueue::MessagePost_t last1, last2;
+	for (int i = 0; i < kCount; ++i) {
+		last1 = MessageQueue::AsyncInvoke(boost::bind(&StrandJob, &state1, i), strand1);
+		last2 = MessageQueue::AsyncInvoke(boost::bind(&StrandJob, &state2, i), strand2);
+		if (0 == i % 16) MessageQueue::AsyncInvoke(boost::bind(&FanOutJob, pool), MessageQueue::DefAsyncInvokeHandler(pool));
+	}
+
+	EXPECT_TRUE(MessageQueue::WaitMessage(last1));
+	EXPECT_TRUE(MessageQueue::WaitMessage(last2));
+	MessageQueue::WaitForRunningLockEnd(strand1);
+	MessageQueue::WaitForRunningLockEnd(strand2);
+
+	EXPECT_EQ(0u, state1.overlapped);
+	EXPECT_EQ(0u, state2.overlapped);
+	ASSERT_EQ((size_t)kCount, state1.order.size());
+	ASSERT_EQ((size_t)kCount, state2.order.size());
+	for (int i = 0; i < kCount; ++i) {
+		EXPECT_EQ(i, state1.order[i]);
+		EXPECT_EQ(i, state2.order[i]);
+	}
+
+	MessageQueue::UnInstallMessageHandler(strand1);
+	MessageQueue::UnInstallMessageHandler(strand2);
+	MessageQueue::ReleaseTaskPool(pool);
+}
+
+TEST(TaskPool_test, UnInstall_RunningStrand)
+{
+	MessageQueue::MessageQueue_t pool = MessageQueue::CreateTaskPool(2, "task_pool_test");
+	ASSERT_NE(pool, MessageQueue::KInvalidQueueID);
+
+	MessageQueue::MessageHandler_t strand = MessageQueue::InstallAsyncHandler(pool);
+	Gate running, unblock;
+	volatile uint32_t finished = 0;
+	MessageQueue::AsyncInvoke([&]() { running.Open(); unblock.Wait(); atomic_write32(&finished, 1); }, strand);
+	running.Wait();
+
+	// uninstalled while its job runs: new posts are rejected, a wait on the handler still covers the running job.
+	MessageQueue::UnInstallMessageHandler(strand);
+	EXPECT_TRUE(MessageQueue::KNullPost == MessageQueue::AsyncInvoke([]() {}, strand));
+
+	Thread unblocker([&]() { ::usleep(20 * 1000); unblock.Open(); });
+	unblocker.start();
+	MessageQueue::WaitForRunningLockEnd(strand);
+	EXPECT_EQ(1u, atomic_read32(&finished));
+	unblocker.join();
+
+	MessageQueue::ReleaseTaskPool(pool);
+}
+
+TEST(TaskPool_test, Find_Release)
+{
+	MessageQueue::MessageQueue_t pool = MessageQueue::CreateTaskPool(2, "task_pool_test");
+	ASSERT_NE(pool, MessageQueue::KInvalidQueueID);
+
+	MessageQueue::TaskPool* task_pool = MessageQueue::TaskPool::Find(pool);
+	ASSERT_TRUE(NULL != task_pool);
+	EXPECT_EQ(pool, task_pool->Id());
+	EXPECT_TRUE(NULL == MessageQueue::TaskPool::Find(MessageQueue::KInvalidQueueID));
+	EXPECT_TRUE(NULL == MessageQueue::TaskPool::Find(MessageQueue::GetDefTaskQueue()));
+	EXPECT_TRUE(NULL == MessageQueue::TaskPool::Current());
+
+	// a worker sees its pool as the current queue.
+	MessageQueue::TaskPool* current = NULL;
+	MessageQueue::MessageQueue_t current_queue = MessageQueue::KInvalidQueueID;
+	EXPECT_TRUE(MessageQueue::WaitMessage(MessageQueue::AsyncInvoke([&]() {
+		current = MessageQueue::TaskPool::Current();
+		current_queue = MessageQueue::CurrentThreadMessageQueue();
+	}, MessageQueue::DefAsyncInvokeHandler(pool))));
+	EXPECT_EQ(task_pool, current);
+	EXPECT_EQ(pool, current_queue);
+
+	// pending messages are dropped with their captures by the release.
+	int runs = 0;
+	boost::shared_ptr<int> token = boost::make_shared<int>(0);
+	MessageQueue::MessageHandler_t strand = MessageQueue::InstallAsyncHandler(pool);
+	MessageQueue::MessagePost_t timer = MessageQueue::AsyncInvokeAfter(60 * 1000, [&runs, token]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(pool));
+	MessageQueue::AsyncInvokeAfter(60 * 1000, [&runs, token]() { ++runs; }, strand);
+	EXPECT_TRUE(MessageQueue::FoundMessage(timer));
+	EXPECT_EQ(3, token.use_count());
+
+	MessageQueue::ReleaseTaskPool(pool);
+	EXPECT_EQ(0, runs);
+	EXPECT_EQ(1, token.use_count());
+	EXPECT_FALSE(MessageQueue::FoundMessage(timer));
+	EXPECT_FALSE(MessageQueue::CancelMessage(timer));
+
+	// the pool object stays, so its id still finds it and isn't handed to a new pool.
+	EXPECT_EQ(task_pool, MessageQueue::TaskPool::Find(pool));
+	EXPECT_TRUE(MessageQueue::KNullPost == MessageQueue::AsyncInvoke([&runs]() { ++runs; }, MessageQueue::DefAsyncInvokeHandler(pool)));
+
+	MessageQueue::MessageQueue_t other = MessageQueue::CreateTaskPool(1, "task_pool_test");
+	EXPECT_NE(pool, other);
+	MessageQueue::ReleaseTaskPool(other);
+	EXPECT_EQ(0, runs);
+}
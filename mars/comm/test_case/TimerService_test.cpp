@@ -0,0 +1,126 @@
+#include "../messagequeue/timer_service.h"
+#include "gtest/gtest.h"
+
+#include "boost/make_shared.hpp"
+#include "thread/lock.h"
+#include "time_utils.h"
+
+#include <unistd.h>
+
+namespace
+{
+
+struct Fired {
+	Fired(): count(0), tick(0) {}
+
+	void Set() {
+		ScopedLock lock(mutex);
+		++count;
+		tick = ::gettickcount();
+	}
+
+	int Count() {
+		ScopedLock lock(mutex);
+		return count;
+	}
+
+	uint64_t Tick() {
+		ScopedLock lock(mutex);
+		return tick;
+	}
+
+	Mutex mutex;
+	int count;
+	uint64_t tick;
+};
+
+// a timer fires no earlier than asked, and within this of it on a loaded machine.
+static const uint64_t kLateTolerance = 100;
+
+}
+
+TEST(TimerService_test, Cascade_FiresOnTime)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("timer_service_test");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+	MessageQueue::MessageHandler_t handler = MessageQueue::DefAsyncInvokeHandler(queue);
+	MessageQueue::TimerService& service = MessageQueue::TimerService::Instance();
+
+	// level 0 covers 64ms, level 1 4s: 30ms fires from level 0, 300ms cascades once, 4200ms twice.
+	const int64_t kAfters[] = {30, 300, 4200};
+	const int kTimers = sizeof(kAfters) / sizeof(kAfters[0]);
+	Fired fired[kTimers];
+
+	size_t size = service.Size();
+	uint64_t start = ::gettickcount();
+	for (int i = 0; i < kTimers; ++i) {
+		Fired* f = &fired[i];
+		EXPECT_NE((MessageQueue::TimerService::TimerId)MessageQueue::TimerService::kInvalidTimer, service.Start(kAfters[i], handler, [f]() { f->Set(); }));
+	}
+	EXPECT_EQ(size + kTimers, service.Size());
+
+	while (fired[kTimers - 1].Count() == 0 && ::gettickcount() - start < (uint64_t)kAfters[kTimers - 1] + 2000) {
+		::usleep(10 * 1000);
+	}
+
+	for (int i = 0; i < kTimers; ++i) {
+		EXPECT_EQ(1, fired[i].Count()) << "after " << kAfters[i];
+		EXPECT_GE(fired[i].Tick() - start, (uint64_t)kAfters[i]);
+		EXPECT_LE(fired[i].Tick() - start, (uint64_t)kAfters[i] + kLateTolerance);
+	}
+	EXPECT_EQ(size, service.Size());
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+}
+
+TEST(TimerService_test, Cancel_BeforeCascade)
+{
+	MessageQueue::MessageQueue_t queue = MessageQueue::MessageQueueCreater::CreateNewMessageQueue("timer_service_test");
+	ASSERT_NE(queue, MessageQueue::KInvalidQueueID);
+	MessageQueue::MessageHandler_t handler = MessageQueue::DefAsyncInvokeHandler(queue);
+	MessageQueue::TimerService& service = MessageQueue::TimerService::Instance();
+
+	size_t size = service.Size();
+	Fired cancelled, cascaded_cancelled, kept;
+	boost::shared_ptr<int> token = boost::make_shared<int>(0);
+
+	Fired* f = &cancelled;
+	MessageQueue::TimerService::TimerId far = service.Start(4200, handler, [f, token]() { f->Set(); });
+	f = &cascaded_cancelled;
+	MessageQueue::TimerService::TimerId near = service.Start(300, handler, [f, token]() { f->Set(); });
+	f = &kept;
+	MessageQueue::TimerService::TimerId kept_id = service.Start(350, handler, [f]() { f->Set(); });
+	EXPECT_EQ(size + 3, service.Size());
+
+	// still in level 1 and 2, nothing has cascaded yet.
+	EXPECT_TRUE(service.Cancel(far));
+	EXPECT_FALSE(service.Cancel(far));
+	EXPECT_EQ(2, token.use_count());
+
+	// the entry of a cancelled timer is reused, its old id doesn't reach the new timer.
+	f = &kept;
+	MessageQueue::TimerService::TimerId reuse = service.Start(60 * 1000, handler, [f]() { f->Set(); });
+	EXPECT_NE(far, reuse);
+	EXPECT_FALSE(service.Cancel(far));
+
+	// by 250ms the 300ms timer has moved down to level 0.
+	::usleep(250 * 1000);
+	EXPECT_TRUE(service.Cancel(near));
+	EXPECT_EQ(1, token.use_count());
+
+	uint64_t start = ::gettickcount();
+	while (kept.Count() == 0 && ::gettickcount() - start < 2000) {
+		::usleep(10 * 1000);
+	}
+	::usleep(100 * 1000);
+
+	EXPECT_EQ(0, cancelled.Count());
+	EXPECT_EQ(0, cascaded_cancelled.Count());
+	EXPECT_EQ(1, kept.Count());
+	EXPECT_FALSE(service.Cancel(kept_id));      // fired already
+
+	EXPECT_TRUE(service.Cancel(reuse));
+	EXPECT_EQ(size, service.Size());
+
+	MessageQueue::MessageQueueCreater::ReleaseNewMessageQueue(queue);
+}
@@ -22,13 +22,17 @@
 #include "socketbreaker.h"
 
 #include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
+#include "comm/thread/atomic_oper.h"
 #include "comm/xlogger/xlogger.h"
 
 
 SocketBreaker::SocketBreaker()
 : create_success_(true),
-broken_(false)
+broken_(0)
 {
     pipes_[0] = -1;
     pipes_[1] = -1;
@@ -47,14 +51,23 @@ bool SocketBreaker::IsCreateSuc() const
 
 bool SocketBreaker::ReCreate()
 {
-    if(pipes_[1] >= 0)
-        close(pipes_[1]);
-    if(pipes_[0] >= 0)
-        close(pipes_[0]);
-    
-    pipes_[0] = -1;
-    pipes_[1] = -1;
+    Close();
+    broken_ = 0;
+
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK);
+    xassert2(-1 != fd, "eventfd errno=%d", errno);
 
+    if (-1 == fd) {
+        create_success_ = false;
+        return create_success_;
+    }
+
+    pipes_[0] = fd;
+    pipes_[1] = fd;
+    create_success_ = true;
+    return create_success_;
+#else
     int Ret;
     Ret = pipe(pipes_);
     xassert2(-1 != Ret, "pipe errno=%d", errno);
@@ -97,8 +110,44 @@ bool SocketBreaker::ReCreate()
 
     create_success_ = true;
     return create_success_;
+#endif
 }
 
+#ifdef __linux__
+bool SocketBreaker::Break()
+{
+    // already broken, the eventfd is readable until Clear().
+    if (0 != atomic_cas32(&broken_, 1, 0)) return true;
+
+    uint64_t one = 1;
+    int ret = (int)write(pipes_[1], &one, sizeof(one));
+
+    if (ret != (int)sizeof(one))
+    {
+        xerror2(TSF"Ret:%_, errno:(%_, %_)", ret, errno, strerror(errno));
+        atomic_write32(&broken_, 0);
+        return false;
+    }
+
+    return true;
+}
+
+bool SocketBreaker::Clear()
+{
+    uint64_t count = 0;
+    int ret = (int)read(pipes_[0], &count, sizeof(count));
+
+    if (ret < 0)
+    {
+        xverbose2(TSF"Ret=%0", ret);
+        return false;
+    }
+
+    // reset after the read: a Break() that saw it set went in before this Clear(), any later one writes again.
+    atomic_write32(&broken_, 0);
+    return true;
+}
+#else
 bool SocketBreaker::Break()
 {
     ScopedLock lock(mutex_);
@@ -133,11 +182,12 @@ bool SocketBreaker::Clear()
     broken_ =  false;
     return true;
 }
+#endif
 
 void SocketBreaker::Close()
 {
     broken_ =  true;
-    if(pipes_[1] >= 0)
+    if(pipes_[1] >= 0 && pipes_[1] != pipes_[0])
         close(pipes_[1]);
     if(pipes_[0] >= 0)
         close(pipes_[0]);
@@ -152,5 +202,5 @@ int SocketBreaker::BreakerFD() const
 
 bool SocketBreaker::IsBreak() const
 {
-    return broken_;
+    return 0 != broken_;
 }
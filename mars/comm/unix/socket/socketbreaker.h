@@ -21,8 +21,11 @@
 #ifndef _SOCKSTBREAKER_
 #define _SOCKSTBREAKER_ 
 
+#include <stdint.h>
+
 #include "comm/thread/lock.h"
 
+// on linux the breaker is a single eventfd and Break() takes no lock, elsewhere a pipe.
 class SocketBreaker {
   public:
     SocketBreaker();
@@ -43,9 +46,9 @@ class SocketBreaker {
     SocketBreaker& operator=(const SocketBreaker&);
 
   private:
-    int   pipes_[2];
+    int   pipes_[2];    // both the same eventfd on linux
     bool  create_success_;
-    bool  broken_;
+    volatile uint32_t broken_;
     Mutex mutex_;
 };
 
@@ -190,6 +190,7 @@ bool SocketPoll::ConsignReport(SocketPoll& _consignor, int64_t _timeout) const {
             
             if (i.fd == _consignor.events_[0].fd) {
                 xassert2(&i == &(_consignor.events_[0]));
+                ++find_it;
                 continue;
             }
             
@@ -234,3 +235,151 @@ SocketBreaker& SocketPoll::Breaker() {
     return breaker_;
 }
 
+
+#ifdef __linux__
+//////////////////////////////////////////////
+
+SocketEpoll::SocketEpoll(SocketBreaker& _breaker, bool _autoclear, bool _persistent)
+: SocketPoll(_breaker, _autoclear), epfd_(_persistent ? epoll_create1(EPOLL_CLOEXEC) : -1), generation_(0)
+{
+    xassert2(!_persistent || 0 <= epfd_, TSF"epoll_create1 errno:(%_, %_)", errno, strerror(errno));
+}
+
+SocketEpoll::~SocketEpoll() {
+    if (0 <= epfd_) close(epfd_);
+}
+
+void SocketEpoll::DelEvent(SOCKET _fd) {
+    SocketPoll::DelEvent(_fd);
+    
+    // dropped right away rather than on the next Poll(), the fd number may be reused by then.
+    auto it = registered_.find(_fd);
+    if (it == registered_.end()) return;
+    
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, _fd, NULL);
+    registered_.erase(it);
+    synced_.clear();
+}
+
+static bool __SameEvents(const std::vector<pollfd>& _l, const std::vector<pollfd>& _r) {
+    if (_l.size() != _r.size()) return false;
+    
+    for (size_t i = 0; i < _l.size(); ++i) {
+        if (_l[i].fd != _r[i].fd || _l[i].events != _r[i].events) return false;
+    }
+    return true;
+}
+
+void SocketEpoll::__Sync() {
+    if (invalid_.empty() && __SameEvents(events_, synced_)) return;
+    
+    ++generation_;
+    invalid_.clear();
+    
+    for (auto &i : events_) {
+        uint32_t want = ((i.events & POLLIN)? EPOLLIN:0) | ((i.events & POLLOUT)? EPOLLOUT:0);
+        auto it = registered_.find(i.fd);
+        
+        if (it != registered_.end() && it->second.generation == generation_) {
+            // the same fd twice in the list, after a Consign: watch for both
+            want |= it->second.events;
+            if (want == it->second.events) continue;
+        } else if (it != registered_.end() && want == it->second.events) {
+            it->second.generation = generation_;
+            continue;
+        }
+        
+        struct epoll_event ev = {0};
+        ev.events = want;
+        ev.data.fd = i.fd;
+        
+        int ret = epoll_ctl(epfd_, it == registered_.end()? EPOLL_CTL_ADD:EPOLL_CTL_MOD, i.fd, &ev);
+        if (0 != ret && it == registered_.end() && EEXIST == errno) ret = epoll_ctl(epfd_, EPOLL_CTL_MOD, i.fd, &ev);
+        if (0 != ret && it != registered_.end() && ENOENT == errno) ret = epoll_ctl(epfd_, EPOLL_CTL_ADD, i.fd, &ev);
+        
+        if (0 != ret) {
+            xwarn2(TSF"epoll_ctl fd:%_, errno:(%_, %_)", i.fd, errno, strerror(errno));
+            if (it != registered_.end()) registered_.erase(it);
+            invalid_.insert(i.fd);
+            continue;
+        }
+        
+        Registration& reg = registered_[i.fd];
+        reg.events = want;
+        reg.generation = generation_;
+    }
+    
+    for (auto it = registered_.begin(); it != registered_.end();) {
+        if (it->second.generation == generation_) {
+            ++it;
+            continue;
+        }
+        
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, it->first, NULL);
+        registered_.erase(it++);
+    }
+    
+    synced_ = events_;
+}
+
+int SocketEpoll::Poll(int _msec) {
+    if (0 > epfd_) return SocketPoll::Poll(_msec);
+    
+    ASSERT(-1 <= _msec);
+    if (-1 > _msec) _msec = 0;
+    
+    triggered_events_.clear();
+    errno_ = 0;
+    ret_   = 0;
+    for (auto &i : events_) { i.revents = 0; }
+    
+    __Sync();
+    
+    // an fd epoll refuses is one poll(2) would flag POLLNVAL, don't wait on the others then.
+    ready_.resize(registered_.empty()? 1:registered_.size());
+    int ready_count = epoll_wait(epfd_, &ready_[0], (int)ready_.size(), invalid_.empty()? _msec:0);
+    
+    do {
+        if (0 > ready_count) {
+            ret_ = ready_count;
+            errno_ = errno;
+            break;
+        }
+        
+        if (0 == ready_count && invalid_.empty()) {
+            break;
+        }
+        
+        // sorted by fd, events_ can be long and so can the ready list when one thread runs many sockets
+        struct epoll_event* ready_begin = &ready_[0];
+        struct epoll_event* ready_end = ready_begin + ready_count;
+        std::sort(ready_begin, ready_end, [](const struct epoll_event& _l, const struct epoll_event& _r){ return _l.data.fd < _r.data.fd;});
+        
+        for (size_t i = 0; i < events_.size(); ++i) {
+            SOCKET fd = events_[i].fd;
+            
+            if (!invalid_.empty() && invalid_.end() != invalid_.find(fd)) {
+                events_[i].revents = POLLNVAL;
+            } else {
+                auto it = std::lower_bound(ready_begin, ready_end, fd, [](const struct epoll_event& _v, SOCKET _fd){ return _v.data.fd < _fd;});
+                if (it == ready_end || it->data.fd != fd) continue;
+                // EPOLLIN/OUT/ERR/HUP share their values with the poll(2) flags
+                events_[i].revents = (short)(it->events & (events_[i].events | POLLERR | POLLHUP));
+                if (0 == events_[i].revents) continue;
+            }
+            
+            ++ret_;
+            if (0 == i) continue;
+            
+            PollEvent traggered_event;
+            traggered_event.poll_event_ = events_[i];
+            traggered_event.user_data_  = events_user_data_[events_[i].fd];
+            
+            triggered_events_.push_back(traggered_event);
+        }
+    } while(false);
+    
+    if (autoclear_) Breaker().Clear();
+    return ret_;
+}
+#endif
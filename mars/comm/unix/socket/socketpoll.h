@@ -22,15 +22,20 @@
 #define _SOCKSTPOLL_ 
 
 #include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "comm/socket/unix_socket.h"
 #include "comm/socket/socketbreaker.h"
 
 struct PollEvent {
     friend class SocketPoll;
+    friend class SocketEpoll;
 public:
     PollEvent();
     
@@ -58,7 +63,7 @@ public:
     void ReadEvent(SOCKET _fd, bool _active);
     void WriteEvent(SOCKET _fd, bool _active);
     void NullEvent(SOCKET _fd);
-    void DelEvent(SOCKET _fd);
+    virtual void DelEvent(SOCKET _fd);
     void ClearEvent();
 
     virtual int Poll();
@@ -90,4 +95,41 @@ protected:
     int                    errno_;
 };
 
+#ifdef __linux__
+/*
+ * SocketPoll on a persistent epoll set: the fds stay registered across Poll() calls,
+ * each Poll() only issues epoll_ctl for what changed in the event list since the last one.
+ * Registration is level triggered, so what Poll() reports is the same as poll(2) would.
+ * Without _persistent there is no epoll set and it polls like SocketPoll, so SocketSelect can hold one either way.
+ *
+ * DelEvent() a socket before closing it. Closing one that is still in the list,
+ * then getting the fd number back for a new socket, leaves the kernel watching the old file.
+ */
+class SocketEpoll : public SocketPoll {
+public:
+    SocketEpoll(SocketBreaker& _breaker, bool _autoclear = false, bool _persistent = true);
+    virtual ~SocketEpoll();
+    
+    virtual void DelEvent(SOCKET _fd);
+    virtual int Poll(int _msec);
+    using SocketPoll::Poll;
+    
+private:
+    struct Registration {
+        uint32_t events;
+        uint32_t generation;    // the Poll() that last saw the fd in events_
+    };
+    
+    void __Sync();
+    
+private:
+    int                             epfd_;
+    uint32_t                        generation_;
+    std::map<SOCKET, Registration>  registered_;
+    std::set<SOCKET>                invalid_;    // fds epoll_ctl refused, reported as POLLNVAL
+    std::vector<pollfd>             synced_;     // events_ as of the last __Sync(), nothing to do while it's unchanged
+    std::vector<struct epoll_event> ready_;
+};
+#endif
+
 #endif
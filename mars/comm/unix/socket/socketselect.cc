@@ -18,7 +18,7 @@
 
 
 #if 0/*TARGET_OS_MAC*/
-SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear)
+SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear, bool _persistent)
 : breaker_(_breaker), kq_(0), events_(NULL), trigered_events_(0), errno_(0), autoclear_(_autoclear)
 {
     // inital FD
@@ -179,9 +179,15 @@ int SocketSelect::Errno() const
 
 #else
 
-SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear)
+#ifdef __linux__
+SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear, bool _persistent)
+: socket_poll_(_breaker, _autoclear, _persistent)
+{}
+#else
+SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear, bool _persistent)
 : socket_poll_(_breaker, _autoclear)
 {}
+#endif
 
 SocketSelect::~SocketSelect() {}
 
@@ -21,7 +21,7 @@
 #endif
 class SocketSelect {
   public:
-    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false);
+    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false, bool _persistent = false);
     ~SocketSelect();
 
     void PreSelect();
@@ -62,7 +62,9 @@ class SocketSelect {
 
 class SocketSelect {
   public:
-    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false);
+    // _persistent: keep the fds registered across Select() calls (SocketEpoll), for a loop that selects on the same sockets every time.
+    // only makes a difference on linux.
+    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false, bool _persistent = false);
     virtual ~SocketSelect();
 
     void PreSelect();
@@ -92,7 +94,11 @@ class SocketSelect {
     SocketSelect& operator=(const SocketSelect&);
 
   protected:
+#ifdef __linux__
+    SocketEpoll  socket_poll_;
+#else
     SocketPoll  socket_poll_;
+#endif
 };
 
 #endif
@@ -51,7 +51,7 @@ class SocketBreaker {
 
 class SocketSelect {
   public:
-    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false);
+    SocketSelect(SocketBreaker& _breaker, bool _autoclear = false, bool _persistent = false);   // _persistent: no effect here
     ~SocketSelect();
 
     void PreSelect();
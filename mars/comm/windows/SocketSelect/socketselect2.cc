@@ -114,7 +114,7 @@ WSAEVENT SocketBreaker::BreakerFD() const {
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear)
+SocketSelect::SocketSelect(SocketBreaker& _breaker, bool _autoclear, bool _persistent)
     : autoclear_(_autoclear), breaker_(_breaker), m_broken(false), errno_(0) {
     // inital FD
     FD_ZERO(&writefd_);
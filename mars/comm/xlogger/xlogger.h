@@ -30,6 +30,7 @@
 
 #ifdef XLOGGER_DISABLE
 #define  xlogger_IsEnabledFor(_level)	(false)
+#define  xlogger_IsEnabledForModule(_level, _tag, _filename)	(false)
 #define  xlogger_AssertP(...)			((void)0)
 #define  xlogger_Assert(...)			((void)0)
 #define  xlogger_VPrint(...)			((void)0)
@@ -39,6 +40,9 @@
 
 #ifdef __cplusplus
 #include <string>
+#include <type_traits>
+
+#include "xlogger_binary.h"
 
 template <bool x> struct XLOGGER_STATIC_ASSERTION_FAILURE;
 template <> struct XLOGGER_STATIC_ASSERTION_FAILURE<true> { enum { value = 1 }; };
@@ -55,6 +59,143 @@ using TypeSafeFormat = void*;
 const struct XLoggerTag {XLoggerTag(){}} __xlogger_tag__;
 const struct XLoggerInfoNull {XLoggerInfoNull(){}} __xlogger_info_null__;
 
+inline bool XLoggerSerializeString(XLoggerBinaryWriter& _writer, const char* _str) {
+    return _writer.Put(kXLoggerBinaryArgString) && _writer.PutString(_str, strlen(_str));
+}
+
+/*
+ * Prints or serializes one TSF argument. Integers are written by string_cast_itoa and strings are appended as they are,
+ * everything else goes through string_cast like before. Serialize keeps integers, doubles, bools and chars raw,
+ * the decoder prints them the same way string_cast does.
+ */
+template <typename T>
+struct TypeSafeArgStringCastAppender {
+    static bool Append(std::string& _out, const void* _value) {
+        const string_cast& value = *(const T*)_value;
+        if (NULL == value.str()) return false;
+        _out += value.str();
+        return true;
+    }
+
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        const string_cast& value = *(const T*)_value;
+        return NULL != value.str() && XLoggerSerializeString(_writer, value.str());
+    }
+};
+
+template <typename T, bool IsInteger = std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>
+struct TypeSafeArgAppender : public TypeSafeArgStringCastAppender<T> {};
+
+template <typename T>
+struct TypeSafeArgAppender<T, true> {
+    static bool Append(std::string& _out, const void* _value) {
+        char temp[32];
+        _out += string_cast_itoa(*(const T*)_value, temp);
+        return true;
+    }
+
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        if (std::is_signed<T>::value) return _writer.Put(kXLoggerBinaryArgSigned) && _writer.PutSigned((int64_t)*(const T*)_value);
+        return _writer.Put(kXLoggerBinaryArgUnsigned) && _writer.PutVarint((uint64_t)*(const T*)_value);
+    }
+};
+
+template <typename T>
+struct TypeSafeArgDoubleAppender : public TypeSafeArgStringCastAppender<T> {
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        double value = *(const T*)_value;
+        return _writer.Put(kXLoggerBinaryArgDouble) && _writer.PutBytes(&value, sizeof(value));
+    }
+};
+
+template <> struct TypeSafeArgAppender<float, false> : public TypeSafeArgDoubleAppender<float> {};
+template <> struct TypeSafeArgAppender<double, false> : public TypeSafeArgDoubleAppender<double> {};
+
+template <>
+struct TypeSafeArgAppender<bool, false> {
+    static bool Append(std::string& _out, const void* _value) { _out += *(const bool*)_value ? "true" : "false"; return true; }
+
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        return _writer.Put(kXLoggerBinaryArgBool) && _writer.Put(*(const bool*)_value ? 1 : 0);
+    }
+};
+
+template <>
+struct TypeSafeArgAppender<char, false> {
+    static bool Append(std::string& _out, const void* _value) {
+        if ('\0' != *(const char*)_value) _out += *(const char*)_value;
+        return true;
+    }
+
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        return _writer.Put(kXLoggerBinaryArgChar) && _writer.Put((uint8_t)*(const char*)_value);
+    }
+};
+
+template <>
+struct TypeSafeArgAppender<const char*, false> {
+    static bool Append(std::string& _out, const void* _value) {
+        const char* value = *(const char* const*)_value;
+        if (NULL == value) return false;
+        _out += value;
+        return true;
+    }
+
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) {
+        const char* value = *(const char* const*)_value;
+        return NULL != value && XLoggerSerializeString(_writer, value);
+    }
+};
+
+template <>
+struct TypeSafeArgAppender<char*, false> : public TypeSafeArgAppender<const char*, false> {};
+
+template <size_t N>
+struct TypeSafeArgAppender<char[N], false> {
+    static bool Append(std::string& _out, const void* _value) { _out += (const char*)_value; return true; }
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) { return XLoggerSerializeString(_writer, (const char*)_value); }
+};
+
+template <>
+struct TypeSafeArgAppender<std::string, false> {
+    static bool Append(std::string& _out, const void* _value) { _out += ((const std::string*)_value)->c_str(); return true; }
+    static bool Serialize(XLoggerBinaryWriter& _writer, const void* _value) { return XLoggerSerializeString(_writer, ((const std::string*)_value)->c_str()); }
+};
+
+/*
+ * Reference to one argument of a TSF call and the functions printing or serializing it, the argument is only
+ * converted when its placeholder is reached and is written straight into the message.
+ */
+class TypeSafeArg {
+public:
+    TypeSafeArg(): append_(NULL), serialize_(NULL), value_(NULL) {}
+
+    template <typename T>
+    static TypeSafeArg Make(const T& _value) {
+        // volatile flags are logged as well, the value is read once when it's printed.
+        typedef TypeSafeArgAppender<typename std::remove_cv<T>::type> Appender;
+        return TypeSafeArg(&Appender::Append, &Appender::Serialize, (const void*)&_value);
+    }
+
+    static bool Serialize(const TypeSafeArg* _args, size_t _count, XLoggerBinaryWriter& _writer) {
+        for (size_t i = 0; i < _count; ++i) {
+            if (!_args[i].serialize_(_writer, _args[i].value_)) return false;
+        }
+        return true;
+    }
+
+    bool AppendTo(std::string& _out) const { return append_(_out, value_); }
+
+private:
+    TypeSafeArg(bool (*_append)(std::string&, const void*), bool (*_serialize)(XLoggerBinaryWriter&, const void*), const void* _value)
+    : append_(_append), serialize_(_serialize), value_(_value) {}
+
+private:
+    bool (*append_)(std::string& _out, const void* _value);
+    bool (*serialize_)(XLoggerBinaryWriter& _writer, const void* _value);
+    const void* value_;
+};
+
 class XMessage {
 public:
     XMessage(): m_message() { m_message.reserve(512); }
@@ -92,28 +233,17 @@ public:
 #endif
     XMessage& VPrintf(const char* _format, va_list _list);
 
-#define XLOGGER_FORMAT_ARGS(n) PP_ENUM_TRAILING_PARAMS(n, const string_cast& a)
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(0));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(1));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(2));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(3));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(4));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(5));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(6));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(7));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(8));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(9));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(10));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(11));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(12));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(13));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(14));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(15));
-    XMessage&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(16));
-#undef XLOGGER_FORMAT_ARGS
+    template <typename... Args>
+    XMessage&  operator()(const TypeSafeFormat&, const char* _format, const Args&... _args) {
+        if (_format != NULL) {
+            const TypeSafeArg args[sizeof...(Args) + 1] = { TypeSafeArg::Make(_args)..., TypeSafeArg() };
+            DoTypeSafeFormat(_format, args, sizeof...(Args));
+        }
+        return *this;
+    }
 
 private:
-    void DoTypeSafeFormat(const char* _format, const string_cast** _args);
+    void DoTypeSafeFormat(const char* _format, const TypeSafeArg* _args, size_t _count);
 
 private:
 //	  XMessage(const XMessage&);
@@ -210,28 +340,17 @@ public:
 #endif
     XLogger& VPrintf(const char* _format, va_list _list);
 
-#define XLOGGER_FORMAT_ARGS(n) PP_ENUM_TRAILING_PARAMS(n, const string_cast& a)
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(0));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(1));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(2));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(3));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(4));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(5));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(6));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(7));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(8));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(9));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(10));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(11));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(12));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(13));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(14));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(15));
-    XLogger&  operator()(const TypeSafeFormat&, const char*_format XLOGGER_FORMAT_ARGS(16));
-#undef XLOGGER_FORMAT_ARGS
+    template <typename... Args>
+    XLogger&  operator()(const TypeSafeFormat&, const char* _format, const Args&... _args) {
+        if (_format != NULL) {
+            const TypeSafeArg args[sizeof...(Args) + 1] = { TypeSafeArg::Make(_args)..., TypeSafeArg() };
+            DoTypeSafeFormat(_format, args, sizeof...(Args));
+        }
+        return *this;
+    }
 
 private:
-    void DoTypeSafeFormat(const char* _format, const string_cast** _args);
+    void DoTypeSafeFormat(const char* _format, const TypeSafeArg* _args, size_t _count);
     
 private:
     XLogger(const XLogger&);
@@ -247,10 +366,61 @@ private:
 };
 
 
+/*
+ * Deferred-format logging for hot paths, e.g. xinfo2_bin(TSF"send seq:%_, len:%_", seq, len).
+ * When a binary appender is installed (appender_set_binary_log), the call site and the raw arguments are written
+ * instead of text and the decoder renders the line, otherwise it logs exactly like XLogger.
+ * Only the TSF form is supported, the message can not be extended with <<, >> or groups.
+ */
+class XBinaryLogger {
+public:
+    XBinaryLogger(TLogLevel _level, const char* _tag, const char* _file, const char* _func, int _line, bool (*_hook)(XLoggerInfo& _info, std::string& _log))
+    : m_level(_level), m_tag(_tag), m_file(_file), m_func(_func), m_line(_line), m_hook(_hook) {}
+
+    template <typename... Args>
+    void operator()(const TypeSafeFormat& _tsf, const char* _format, const Args&... _args) {
+        if (NULL == m_hook && NULL != _format && xlogger_IsBinaryEnabled()) {
+            const TypeSafeArg args[sizeof...(Args) + 1] = { TypeSafeArg::Make(_args)..., TypeSafeArg() };
+
+            char temp[4 * 1024];
+            XLoggerBinaryWriter writer(temp, sizeof(temp));
+            if (TypeSafeArg::Serialize(args, sizeof...(Args), writer)) {
+                XLoggerInfo info;
+                info.level = m_level;
+                info.tag = m_tag;
+                info.filename = m_file;
+                info.func_name = m_func;
+                info.line = m_line;
+                gettimeofday(&info.timeval, NULL);
+                info.pid = -1;
+                info.tid = -1;
+                info.maintid = -1;
+
+                if (xlogger_WriteBinary(&info, _format, writer.Ptr(), writer.Length())) return;
+            }
+        }
+
+        // too long, NULL strings or no binary appender, the text path handles all of them.
+        XLogger(m_level, m_tag, m_file, m_func, m_line, m_hook)(_tsf, _format, _args...);
+    }
+
+private:
+    XBinaryLogger(const XBinaryLogger&);
+    XBinaryLogger& operator=(const XBinaryLogger&);
+
+private:
+    TLogLevel m_level;
+    const char* m_tag;
+    const char* m_file;
+    const char* m_func;
+    int m_line;
+    bool (*m_hook)(XLoggerInfo& _info, std::string& _log);
+};
+
 class XScopeTracer {
 public:
     XScopeTracer(TLogLevel _level, const char* _tag, const char* _name, const char* _file, const char* _func, int _line, const char* _log)
-    :m_enable(xlogger_IsEnabledFor(_level)), m_info(), m_tv() {
+    :m_enable(xlogger_IsEnabledForModule(_level, _tag, _file)), m_info(), m_tv() {
         m_info.level = _level;
 
         if (m_enable) {
@@ -350,66 +520,30 @@ inline XMessage& XMessage::operator()(const char* _format, ...) {
     return *this;
 }
 
-#define XLOGGER_FORMAT_ARGS(n) PP_ENUM_TRAILING_PARAMS(n, const string_cast& a)
-#define XLOGGER_VARIANT_ARGS(n) PP_ENUM_PARAMS(n, &a)
-#define XLOGGER_VARIANT_ARGS_NULL(n) PP_ENUM(n, NULL)
-#define XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(n, m) \
-        inline XMessage& XMessage::operator()(const TypeSafeFormat&, const char* _format XLOGGER_FORMAT_ARGS(n)) { \
-        if (_format != NULL) { \
-            const string_cast* args[16] = { XLOGGER_VARIANT_ARGS(n) PP_COMMA_IF(PP_AND(n, m)) XLOGGER_VARIANT_ARGS_NULL(m) }; \
-            DoTypeSafeFormat(_format, args); \
-        } \
-        return *this;\
-    }
-
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(0, 16)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(1, 15)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(2, 14)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(3, 13)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(4, 12)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(5, 11)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(6, 10)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(7, 9)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(8, 8)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(9, 7)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(10, 6)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(11, 5)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(12, 4)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(13, 3)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(14, 2)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(15, 1)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(16, 0)
-
-#undef XLOGGER_FORMAT_ARGS
-#undef XLOGGER_VARIANT_ARGS
-#undef XLOGGER_VARIANT_ARGS_NULL
-#undef XLOGGER_TYPESAFE_FORMAT_IMPLEMENT
-
-inline void XMessage::DoTypeSafeFormat(const char* _format, const string_cast** _args) {
+inline void XMessage::DoTypeSafeFormat(const char* _format, const TypeSafeArg* _args, size_t _count) {
 
     const char* current = _format;
-    int count = 0;
-    while ('\0' != *current)
+    size_t count = 0;
+    while (true)
     {
-       if ('%' != *current)
-       {
-           m_message += *current;
-            ++current;
-            continue;
-       }
-
-        char nextch = *(current+1);
+        // copy everything up to the next placeholder at once.
+        const char* percent = strchr(current, '%');
+        if (NULL == percent) {
+            m_message += current;
+            break;
+        }
+        m_message.append(current, percent - current);
+
+        char nextch = *(percent+1);
         if (('0' <=nextch  && nextch <= '9') || nextch == '_')
         {
-            int argIndex = count;
+            size_t argIndex = count;
             if (nextch != '_') argIndex = nextch - '0';
 
-            if (_args[argIndex] != NULL)
+            if (argIndex < _count)
             {
-                if (NULL != _args[argIndex]->str())
+                if (!_args[argIndex].AppendTo(m_message))
                 {
-                    m_message += _args[argIndex]->str();
-                } else {
                     m_message += "(null)";
                     assert(false);
                 }
@@ -417,13 +551,13 @@ inline void XMessage::DoTypeSafeFormat(const char* _format, const string_cast**
                 assert(false);
             }
             count++;
-            current += 2;
+            current = percent + 2;
         }
         else if (nextch == '%') {
             m_message += '%';
-            current += 2;
+            current = percent + 2;
         } else {
-            ++current;
+            current = percent + 1;
             assert(false);
         }
     }
@@ -483,68 +617,31 @@ inline XLogger& XLogger::operator()(const char* _format, ...) {
     return *this;
 }
 
-#define XLOGGER_FORMAT_ARGS(n) PP_ENUM_TRAILING_PARAMS(n, const string_cast& a)
-#define XLOGGER_VARIANT_ARGS(n) PP_ENUM_PARAMS(n, &a)
-#define XLOGGER_VARIANT_ARGS_NULL(n) PP_ENUM(n, NULL)
-#define XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(n, m) \
-        inline XLogger& XLogger::operator()(const TypeSafeFormat&, const char* _format XLOGGER_FORMAT_ARGS(n)) { \
-        if (_format != NULL) { \
-            const string_cast* args[16] = { XLOGGER_VARIANT_ARGS(n) PP_COMMA_IF(PP_AND(n, m)) XLOGGER_VARIANT_ARGS_NULL(m) }; \
-            DoTypeSafeFormat(_format, args); \
-        } \
-        return *this;\
-    }
-
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(0, 16)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(1, 15)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(2, 14)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(3, 13)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(4, 12)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(5, 11)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(6, 10)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(7, 9)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(8, 8)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(9, 7)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(10, 6)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(11, 5)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(12, 4)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(13, 3)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(14, 2)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(15, 1)
-XLOGGER_TYPESAFE_FORMAT_IMPLEMENT(16, 0)
-
-
-#undef XLOGGER_FORMAT_ARGS
-#undef XLOGGER_VARIANT_ARGS
-#undef XLOGGER_VARIANT_ARGS_NULL
-#undef XLOGGER_TYPESAFE_FORMAT_IMPLEMENT
-
-inline void XLogger::DoTypeSafeFormat(const char* _format, const string_cast** _args) {
+inline void XLogger::DoTypeSafeFormat(const char* _format, const TypeSafeArg* _args, size_t _count) {
 
     const char* current = _format;
-    int count = 0;
-    while ('\0' != *current)
+    size_t count = 0;
+    while (true)
     {
-       if ('%' != *current)
-       {
-           m_message += *current;
-            ++current;
-            continue;
-       }
-
-        char nextch = *(current+1);
+        // copy everything up to the next placeholder at once.
+        const char* percent = strchr(current, '%');
+        if (NULL == percent) {
+            m_message += current;
+            break;
+        }
+        m_message.append(current, percent - current);
+
+        char nextch = *(percent+1);
         if (('0' <=nextch  && nextch <= '9') || nextch == '_')
         {
 
-            int argIndex = count;
+            size_t argIndex = count;
             if (nextch != '_') argIndex = nextch - '0';
 
-            if (_args[argIndex] != NULL)
+            if (argIndex < _count)
             {
-                if (NULL != _args[argIndex]->str())
+                if (!_args[argIndex].AppendTo(m_message))
                 {
-                    m_message += _args[argIndex]->str();
-                } else {
                     m_info.level = kLevelFatal;
                     m_message += "{!!! void XLogger::DoTypeSafeFormat: _args[";
                     m_message += string_cast(argIndex).str();
@@ -559,13 +656,13 @@ inline void XLogger::DoTypeSafeFormat(const char* _format, const string_cast** _
                 assert(false);
             }
             count++;
-            current += 2;
+            current = percent + 2;
         }
         else if (nextch == '%') {
             m_message += '%';
-            current += 2;
+            current = percent + 2;
         } else {
-            ++current;
+            current = percent + 1;
             m_info.level = kLevelFatal;
             m_message += "{!!! void XLogger::DoTypeSafeFormat: %";
             m_message += nextch;
@@ -620,12 +717,12 @@ __attribute__((__format__ (printf, 2, 3)))
 #endif
 __inline void  __xlogger_c_write(const XLoggerInfo* _info, const char* _log, ...) { xlogger_Write(_info, _log); }
 
-#define xlogger2(level, tag, file, func, line, ...)		 if ((!xlogger_IsEnabledFor(level)));\
+#define xlogger2(level, tag, file, func, line, ...)		 if ((!xlogger_IsEnabledForModule(level, tag, file)));\
                                                               else { XLoggerInfo info= {level, tag, file, func, line,\
                                                                      {0, 0}, -1, -1, -1};\ gettimeofday(&info.m_tv, NULL);\
                                                                      XLOGGER_ROUTER_OUTPUT(__xlogger_c_write(&info, __VA_ARGS__),xlogger_Print(&info, __VA_ARGS__), __VA_ARGS__);}
 
-#define xlogger2_if(exp, level, tag, file, func, line, ...)    if (!(exp) || !xlogger_IsEnabledFor(level));\
+#define xlogger2_if(exp, level, tag, file, func, line, ...)    if (!(exp) || !xlogger_IsEnabledForModule(level, tag, file));\
                                                                     else { XLoggerInfo info= {level, tag, file, func, line,\
                                                                            {0, 0}, -1, -1, -1}; gettimeofday(&info.timeval, NULL);\
                                                                            XLOGGER_ROUTER_OUTPUT(__xlogger_c_write(&info, __VA_ARGS__),xlogger_Print(&info, __VA_ARGS__), __VA_ARGS__);}
@@ -659,19 +756,23 @@ __inline void  __xlogger_c_write(const XLoggerInfo* _info, const char* _log, ...
 #define XLOGGER_HOOK NULL
 #endif
 
-#define xlogger(level, tag, file, func, line, ...)	   if ((!xlogger_IsEnabledFor(level)));\
+#define xlogger(level, tag, file, func, line, ...)	   if ((!xlogger_IsEnabledForModule(level, tag, file)));\
                                                        else XLogger(level, tag, file, func, line, XLOGGER_HOOK)\
                                                              XLOGGER_ROUTER_OUTPUT(.WriteNoFormat(TSF __VA_ARGS__),(TSF __VA_ARGS__), __VA_ARGS__)
 
-#define xlogger2(level, tag, file, func, line, ...)		if ((!xlogger_IsEnabledFor(level)));\
+#define xlogger2(level, tag, file, func, line, ...)		if ((!xlogger_IsEnabledForModule(level, tag, file)));\
                                                         else XLogger(level, tag, file, func, line, XLOGGER_HOOK)\
                                                              XLOGGER_ROUTER_OUTPUT(.WriteNoFormat(__VA_ARGS__),(__VA_ARGS__), __VA_ARGS__)
 
-#define xlogger2_if(exp, level, tag, file, func, line, ...)		if ((!(exp) || !xlogger_IsEnabledFor(level)));\
+#define xlogger2_if(exp, level, tag, file, func, line, ...)		if ((!(exp) || !xlogger_IsEnabledForModule(level, tag, file)));\
                                                                 else XLogger(level, tag, file, func, line, XLOGGER_HOOK)\
                                                                      XLOGGER_ROUTER_OUTPUT(.WriteNoFormat(__VA_ARGS__),(__VA_ARGS__), __VA_ARGS__)
 
+#define xlogger2_bin(level, tag, file, func, line, ...)	if ((!xlogger_IsEnabledForModule(level, tag, file)));\
+                                                        else XBinaryLogger(level, tag, file, func, line, XLOGGER_HOOK)(__VA_ARGS__)
+
 #define __xlogger_cpp_impl2(level, ...)				 xlogger2(level, XLOGGER_TAG, __XFILE__, __XFUNCTION__, __LINE__, __VA_ARGS__)
+#define __xlogger_cpp_impl_bin(level, ...)			 xlogger2_bin(level, XLOGGER_TAG, __XFILE__, __XFUNCTION__, __LINE__, __VA_ARGS__)
 #define __xlogger_cpp_impl_if(level, exp, ...)	   xlogger2_if(exp, level, XLOGGER_TAG, __XFILE__, __XFUNCTION__, __LINE__, __VA_ARGS__)
 
 #define xverbose2(...)			   __xlogger_cpp_impl2(kLevelVerbose, __VA_ARGS__)
@@ -682,6 +783,12 @@ __inline void  __xlogger_c_write(const XLoggerInfo* _info, const char* _log, ...
 #define xfatal2(...)			   __xlogger_cpp_impl2(kLevelFatal, __VA_ARGS__)
 #define xlog2(level, ...)		   __xlogger_cpp_impl2(level, __VA_ARGS__)
 
+#define xverbose2_bin(...)		   __xlogger_cpp_impl_bin(kLevelVerbose, __VA_ARGS__)
+#define xdebug2_bin(...)		   __xlogger_cpp_impl_bin(kLevelDebug, __VA_ARGS__)
+#define xinfo2_bin(...)			   __xlogger_cpp_impl_bin(kLevelInfo, __VA_ARGS__)
+#define xwarn2_bin(...)			   __xlogger_cpp_impl_bin(kLevelWarn, __VA_ARGS__)
+#define xerror2_bin(...)		   __xlogger_cpp_impl_bin(kLevelError, __VA_ARGS__)
+
 #define xverbose2_if(exp, ...)	   __xlogger_cpp_impl_if(kLevelVerbose, exp,  __VA_ARGS__)
 #define xdebug2_if(exp, ...)	   __xlogger_cpp_impl_if(kLevelDebug, exp,	__VA_ARGS__)
 #define xinfo2_if(exp, ...)		   __xlogger_cpp_impl_if(kLevelInfo, exp,  __VA_ARGS__)
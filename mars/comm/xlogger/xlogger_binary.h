@@ -0,0 +1,87 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * xlogger_binary.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef XLOGGER_BINARY_H_
+#define XLOGGER_BINARY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Layout of the deferred-format records an appender writes for the *_bin macros of xlogger.h,
+ *  |0x1E|'D'|varint len|varint id|varint line|tag|file|function|format|     strings are |varint len|bytes|
+ *  |0x1E|'R'|varint len|varint id|level|flags|sec|varint msec|gmtoff|pid|tid|args|    sec, gmtoff, pid, tid are zigzag varints
+ * every block carries the definitions of the sites it uses, so each block is rendered on its own.
+ */
+static const char kXLoggerBinaryRecordMagic = 0x1E;     // first byte of a line, never produced by log_formater
+static const char kXLoggerBinaryRecordSite = 'D';
+static const char kXLoggerBinaryRecordLog = 'R';
+
+enum TXLoggerBinaryArgType {
+    kXLoggerBinaryArgSigned = 'i',
+    kXLoggerBinaryArgUnsigned = 'u',
+    kXLoggerBinaryArgDouble = 'd',
+    kXLoggerBinaryArgBool = 'b',
+    kXLoggerBinaryArgChar = 'c',
+    kXLoggerBinaryArgString = 's',
+};
+
+/*
+ * Writer for the records and the arguments of deferred-format logs, integers are LEB128 varints,
+ * signed ones zigzag encoded, doubles are 8 bytes little-endian and strings are |varint len|bytes|.
+ */
+class XLoggerBinaryWriter {
+public:
+    XLoggerBinaryWriter(char* _buffer, size_t _len): begin_(_buffer), pos_(_buffer), end_(_buffer + _len) {}
+
+    bool Put(uint8_t _value) {
+        if (pos_ >= end_) return false;
+        *pos_++ = (char)_value;
+        return true;
+    }
+
+    bool PutVarint(uint64_t _value) {
+        while (_value >= 0x80) {
+            if (!Put((uint8_t)(_value | 0x80))) return false;
+            _value >>= 7;
+        }
+        return Put((uint8_t)_value);
+    }
+
+    bool PutSigned(int64_t _value) { return PutVarint(((uint64_t)_value << 1) ^ (uint64_t)(_value >> 63)); }
+
+    bool PutBytes(const void* _data, size_t _len) {
+        if ((size_t)(end_ - pos_) < _len) return false;
+        memcpy(pos_, _data, _len);
+        pos_ += _len;
+        return true;
+    }
+
+    bool PutString(const char* _str, size_t _len) { return PutVarint(_len) && PutBytes(_str, _len); }
+
+    const char* Ptr() const { return begin_; }
+    size_t Length() const { return pos_ - begin_; }
+
+private:
+    char* begin_;
+    char* pos_;
+    char* end_;
+};
+
+#endif /* XLOGGER_BINARY_H_ */
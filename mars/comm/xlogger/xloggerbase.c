@@ -6,15 +6,27 @@
 
 #include "comm/xlogger/xloggerbase.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
 
 #include "comm/compiler_util.h"
+#include "comm/time_utils.h"
 
 WEAK_FUNC  TLogLevel   __xlogger_Level_impl();
 WEAK_FUNC  void        __xlogger_SetLevel_impl(TLogLevel _level);
 WEAK_FUNC  int         __xlogger_IsEnabledFor_impl(TLogLevel _level);
 WEAK_FUNC xlogger_appender_t __xlogger_SetAppender_impl(xlogger_appender_t _appender);
+WEAK_FUNC  void        __xlogger_SetModuleLevel_impl(int _kind, const char* _name, TLogLevel _level);
+WEAK_FUNC  void        __xlogger_ClearModuleLevels_impl();
+WEAK_FUNC  int         __xlogger_IsEnabledForModule_impl(TLogLevel _level, const char* _tag, const char* _filename);
 WEAK_FUNC void __xlogger_Write_impl(const XLoggerInfo* _info, const char* _log);
 WEAK_FUNC void __xlogger_VPrint_impl(const XLoggerInfo* _info, const char* _format, va_list _list);
+WEAK_FUNC xlogger_binary_appender_t __xlogger_SetBinaryAppender_impl(xlogger_binary_appender_t _appender);
+WEAK_FUNC int  __xlogger_IsBinaryEnabled_impl();
+WEAK_FUNC int  __xlogger_WriteBinary_impl(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len);
 
 WEAK_FUNC void __xlogger_AssertP_impl(const XLoggerInfo* _info, const char* _expression, const char* _format, va_list _list);
 WEAK_FUNC void __xlogger_Assert_impl(const XLoggerInfo* _info, const char* _expression, const char* _log);
@@ -45,6 +57,29 @@ xlogger_appender_t xlogger_SetAppender(xlogger_appender_t _appender) {
     return __xlogger_SetAppender_impl(_appender);
 }
 
+#define XLOGGER_MODULE_TAG  (1)
+#define XLOGGER_MODULE_FILE (2)
+
+void xlogger_SetTagLevel(const char* _tag, TLogLevel _level) {
+    if (NULL != &__xlogger_SetModuleLevel_impl)
+        __xlogger_SetModuleLevel_impl(XLOGGER_MODULE_TAG, _tag, _level);
+}
+
+void xlogger_SetFileLevel(const char* _filename, TLogLevel _level) {
+    if (NULL != &__xlogger_SetModuleLevel_impl)
+        __xlogger_SetModuleLevel_impl(XLOGGER_MODULE_FILE, _filename, _level);
+}
+
+void xlogger_ClearModuleLevels() {
+    if (NULL != &__xlogger_ClearModuleLevels_impl)
+        __xlogger_ClearModuleLevels_impl();
+}
+
+int xlogger_IsEnabledForModule(TLogLevel _level, const char* _tag, const char* _filename) {
+    if (NULL == &__xlogger_IsEnabledForModule_impl) { return xlogger_IsEnabledFor(_level);}
+    return __xlogger_IsEnabledForModule_impl(_level, _tag, _filename);
+}
+
 static xlogger_filter_t sg_filter = NULL;
 void xlogger_SetFilter(xlogger_filter_t _filter) {
     sg_filter = _filter;
@@ -59,6 +94,22 @@ void xlogger_Write(const XLoggerInfo* _info, const char* _log) {
 		__xlogger_Write_impl(_info, _log);
 }
 
+xlogger_binary_appender_t xlogger_SetBinaryAppender(xlogger_binary_appender_t _appender) {
+    if (NULL == &__xlogger_SetBinaryAppender_impl) { return NULL;}
+    return __xlogger_SetBinaryAppender_impl(_appender);
+}
+
+int xlogger_IsBinaryEnabled() {
+    // filters only understand text.
+    if (NULL == &__xlogger_IsBinaryEnabled_impl || NULL != sg_filter) { return 0;}
+    return __xlogger_IsBinaryEnabled_impl();
+}
+
+int xlogger_WriteBinary(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len) {
+    if (NULL == &__xlogger_WriteBinary_impl) { return 0;}
+    return __xlogger_WriteBinary_impl(_info, _format, _args, _len);
+}
+
 void xlogger_VPrint(const XLoggerInfo* _info, const char* _format, va_list _list) {
 	if (NULL != &__xlogger_VPrint_impl)
 		__xlogger_VPrint_impl(_info, _format, _list);
@@ -92,11 +143,215 @@ void xlogger_Assert(const XLoggerInfo* _info, const char* _expression, const cha
 #ifndef USING_XLOG_WEAK_FUNC
 static TLogLevel gs_level = kLevelNone;
 static xlogger_appender_t gs_appender = NULL;
+static xlogger_binary_appender_t gs_binary_appender = NULL;
 
 TLogLevel   __xlogger_Level_impl() {return gs_level;}
 void        __xlogger_SetLevel_impl(TLogLevel _level){ gs_level = _level;}
 int         __xlogger_IsEnabledFor_impl(TLogLevel _level) {return gs_level <= _level;}
 
+/*
+ * Module levels live in an open-addressing table that is never changed once published,
+ * a writer copies it with its change and swaps the pointer in, so lookups take no lock.
+ * Replaced tables are chained to the new one, a reader may still hold them for the lookup it is in.
+ * The writer of a later change frees the ones replaced more than XLOGGER_LEVELS_GRACE_MS ago.
+ */
+typedef struct {
+    uint32_t hash;
+    uint8_t kind;
+    uint8_t level;
+    uint16_t name_offset;
+} XLoggerModuleLevel;
+
+typedef struct XLoggerModuleLevels_t {
+    struct XLoggerModuleLevels_t* retired;
+    uint64_t retired_tick;  // when this table replaced retired
+    TLogLevel min_level;    // over all modules, a site below it and the global level is disabled without a lookup
+    TLogLevel max_level;
+    uint32_t count;
+    uint32_t kind_count[3];  // indexed by XLOGGER_MODULE_*, a kind without entries is not looked up
+    uint32_t mask;
+    XLoggerModuleLevel* entries;
+    char* names;
+    size_t names_len;
+} XLoggerModuleLevels;
+
+#define XLOGGER_LEVELS_GRACE_MS (10 * 1000)
+
+#if defined(_MSC_VER)
+#define __xlogger_load_levels()                 ((XLoggerModuleLevels*)(*(void* volatile*)&gs_module_levels))
+#define __xlogger_swap_levels(_old, _new)       ((_old) == InterlockedCompareExchangePointer((void* volatile*)&gs_module_levels, (_new), (_old)))
+#define __xlogger_try_reclaim()                 (0 == InterlockedCompareExchange(&gs_levels_reclaiming, 1, 0))
+#define __xlogger_end_reclaim()                 InterlockedExchange(&gs_levels_reclaiming, 0)
+static volatile LONG gs_levels_reclaiming = 0;
+#else
+#define __xlogger_load_levels()                 (__atomic_load_n(&gs_module_levels, __ATOMIC_ACQUIRE))
+#define __xlogger_swap_levels(_old, _new)       (__sync_bool_compare_and_swap(&gs_module_levels, (_old), (_new)))
+#define __xlogger_try_reclaim()                 (__sync_bool_compare_and_swap(&gs_levels_reclaiming, 0, 1))
+#define __xlogger_end_reclaim()                 __sync_lock_release(&gs_levels_reclaiming)
+static volatile int gs_levels_reclaiming = 0;
+#endif
+
+static XLoggerModuleLevels* gs_module_levels = NULL;
+
+static uint32_t __xlogger_module_hash(int _kind, const char* _name) {
+    uint32_t hash = 2166136261u ^ (uint32_t)_kind;
+    for (; '\0' != *_name; ++_name) {
+        hash = (hash ^ (uint8_t)*_name) * 16777619u;
+    }
+    return hash;
+}
+
+static const char* __xlogger_basename(const char* _path) {
+    const char* name = strrchr(_path, '/');
+#ifdef _WIN32
+    const char* win_name = strrchr(NULL == name ? _path : name, '\\');
+    if (NULL != win_name) name = win_name;
+#endif
+    return NULL == name ? _path : name + 1;
+}
+
+static int __xlogger_find_module_level(const XLoggerModuleLevels* _levels, int _kind, const char* _name) {
+    uint32_t hash = __xlogger_module_hash(_kind, _name);
+    uint32_t i = hash & _levels->mask;
+
+    for (; 0 != _levels->entries[i].kind; i = (i + 1) & _levels->mask) {
+        const XLoggerModuleLevel* entry = &_levels->entries[i];
+        if (entry->hash == hash && entry->kind == _kind && 0 == strcmp(_levels->names + entry->name_offset, _name)) {
+            return entry->level;
+        }
+    }
+    return -1;
+}
+
+static void __xlogger_insert_module_level(XLoggerModuleLevels* _levels, int _kind, const char* _name, size_t _len, int _level) {
+    uint32_t hash = __xlogger_module_hash(_kind, _name);
+    uint32_t i = hash & _levels->mask;
+    XLoggerModuleLevel* entry = NULL;
+
+    for (; 0 != _levels->entries[i].kind; i = (i + 1) & _levels->mask) {
+        entry = &_levels->entries[i];
+        if (entry->hash == hash && entry->kind == _kind && 0 == strcmp(_levels->names + entry->name_offset, _name)) {
+            entry->level = (uint8_t)_level;
+            return;
+        }
+    }
+
+    entry = &_levels->entries[i];
+    entry->hash = hash;
+    entry->kind = (uint8_t)_kind;
+    entry->level = (uint8_t)_level;
+    entry->name_offset = (uint16_t)_levels->names_len;
+    memcpy(_levels->names + _levels->names_len, _name, _len + 1);
+    _levels->names_len += _len + 1;
+    _levels->count++;
+    _levels->kind_count[_kind]++;
+}
+
+// a copy of _old with _name set, or an empty table when _name is NULL.
+static XLoggerModuleLevels* __xlogger_new_module_levels(XLoggerModuleLevels* _old, int _kind, const char* _name, TLogLevel _level) {
+    uint32_t count = (NULL == _old ? 0 : _old->count) + 1;
+    size_t names_len = (NULL == _old ? 0 : _old->names_len) + (NULL == _name ? 0 : strlen(_name) + 1);
+    uint32_t capacity = 8;
+    XLoggerModuleLevels* levels = NULL;
+    uint32_t i = 0;
+
+    if (names_len > 0xFFFF) return NULL;
+    while (capacity < count * 2) capacity *= 2;
+
+    levels = (XLoggerModuleLevels*)calloc(1, sizeof(XLoggerModuleLevels) + capacity * sizeof(XLoggerModuleLevel) + names_len);
+    if (NULL == levels) return NULL;
+
+    levels->retired = _old;
+    levels->retired_tick = gettickcount();
+    levels->mask = capacity - 1;
+    levels->entries = (XLoggerModuleLevel*)(levels + 1);
+    levels->names = (char*)(levels->entries + capacity);
+    levels->min_level = kLevelNone;
+    levels->max_level = kLevelAll;
+
+    if (NULL == _name) return levels;
+
+    if (NULL != _old) {
+        for (i = 0; i <= _old->mask; ++i) {
+            const XLoggerModuleLevel* entry = &_old->entries[i];
+            const char* name = _old->names + entry->name_offset;
+            if (0 != entry->kind) __xlogger_insert_module_level(levels, entry->kind, name, strlen(name), entry->level);
+        }
+    }
+    __xlogger_insert_module_level(levels, _kind, _name, strlen(_name), _level);
+
+    for (i = 0; i <= levels->mask; ++i) {
+        if (0 == levels->entries[i].kind) continue;
+        if ((TLogLevel)levels->entries[i].level < levels->min_level) levels->min_level = (TLogLevel)levels->entries[i].level;
+        if ((TLogLevel)levels->entries[i].level > levels->max_level) levels->max_level = (TLogLevel)levels->entries[i].level;
+    }
+    return levels;
+}
+
+// frees the tables in the chain of _levels that were replaced long enough ago for any lookup in them to be over.
+static void __xlogger_reclaim_module_levels(XLoggerModuleLevels* _levels) {
+    uint64_t now = gettickcount();
+    XLoggerModuleLevels* expired = NULL;
+
+    // another writer is at it, the chain is looked at again on the next change.
+    if (!__xlogger_try_reclaim()) return;
+
+    while (NULL != _levels->retired && (now < _levels->retired_tick || now - _levels->retired_tick < XLOGGER_LEVELS_GRACE_MS)) {
+        _levels = _levels->retired;
+    }
+    expired = _levels->retired;
+    _levels->retired = NULL;
+    __xlogger_end_reclaim();
+
+    while (NULL != expired) {
+        XLoggerModuleLevels* next = expired->retired;
+        free(expired);
+        expired = next;
+    }
+}
+
+static void __xlogger_publish_module_levels(int _kind, const char* _name, TLogLevel _level) {
+    XLoggerModuleLevels* old_levels = NULL;
+    XLoggerModuleLevels* new_levels = NULL;
+
+    do {
+        free(new_levels);
+        old_levels = __xlogger_load_levels();
+        new_levels = __xlogger_new_module_levels(old_levels, _kind, _name, _level);
+        if (NULL == new_levels) return;
+    } while (!__xlogger_swap_levels(old_levels, new_levels));
+
+    __xlogger_reclaim_module_levels(new_levels);
+}
+
+void __xlogger_SetModuleLevel_impl(int _kind, const char* _name, TLogLevel _level) {
+    if (NULL == _name || '\0' == *_name || _level < kLevelAll || _level > kLevelNone) return;
+    __xlogger_publish_module_levels(_kind, XLOGGER_MODULE_FILE == _kind ? __xlogger_basename(_name) : _name, _level);
+}
+
+void __xlogger_ClearModuleLevels_impl() {
+    if (NULL == __xlogger_load_levels()) return;
+    __xlogger_publish_module_levels(0, NULL, kLevelNone);
+}
+
+int __xlogger_IsEnabledForModule_impl(TLogLevel _level, const char* _tag, const char* _filename) {
+    const XLoggerModuleLevels* levels = __xlogger_load_levels();
+    int module_level = -1;
+
+    if (NULL == levels || 0 == levels->count) return gs_level <= _level;
+    if (_level < levels->min_level && _level < gs_level) return 0;
+    if (_level >= levels->max_level && _level >= gs_level) return 1;
+
+    if (NULL != _filename && 0 != levels->kind_count[XLOGGER_MODULE_FILE]) {
+        module_level = __xlogger_find_module_level(levels, XLOGGER_MODULE_FILE, __xlogger_basename(_filename));
+    }
+    if (0 > module_level && NULL != _tag && 0 != levels->kind_count[XLOGGER_MODULE_TAG]) {
+        module_level = __xlogger_find_module_level(levels, XLOGGER_MODULE_TAG, _tag);
+    }
+
+    return (0 > module_level ? gs_level : (TLogLevel)module_level) <= _level;
+}
+
 xlogger_appender_t __xlogger_SetAppender_impl(xlogger_appender_t _appender)  {
     xlogger_appender_t old_appender = gs_appender;
     gs_appender = _appender;
@@ -126,6 +381,30 @@ void __xlogger_Write_impl(const XLoggerInfo* _info, const char* _log) {
     }
 }
 
+xlogger_binary_appender_t __xlogger_SetBinaryAppender_impl(xlogger_binary_appender_t _appender) {
+    xlogger_binary_appender_t old_appender = gs_binary_appender;
+    gs_binary_appender = _appender;
+    return old_appender;
+}
+
+int __xlogger_IsBinaryEnabled_impl() { return NULL != gs_binary_appender;}
+
+int __xlogger_WriteBinary_impl(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len) {
+    xlogger_binary_appender_t appender = gs_binary_appender;
+    if (!appender || NULL == _info) return 0;
+
+    if (-1==_info->pid && -1==_info->tid && -1==_info->maintid)
+    {
+        XLoggerInfo* info = (XLoggerInfo*)_info;
+        info->pid = xlogger_pid();
+        info->tid = xlogger_tid();
+        info->maintid = xlogger_maintid();
+    }
+
+    appender(_info, _format, _args, _len);
+    return 1;
+}
+
 void __xlogger_VPrint_impl(const XLoggerInfo* _info, const char* _format, va_list _list) {
     if (NULL == _format) {
         XLoggerInfo* info = (XLoggerInfo*)_info;
@@ -64,10 +64,23 @@ void xlogger_SetLevel(TLogLevel _level);
 int  xlogger_IsEnabledFor(TLogLevel _level);
 xlogger_appender_t xlogger_SetAppender(xlogger_appender_t _appender);
 
+// per-module levels checked by the xlogger2 macros before the global one, a file level (base name, e.g. "longlink.cc") wins over a tag level.
+// lookups take no lock, each change publishes a new table.
+void xlogger_SetTagLevel(const char* _tag, TLogLevel _level);
+void xlogger_SetFileLevel(const char* _filename, TLogLevel _level);
+void xlogger_ClearModuleLevels();
+int  xlogger_IsEnabledForModule(TLogLevel _level, const char* _tag, const char* _filename);
+
 typedef int (*xlogger_filter_t)(XLoggerInfo* _info, const char* _log);
 void xlogger_SetFilter(xlogger_filter_t _filter);
 xlogger_filter_t xlogger_GetFilter();
 
+// deferred-format records, _args holds the serialized arguments of _format, see XBinaryLogger in xlogger.h.
+typedef void (*xlogger_binary_appender_t)(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len);
+xlogger_binary_appender_t xlogger_SetBinaryAppender(xlogger_binary_appender_t _appender);
+int  xlogger_IsBinaryEnabled();
+int  xlogger_WriteBinary(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len);  // 0 if no binary appender took it
+
 // no level filter
 #ifdef __GNUC__
 __attribute__((__format__(printf, 3, 4)))
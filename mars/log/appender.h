@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <time.h>
 
 enum TAppenderMode
 {
@@ -31,6 +32,25 @@ enum TAppenderMode
     kAppednerSync,
 };
 
+enum TLogCompressMode
+{
+    kLogCompressZlib,
+    kLogCompressNone,
+};
+
+enum TLogCryptMode
+{
+    kLogCryptTea,
+    kLogCryptChaCha20,
+};
+
+enum TAppenderBufferFullPolicy
+{
+    kAppenderBufferFullDrop,
+    kAppenderBufferFullBlock,
+    kAppenderBufferFullGrow,
+};
+
 void appender_open(TAppenderMode _mode, const char* _dir, const char* _nameprefix, const char* _pub_key);
 void appender_open_with_cache(TAppenderMode _mode, const std::string& _cachedir, const std::string& _logdir,
                               const char* _nameprefix, int _cache_days, const char* _pub_key);
@@ -40,10 +60,71 @@ void appender_close();
 void appender_setmode(TAppenderMode _mode);
 bool appender_getfilepath_from_timespan(int _timespan, const char* _prefix, std::vector<std::string>& _filepath_vec);
 bool appender_make_logfile_name(int _timespan, const char* _prefix, std::vector<std::string>& _filepath_vec);
+/*
+ * Copy the blocks of _log_path holding logs between _begin_time and _end_time to _out_path, which is a regular xlog file.
+ * The index written along with the log file (.xidx) is used to seek straight to them,
+ * parts of the file the index doesn't cover (e.g. written by an older version) are copied whole.
+ *
+ * @param _min_level    a TLogLevel, blocks without any line at or above it are skipped.
+ */
+bool appender_get_period_logs(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                              const char* _out_path, std::string& _err_msg);
 bool appender_get_current_log_path(char* _log_path, unsigned int _len);
 bool appender_get_current_log_cache_path(char* _logPath, unsigned int _len);
 void appender_set_console_log(bool _is_open);
 
+/*
+ * In async mode, let every thread format its logs into a private lock-free ring instead of taking the global buffer lock.
+ * The async log thread is the only one that compresses and encrypts them into the mmap buffer.
+ * Staged lines are not in the mmap buffer yet, so they are lost if the process crashes before the next drain.
+ *
+ * @param _enable    default is false.
+ */
+void appender_set_thread_staging(bool _enable);
+
+/*
+ * Choose what happens to an async log line when the buffer segment being written is nearly full,
+ * because the log thread is still busy writing the previous one to file.
+ * kAppenderBufferFullDrop drops the lines below _drop_level, kAppenderBufferFullBlock makes the caller wait up to 1s,
+ * kAppenderBufferFullGrow moves the segment into a heap buffer, up to the grow limit, and then drops as kAppenderBufferFullDrop.
+ * The count of dropped lines is written to the log with the next flush.
+ *
+ * @param _policy        default is kAppenderBufferFullDrop.
+ * @param _drop_level    a TLogLevel, used by kAppenderBufferFullDrop and past the grow limit, default is kLevelError.
+ *                       kLevelNone drops all.
+ */
+void appender_set_buffer_full_policy(TAppenderBufferFullPolicy _policy, int _drop_level);
+
+/*
+ * Bound the heap buffer kAppenderBufferFullGrow and thread staging flush into while the log thread is busy.
+ *
+ * @param _max_bytes    default is 8MB.
+ */
+void appender_set_buffer_grow_limit(size_t _max_bytes);
+
+/*
+ * Number of async log lines dropped or stalled by a full buffer since the process started.
+ */
+void appender_get_buffer_stat(uint64_t& _dropped_lines, uint64_t& _stalled_lines);
+
+/*
+ * Let xinfo2_bin and the other *_bin macros write the call site and raw arguments instead of text in async mode,
+ * the line is rendered by the decoder (decode_log_file_c_impl). Console output and sync mode always use text.
+ *
+ * @param _enable    default is false, the *_bin macros then log text like xinfo2.
+ */
+void appender_set_binary_log(bool _enable);
+
+/*
+ * Select how async log blocks are compressed and encrypted, must be called before appender_open.
+ * The choice is recorded in the magic byte of every block, so the decoder picks it up automatically.
+ *
+ * @param _compress_mode    default is kLogCompressZlib.
+ * @param _compress_level   zlib level 1~9, default is 9 (Z_BEST_COMPRESSION), lower levels are much cheaper per byte.
+ * @param _crypt_mode       default is kLogCryptTea, only effective when a public key is given to appender_open.
+ */
+void appender_set_codec(TLogCompressMode _compress_mode, int _compress_level, TLogCryptMode _crypt_mode);
+
 /*
  * By default, all logs will write to one file everyday. You can split logs to multi-file by changing max_file_size.
  * 
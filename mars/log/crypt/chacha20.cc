@@ -0,0 +1,94 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * chacha20.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "chacha20.h"
+
+static const size_t kChaCha20BlockLen = 64;
+
+static inline uint32_t __Rotl32(uint32_t _v, int _n) {
+    return (_v << _n) | (_v >> (32 - _n));
+}
+
+static inline uint32_t __Load32(const uint8_t* _p) {
+    return (uint32_t)_p[0] | ((uint32_t)_p[1] << 8) | ((uint32_t)_p[2] << 16) | ((uint32_t)_p[3] << 24);
+}
+
+#define CHACHA20_QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = __Rotl32(d, 16); \
+    c += d; b ^= c; b = __Rotl32(b, 12); \
+    a += b; d ^= a; d = __Rotl32(d, 8);  \
+    c += d; b ^= c; b = __Rotl32(b, 7);
+
+static void __ChaCha20Block(const uint32_t _input[16], uint8_t _output[kChaCha20BlockLen]) {
+    uint32_t x[16];
+    for (int i = 0; i < 16; ++i) x[i] = _input[i];
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA20_QUARTER_ROUND(x[0], x[4], x[8],  x[12])
+        CHACHA20_QUARTER_ROUND(x[1], x[5], x[9],  x[13])
+        CHACHA20_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        CHACHA20_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        CHACHA20_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        CHACHA20_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        CHACHA20_QUARTER_ROUND(x[2], x[7], x[8],  x[13])
+        CHACHA20_QUARTER_ROUND(x[3], x[4], x[9],  x[14])
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        uint32_t v = x[i] + _input[i];
+        _output[i * 4 + 0] = (uint8_t)(v);
+        _output[i * 4 + 1] = (uint8_t)(v >> 8);
+        _output[i * 4 + 2] = (uint8_t)(v >> 16);
+        _output[i * 4 + 3] = (uint8_t)(v >> 24);
+    }
+}
+
+#undef CHACHA20_QUARTER_ROUND
+
+void ChaCha20Xor(const uint8_t _key[kChaCha20KeyLen], const uint8_t _nonce[kChaCha20NonceLen], uint64_t _offset,
+                 const uint8_t* _in, uint8_t* _out, size_t _len) {
+    uint32_t state[16];
+    // "expand 32-byte k"
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) state[4 + i] = __Load32(_key + i * 4);
+    state[12] = (uint32_t)(_offset / kChaCha20BlockLen);
+    for (int i = 0; i < 3; ++i) state[13 + i] = __Load32(_nonce + i * 4);
+
+    uint8_t key_stream[kChaCha20BlockLen];
+    size_t skip = (size_t)(_offset % kChaCha20BlockLen);
+
+    while (_len > 0) {
+        __ChaCha20Block(state, key_stream);
+        ++state[12];
+
+        size_t n = kChaCha20BlockLen - skip;
+        if (n > _len) n = _len;
+
+        for (size_t i = 0; i < n; ++i) {
+            _out[i] = _in[i] ^ key_stream[skip + i];
+        }
+
+        _in += n;
+        _out += n;
+        _len -= n;
+        skip = 0;
+    }
+}
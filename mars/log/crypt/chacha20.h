@@ -0,0 +1,36 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * chacha20.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef LOG_CHACHA20_H_
+#define LOG_CHACHA20_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const size_t kChaCha20KeyLen = 32;
+static const size_t kChaCha20NonceLen = 12;
+
+/*
+ * ChaCha20 (RFC 7539) stream cipher.
+ * _offset is the byte position in the key stream, so a log block can be encrypted piece by piece.
+ * _in and _out may be the same buffer.
+ */
+void ChaCha20Xor(const uint8_t _key[kChaCha20KeyLen], const uint8_t _nonce[kChaCha20NonceLen], uint64_t _offset,
+                 const uint8_t* _in, uint8_t* _out, size_t _len);
+
+#endif /* LOG_CHACHA20_H_ */
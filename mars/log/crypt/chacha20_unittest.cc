@@ -0,0 +1,36 @@
+#include "chacha20.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+using namespace testing;
+
+// RFC 7539 2.4.2, counter 1 is key stream offset 64.
+TEST(chacha20, rfc7539) {
+    uint8_t key[kChaCha20KeyLen];
+    for (size_t i = 0; i < sizeof(key); ++i) key[i] = (uint8_t)i;
+    const uint8_t nonce[kChaCha20NonceLen] = {0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+
+    const char* plain = "Ladies and Gentlemen of the class of '99";
+    const uint8_t expect[] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28,
+        0xdd, 0x0d, 0x69, 0x81, 0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2,
+        0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b, 0xf9, 0x1b, 0x65, 0xc5,
+        0x52, 0x47, 0x33, 0xab};
+    ASSERT_EQ(sizeof(expect), strlen(plain));
+
+    uint8_t out[sizeof(expect)];
+    ChaCha20Xor(key, nonce, 64, (const uint8_t*)plain, out, sizeof(out));
+    EXPECT_EQ(0, memcmp(expect, out, sizeof(out)));
+
+    // piecewise, the way async logs are encrypted line by line.
+    uint8_t piece[sizeof(expect)];
+    ChaCha20Xor(key, nonce, 64, (const uint8_t*)plain, piece, 3);
+    ChaCha20Xor(key, nonce, 64 + 3, (const uint8_t*)plain + 3, piece + 3, sizeof(piece) - 3);
+    EXPECT_EQ(0, memcmp(expect, piece, sizeof(piece)));
+
+    ChaCha20Xor(key, nonce, 64, piece, piece, sizeof(piece));
+    EXPECT_EQ(0, memcmp(plain, piece, sizeof(piece)));
+}
+
+EXPORT_GTEST_SYMBOLS(log_export_chacha20_unittest)
@@ -22,6 +22,8 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include "zlib.h"
 #include "micro-ecc-master/uECC.h"
 
@@ -37,6 +39,10 @@ const int NEW_MAGIC_COMPRESS_CRYPT_START = 0x04;
 const int NEW_MAGIC_COMPRESS_CRYPT_START1 = 0x05;
 const int MAGIC_COMPRESS_START2 = 0x07;
 const int MAGIC_COMPRESS_NO_CRYPT_START = 0x09;
+const int MAGIC_COMPRESS_CHACHA_START = 0x0A;
+const int MAGIC_NO_COMPRESS_TEA_START = 0x0B;
+const int MAGIC_ASYNC_NO_COMPRESS_NO_CRYPT_START = 0x0C;
+const int MAGIC_NO_COMPRESS_CHACHA_START = 0x0D;
 
 
 const int MAGIC_END = 0x00;
@@ -48,6 +54,38 @@ const char* PRIV_KEY = "";
 const char* PUB_KEY = "";
 
 const int TEA_BLOCK_LEN = 8;
+const int CHACHA_NONCE_LEN = 8;
+
+const char BINARY_RECORD_MAGIC = 0x1E;
+const char BINARY_RECORD_SITE = 'D';
+const char BINARY_RECORD_LOG = 'R';
+#define BINARY_MAX_ARGS 64
+
+typedef struct
+{
+    bool defined;
+    uint64_t line;
+    const char* tag;
+    size_t tagLen;
+    const char* file;
+    size_t fileLen;
+    const char* func;
+    size_t funcLen;
+    const char* format;
+    size_t formatLen;
+} BinarySite;
+
+typedef struct
+{
+    char type;
+    uint64_t value;
+    double doubleValue;
+    const char* str;
+    size_t strLen;
+} BinaryArg;
+
+BinarySite* binarySites = NULL;
+size_t binarySiteCount = 0;
 
 
 bool Hex2Buffer(const char* str, size_t len, unsigned char* buffer) 
@@ -95,6 +133,90 @@ void teaDecrypt(uint32_t *v, uint32_t *k)
     v[1] = v1;
 }
 
+#define CHACHA20_ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define CHACHA20_QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = CHACHA20_ROTL32(d, 16); \
+    c += d; b ^= c; b = CHACHA20_ROTL32(b, 12); \
+    a += b; d ^= a; d = CHACHA20_ROTL32(d, 8);  \
+    c += d; b ^= c; b = CHACHA20_ROTL32(b, 7);
+
+uint32_t chacha20Load32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// RFC 7539, the nonce is 4 zero bytes followed by the 8 bytes stored in front of the block data.
+void chacha20Decrypt(const unsigned char key[32], const unsigned char nonce[8], char* buffer, size_t len)
+{
+    uint32_t state[16];
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    int i;
+    for (i = 0; i < 8; i++)
+    {
+        state[4 + i] = chacha20Load32(key + i * 4);
+    }
+    state[12] = 0;
+    state[13] = 0;
+    state[14] = chacha20Load32(nonce);
+    state[15] = chacha20Load32(nonce + 4);
+
+    size_t pos = 0;
+    while (pos < len)
+    {
+        uint32_t x[16];
+        for (i = 0; i < 16; i++)
+        {
+            x[i] = state[i];
+        }
+        for (i = 0; i < 10; i++)
+        {
+            CHACHA20_QUARTER_ROUND(x[0], x[4], x[8],  x[12])
+            CHACHA20_QUARTER_ROUND(x[1], x[5], x[9],  x[13])
+            CHACHA20_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+            CHACHA20_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+            CHACHA20_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+            CHACHA20_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+            CHACHA20_QUARTER_ROUND(x[2], x[7], x[8],  x[13])
+            CHACHA20_QUARTER_ROUND(x[3], x[4], x[9],  x[14])
+        }
+
+        unsigned char keyStream[64];
+        for (i = 0; i < 16; i++)
+        {
+            uint32_t v = x[i] + state[i];
+            keyStream[i * 4 + 0] = (unsigned char)(v);
+            keyStream[i * 4 + 1] = (unsigned char)(v >> 8);
+            keyStream[i * 4 + 2] = (unsigned char)(v >> 16);
+            keyStream[i * 4 + 3] = (unsigned char)(v >> 24);
+        }
+        state[12]++;
+
+        for (i = 0; i < 64 && pos < len; i++, pos++)
+        {
+            buffer[pos] ^= keyStream[i];
+        }
+    }
+}
+
+void getEcdhKey(const unsigned char* clientPubKey, unsigned char ecdhKey[32])
+{
+    unsigned char svrPriKey[32] = {0};
+    if (!Hex2Buffer(PRIV_KEY, 64, svrPriKey))
+    {
+        fputs("Get PRIV KEY error", stderr);
+        exit(7);
+    }
+
+    if (0 == uECC_shared_secret(clientPubKey, svrPriKey, ecdhKey, uECC_secp256k1()))
+    {
+        fputs("Get ECDH key error", stderr);
+        exit(8);
+    }
+}
+
 bool isGoodLogBuffer(const char* buffer, size_t bufferSize, size_t offset, int count)
 {
     if (offset == bufferSize)
@@ -117,7 +239,8 @@ bool isGoodLogBuffer(const char* buffer, size_t bufferSize, size_t offset, int c
     else if (MAGIC_COMPRESS_START2 == buffer[offset] ||
         MAGIC_NO_COMPRESS_START1 == buffer[offset] ||
         MAGIC_NO_COMPRESS_NO_CRYPT_START == buffer[offset] ||
-        MAGIC_COMPRESS_NO_CRYPT_START == buffer[offset])
+        MAGIC_COMPRESS_NO_CRYPT_START == buffer[offset] ||
+        (MAGIC_COMPRESS_CHACHA_START <= buffer[offset] && buffer[offset] <= MAGIC_NO_COMPRESS_CHACHA_START))
     {
         headerLen = 1 + 2 + 1 + 1 + 4 + 64;
         cryptKeyLen = 64;
@@ -168,7 +291,7 @@ size_t getLogStartPos(const char* buffer, size_t bufferSize,  int count)
         if (offset >= bufferSize) {
             break;
         }
-        if (buffer[offset] >=  MAGIC_CRYPT_START && buffer[offset] <= MAGIC_COMPRESS_NO_CRYPT_START)
+        if (buffer[offset] >=  MAGIC_CRYPT_START && buffer[offset] <= MAGIC_NO_COMPRESS_CHACHA_START)
         {
             if (isGoodLogBuffer(buffer, bufferSize, offset, count))
             {
@@ -202,6 +325,313 @@ void appendBuffer(char** outBuffer, size_t *outBufferSize, size_t *writePos, con
     *writePos = (*writePos) + bufferSize;
 }
 
+bool readVarint(const char** pos, const char* end, uint64_t* value)
+{
+    *value = 0;
+    int shift = 0;
+    while (*pos < end && shift < 64)
+    {
+        unsigned char byte = (unsigned char)**pos;
+        (*pos)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+bool readSigned(const char** pos, const char* end, int64_t* value)
+{
+    uint64_t raw;
+    if (!readVarint(pos, end, &raw))
+    {
+        return false;
+    }
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+bool readString(const char** pos, const char* end, const char** str, size_t* len)
+{
+    uint64_t raw;
+    if (!readVarint(pos, end, &raw) || raw > (uint64_t)(end - *pos))
+    {
+        return false;
+    }
+    *str = *pos;
+    *len = (size_t)raw;
+    *pos += raw;
+    return true;
+}
+
+void appendString(char** outBuffer, size_t *outBufferSize, size_t *writePos, const char* str)
+{
+    appendBuffer(outBuffer, outBufferSize, writePos, str, strlen(str));
+}
+
+bool parseBinarySite(const char* pos, const char* end)
+{
+    uint64_t id;
+    BinarySite site;
+    memset(&site, 0, sizeof(site));
+
+    if (!readVarint(&pos, end, &id) || !readVarint(&pos, end, &site.line)
+        || !readString(&pos, end, &site.tag, &site.tagLen) || !readString(&pos, end, &site.file, &site.fileLen)
+        || !readString(&pos, end, &site.func, &site.funcLen) || !readString(&pos, end, &site.format, &site.formatLen)
+        || id > 0xFFFFFF)
+    {
+        return false;
+    }
+
+    if (id >= binarySiteCount)
+    {
+        size_t count = (size_t)id + 1024;
+        BinarySite* sites = (BinarySite*)realloc(binarySites, count * sizeof(BinarySite));
+        if (NULL == sites)
+        {
+            fputs("Error reallocating memory", stderr);
+            exit(5);
+        }
+        memset(sites + binarySiteCount, 0, (count - binarySiteCount) * sizeof(BinarySite));
+        binarySites = sites;
+        binarySiteCount = count;
+    }
+
+    site.defined = true;
+    binarySites[id] = site;
+    return true;
+}
+
+void appendBinaryArg(char** outBuffer, size_t *outBufferSize, size_t *writePos, const BinaryArg* arg)
+{
+    char temp[64] = {0};
+    switch (arg->type)
+    {
+        case 'i':
+            snprintf(temp, sizeof(temp), "%lld", (long long)(int64_t)arg->value);
+            break;
+        case 'u':
+            snprintf(temp, sizeof(temp), "%llu", (unsigned long long)arg->value);
+            break;
+        case 'd':
+            snprintf(temp, sizeof(temp), "%E", arg->doubleValue);
+            break;
+        case 'b':
+            snprintf(temp, sizeof(temp), "%s", arg->value ? "true" : "false");
+            break;
+        case 'c':
+            temp[0] = (char)arg->value;
+            break;
+        case 's':
+            appendBuffer(outBuffer, outBufferSize, writePos, arg->str, arg->strLen);
+            return;
+        default:
+            break;
+    }
+    appendString(outBuffer, outBufferSize, writePos, temp);
+}
+
+// renders a record the same way log_formater and XLogger::DoTypeSafeFormat print the text line.
+bool renderBinaryLog(const char* pos, const char* end, char** outBuffer, size_t *outBufferSize, size_t *writePos)
+{
+    static const char* levelStrings[] = {"V", "D", "I", "W", "E", "F"};
+
+    uint64_t id, msec;
+    int64_t sec, gmtoff, pid, tid;
+    unsigned char level, flags;
+
+    if (!readVarint(&pos, end, &id) || end - pos < 2)
+    {
+        return false;
+    }
+    level = (unsigned char)*pos++;
+    flags = (unsigned char)*pos++;
+    if (!readSigned(&pos, end, &sec) || !readVarint(&pos, end, &msec) || !readSigned(&pos, end, &gmtoff)
+        || !readSigned(&pos, end, &pid) || !readSigned(&pos, end, &tid)
+        || id >= binarySiteCount || !binarySites[id].defined || level > 5)
+    {
+        return false;
+    }
+
+    BinaryArg args[BINARY_MAX_ARGS];
+    size_t argCount = 0;
+    while (pos < end)
+    {
+        BinaryArg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.type = *pos++;
+
+        bool ok = false;
+        if ('i' == arg.type || 'u' == arg.type)
+        {
+            ok = readVarint(&pos, end, &arg.value);
+            if ('i' == arg.type) arg.value = (uint64_t)((int64_t)(arg.value >> 1) ^ -(int64_t)(arg.value & 1));
+        }
+        else if ('d' == arg.type && end - pos >= (long)sizeof(double))
+        {
+            memcpy(&arg.doubleValue, pos, sizeof(double));
+            pos += sizeof(double);
+            ok = true;
+        }
+        else if (('b' == arg.type || 'c' == arg.type) && pos < end)
+        {
+            arg.value = (unsigned char)*pos++;
+            ok = true;
+        }
+        else if ('s' == arg.type)
+        {
+            ok = readString(&pos, end, &arg.str, &arg.strLen);
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+        if (argCount < BINARY_MAX_ARGS)
+        {
+            args[argCount++] = arg;
+        }
+    }
+
+    const BinarySite* site = &binarySites[id];
+    char temp[256] = {0};
+    char timeStr[64] = {0};
+    if (0 != sec)
+    {
+        time_t localSec = (time_t)(sec + gmtoff);
+        struct tm tm;
+        gmtime_r(&localSec, &tm);
+        snprintf(timeStr, sizeof(timeStr), "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
+                 gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)msec);
+    }
+
+    snprintf(temp, sizeof(temp), "[%s][%s][%lld, %lld%s][", levelStrings[level], timeStr, (long long)pid, (long long)tid, (flags & 1) ? "*" : "");
+    appendString(outBuffer, outBufferSize, writePos, temp);
+    appendBuffer(outBuffer, outBufferSize, writePos, site->tag, site->tagLen);
+    appendString(outBuffer, outBufferSize, writePos, "][");
+    appendBuffer(outBuffer, outBufferSize, writePos, site->file, site->fileLen);
+    appendString(outBuffer, outBufferSize, writePos, ", ");
+    appendBuffer(outBuffer, outBufferSize, writePos, site->func, site->funcLen);
+    snprintf(temp, sizeof(temp), ", %d][", (int)site->line);
+    appendString(outBuffer, outBufferSize, writePos, temp);
+
+    size_t bodyStart = *writePos;
+    const char* format = site->format;
+    const char* formatEnd = site->format + site->formatLen;
+    size_t count = 0;
+    while (format < formatEnd)
+    {
+        const char* percent = (const char*)memchr(format, '%', formatEnd - format);
+        if (NULL == percent)
+        {
+            appendBuffer(outBuffer, outBufferSize, writePos, format, formatEnd - format);
+            break;
+        }
+        appendBuffer(outBuffer, outBufferSize, writePos, format, percent - format);
+
+        char nextch = percent + 1 < formatEnd ? *(percent + 1) : '\0';
+        if (('0' <= nextch && nextch <= '9') || '_' == nextch)
+        {
+            size_t argIndex = ('_' == nextch) ? count : (size_t)(nextch - '0');
+            if (argIndex < argCount)
+            {
+                appendBinaryArg(outBuffer, outBufferSize, writePos, &args[argIndex]);
+            }
+            else
+            {
+                snprintf(temp, sizeof(temp), "{!!! void XLogger::DoTypeSafeFormat: _args[%d] == NULL !!!}", (int)argIndex);
+                appendString(outBuffer, outBufferSize, writePos, temp);
+            }
+            count++;
+            format = percent + 2;
+        }
+        else if ('%' == nextch)
+        {
+            appendString(outBuffer, outBufferSize, writePos, "%");
+            format = percent + 2;
+        }
+        else
+        {
+            appendString(outBuffer, outBufferSize, writePos, "{!!! void XLogger::DoTypeSafeFormat: %");
+            if ('\0' == nextch)
+            {
+                break;
+            }
+            appendBuffer(outBuffer, outBufferSize, writePos, &nextch, 1);
+            appendString(outBuffer, outBufferSize, writePos, " not fit mode !!!}");
+            format = percent + 1;
+        }
+    }
+
+    if (*writePos == bodyStart || '\n' != (*outBuffer)[*writePos - 1])
+    {
+        appendString(outBuffer, outBufferSize, writePos, "\n");
+    }
+    return true;
+}
+
+// copies a decoded block, deferred-format records at the start of a line are rendered to text.
+void appendLogBlock(char** outBuffer, size_t *outBufferSize, size_t *writePos, const char* buffer, size_t bufferSize)
+{
+    size_t i;
+    for (i = 0; i < binarySiteCount; i++)
+    {
+        binarySites[i].defined = false;
+    }
+
+    size_t pos = 0;
+    size_t recordEnd = 0;   // a site definition is directly followed by the first record using it
+    while (pos < bufferSize)
+    {
+        const char* mark = (const char*)memchr(buffer + pos, BINARY_RECORD_MAGIC, bufferSize - pos);
+        size_t next = (NULL == mark) ? bufferSize : (size_t)(mark - buffer);
+        appendBuffer(outBuffer, outBufferSize, writePos, buffer + pos, next - pos);
+        pos = next;
+        if (pos >= bufferSize)
+        {
+            break;
+        }
+
+        const char* recordPos = buffer + pos + 2;
+        const char* bufferEnd = buffer + bufferSize;
+        uint64_t recordLen = 0;
+        bool isRecord = (recordEnd == pos || '\n' == buffer[pos - 1]) && pos + 2 < bufferSize
+                        && (BINARY_RECORD_SITE == buffer[pos + 1] || BINARY_RECORD_LOG == buffer[pos + 1])
+                        && readVarint(&recordPos, bufferEnd, &recordLen) && recordLen <= (uint64_t)(bufferEnd - recordPos);
+
+        if (isRecord)
+        {
+            size_t restorePos = *writePos;
+            if (BINARY_RECORD_SITE == buffer[pos + 1])
+            {
+                isRecord = parseBinarySite(recordPos, recordPos + recordLen);
+            }
+            else
+            {
+                isRecord = renderBinaryLog(recordPos, recordPos + recordLen, outBuffer, outBufferSize, writePos);
+                if (!isRecord) *writePos = restorePos;
+            }
+        }
+
+        if (!isRecord)
+        {
+            appendBuffer(outBuffer, outBufferSize, writePos, buffer + pos, 1);
+            pos++;
+            continue;
+        }
+
+        pos = recordPos + recordLen - buffer;
+        if (pos < bufferSize && '\n' == buffer[pos])
+        {
+            pos++;
+        }
+        recordEnd = pos;
+    }
+}
+
 bool zlibDecompress(const char* compressedBytes, size_t compressedBytesSize, char** outBuffer, size_t* outBufferSize) {
     *outBuffer = NULL;
     *outBufferSize = 0;
@@ -308,7 +738,8 @@ int decodeBuffer(const char* buffer, size_t bufferSize, size_t offset, char** ou
     else if (MAGIC_COMPRESS_START2 == buffer[offset] ||
              MAGIC_NO_COMPRESS_START1 == buffer[offset] ||
              MAGIC_NO_COMPRESS_NO_CRYPT_START == buffer[offset] ||
-             MAGIC_COMPRESS_NO_CRYPT_START == buffer[offset])
+             MAGIC_COMPRESS_NO_CRYPT_START == buffer[offset] ||
+             (MAGIC_COMPRESS_CHACHA_START <= buffer[offset] && buffer[offset] <= MAGIC_NO_COMPRESS_CHACHA_START))
     {
         headerLen = 1 + 2 + 1 + 1 + 4 + 64;
         cryptKeyLen = 64;
@@ -416,29 +847,49 @@ int decodeBuffer(const char* buffer, size_t bufferSize, size_t offset, char** ou
         tmpBufferSize = decompBufferSize;
     }
     else if (MAGIC_NO_COMPRESS_START1 == buffer[offset] ||
-             MAGIC_NO_COMPRESS_NO_CRYPT_START == buffer[offset])
+             MAGIC_NO_COMPRESS_NO_CRYPT_START == buffer[offset] ||
+             MAGIC_ASYNC_NO_COMPRESS_NO_CRYPT_START == buffer[offset])
     {
         memcpy(tmpBuffer, buffer + offset + headerLen, length);
     }
-    else if (MAGIC_COMPRESS_START2 == buffer[offset])
+    else if (MAGIC_COMPRESS_CHACHA_START == buffer[offset] ||
+             MAGIC_NO_COMPRESS_CHACHA_START == buffer[offset])
     {
-        memcpy(tmpBuffer, buffer + offset + headerLen, length);
-        unsigned char clientPubKey[cryptKeyLen];
-        memcpy(clientPubKey, buffer+offset+headerLen-cryptKeyLen, cryptKeyLen);
-
-        unsigned char svrPriKey[32] = {0};
-        if (!Hex2Buffer(PRIV_KEY, 64, svrPriKey))
+        if (length < CHACHA_NONCE_LEN)
         {
-            fputs("Get PRIV KEY error", stderr);
-            exit(7);
+            free(tmpBuffer);
+            return offset + headerLen + length + 1;
         }
 
         unsigned char ecdhKey[32] = {0};
-        if (0 == uECC_shared_secret(clientPubKey, svrPriKey, ecdhKey, uECC_secp256k1()))
+        getEcdhKey((const unsigned char*)buffer + offset + headerLen - cryptKeyLen, ecdhKey);
+
+        tmpBufferSize = length - CHACHA_NONCE_LEN;
+        memcpy(tmpBuffer, buffer + offset + headerLen + CHACHA_NONCE_LEN, tmpBufferSize);
+        chacha20Decrypt(ecdhKey, (const unsigned char*)buffer + offset + headerLen, tmpBuffer, tmpBufferSize);
+
+        if (MAGIC_COMPRESS_CHACHA_START == buffer[offset])
         {
-            fputs("Get ECDH key error", stderr);
-            exit(8);
+            char *decompBuffer;
+            size_t decompBufferSize;
+            if (!zlibDecompress(tmpBuffer, tmpBufferSize, &decompBuffer, &decompBufferSize))
+            {
+                fputs("Decompress error", stderr);
+                exit(6);
+            }
+
+            free(tmpBuffer);
+            tmpBuffer = decompBuffer;
+            tmpBufferSize = decompBufferSize;
         }
+    }
+    else if (MAGIC_COMPRESS_START2 == buffer[offset] ||
+             MAGIC_NO_COMPRESS_TEA_START == buffer[offset])
+    {
+        memcpy(tmpBuffer, buffer + offset + headerLen, length);
+
+        unsigned char ecdhKey[32] = {0};
+        getEcdhKey((const unsigned char*)buffer + offset + headerLen - cryptKeyLen, ecdhKey);
 
         uint32_t teaKey[4];
         memcpy(teaKey, ecdhKey, sizeof(teaKey));
@@ -453,17 +904,20 @@ int decodeBuffer(const char* buffer, size_t bufferSize, size_t offset, char** ou
             memcpy(tmpBuffer + i * TEA_BLOCK_LEN, tmp, TEA_BLOCK_LEN);
         }
 
-        char *decompBuffer;
-        size_t decompBufferSize;
-        if (!zlibDecompress(tmpBuffer, tmpBufferSize, &decompBuffer, &decompBufferSize))
+        if (MAGIC_COMPRESS_START2 == buffer[offset])
         {
-            fputs("Decompress error", stderr);
-            exit(6);
-        }
+            char *decompBuffer;
+            size_t decompBufferSize;
+            if (!zlibDecompress(tmpBuffer, tmpBufferSize, &decompBuffer, &decompBufferSize))
+            {
+                fputs("Decompress error", stderr);
+                exit(6);
+            }
 
-        free(tmpBuffer);
-        tmpBuffer = decompBuffer;
-        tmpBufferSize = decompBufferSize;
+            free(tmpBuffer);
+            tmpBuffer = decompBuffer;
+            tmpBufferSize = decompBufferSize;
+        }
     }
     else if (MAGIC_COMPRESS_NO_CRYPT_START == buffer[offset])
     {
@@ -489,7 +943,7 @@ int decodeBuffer(const char* buffer, size_t bufferSize, size_t offset, char** ou
         }
     }
 
-    appendBuffer(outBuffer, outBufferSize, writePos, tmpBuffer, tmpBufferSize);
+    appendLogBlock(outBuffer, outBufferSize, writePos, tmpBuffer, tmpBufferSize);
     free(tmpBuffer);
 
     return offset + headerLen + length + 1;
@@ -0,0 +1,672 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_decoder.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "log_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "zlib.h"
+#include "micro-ecc-master/uECC.h"
+#include "chacha20.h"
+
+static const char kMagicCryptStart = 0x01;
+static const char kMagicCompressCryptStart = 0x02;
+static const char kNewMagicCryptStart = 0x03;
+static const char kNewMagicCompressCryptStart = 0x04;
+static const char kNewMagicCompressCryptStart1 = 0x05;
+static const char kMagicNoCompressStart1 = 0x06;
+static const char kMagicCompressStart2 = 0x07;
+static const char kMagicNoCompressNoCryptStart = 0x08;
+static const char kMagicCompressNoCryptStart = 0x09;
+static const char kMagicCompressChaChaStart = 0x0A;
+static const char kMagicNoCompressTeaStart = 0x0B;
+static const char kMagicAsyncNoCompressNoCryptStart = 0x0C;
+static const char kMagicNoCompressChaChaStart = 0x0D;
+
+static const char kMagicEnd = 0x00;
+static const int kBaseKey = 0xCC;
+static const size_t kTeaBlockLen = 8;
+static const size_t kChaChaNonceLen = 8;
+
+static const char kBinaryRecordMagic = 0x1E;
+static const char kBinaryRecordSite = 'D';
+static const char kBinaryRecordLog = 'R';
+static const size_t kBinaryMaxArgs = 64;
+
+static const size_t kBlocksAheadPerThread = 4;
+
+/*
+ * |magic start(char)|seq(uint16_t)|begin hour(char)|end hour(char)|length(uint32_t)|crypt key(char*64)|
+ * the oldest formats have shorter headers.
+ */
+static bool __GetHeaderLen(char _magic, size_t& _header_len, size_t& _crypt_key_len) {
+    _crypt_key_len = 0;
+    if (kMagicCryptStart == _magic || kMagicCompressCryptStart == _magic) {
+        _header_len = 1 + 4;
+    } else if (kNewMagicCryptStart == _magic || kNewMagicCompressCryptStart == _magic || kNewMagicCompressCryptStart1 == _magic) {
+        _header_len = 1 + 2 + 1 + 1 + 4;
+    } else if (kMagicNoCompressStart1 <= _magic && _magic <= kMagicNoCompressChaChaStart) {
+        _header_len = 1 + 2 + 1 + 1 + 4 + 64;
+        _crypt_key_len = 64;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static uint32_t __GetLength(const char* _buffer, size_t _offset, size_t _header_len, size_t _crypt_key_len) {
+    uint32_t length = 0;
+    memcpy(&length, _buffer + _offset + _header_len - _crypt_key_len - sizeof(length), sizeof(length));
+    return length;
+}
+
+static bool __IsGoodBlock(const char* _buffer, size_t _len, size_t _offset, int _count) {
+    for (; _count > 0; --_count) {
+        if (_offset == _len) return true;
+
+        size_t header_len = 0;
+        size_t crypt_key_len = 0;
+        if (!__GetHeaderLen(_buffer[_offset], header_len, crypt_key_len)) return false;
+        if (_offset + header_len + 1 + 1 > _len) return false;
+
+        uint32_t length = __GetLength(_buffer, _offset, header_len, crypt_key_len);
+        if (_offset + header_len + length + 1 > _len) return false;
+        if (kMagicEnd != _buffer[_offset + header_len + length]) return false;
+
+        _offset += header_len + length + 1;
+    }
+    return true;
+}
+
+static bool __GetLogStartPos(const char* _buffer, size_t _len, int _count, size_t& _pos) {
+    for (size_t offset = 0; offset < _len; ++offset) {
+        if (kMagicCryptStart <= _buffer[offset] && _buffer[offset] <= kMagicNoCompressChaChaStart
+            && __IsGoodBlock(_buffer, _len, offset, _count)) {
+            _pos = offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool __Hex2Buffer(const char* _str, size_t _len, unsigned char* _buffer) {
+    if (NULL == _str || 0 == _len || 0 != _len % 2) return false;
+
+    char tmp[3] = {0};
+    for (size_t i = 0; i < _len - 1; i += 2) {
+        for (size_t j = 0; j < 2; ++j) {
+            tmp[j] = _str[i + j];
+            if (!(('0' <= tmp[j] && tmp[j] <= '9') || ('a' <= tmp[j] && tmp[j] <= 'f') || ('A' <= tmp[j] && tmp[j] <= 'F'))) {
+                return false;
+            }
+        }
+        _buffer[i / 2] = (unsigned char)strtol(tmp, NULL, 16);
+    }
+    return true;
+}
+
+static void __TeaDecrypt(uint32_t* _v, const uint32_t* _k) {
+    uint32_t v0 = _v[0], v1 = _v[1], i;
+    static const uint32_t delta = 0x9e3779b9;
+    uint32_t sum = delta << 4;
+    uint32_t k0 = _k[0], k1 = _k[1], k2 = _k[2], k3 = _k[3];
+    for (i = 0; i < 16; i++) {
+        v1 -= ((v0 << 4) + k2) ^ (v0 + sum) ^ ((v0 >> 5) + k3);
+        v0 -= ((v1 << 4) + k0) ^ (v1 + sum) ^ ((v1 >> 5) + k1);
+        sum -= delta;
+    }
+    _v[0] = v0;
+    _v[1] = v1;
+}
+
+// the stream is never finished by the writer, so whatever inflates before the input runs out is the block.
+static void __Inflate(const char* _data, size_t _len, std::string& _out) {
+    _out.clear();
+    if (0 == _len) return;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (Z_OK != inflateInit2(&strm, -MAX_WBITS)) return;
+
+    _out.resize(_len * 4);
+    strm.next_in = (Bytef*)_data;
+    strm.avail_in = (uInt)_len;
+
+    while (true) {
+        if (strm.total_out >= _out.size()) _out.resize(_out.size() * 2);
+
+        strm.next_out = (Bytef*)&_out[strm.total_out];
+        strm.avail_out = (uInt)(_out.size() - strm.total_out);
+
+        int err = inflate(&strm, Z_SYNC_FLUSH);
+        if (Z_OK != err) break;
+    }
+
+    _out.resize(strm.total_out);
+    inflateEnd(&strm);
+}
+
+/*
+ * Deferred-format records written by appender_set_binary_log, see __write_binary_log in appender.cc.
+ */
+namespace {
+
+struct BinarySite {
+    bool defined;
+    uint64_t line;
+    const char* tag;
+    size_t tag_len;
+    const char* file;
+    size_t file_len;
+    const char* func;
+    size_t func_len;
+    const char* format;
+    size_t format_len;
+};
+
+struct BinaryArg {
+    char type;
+    uint64_t value;
+    double double_value;
+    const char* str;
+    size_t str_len;
+};
+
+class BinaryLogRenderer {
+  public:
+    explicit BinaryLogRenderer(std::string& _out) : out_(_out) {}
+
+    void Render(const char* _buffer, size_t _len);
+
+  private:
+    bool __ParseSite(const char* _pos, const char* _end);
+    bool __RenderLog(const char* _pos, const char* _end);
+    void __AppendArg(const BinaryArg& _arg);
+
+  private:
+    std::string& out_;
+    std::vector<BinarySite> sites_;
+};
+
+bool __ReadVarint(const char*& _pos, const char* _end, uint64_t& _value) {
+    _value = 0;
+    for (int shift = 0; _pos < _end && shift < 64; shift += 7) {
+        unsigned char byte = (unsigned char)*_pos++;
+        _value |= (uint64_t)(byte & 0x7F) << shift;
+        if (0 == (byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool __ReadSigned(const char*& _pos, const char* _end, int64_t& _value) {
+    uint64_t raw = 0;
+    if (!__ReadVarint(_pos, _end, raw)) return false;
+    _value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+bool __ReadString(const char*& _pos, const char* _end, const char*& _str, size_t& _len) {
+    uint64_t raw = 0;
+    if (!__ReadVarint(_pos, _end, raw) || raw > (uint64_t)(_end - _pos)) return false;
+    _str = _pos;
+    _len = (size_t)raw;
+    _pos += raw;
+    return true;
+}
+
+void BinaryLogRenderer::Render(const char* _buffer, size_t _len) {
+    size_t pos = 0;
+    size_t record_end = 0;  // a site definition is directly followed by the first record using it
+    while (pos < _len) {
+        const char* mark = (const char*)memchr(_buffer + pos, kBinaryRecordMagic, _len - pos);
+        size_t next = NULL == mark ? _len : (size_t)(mark - _buffer);
+        out_.append(_buffer + pos, next - pos);
+        pos = next;
+        if (pos >= _len) break;
+
+        const char* record_pos = _buffer + pos + 2;
+        const char* end = _buffer + _len;
+        uint64_t record_len = 0;
+        bool is_record = (record_end == pos || '\n' == _buffer[pos - 1]) && pos + 2 < _len
+                         && (kBinaryRecordSite == _buffer[pos + 1] || kBinaryRecordLog == _buffer[pos + 1])
+                         && __ReadVarint(record_pos, end, record_len) && record_len <= (uint64_t)(end - record_pos);
+
+        if (is_record) {
+            size_t restore_len = out_.size();
+            if (kBinaryRecordSite == _buffer[pos + 1]) {
+                is_record = __ParseSite(record_pos, record_pos + record_len);
+            } else {
+                is_record = __RenderLog(record_pos, record_pos + record_len);
+                if (!is_record) out_.resize(restore_len);
+            }
+        }
+
+        if (!is_record) {
+            out_.push_back(_buffer[pos]);
+            ++pos;
+            continue;
+        }
+
+        pos = record_pos + record_len - _buffer;
+        if (pos < _len && '\n' == _buffer[pos]) ++pos;
+        record_end = pos;
+    }
+}
+
+bool BinaryLogRenderer::__ParseSite(const char* _pos, const char* _end) {
+    uint64_t id = 0;
+    BinarySite site;
+    memset(&site, 0, sizeof(site));
+
+    if (!__ReadVarint(_pos, _end, id) || !__ReadVarint(_pos, _end, site.line)
+        || !__ReadString(_pos, _end, site.tag, site.tag_len) || !__ReadString(_pos, _end, site.file, site.file_len)
+        || !__ReadString(_pos, _end, site.func, site.func_len) || !__ReadString(_pos, _end, site.format, site.format_len)
+        || id > 0xFFFFFF) {
+        return false;
+    }
+
+    if (id >= sites_.size()) {
+        BinarySite undefined;
+        memset(&undefined, 0, sizeof(undefined));
+        sites_.resize((size_t)id + 1, undefined);
+    }
+
+    site.defined = true;
+    sites_[id] = site;
+    return true;
+}
+
+void BinaryLogRenderer::__AppendArg(const BinaryArg& _arg) {
+    char temp[64] = {0};
+    switch (_arg.type) {
+        case 'i': snprintf(temp, sizeof(temp), "%lld", (long long)(int64_t)_arg.value); break;
+        case 'u': snprintf(temp, sizeof(temp), "%llu", (unsigned long long)_arg.value); break;
+        case 'd': snprintf(temp, sizeof(temp), "%E", _arg.double_value); break;
+        case 'b': snprintf(temp, sizeof(temp), "%s", _arg.value ? "true" : "false"); break;
+        case 'c': temp[0] = (char)_arg.value; break;
+        case 's': out_.append(_arg.str, _arg.str_len); return;
+        default: break;
+    }
+    out_.append(temp);
+}
+
+// the same text log_formater and XLogger::DoTypeSafeFormat print.
+bool BinaryLogRenderer::__RenderLog(const char* _pos, const char* _end) {
+    static const char* const kLevelStrings[] = {"V", "D", "I", "W", "E", "F"};
+
+    uint64_t id = 0, msec = 0;
+    int64_t sec = 0, gmtoff = 0, pid = 0, tid = 0;
+    if (!__ReadVarint(_pos, _end, id) || _end - _pos < 2) return false;
+
+    unsigned char level = (unsigned char)*_pos++;
+    unsigned char flags = (unsigned char)*_pos++;
+    if (!__ReadSigned(_pos, _end, sec) || !__ReadVarint(_pos, _end, msec) || !__ReadSigned(_pos, _end, gmtoff)
+        || !__ReadSigned(_pos, _end, pid) || !__ReadSigned(_pos, _end, tid)
+        || id >= sites_.size() || !sites_[id].defined || level > 5) {
+        return false;
+    }
+
+    BinaryArg args[kBinaryMaxArgs];
+    size_t arg_count = 0;
+    while (_pos < _end) {
+        BinaryArg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.type = *_pos++;
+
+        bool ok = false;
+        if ('i' == arg.type || 'u' == arg.type) {
+            ok = __ReadVarint(_pos, _end, arg.value);
+            if ('i' == arg.type) arg.value = (uint64_t)((int64_t)(arg.value >> 1) ^ -(int64_t)(arg.value & 1));
+        } else if ('d' == arg.type && _end - _pos >= (long)sizeof(double)) {
+            memcpy(&arg.double_value, _pos, sizeof(double));
+            _pos += sizeof(double);
+            ok = true;
+        } else if (('b' == arg.type || 'c' == arg.type) && _pos < _end) {
+            arg.value = (unsigned char)*_pos++;
+            ok = true;
+        } else if ('s' == arg.type) {
+            ok = __ReadString(_pos, _end, arg.str, arg.str_len);
+        }
+
+        if (!ok) return false;
+        if (arg_count < kBinaryMaxArgs) args[arg_count++] = arg;
+    }
+
+    const BinarySite& site = sites_[id];
+    char temp[256] = {0};
+    char time_str[64] = {0};
+    if (0 != sec) {
+        time_t local_sec = (time_t)(sec + gmtoff);
+        struct tm tm;
+        gmtime_r(&local_sec, &tm);
+        snprintf(time_str, sizeof(time_str), "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
+                 gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)msec);
+    }
+
+    snprintf(temp, sizeof(temp), "[%s][%s][%lld, %lld%s][", kLevelStrings[level], time_str, (long long)pid, (long long)tid, (flags & 1) ? "*" : "");
+    out_.append(temp);
+    out_.append(site.tag, site.tag_len);
+    out_.append("][");
+    out_.append(site.file, site.file_len);
+    out_.append(", ");
+    out_.append(site.func, site.func_len);
+    snprintf(temp, sizeof(temp), ", %d][", (int)site.line);
+    out_.append(temp);
+
+    size_t body_start = out_.size();
+    const char* format = site.format;
+    const char* format_end = site.format + site.format_len;
+    size_t count = 0;
+    while (format < format_end) {
+        const char* percent = (const char*)memchr(format, '%', format_end - format);
+        if (NULL == percent) {
+            out_.append(format, format_end - format);
+            break;
+        }
+        out_.append(format, percent - format);
+
+        char nextch = percent + 1 < format_end ? *(percent + 1) : '\0';
+        if (('0' <= nextch && nextch <= '9') || '_' == nextch) {
+            size_t arg_index = ('_' == nextch) ? count : (size_t)(nextch - '0');
+            if (arg_index < arg_count) {
+                __AppendArg(args[arg_index]);
+            } else {
+                snprintf(temp, sizeof(temp), "{!!! void XLogger::DoTypeSafeFormat: _args[%d] == NULL !!!}", (int)arg_index);
+                out_.append(temp);
+            }
+            ++count;
+            format = percent + 2;
+        } else if ('%' == nextch) {
+            out_.push_back('%');
+            format = percent + 2;
+        } else {
+            out_.append("{!!! void XLogger::DoTypeSafeFormat: %");
+            if ('\0' == nextch) break;
+            out_.push_back(nextch);
+            out_.append(" not fit mode !!!}");
+            format = percent + 1;
+        }
+    }
+
+    if (out_.size() == body_start || '\n' != out_[out_.size() - 1]) out_.push_back('\n');
+    return true;
+}
+
+}  // namespace
+
+LogDecoder::LogDecoder(const std::string& _priv_key, int _thread_count)
+: priv_key_(_priv_key), thread_count_(_thread_count < 1 ? 1 : _thread_count) {}
+
+bool LogDecoder::__GetEcdhKey(const char* _client_pubkey, unsigned char _ecdh_key[32]) {
+    std::string pubkey(_client_pubkey, 64);
+    {
+        std::lock_guard<std::mutex> lock(ecdh_mutex_);
+        std::map<std::string, std::string>::const_iterator iter = ecdh_keys_.find(pubkey);
+        if (ecdh_keys_.end() != iter) {
+            memcpy(_ecdh_key, iter->second.data(), 32);
+            return true;
+        }
+    }
+
+    // the shared secret costs far more than decoding a block, every key pair is only used once.
+    unsigned char svr_pri_key[32] = {0};
+    if (!__Hex2Buffer(priv_key_.c_str(), priv_key_.size(), svr_pri_key) || 64 != priv_key_.size()) return false;
+    if (0 == uECC_shared_secret((const uint8_t*)_client_pubkey, svr_pri_key, _ecdh_key, uECC_secp256k1())) return false;
+
+    std::lock_guard<std::mutex> lock(ecdh_mutex_);
+    ecdh_keys_[pubkey] = std::string((const char*)_ecdh_key, 32);
+    return true;
+}
+
+size_t LogDecoder::__FindBlocks(const char* _buffer, size_t _len, std::vector<Block>& _blocks) {
+    size_t offset = 0;
+    if (!__GetLogStartPos(_buffer, _len, 2, offset)) return _len;
+
+    size_t skipped = offset;
+    int last_seq = 0;
+    std::string prefix;
+    char text[128];
+
+    while (offset < _len) {
+        if (!__IsGoodBlock(_buffer, _len, offset, 1)) {
+            size_t fix_pos = 0;
+            if (!__GetLogStartPos(_buffer + offset, _len - offset, 1, fix_pos)) {
+                skipped += _len - offset;
+                break;
+            }
+
+            snprintf(text, sizeof(text), "[F]decode_log_file.py decode error len=%d\n", (int)fix_pos);
+            prefix += text;
+            offset += fix_pos;
+            skipped += fix_pos;
+        }
+
+        Block block;
+        __GetHeaderLen(_buffer[offset], block.header_len, block.crypt_key_len);
+        block.offset = offset;
+        block.length = __GetLength(_buffer, offset, block.header_len, block.crypt_key_len);
+
+        if (kMagicCryptStart != _buffer[offset] && kMagicCompressCryptStart != _buffer[offset]) {
+            uint16_t seq = 0;
+            memcpy(&seq, _buffer + offset + 1, sizeof(seq));
+
+            if (0 != seq && 1 != seq && 0 != last_seq && seq != (last_seq + 1)) {
+                snprintf(text, sizeof(text), "[F]decode_log_file.py log seq:%d-%d is missing\n", last_seq + 1, seq - 1);
+                prefix += text;
+            }
+            if (0 != seq) last_seq = seq;
+        }
+
+        block.prefix.swap(prefix);
+        _blocks.push_back(block);
+        offset += block.header_len + block.length + 1;
+    }
+
+    return skipped;
+}
+
+void LogDecoder::__DecodeBlock(const char* _buffer, const Block& _block, std::string& _out) {
+    const char magic = _buffer[_block.offset];
+    const char* data = _buffer + _block.offset + _block.header_len;
+    const char* client_pubkey = data - _block.crypt_key_len;
+    uint32_t length = _block.length;
+
+    int key = 0;
+    if (kMagicCompressCryptStart == magic || kMagicCryptStart == magic) {
+        key = kBaseKey ^ (0xff & length) ^ magic;
+    } else {
+        uint16_t seq = 0;
+        memcpy(&seq, _buffer + _block.offset + 1, sizeof(seq));
+        key = kBaseKey ^ (0xff & seq) ^ magic;
+    }
+
+    std::string raw;
+    std::string plain;
+    bool compressed = false;
+
+    if (kMagicCompressCryptStart == magic || kNewMagicCompressCryptStart == magic
+        || kMagicCryptStart == magic || kNewMagicCryptStart == magic) {
+        raw.resize(length);
+        for (size_t i = 0; i < length; ++i) raw[i] = (char)(key ^ data[i]);
+        compressed = kMagicCompressCryptStart == magic || kNewMagicCompressCryptStart == magic;
+    } else if (kNewMagicCompressCryptStart1 == magic) {
+        size_t read_pos = 0;
+        while (read_pos + sizeof(uint16_t) <= length) {
+            uint16_t single_log_len = 0;
+            memcpy(&single_log_len, data + read_pos, sizeof(single_log_len));
+            raw.append(data + read_pos + sizeof(single_log_len), single_log_len);
+            read_pos += single_log_len + sizeof(single_log_len);
+        }
+        for (size_t i = 0; i < raw.size(); ++i) raw[i] = (char)(key ^ raw[i]);
+        compressed = true;
+    } else if (kMagicNoCompressStart1 == magic || kMagicNoCompressNoCryptStart == magic
+               || kMagicAsyncNoCompressNoCryptStart == magic) {
+        raw.assign(data, length);
+    } else if (kMagicCompressNoCryptStart == magic) {
+        raw.assign(data, length);
+        compressed = true;
+    } else {
+        unsigned char ecdh_key[32] = {0};
+        if (!__GetEcdhKey(client_pubkey, ecdh_key)) {
+            _out += "[F]decode_log_file get ecdh key error, check the private key\n";
+            return;
+        }
+
+        if (kMagicCompressChaChaStart == magic || kMagicNoCompressChaChaStart == magic) {
+            if (length < kChaChaNonceLen) return;
+
+            uint8_t nonce[kChaCha20NonceLen] = {0};
+            memcpy(nonce + kChaCha20NonceLen - kChaChaNonceLen, data, kChaChaNonceLen);
+            raw.resize(length - kChaChaNonceLen);
+            ChaCha20Xor(ecdh_key, nonce, 0, (const uint8_t*)data + kChaChaNonceLen, (uint8_t*)&raw[0], raw.size());
+            compressed = kMagicCompressChaChaStart == magic;
+        } else {
+            // tea, the tail shorter than a tea block is left plain by the writer.
+            raw.assign(data, length);
+            uint32_t tea_key[4];
+            memcpy(tea_key, ecdh_key, sizeof(tea_key));
+            for (size_t i = 0; i + kTeaBlockLen <= length; i += kTeaBlockLen) {
+                uint32_t tmp[2];
+                memcpy(tmp, &raw[i], kTeaBlockLen);
+                __TeaDecrypt(tmp, tea_key);
+                memcpy(&raw[i], tmp, kTeaBlockLen);
+            }
+            compressed = kMagicCompressStart2 == magic;
+        }
+    }
+
+    if (compressed) {
+        __Inflate(raw.data(), raw.size(), plain);
+    } else {
+        plain.swap(raw);
+    }
+
+    BinaryLogRenderer(_out).Render(plain.data(), plain.size());
+}
+
+bool LogDecoder::Decode(const char* _buffer, size_t _len, const OutputFunc& _output, LogDecodeStat& _stat) {
+    memset(&_stat, 0, sizeof(_stat));
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    std::vector<Block> blocks;
+    _stat.skipped_bytes = __FindBlocks(_buffer, _len, blocks);
+    _stat.blocks = blocks.size();
+    _stat.input_bytes = _len;
+
+    // block i is decoded into slot i % window, a worker never runs more than window blocks ahead of the output.
+    const size_t window = thread_count_ * kBlocksAheadPerThread;
+    std::vector<std::string> results(window);
+    std::vector<char> done(window, 0);
+    size_t next = 0;
+    size_t emitted = 0;
+    std::mutex mutex;
+    std::condition_variable cond_done;
+    std::condition_variable cond_space;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count_; ++i) {
+        threads.push_back(std::thread([&]() {
+            std::string out;
+            while (true) {
+                size_t index = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond_space.wait(lock, [&]() { return next >= blocks.size() || next < emitted + window; });
+                    if (next >= blocks.size()) return;
+                    index = next++;
+                }
+
+                out = blocks[index].prefix;
+                __DecodeBlock(_buffer, blocks[index], out);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[index % window].swap(out);
+                    done[index % window] = 1;
+                }
+                cond_done.notify_all();
+            }
+        }));
+    }
+
+    std::string out;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond_done.wait(lock, [&]() { return 0 != done[i % window]; });
+            out.swap(results[i % window]);
+            done[i % window] = 0;
+            ++emitted;
+        }
+        cond_space.notify_all();
+
+        _output(out.data(), out.size());
+        _stat.output_bytes += out.size();
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    _stat.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return !blocks.empty();
+}
+
+bool LogDecoder::DecodeFile(const char* _path, const char* _out_path, LogDecodeStat& _stat) {
+    memset(&_stat, 0, sizeof(_stat));
+
+    int fd = open(_path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (0 != fstat(fd, &st) || 0 == st.st_size) {
+        close(fd);
+        return false;
+    }
+
+    void* buffer = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == buffer) return false;
+    madvise(buffer, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    FILE* out_file = fopen(_out_path, "wb");
+    if (NULL == out_file) {
+        munmap(buffer, (size_t)st.st_size);
+        return false;
+    }
+
+    bool write_ok = true;
+    bool ret = Decode((const char*)buffer, (size_t)st.st_size, [&](const char* _data, size_t _len) {
+        if (0 < _len && 1 != fwrite(_data, _len, 1, out_file)) write_ok = false;
+    }, _stat);
+
+    fclose(out_file);
+    munmap(buffer, (size_t)st.st_size);
+    return ret && write_ok;
+}
@@ -0,0 +1,81 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_decoder.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef LOG_DECODER_H_
+#define LOG_DECODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <functional>
+
+struct LogDecodeStat {
+    uint64_t blocks;
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+    uint64_t skipped_bytes;     // corrupted ranges between blocks
+    double seconds;
+};
+
+/*
+ * Decodes xlog files the same way decode_log_file_c_impl does, with the blocks decrypted and inflated on a thread pool.
+ *
+ * Block boundaries are found sequentially from the kMagic*Start headers, which is cheap,
+ * so the output is streamed in file order while up to a few blocks per thread are decoded ahead.
+ * A range that doesn't start with a valid block is skipped to the next one, leaving a "[F]... decode error" line.
+ */
+class LogDecoder {
+  public:
+    typedef std::function<void (const char* _data, size_t _len)> OutputFunc;
+
+    // _priv_key is the hex private key matching the public key given to appender_open, empty for files without crypt.
+    LogDecoder(const std::string& _priv_key, int _thread_count);
+
+  public:
+    bool Decode(const char* _buffer, size_t _len, const OutputFunc& _output, LogDecodeStat& _stat);
+    bool DecodeFile(const char* _path, const char* _out_path, LogDecodeStat& _stat);
+
+  private:
+    struct Block {
+        size_t offset;
+        size_t header_len;
+        size_t crypt_key_len;
+        uint32_t length;
+        std::string prefix;     // fix and missing seq tips written before the block
+    };
+
+    size_t __FindBlocks(const char* _buffer, size_t _len, std::vector<Block>& _blocks);
+    void __DecodeBlock(const char* _buffer, const Block& _block, std::string& _out);
+    bool __GetEcdhKey(const char* _client_pubkey, unsigned char _ecdh_key[32]);
+
+  private:
+    LogDecoder(const LogDecoder&);
+    LogDecoder& operator=(const LogDecoder&);
+
+  private:
+    std::string priv_key_;
+    int thread_count_;
+
+    std::mutex ecdh_mutex_;
+    std::map<std::string, std::string> ecdh_keys_;     // client public key -> ecdh key, one per LogCrypt instance
+};
+
+#endif /* LOG_DECODER_H_ */
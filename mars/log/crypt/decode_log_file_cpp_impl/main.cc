@@ -0,0 +1,122 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * main.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <thread>
+
+#include "log_decoder.h"
+
+static const char* PRIV_KEY = "";
+
+static uint64_t sg_total_input = 0;
+static uint64_t sg_total_output = 0;
+static double sg_total_seconds = 0;
+
+static void __Usage(const char* _name) {
+    fprintf(stderr, "usage: %s [-j threads] [-k private_key] [xlog_file [out_file] | xlog_dir]\n", _name);
+}
+
+static bool __ParseFile(LogDecoder& _decoder, const std::string& _path, const std::string& _out_path) {
+    LogDecodeStat stat;
+    if (!_decoder.DecodeFile(_path.c_str(), _out_path.c_str(), stat)) {
+        fprintf(stderr, "decode %s failed\n", _path.c_str());
+        return false;
+    }
+
+    sg_total_input += stat.input_bytes;
+    sg_total_output += stat.output_bytes;
+    sg_total_seconds += stat.seconds;
+
+    fprintf(stderr, "%s: %llu blocks, %.1fMB -> %.1fMB, skipped %llu bytes, %.3fs, %.1fMB/s\n", _path.c_str(),
+            (unsigned long long)stat.blocks, stat.input_bytes / 1048576.0, stat.output_bytes / 1048576.0,
+            (unsigned long long)stat.skipped_bytes, stat.seconds, stat.seconds > 0 ? stat.input_bytes / 1048576.0 / stat.seconds : 0);
+    return true;
+}
+
+static bool __ParseDir(LogDecoder& _decoder, const std::string& _path) {
+    DIR* dir = opendir(_path.c_str());
+    if (NULL == dir) {
+        fputs("opendir failed\n", stderr);
+        return false;
+    }
+
+    bool ret = true;
+    struct dirent* ent = NULL;
+    while (NULL != (ent = readdir(dir))) {
+        size_t len = strlen(ent->d_name);
+        if (len > 5 && 0 == strcmp(ent->d_name + len - 5, ".xlog")) {
+            std::string in_path = _path + "/" + ent->d_name;
+            ret = __ParseFile(_decoder, in_path, in_path + ".log") && ret;
+        }
+    }
+
+    closedir(dir);
+    return ret;
+}
+
+int main(int argc, char* argv[]) {
+    int thread_count = (int)std::thread::hardware_concurrency();
+    std::string priv_key = PRIV_KEY;
+
+    int opt = 0;
+    while (-1 != (opt = getopt(argc, argv, "j:k:h"))) {
+        switch (opt) {
+            case 'j': thread_count = atoi(optarg); break;
+            case 'k': priv_key = optarg; break;
+            default: __Usage(argv[0]); return 1;
+        }
+    }
+
+    LogDecoder decoder(priv_key, thread_count < 1 ? 1 : thread_count);
+
+    bool ret = true;
+    int args = argc - optind;
+    if (2 == args) {
+        ret = __ParseFile(decoder, argv[optind], argv[optind + 1]);
+    } else if (1 == args) {
+        struct stat path_stat;
+        if (0 != stat(argv[optind], &path_stat)) {
+            fputs("openfile failed\n", stderr);
+            return 1;
+        }
+
+        if (S_ISDIR(path_stat.st_mode)) {
+            ret = __ParseDir(decoder, argv[optind]);
+        } else {
+            ret = __ParseFile(decoder, argv[optind], std::string(argv[optind]) + ".log");
+        }
+    } else if (0 == args) {
+        ret = __ParseDir(decoder, ".");
+    } else {
+        __Usage(argv[0]);
+        return 1;
+    }
+
+    if (sg_total_seconds > 0) {
+        fprintf(stderr, "total: %.1fMB -> %.1fMB in %.3fs with %d threads, %.1fMB/s\n", sg_total_input / 1048576.0,
+                sg_total_output / 1048576.0, sg_total_seconds, thread_count, sg_total_input / 1048576.0 / sg_total_seconds);
+    }
+    return ret ? 0 : 1;
+}
@@ -5,6 +5,7 @@ import os
 import glob
 import zlib
 import struct
+import time
 import binascii
 import pyelliptic
 import traceback
@@ -17,9 +18,21 @@ MAGIC_COMPRESS_START = 0x04
 MAGIC_COMPRESS_START1 = 0x05
 MAGIC_COMPRESS_START2 = 0x07
 MAGIC_COMPRESS_NO_CRYPT_START = 0x09
+MAGIC_COMPRESS_CHACHA_START = 0x0A
+MAGIC_NO_COMPRESS_TEA_START = 0x0B
+MAGIC_ASYNC_NO_COMPRESS_NO_CRYPT_START = 0x0C
+MAGIC_NO_COMPRESS_CHACHA_START = 0x0D
 
 MAGIC_END = 0x00
 
+BINARY_RECORD_MAGIC = 0x1E
+BINARY_RECORD_SITE = ord('D')
+BINARY_RECORD_LOG = ord('R')
+BINARY_MAX_ARGS = 64
+BINARY_LEVEL_STRINGS = ('V', 'D', 'I', 'W', 'E', 'F')
+
+CHACHA_NONCE_LEN = 8
+
 lastseq = 0
 
 PRIV_KEY = "145aa7717bf9745b91e9569b80bbf1eedaa6cc6cd0e26317d810e35710f44cf8"
@@ -49,6 +62,206 @@ def tea_decrypt(v, k):
     return ret
 
 
+def chacha20_quarter_round(x, a, b, c, d):
+    op = 0xffffffffL
+    x[a] = (x[a] + x[b]) & op; x[d] ^= x[a]; x[d] = ((x[d] << 16) | (x[d] >> 16)) & op
+    x[c] = (x[c] + x[d]) & op; x[b] ^= x[c]; x[b] = ((x[b] << 12) | (x[b] >> 20)) & op
+    x[a] = (x[a] + x[b]) & op; x[d] ^= x[a]; x[d] = ((x[d] << 8) | (x[d] >> 24)) & op
+    x[c] = (x[c] + x[d]) & op; x[b] ^= x[c]; x[b] = ((x[b] << 7) | (x[b] >> 25)) & op
+
+
+# RFC 7539, the nonce is 4 zero bytes followed by the 8 bytes stored in front of the block data.
+def chacha20_decrypt(v, k, nonce):
+    op = 0xffffffffL
+    state = list(struct.unpack('<4L', 'expand 32-byte k')) + list(struct.unpack('<8L', k[0:32])) \
+            + [0, 0] + list(struct.unpack('<2L', str(nonce[0:CHACHA_NONCE_LEN])))
+    ret = bytearray(v)
+    for pos in xrange(0, len(ret), 64):
+        x = state[:]
+        for i in xrange(10):
+            chacha20_quarter_round(x, 0, 4, 8, 12)
+            chacha20_quarter_round(x, 1, 5, 9, 13)
+            chacha20_quarter_round(x, 2, 6, 10, 14)
+            chacha20_quarter_round(x, 3, 7, 11, 15)
+            chacha20_quarter_round(x, 0, 5, 10, 15)
+            chacha20_quarter_round(x, 1, 6, 11, 12)
+            chacha20_quarter_round(x, 2, 7, 8, 13)
+            chacha20_quarter_round(x, 3, 4, 9, 14)
+        key_stream = struct.pack('<16L', *[(x[i] + state[i]) & op for i in xrange(16)])
+        for i in xrange(min(64, len(ret) - pos)):
+            ret[pos + i] ^= ord(key_stream[i])
+        state[12] = (state[12] + 1) & op
+
+    return ret
+
+
+def GetEcdhKey(_buffer, _pubkey_offset, crypt_key_len):
+    svr = pyelliptic.ECC(curve='secp256k1')
+    client = pyelliptic.ECC(curve='secp256k1')
+    client.pubkey_x = str(buffer(_buffer, _pubkey_offset, crypt_key_len/2))
+    client.pubkey_y = str(buffer(_buffer, _pubkey_offset+crypt_key_len/2, crypt_key_len/2))
+
+    svr.privkey = binascii.unhexlify(PRIV_KEY)
+    return svr.get_ecdh_key(client.get_pubkey())
+
+
+def ReadVarint(_buffer, _pos, _end):
+    value = 0
+    shift = 0
+    while _pos < _end and shift < 64:
+        byte = _buffer[_pos]
+        _pos += 1
+        value |= (byte & 0x7F) << shift
+        if 0 == (byte & 0x80): return (value & 0xffffffffffffffffL, _pos)
+        shift += 7
+    raise ValueError('bad varint at %d'%_pos)
+
+
+def ReadSigned(_buffer, _pos, _end):
+    value, _pos = ReadVarint(_buffer, _pos, _end)
+    return ((value >> 1) ^ -(value & 1), _pos)
+
+
+def ReadString(_buffer, _pos, _end):
+    length, _pos = ReadVarint(_buffer, _pos, _end)
+    if length > _end - _pos: raise ValueError('string length:%d > %d'%(length, _end - _pos))
+    return (_buffer[_pos:_pos+length], _pos+length)
+
+
+def ParseBinarySite(_buffer, _pos, _end, _sites):
+    site_id, _pos = ReadVarint(_buffer, _pos, _end)
+    line, _pos = ReadVarint(_buffer, _pos, _end)
+    tag, _pos = ReadString(_buffer, _pos, _end)
+    filename, _pos = ReadString(_buffer, _pos, _end)
+    func, _pos = ReadString(_buffer, _pos, _end)
+    format, _pos = ReadString(_buffer, _pos, _end)
+    if site_id > 0xFFFFFF: raise ValueError('site id:%d'%site_id)
+    _sites[site_id] = (line, tag, filename, func, format)
+
+
+def FormatBinaryArg(_type, _value):
+    if 'i'==_type or 'u'==_type: return '%d'%_value
+    elif 'd'==_type: return '%E'%_value
+    elif 'b'==_type: return 'true' if _value else 'false'
+    elif 'c'==_type: return chr(_value) if _value else ''
+    else: return _value
+
+
+# renders a record the same way log_formater and XLogger::DoTypeSafeFormat print the text line.
+def RenderBinaryLog(_buffer, _pos, _end, _sites):
+    site_id, _pos = ReadVarint(_buffer, _pos, _end)
+    if _end - _pos < 2: raise ValueError('record too short')
+    level = _buffer[_pos]
+    flags = _buffer[_pos+1]
+    _pos += 2
+    sec, _pos = ReadSigned(_buffer, _pos, _end)
+    msec, _pos = ReadVarint(_buffer, _pos, _end)
+    gmtoff, _pos = ReadSigned(_buffer, _pos, _end)
+    pid, _pos = ReadSigned(_buffer, _pos, _end)
+    tid, _pos = ReadSigned(_buffer, _pos, _end)
+    if site_id not in _sites or level >= len(BINARY_LEVEL_STRINGS): raise ValueError('site id:%d, level:%d'%(site_id, level))
+
+    args = []
+    while _pos < _end:
+        arg_type = chr(_buffer[_pos])
+        _pos += 1
+        if 'i'==arg_type or 'u'==arg_type:
+            value, _pos = ReadVarint(_buffer, _pos, _end)
+            if 'i'==arg_type: value = (value >> 1) ^ -(value & 1)
+        elif 'd'==arg_type and _end - _pos >= 8:
+            value = struct.unpack_from("d", buffer(_buffer, _pos, 8))[0]
+            _pos += 8
+        elif ('b'==arg_type or 'c'==arg_type) and _pos < _end:
+            value = _buffer[_pos]
+            _pos += 1
+        elif 's'==arg_type:
+            value, _pos = ReadString(_buffer, _pos, _end)
+        else:
+            raise ValueError('arg type:%s'%arg_type)
+        if len(args) < BINARY_MAX_ARGS: args.append((arg_type, value))
+
+    line, tag, filename, func, format = _sites[site_id]
+    time_str = ''
+    if 0 != sec:
+        tm = time.gmtime(sec + gmtoff)
+        time_str = '%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d'%(tm.tm_year, tm.tm_mon, tm.tm_mday, gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, msec)
+
+    out = bytearray('[%s][%s][%d, %d%s]['%(BINARY_LEVEL_STRINGS[level], time_str, pid, tid, '*' if flags & 1 else ''))
+    out.extend(tag)
+    out.extend('][')
+    out.extend(filename)
+    out.extend(', ')
+    out.extend(func)
+    out.extend(', %d]['%line)
+
+    body_start = len(out)
+    pos = 0
+    count = 0
+    while pos < len(format):
+        percent = format.find('%', pos)
+        if -1 == percent:
+            out.extend(format[pos:])
+            break
+        out.extend(format[pos:percent])
+
+        nextch = chr(format[percent+1]) if percent + 1 < len(format) else ''
+        if nextch.isdigit() or '_'==nextch:
+            index = count if '_'==nextch else int(nextch)
+            if index < len(args): out.extend(FormatBinaryArg(*args[index]))
+            else: out.extend('{!!! void XLogger::DoTypeSafeFormat: _args[%d] == NULL !!!}'%index)
+            count += 1
+            pos = percent + 2
+        elif '%'==nextch:
+            out.extend('%')
+            pos = percent + 2
+        else:
+            out.extend('{!!! void XLogger::DoTypeSafeFormat: %')
+            if ''==nextch: break
+            out.extend(nextch + ' not fit mode !!!}')
+            pos = percent + 1
+
+    if len(out) == body_start or ord('\n') != out[-1]: out.extend('\n')
+    return out
+
+
+# copies a decoded block, deferred-format records at the start of a line are rendered to text.
+def AppendLogBlock(_outbuffer, _block):
+    block = bytearray(_block)
+    sites = {}
+    pos = 0
+    record_end = 0    # a site definition is directly followed by the first record using it
+    while pos < len(block):
+        mark = block.find(chr(BINARY_RECORD_MAGIC), pos)
+        if -1 == mark: mark = len(block)
+        _outbuffer.extend(block[pos:mark])
+        pos = mark
+        if pos >= len(block): break
+
+        record = None
+        if (record_end == pos or ord('\n') == block[pos-1]) and pos + 2 < len(block) \
+                and (BINARY_RECORD_SITE == block[pos+1] or BINARY_RECORD_LOG == block[pos+1]):
+            try:
+                length, start = ReadVarint(block, pos+2, len(block))
+                if length > len(block) - start: raise ValueError('record length:%d'%length)
+                if BINARY_RECORD_SITE == block[pos+1]:
+                    ParseBinarySite(block, start, start+length, sites)
+                    record = bytearray()
+                else:
+                    record = RenderBinaryLog(block, start, start+length, sites)
+            except Exception:
+                record = None
+
+        if record is None:
+            _outbuffer.append(block[pos])
+            pos += 1
+            continue
+
+        _outbuffer.extend(record)
+        pos = start + length
+        if pos < len(block) and ord('\n') == block[pos]: pos += 1
+        record_end = pos
+
+
 def IsGoodLogBuffer(_buffer, _offset, count):
 
     if _offset == len(_buffer): return (True, '')
@@ -56,7 +269,8 @@ def IsGoodLogBuffer(_buffer, _offset, count):
     magic_start = _buffer[_offset] 
     if MAGIC_NO_COMPRESS_START==magic_start or MAGIC_COMPRESS_START==magic_start or MAGIC_COMPRESS_START1==magic_start:
         crypt_key_len = 4
-    elif MAGIC_COMPRESS_START2==magic_start or MAGIC_NO_COMPRESS_START1==magic_start or MAGIC_NO_COMPRESS_NO_CRYPT_START==magic_start or MAGIC_COMPRESS_NO_CRYPT_START==magic_start:
+    elif MAGIC_COMPRESS_START2==magic_start or MAGIC_NO_COMPRESS_START1==magic_start or MAGIC_NO_COMPRESS_NO_CRYPT_START==magic_start or MAGIC_COMPRESS_NO_CRYPT_START==magic_start \
+            or MAGIC_COMPRESS_CHACHA_START<=magic_start<=MAGIC_NO_COMPRESS_CHACHA_START:
         crypt_key_len = 64
     else:
         return (False, '_buffer[%d]:%d != MAGIC_NUM_START'%(_offset, _buffer[_offset]))
@@ -78,7 +292,8 @@ def GetLogStartPos(_buffer, _count):
     while True:
         if offset >= len(_buffer): break
         
-        if MAGIC_NO_COMPRESS_START==_buffer[offset] or MAGIC_NO_COMPRESS_START1==_buffer[offset] or MAGIC_COMPRESS_START==_buffer[offset] or MAGIC_COMPRESS_START1==_buffer[offset] or MAGIC_COMPRESS_START2==_buffer[offset] or MAGIC_COMPRESS_NO_CRYPT_START==_buffer[offset] or MAGIC_NO_COMPRESS_NO_CRYPT_START==_buffer[offset]:
+        if MAGIC_NO_COMPRESS_START==_buffer[offset] or MAGIC_NO_COMPRESS_START1==_buffer[offset] or MAGIC_COMPRESS_START==_buffer[offset] or MAGIC_COMPRESS_START1==_buffer[offset] or MAGIC_COMPRESS_START2==_buffer[offset] or MAGIC_COMPRESS_NO_CRYPT_START==_buffer[offset] or MAGIC_NO_COMPRESS_NO_CRYPT_START==_buffer[offset] \
+                or MAGIC_COMPRESS_CHACHA_START<=_buffer[offset]<=MAGIC_NO_COMPRESS_CHACHA_START:
             if IsGoodLogBuffer(_buffer, offset, _count)[0]: return offset
         offset+=1
         
@@ -100,7 +315,8 @@ def DecodeBuffer(_buffer, _offset, _outbuffer):
     magic_start = _buffer[_offset]
     if MAGIC_NO_COMPRESS_START==magic_start or MAGIC_COMPRESS_START==magic_start or MAGIC_COMPRESS_START1==magic_start:
         crypt_key_len = 4
-    elif MAGIC_COMPRESS_START2==magic_start or MAGIC_NO_COMPRESS_START1==magic_start or MAGIC_NO_COMPRESS_NO_CRYPT_START==magic_start or MAGIC_COMPRESS_NO_CRYPT_START==magic_start:
+    elif MAGIC_COMPRESS_START2==magic_start or MAGIC_NO_COMPRESS_START1==magic_start or MAGIC_NO_COMPRESS_NO_CRYPT_START==magic_start or MAGIC_COMPRESS_NO_CRYPT_START==magic_start \
+            or MAGIC_COMPRESS_CHACHA_START<=magic_start<=MAGIC_NO_COMPRESS_CHACHA_START:
         crypt_key_len = 64
     else:
         _outbuffer.extend('in DecodeBuffer _buffer[%d]:%d != MAGIC_NUM_START'%(_offset, magic_start))
@@ -126,20 +342,22 @@ def DecodeBuffer(_buffer, _offset, _outbuffer):
     try:
         decompressor = zlib.decompressobj(-zlib.MAX_WBITS)
 
-        if MAGIC_NO_COMPRESS_START1==_buffer[_offset]:
+        if MAGIC_NO_COMPRESS_START1==_buffer[_offset] or MAGIC_ASYNC_NO_COMPRESS_NO_CRYPT_START==_buffer[_offset]:
             pass
         
-        elif MAGIC_COMPRESS_START2==_buffer[_offset]:
-            svr = pyelliptic.ECC(curve='secp256k1')
-            client = pyelliptic.ECC(curve='secp256k1')
-            client.pubkey_x = str(buffer(_buffer, _offset+headerLen-crypt_key_len, crypt_key_len/2))
-            client.pubkey_y = str(buffer(_buffer, _offset+headerLen-crypt_key_len/2, crypt_key_len/2))
-
-            svr.privkey = binascii.unhexlify(PRIV_KEY)
-            tea_key = svr.get_ecdh_key(client.get_pubkey())
+        elif MAGIC_COMPRESS_START2==_buffer[_offset] or MAGIC_NO_COMPRESS_TEA_START==_buffer[_offset]:
+            tea_key = GetEcdhKey(_buffer, _offset+headerLen-crypt_key_len, crypt_key_len)
 
             tmpbuffer = tea_decrypt(tmpbuffer, tea_key)
-            tmpbuffer = decompressor.decompress(str(tmpbuffer))
+            if MAGIC_COMPRESS_START2==_buffer[_offset]:
+                tmpbuffer = decompressor.decompress(str(tmpbuffer))
+        elif MAGIC_COMPRESS_CHACHA_START==_buffer[_offset] or MAGIC_NO_COMPRESS_CHACHA_START==_buffer[_offset]:
+            # the block data starts with the plain nonce of the key stream.
+            chacha_key = GetEcdhKey(_buffer, _offset+headerLen-crypt_key_len, crypt_key_len)
+
+            tmpbuffer = chacha20_decrypt(tmpbuffer[CHACHA_NONCE_LEN:], chacha_key, tmpbuffer[0:CHACHA_NONCE_LEN])
+            if MAGIC_COMPRESS_CHACHA_START==_buffer[_offset]:
+                tmpbuffer = decompressor.decompress(str(tmpbuffer))
         elif MAGIC_COMPRESS_START==_buffer[_offset] or MAGIC_COMPRESS_NO_CRYPT_START==_buffer[_offset]:
             tmpbuffer = decompressor.decompress(str(tmpbuffer))
         elif MAGIC_COMPRESS_START1==_buffer[_offset]:
@@ -160,7 +378,7 @@ def DecodeBuffer(_buffer, _offset, _outbuffer):
         _outbuffer.extend("[F]decode_log_file.py decompress err, " + str(e) + "\n")
         return _offset+headerLen+length+1
 
-    _outbuffer.extend(tmpbuffer)
+    AppendLogBlock(_outbuffer, tmpbuffer)
     
     return _offset+headerLen+length+1
 
@@ -33,15 +33,33 @@
 #include "micro-ecc-master/uECC.h"
 #endif
 
+#include "chacha20.h"
+
 static const char kMagicSyncStart = '\x06';
 static const char kMagicSyncNoCryptStart ='\x08';
 static const char kMagicAsyncStart ='\x07';
 static const char kMagicAsyncNoCryptStart ='\x09';
+static const char kMagicAsyncChaChaStart = '\x0A';
+static const char kMagicAsyncNoCompressStart = '\x0B';
+static const char kMagicAsyncNoCompressNoCryptStart = '\x0C';
+static const char kMagicAsyncNoCompressChaChaStart = '\x0D';
 
 static const char kMagicEnd  = '\0';
 
 const static int TEA_BLOCK_LEN = 8;
 
+/*
+ * chacha20 blocks start with a plain nonce of kChaChaNonceLen bytes, counted in the log length.
+ */
+const static uint32_t kChaChaNonceLen = sizeof(uint64_t);
+
+static bool __IsValidMagicStart(char _start) {
+    return kMagicSyncStart == _start || kMagicSyncNoCryptStart == _start
+        || kMagicAsyncStart == _start || kMagicAsyncNoCryptStart == _start
+        || kMagicAsyncChaChaStart == _start || kMagicAsyncNoCompressStart == _start
+        || kMagicAsyncNoCompressNoCryptStart == _start || kMagicAsyncNoCompressChaChaStart == _start;
+}
+
 static void __TeaEncrypt (uint32_t* v, uint32_t* k) {
     uint32_t v0=v[0], v1=v[1], sum=0, i;
     const static uint32_t delta=0x9e3779b9;
@@ -97,7 +115,8 @@ static bool Hex2Buffer(const char* _str, size_t _len, unsigned char* _buffer) {
 }
 #endif
 
-LogCrypt::LogCrypt(const char* _pubkey): seq_(0), is_crypt_(false) {
+LogCrypt::LogCrypt(const char* _pubkey, TLogCryptMode _crypt_mode)
+: seq_(0), chacha_nonce_(0), crypt_offset_(0), is_crypt_(false), crypt_mode_(_crypt_mode) {
     
 #ifndef XLOG_NO_CRYPT
     const static size_t PUB_KEY_LEN = 64;
@@ -123,6 +142,7 @@ LogCrypt::LogCrypt(const char* _pubkey): seq_(0), is_crypt_(false) {
     }
     
     memcpy(tea_key_, ecdh_key, sizeof(tea_key_));
+    memcpy(chacha_key_, ecdh_key, sizeof(chacha_key_));
 
     is_crypt_ = true;
 
@@ -147,7 +167,7 @@ bool LogCrypt::GetLogHour(const char* const _data, size_t _len, int& _begin_hour
     if (_len < GetHeaderLen()) return false;
     
     char start = _data[0];
-    if (kMagicAsyncStart != start && kMagicSyncStart != start) return false;
+    if (!__IsValidMagicStart(start)) return false;
     
     char begin_hour = _data[sizeof(char)+sizeof(uint16_t)];
     char end_hour = _data[sizeof(char)+sizeof(uint16_t)+sizeof(char)];
@@ -168,12 +188,20 @@ void LogCrypt::UpdateLogHour(char* _data) {
     memcpy(_data + GetHeaderLen() - sizeof(uint32_t) - sizeof(char) * 64 - sizeof(char), &hour, sizeof(hour));
 }
 
+uint16_t LogCrypt::GetLogSeq(const char* const _data, size_t _len) {
+    if (_len < GetHeaderLen()) return 0;
+    if (!__IsValidMagicStart(_data[0])) return 0;
+
+    uint16_t seq = 0;
+    memcpy(&seq, _data + sizeof(kMagicAsyncStart), sizeof(seq));
+    return seq;
+}
+
 uint32_t LogCrypt::GetLogLen(const char*  const _data, size_t _len) {
     if (_len < GetHeaderLen()) return 0;
     
     char start = _data[0];
-    if (kMagicAsyncStart != start && kMagicSyncStart != start
-        && kMagicAsyncNoCryptStart != start && kMagicSyncNoCryptStart != start) {
+    if (!__IsValidMagicStart(start)) {
         return 0;
     }
     
@@ -188,13 +216,17 @@ void LogCrypt::UpdateLogLen(char* _data, uint32_t _add_len) {
     memcpy(_data + GetHeaderLen() - sizeof(uint32_t) - sizeof(char) * 64, &currentlen, sizeof(currentlen));
 }
 
-void LogCrypt::SetHeaderInfo(char* _data, bool _is_async) {
+void LogCrypt::SetHeaderInfo(char* _data, bool _is_async, bool _is_compress) {
     if (_is_async) {
-        if (is_crypt_) {
-            memcpy(_data, &kMagicAsyncStart, sizeof(kMagicAsyncStart));
+        const char* start = NULL;
+        if (!is_crypt_) {
+            start = _is_compress ? &kMagicAsyncNoCryptStart : &kMagicAsyncNoCompressNoCryptStart;
+        } else if (kLogCryptChaCha20 == crypt_mode_) {
+            start = _is_compress ? &kMagicAsyncChaChaStart : &kMagicAsyncNoCompressChaChaStart;
         } else {
-            memcpy(_data, &kMagicAsyncNoCryptStart, sizeof(kMagicAsyncNoCryptStart));
+            start = _is_compress ? &kMagicAsyncStart : &kMagicAsyncNoCompressStart;
         }
+        memcpy(_data, start, sizeof(*start));
     } else {
         if (is_crypt_) {
             memcpy(_data, &kMagicSyncStart, sizeof(kMagicSyncStart));
@@ -220,6 +252,15 @@ void LogCrypt::SetHeaderInfo(char* _data, bool _is_async) {
     uint32_t len = 0;
     memcpy(_data + sizeof(kMagicAsyncStart) + sizeof(seq_) + sizeof(hour) * 2, &len, sizeof(len));
     memcpy(_data + sizeof(kMagicAsyncStart) + sizeof(seq_) + sizeof(hour) * 2 + sizeof(len), client_pubkey_, sizeof(client_pubkey_));
+
+    // sync logs are written with the same LogCrypt while an async block is open, leave its stream alone.
+    if (_is_async && is_crypt_ && kLogCryptChaCha20 == crypt_mode_) {
+        // the key is derived from a fresh ecdh key pair per LogCrypt, so a counter is a unique nonce.
+        crypt_offset_ = 0;
+        ++chacha_nonce_;
+        memcpy(_data + GetHeaderLen(), &chacha_nonce_, kChaChaNonceLen);
+        UpdateLogLen(_data, kChaChaNonceLen);
+    }
 }
 
 void LogCrypt::SetTailerInfo(char* _data) {
@@ -284,8 +325,7 @@ bool LogCrypt::GetPeriodLogs(const char* const _log_path, int _begin_hour, int _
         bool fix = false;
         
         char start = *header_buff;
-        if (start != kMagicSyncStart && start != kMagicSyncNoCryptStart
-                && start != kMagicAsyncStart && start != kMagicAsyncNoCryptStart) {
+        if (!__IsValidMagicStart(start)) {
             fix = true;
         } else {
             uint32_t len = GetLogLen(header_buff, GetHeaderLen());
@@ -415,6 +455,16 @@ void LogCrypt::CryptAsyncLog(const char* const _log_data, size_t _input_len, Aut
         return;
     }
 #ifndef XLOG_NO_CRYPT
+    if (kLogCryptChaCha20 == crypt_mode_) {
+        uint8_t nonce[kChaCha20NonceLen] = {0};
+        memcpy(nonce + kChaCha20NonceLen - kChaChaNonceLen, &chacha_nonce_, kChaChaNonceLen);
+
+        ChaCha20Xor(chacha_key_, nonce, crypt_offset_, (const uint8_t*)_log_data, (uint8_t*)_out_buff.Ptr(), _input_len);
+        crypt_offset_ += _input_len;
+        _remain_nocrypt_len = 0;
+        return;
+    }
+
     uint32_t tmp[2] = {0};
     size_t cnt = _input_len / TEA_BLOCK_LEN;
 	_remain_nocrypt_len = _input_len % TEA_BLOCK_LEN;
@@ -435,8 +485,7 @@ bool LogCrypt::Fix(char* _data, size_t _data_len, bool& _is_async, uint32_t& _ra
     }
     
     char start = _data[0];
-    if (kMagicAsyncStart != start && kMagicSyncStart != start
-        && kMagicAsyncNoCryptStart != start && kMagicSyncNoCryptStart != start) {
+    if (!__IsValidMagicStart(start)) {
         return false;
     }
     
@@ -24,11 +24,12 @@
 #include <string>
 
 #include "mars/comm/autobuffer.h"
+#include "mars/log/appender.h"
 
 
 class LogCrypt {
 public:
-    LogCrypt(const char* _pubkey);
+    LogCrypt(const char* _pubkey, TLogCryptMode _crypt_mode = kLogCryptTea);
     virtual ~LogCrypt() {}
     
 private:
@@ -42,13 +43,14 @@ public:
     static bool GetLogHour(const char* const _data, size_t _len, int& _begin_hour, int& _end_hour);
     static void UpdateLogHour(char* _data);
     
+    static uint16_t GetLogSeq(const char* const _data, size_t _len);
     static uint32_t GetLogLen(const char* const _data, size_t _len);
     static void UpdateLogLen(char* _data, uint32_t _add_len);
     static bool GetPeriodLogs(const char* const _log_path, int _begin_hour, int _end_hour, unsigned long& _begin_pos, unsigned long& _end_pos, std::string& _err_msg);
 
 public:
     
-    void SetHeaderInfo(char* _data, bool _is_async);
+    void SetHeaderInfo(char* _data, bool _is_async, bool _is_compress = true);
     void SetTailerInfo(char* _data);
 
     void CryptSyncLog(const char* const _log_data, size_t _input_len, AutoBuffer& _out_buff);
@@ -59,8 +61,12 @@ public:
 private:
     uint16_t seq_;
     uint32_t tea_key_[4];
+    uint8_t chacha_key_[32];
+    uint64_t chacha_nonce_;
+    uint64_t crypt_offset_;
     char client_pubkey_[64];
     bool is_crypt_;
+    TLogCryptMode crypt_mode_;
 
 };
 
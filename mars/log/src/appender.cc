@@ -46,6 +46,7 @@
 #include <zlib.h>
 
 #include <string>
+#include <map>
 #include <algorithm>
 
 #include "boost/bind.hpp"
@@ -61,6 +62,8 @@
 #include "mars/comm/autobuffer.h"
 #include "mars/comm/ptrbuffer.h"
 #include "mars/comm/xlogger/xloggerbase.h"
+#include "mars/comm/xlogger/xlogger_binary.h"
+#include "mars/comm/xlogger/loginfo_extract.h"
 #include "mars/comm/time_utils.h"
 #include "mars/comm/strutil.h"
 #include "mars/comm/mmap_util.h"
@@ -72,8 +75,11 @@
 #endif
 
 #include "log_buffer.h"
+#include "log_staging_ring.h"
+#include "log_index.h"
 
 #define LOG_EXT "xlog"
+#define LOG_INDEX_EXT "xidx"  // see LogIndex
 
 extern void log_formater(const XLoggerInfo* _info, const char* _logbody, PtrBuffer& _log);
 extern void ConsoleLog(const XLoggerInfo* _info, const char* _log);
@@ -86,9 +92,15 @@ static std::string sg_logfileprefix;
 
 static Mutex sg_mutex_log_file;
 static FILE* sg_logfile = NULL;
+static FILE* sg_logindexfile = NULL;
+static uint64_t sg_logfile_size = 0;
 static time_t sg_openfiletime = 0;
 static std::string sg_current_dir;
 
+static Mutex sg_mutex_fileindex;
+static std::string sg_cached_fileprefix;
+static long sg_cached_fileindex = 0;
+
 static Mutex sg_mutex_buffer_async;
 #ifdef _WIN32
 static Condition& sg_cond_buffer_async = *(new Condition());  // 改成引用, 避免在全局释放时执行析构导致crash
@@ -96,7 +108,34 @@ static Condition& sg_cond_buffer_async = *(new Condition());  // 改成引用, 
 static Condition sg_cond_buffer_async;
 #endif
 
-static LogBuffer* sg_log_buff = NULL;
+static const int kBufferSegmentCount = 2;
+static LogBuffer* sg_log_buff_segments[kBufferSegmentCount] = {NULL};
+static int sg_log_buff_index = 0;
+static LogBuffer* sg_log_buff = NULL;   // the segment producers are writing to
+
+// held by whoever turns a segment into file data, so the blocks reach the file in order. lock it before sg_mutex_buffer_async.
+static Mutex sg_mutex_buffer_flush;
+static AutoBuffer& sg_pending_blocks = *(new AutoBuffer);   // flushed blocks not yet written to file
+static std::vector<LogBlockStat>& sg_pending_block_stats = *(new std::vector<LogBlockStat>);
+#ifdef _WIN32
+static Condition& sg_cond_buffer_space = *(new Condition());
+#else
+static Condition sg_cond_buffer_space;
+#endif
+
+static TAppenderBufferFullPolicy sg_buffer_full_policy = kAppenderBufferFullDrop;
+static int sg_buffer_drop_level = kLevelError;
+static size_t sg_pending_blocks_limit = 8 * 1024 * 1024;
+static uint64_t sg_dropped_lines = 0;
+static uint64_t sg_stalled_lines = 0;
+static uint64_t sg_reported_dropped_lines = 0;
+static uint64_t sg_reported_stalled_lines = 0;
+
+static void __orphan_staging_ring(void* _ring);
+static volatile bool sg_thread_staging = false;
+static Mutex sg_mutex_staging_rings;
+static std::vector<LogStagingRing*>& sg_staging_rings = *(new std::vector<LogStagingRing*>);
+static Tss sg_tss_staging_ring(&__orphan_staging_ring);
 
 static volatile bool sg_log_close = true;
 
@@ -108,6 +147,22 @@ static bool sg_consolelog_open = true;
 static bool sg_consolelog_open = false;
 #endif
 
+static TLogCompressMode sg_compress_mode = kLogCompressZlib;
+static int sg_compress_level = Z_BEST_COMPRESSION;
+static TLogCryptMode sg_crypt_mode = kLogCryptTea;
+
+namespace {
+// call site of deferred-format records, its definition is written once into every block using it.
+struct BinaryLogSite {
+    uint32_t id;
+    const LogBuffer* defined_buff;
+    uint32_t defined_block;
+};
+}
+
+static volatile bool sg_binary_log = false;
+static std::map<uint64_t, BinaryLogSite>& sg_binary_log_sites = *(new std::map<uint64_t, BinaryLogSite>);   // guarded by sg_mutex_buffer_async
+
 static uint64_t sg_max_file_size = 0; // 0, will not split log file.
 static int sg_cache_log_days = 0;   // 0, will not cache logs
 
@@ -115,12 +170,22 @@ static void __async_log_thread();
 static Thread sg_thread_async(&__async_log_thread);
 
 static const unsigned int kBufferBlockLength = 150 * 1024;
+static const unsigned int kStagingRingLength = 64 * 1024;
+static const unsigned int kStagingReserveLength = 16 * 1024;
+
+// in front of every line in a staging ring, so the line still counts in the stat of its block.
+struct StagedLineInfo {
+    time_t time;
+    int level;
+};
+static const unsigned int kBufferFullWaitTime = 1000;  // ms
+static const size_t kMaxBinaryLogSites = 64 * 1024;
 static const long kMaxLogAliveTime = 10 * 24 * 60 * 60;    // 10 days in second
 static const long kMinLogAliveTime = 24 * 60 * 60;    // 1 days in second
 static long sg_max_alive_time = kMaxLogAliveTime;
 static std::string sg_log_extra_msg;
 
-static boost::iostreams::mapped_file& sg_mmmap_file = *(new boost::iostreams::mapped_file);
+static boost::iostreams::mapped_file* const sg_mmmap_files = new boost::iostreams::mapped_file[kBufferSegmentCount];
 
 namespace {
 class ScopeErrno {
@@ -232,12 +297,32 @@ static long __get_next_fileindex(const std::string& _fileprefix, const std::stri
     return (filesize > sg_max_file_size) ? index + 1 : index;
 }
 
+/*
+ * The directories are only listed again when the day (the prefix) changes or the current file is rotated,
+ * __get_next_fileindex is far too expensive to run on every flush.
+ */
+static long __get_cached_fileindex(const std::string& _fileprefix, const std::string& _fileext) {
+    ScopedLock lock(sg_mutex_fileindex);
+
+    if (_fileprefix != sg_cached_fileprefix) {
+        sg_cached_fileindex = __get_next_fileindex(_fileprefix, _fileext);
+        sg_cached_fileprefix = _fileprefix;
+    }
+
+    return sg_cached_fileindex;
+}
+
+static void __reset_cached_fileindex() {
+    ScopedLock lock(sg_mutex_fileindex);
+    sg_cached_fileprefix.clear();
+}
+
 static void __make_logfilename(const timeval& _tv, const std::string& _logdir, const char* _prefix, const std::string& _fileext, char* _filepath, unsigned int _len) {
     
     long index = 0;
     std::string logfilenameprefix = __make_logfilenameprefix(_tv, _prefix);
     if (sg_max_file_size > 0) {
-        index = __get_next_fileindex(logfilenameprefix, _fileext);
+        index = __get_cached_fileindex(logfilenameprefix, _fileext);
     }
     
     std::string logfilepath = _logdir;
@@ -269,7 +354,7 @@ static void __del_timeout_file(const std::string& _log_path) {
             
             if (now_time > file_modify_time && now_time - file_modify_time > sg_max_alive_time) {
                 if(boost::filesystem::is_regular_file(iter->status())
-                && iter->path().extension() == (std::string(".") + LOG_EXT)) {
+                && (iter->path().extension() == (std::string(".") + LOG_EXT) || iter->path().extension() == (std::string(".") + LOG_INDEX_EXT))) {
                     boost::filesystem::remove(iter->path());
                 } 
                 if (boost::filesystem::is_directory(iter->status())) {
@@ -340,6 +425,7 @@ static bool __append_file(const std::string& _src_file, const std::string& _dst_
     fclose(src_file);
     fclose(dest_file);
 
+    LogIndex::Merge(_src_file, _dst_file, (uint64_t)dst_file_len);
     return true;
 }
 
@@ -423,9 +509,19 @@ static bool __writefile(const void* _data, size_t _len, FILE* _file) {
         return false;
     }
 
+    // the file stays open in async mode, make the block visible to readers (e.g. uploading) right away.
+    if (kAppednerAsync == sg_mode) fflush(_file);
+
     return true;
 }
 
+static void __closelogindex() {
+    if (NULL == sg_logindexfile) return;
+
+    fclose(sg_logindexfile);
+    sg_logindexfile = NULL;
+}
+
 static bool __openlogfile(const std::string& _log_dir) {
     if (sg_logdir.empty()) return false;
 
@@ -439,6 +535,7 @@ static bool __openlogfile(const std::string& _log_dir) {
 
         if (filetm.tm_year == tcur.tm_year && filetm.tm_mon == tcur.tm_mon && filetm.tm_mday == tcur.tm_mday && sg_current_dir == _log_dir) return true;
 
+        __closelogindex();
         fclose(sg_logfile);
         sg_logfile = NULL;
     }
@@ -461,6 +558,10 @@ static bool __openlogfile(const std::string& _log_dir) {
 
         if (NULL == sg_logfile) {
             __writetips2console("open file error:%d %s, path:%s", errno, strerror(errno), s_last_file_path);
+        } else {
+            fseek(sg_logfile, 0, SEEK_END);
+            sg_logfile_size = (uint64_t)ftell(sg_logfile);
+            sg_logindexfile = LogIndex::Open(s_last_file_path, sg_logfile_size);
         }
 
 #ifdef __APPLE__
@@ -473,6 +574,10 @@ static bool __openlogfile(const std::string& _log_dir) {
 
     if (NULL == sg_logfile) {
         __writetips2console("open file error:%d %s, path:%s", errno, strerror(errno), logfilepath);
+    } else {
+        fseek(sg_logfile, 0, SEEK_END);
+        sg_logfile_size = (uint64_t)ftell(sg_logfile);
+        sg_logindexfile = LogIndex::Open(logfilepath, sg_logfile_size);
     }
 
 
@@ -507,11 +612,38 @@ static bool __openlogfile(const std::string& _log_dir) {
 static void __closelogfile() {
     if (NULL == sg_logfile) return;
 
+    __closelogindex();
     sg_openfiletime = 0;
+    sg_logfile_size = 0;
     fclose(sg_logfile);
     sg_logfile = NULL;
 }
 
+/*
+ * Write to the current log file, which is kept open between flushes.
+ * Once it grows over sg_max_file_size it's closed, so the next write starts a new file.
+ * In async mode the blocks in _data are added to the index of the file, _block_stats are in the same order.
+ * Sync mode writes a block per line and isn't indexed, readers take the unindexed ranges of a file as they are.
+ */
+static bool __writelogfile(const void* _data, size_t _len, const LogBlockStat* _block_stats, size_t _block_stat_count) {
+    uint64_t offset = sg_logfile_size;
+    bool ret = __writefile(_data, _len, sg_logfile);
+    if (ret) {
+        sg_logfile_size += _len;
+        if (NULL != sg_logindexfile && kAppednerAsync == sg_mode) {
+            LogIndex::Append(sg_logindexfile, _data, _len, offset, _block_stats, _block_stat_count);
+            fflush(sg_logindexfile);
+        }
+    }
+
+    if (sg_max_file_size > 0 && sg_logfile_size > sg_max_file_size) {
+        __closelogfile();
+        __reset_cached_fileindex();
+    }
+
+    return ret;
+}
+
 static bool __cache_logs() {
     if (sg_cache_logdir.empty() || sg_cache_log_days <= 0) {
         return false;
@@ -535,19 +667,18 @@ static bool __cache_logs() {
     
 }
 
-static void __log2file(const void* _data, size_t _len, bool _move_file) {
+static void __log2file(const void* _data, size_t _len, bool _move_file,
+                       const std::vector<LogBlockStat>& _block_stats = std::vector<LogBlockStat>()) {
     if (NULL == _data || 0 == _len || sg_logdir.empty()) {
         return;
     }
 
+    const LogBlockStat* block_stats = _block_stats.empty() ? NULL : &_block_stats[0];
     ScopedLock lock_file(sg_mutex_log_file);
 
     if (sg_cache_logdir.empty()) {
         if (__openlogfile(sg_logdir)) {
-            __writefile(_data, _len, sg_logfile);
-            if (kAppednerAsync == sg_mode) {
-                __closelogfile();
-            }
+            __writelogfile(_data, _len, block_stats, _block_stats.size());
         }
         return;
     }
@@ -560,21 +691,18 @@ static void __log2file(const void* _data, size_t _len, bool _move_file) {
     
     bool cache_logs = __cache_logs();
     if ((cache_logs || boost::filesystem::exists(logcachefilepath)) && __openlogfile(sg_cache_logdir)) {
-        __writefile(_data, _len, sg_logfile);
-        if (kAppednerAsync == sg_mode) {
-            __closelogfile();
-        }
+        __writelogfile(_data, _len, block_stats, _block_stats.size());
         
         if (cache_logs || !_move_file) {
             return;
         }
 
+        // the cache file is going to be removed, don't keep it open.
+        __closelogfile();
+
         char logfilepath[1024] = {0};
         __make_logfilename(tv, sg_logdir, sg_logfileprefix.c_str(), LOG_EXT, logfilepath , 1024);
         if (__append_file(logcachefilepath, logfilepath)) {
-            if (kAppednerSync == sg_mode) {
-                __closelogfile();
-            }
             boost::filesystem::remove(logcachefilepath);
         }
         return;
@@ -583,22 +711,16 @@ static void __log2file(const void* _data, size_t _len, bool _move_file) {
     bool write_sucess = false;
     bool open_success = __openlogfile(sg_logdir);
     if (open_success) {
-        write_sucess = __writefile(_data, _len, sg_logfile);
-        if (kAppednerAsync == sg_mode) {
-            __closelogfile();
-        }
+        write_sucess = __writelogfile(_data, _len, block_stats, _block_stats.size());
     }
 
     if (!write_sucess) {
-        if (open_success && kAppednerSync == sg_mode) {
+        if (open_success) {
             __closelogfile();
         }
 
         if (__openlogfile(sg_cache_logdir)) {
-            __writefile(_data, _len, sg_logfile);
-            if (kAppednerAsync == sg_mode) {
-                __closelogfile();
-            }
+            __writelogfile(_data, _len, block_stats, _block_stats.size());
         }
     }
 
@@ -623,18 +745,125 @@ static void __writetips2file(const char* _tips_format, ...) {
     __log2file(tmp_buff.Ptr(), tmp_buff.Length(), false);
 }
 
+static void __orphan_staging_ring(void* _ring) {
+    if (NULL == _ring) return;
+    // the ring is released by the consumer once it has been drained.
+    ((LogStagingRing*)_ring)->Orphan();
+}
+
+static LogStagingRing* __get_staging_ring() {
+    LogStagingRing* ring = (LogStagingRing*)sg_tss_staging_ring.get();
+    if (NULL != ring) return ring;
+
+    ring = new LogStagingRing(kStagingRingLength);
+    ScopedLock lock(sg_mutex_staging_rings);
+    sg_staging_rings.push_back(ring);
+    lock.unlock();
+
+    sg_tss_staging_ring.set(ring);
+    return ring;
+}
+
+/*
+ * Move sg_log_buff's data into sg_pending_blocks, must be called with sg_mutex_buffer_async held.
+ * Returns false once sg_pending_blocks has reached sg_pending_blocks_limit, the lines then go as with kAppenderBufferFullDrop.
+ */
+static bool __flush_to_pending_blocks() {
+    if (sg_pending_blocks.Length() >= sg_pending_blocks_limit) return false;
+
+    sg_log_buff->Flush(sg_pending_blocks, sg_pending_block_stats);
+    return true;
+}
+
+/*
+ * Move every staged line into sg_log_buff, must be called with sg_mutex_buffer_async held.
+ * Whenever sg_log_buff is nearly full it's flushed into sg_pending_blocks, so nothing staged is dropped until those reach their limit.
+ */
+static void __drain_staging_rings() {
+    ScopedLock lock(sg_mutex_staging_rings);
+
+    for (std::vector<LogStagingRing*>::iterator iter = sg_staging_rings.begin(); iter != sg_staging_rings.end();) {
+        LogStagingRing* ring = *iter;
+        // check before draining, the owner may still be writing its last line otherwise.
+        bool orphaned = ring->IsOrphaned();
+
+        const void* data = NULL;
+        size_t len = 0;
+        while (ring->Front(data, len)) {
+            StagedLineInfo line_info;
+            memcpy(&line_info, data, sizeof(line_info));
+
+            bool keep = true;
+            if (sg_log_buff->GetData().Length() >= kBufferBlockLength*4/5 && !__flush_to_pending_blocks()) {
+                keep = line_info.level >= sg_buffer_drop_level;
+            }
+
+            if (!keep || !sg_log_buff->Write((const char*)data + sizeof(line_info), len - sizeof(line_info), line_info.level, line_info.time)) {
+                ++sg_dropped_lines;
+            }
+            ring->Pop();
+        }
+
+        if (orphaned) {
+            delete ring;
+            iter = sg_staging_rings.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+static void __write_buffer_stat_tips() {
+    if (sg_dropped_lines == sg_reported_dropped_lines && sg_stalled_lines == sg_reported_stalled_lines) return;
+
+    char tips[256] = {0};
+    snprintf(tips, sizeof(tips), "[F][ log buffer was full, policy:%d, dropped lines:%" PRIu64 ", stalled lines:%" PRIu64 "\n",
+             (int)sg_buffer_full_policy, sg_dropped_lines - sg_reported_dropped_lines, sg_stalled_lines - sg_reported_stalled_lines);
+    // a segment too full for the tips carries them over to the next switch.
+    if (!sg_log_buff->Write(tips, strnlen(tips, sizeof(tips)), kLevelFatal, time(NULL))) return;
+
+    sg_reported_dropped_lines = sg_dropped_lines;
+    sg_reported_stalled_lines = sg_stalled_lines;
+}
+
+/*
+ * Hand the segment being written over to the caller and let producers go on with the next one,
+ * must be called with sg_mutex_buffer_flush and sg_mutex_buffer_async held.
+ * Every flush is done under sg_mutex_buffer_flush, so the next segment has always been flushed empty.
+ */
+static LogBuffer* __switch_log_buff(AutoBuffer& _flushed, std::vector<LogBlockStat>& _flushed_stats) {
+    __drain_staging_rings();
+    __write_buffer_stat_tips();
+
+    // blocks flushed before are older than anything in the current segment.
+    if (NULL != sg_pending_blocks.Ptr()) _flushed.Attach(sg_pending_blocks);
+    _flushed_stats.swap(sg_pending_block_stats);
+
+    LogBuffer* full = sg_log_buff;
+    sg_log_buff_index = (sg_log_buff_index + 1) % kBufferSegmentCount;
+    sg_log_buff = sg_log_buff_segments[sg_log_buff_index];
+    sg_cond_buffer_space.notifyAll();
+
+    return full;
+}
+
 static void __async_log_thread() {
     while (true) {
 
+        ScopedLock lock_flush(sg_mutex_buffer_flush);
         ScopedLock lock_buffer(sg_mutex_buffer_async);
 
         if (NULL == sg_log_buff) break;
 
         AutoBuffer tmp;
-        sg_log_buff->Flush(tmp);
+        std::vector<LogBlockStat> tmp_stats;
+        LogBuffer* full = __switch_log_buff(tmp, tmp_stats);
         lock_buffer.unlock();
 
-        if (NULL != tmp.Ptr())  __log2file(tmp.Ptr(), tmp.Length(), true);
+        // compressing and copying the full segment out no longer blocks the producers.
+        full->Flush(tmp, tmp_stats);
+        if (NULL != tmp.Ptr())  __log2file(tmp.Ptr(), tmp.Length(), true, tmp_stats);
+        lock_flush.unlock();
 
         if (sg_log_close) break;
 
@@ -644,35 +873,217 @@ static void __async_log_thread() {
 
 static void __appender_sync(const XLoggerInfo* _info, const char* _log) {
 
-    char temp[16 * 1024] = {0};     // tell perry,ray if you want modify size.
+    char temp[16 * 1024];     // tell perry,ray if you want modify size. not zeroed, log_formater only reads back what it wrote.
     PtrBuffer log(temp, 0, sizeof(temp));
     log_formater(_info, _log, log);
 
     AutoBuffer tmp_buff;
     if (!sg_log_buff->Write(log.Ptr(), log.Length(), tmp_buff))   return;
 
-    __log2file(tmp_buff.Ptr(), tmp_buff.Length(), false);
+    std::vector<LogBlockStat> block_stats(1);
+    memset(&block_stats[0], 0, sizeof(LogBlockStat));
+    if (NULL != _info) {
+        block_stats[0].begin_time = block_stats[0].end_time = _info->timeval.tv_sec;
+        if (0 <= _info->level && _info->level < kLogBlockLevelCount) block_stats[0].level_count[_info->level] = 1;
+    }
+
+    __log2file(tmp_buff.Ptr(), tmp_buff.Length(), false, block_stats);
+}
+
+static bool __is_log_buff_full() {
+    return sg_log_buff->GetData().Length() >= kBufferBlockLength*4/5;
+}
+
+/*
+ * Apply sg_buffer_full_policy when sg_log_buff is nearly full, must be called with sg_mutex_buffer_async held.
+ * Returns false if the line must be dropped.
+ */
+static bool __make_buffer_space(ScopedLock& _lock, TLogLevel _level) {
+    if (!__is_log_buff_full()) return true;
+
+    // the log thread may be in the middle of a flush, make sure it runs once more.
+    sg_cond_buffer_async.notifyAll(true);
+
+    switch (sg_buffer_full_policy) {
+    case kAppenderBufferFullGrow:
+        if (__flush_to_pending_blocks()) return true;
+        return _level >= sg_buffer_drop_level;
+
+    case kAppenderBufferFullBlock: {
+        ++sg_stalled_lines;
+
+        uint64_t begin = gettickcount();
+        while (NULL != sg_log_buff && !sg_log_close && __is_log_buff_full()) {
+            uint64_t elapsed = gettickcount() - begin;
+            if (elapsed >= kBufferFullWaitTime) break;
+
+            sg_cond_buffer_space.wait(_lock, (long)(kBufferFullWaitTime - elapsed));
+        }
+
+        return NULL != sg_log_buff && !__is_log_buff_full();
+    }
+
+    default:
+        return _level >= sg_buffer_drop_level;
+    }
 }
 
 static void __appender_async(const XLoggerInfo* _info, const char* _log) {
     ScopedLock lock(sg_mutex_buffer_async);
     if (NULL == sg_log_buff) return;
 
-    char temp[16*1024] = {0};       //tell perry,ray if you want modify size.
+    // lines staged by this thread must reach sg_log_buff before the current one.
+    if (sg_thread_staging) __drain_staging_rings();
+
+    char temp[16*1024];       //tell perry,ray if you want modify size. not zeroed, log_formater only reads back what it wrote.
     PtrBuffer log_buff(temp, 0, sizeof(temp));
     log_formater(_info, _log, log_buff);
 
-    if (sg_log_buff->GetData().Length() >= kBufferBlockLength*4/5) {
-       int ret = snprintf(temp, sizeof(temp), "[F][ sg_buffer_async.Length() >= BUFFER_BLOCK_LENTH*4/5, len: %d\n", (int)sg_log_buff->GetData().Length());
-       log_buff.Length(ret, ret);
+    if (!__make_buffer_space(lock, NULL != _info ? _info->level : kLevelFatal)) {
+        ++sg_dropped_lines;
+        return;
     }
 
-    if (!sg_log_buff->Write(log_buff.Ptr(), (unsigned int)log_buff.Length())) return;
+    bool write_success = NULL != _info ? sg_log_buff->Write(log_buff.Ptr(), log_buff.Length(), _info->level, _info->timeval.tv_sec)
+                                       : sg_log_buff->Write(log_buff.Ptr(), log_buff.Length(), -1, 0);
+    if (!write_success) ++sg_dropped_lines;
 
-    if (sg_log_buff->GetData().Length() >= kBufferBlockLength*1/3 || (NULL!=_info && kLevelFatal == _info->level)) {
+    if (write_success && (sg_log_buff->GetData().Length() >= kBufferBlockLength*1/3 || (NULL!=_info && kLevelFatal == _info->level))) {
        sg_cond_buffer_async.notifyAll();
     }
+}
+
+static uint64_t __hash_binary_site(uint64_t _hash, const char* _str) {
+    // FNV-1a, the terminating '\0' is hashed as well so the fields can't run into each other.
+    do {
+        _hash = (_hash ^ (uint8_t)*_str) * 1099511628211ULL;
+    } while ('\0' != *_str++);
+    return _hash;
+}
+
+static long __get_gmtoff(time_t _sec) {
+    static time_t s_sec = 0;
+    static long s_gmtoff = 0;
+
+    if (s_sec != _sec) {
+#ifdef _WIN32
+        s_gmtoff = -_timezone;
+#else
+        tm tm = *localtime(&_sec);
+        s_gmtoff = tm.tm_gmtoff;
+#endif
+        s_sec = _sec;
+    }
+    return s_gmtoff;
+}
+
+static bool __write_binary_record(XLoggerBinaryWriter& _writer, char _type, const XLoggerBinaryWriter& _body) {
+    return _writer.Put(kXLoggerBinaryRecordMagic) && _writer.Put(_type) && _writer.PutVarint(_body.Length()) && _writer.PutBytes(_body.Ptr(), _body.Length());
+}
+
+/*
+ * Write a deferred-format record, must be called with sg_mutex_buffer_async held.
+ * the layout is in xlogger_binary.h.
+ */
+static bool __write_binary_log(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len) {
+    const char* tag = NULL != _info->tag ? _info->tag : "";
+    const char* filename = ExtractFileName(_info->filename);
+
+    uint64_t hash = 14695981039346656037ULL;
+    hash = __hash_binary_site(hash, tag);
+    hash = __hash_binary_site(hash, filename);
+    hash = __hash_binary_site(hash, NULL != _info->func_name ? _info->func_name : "");
+    hash = __hash_binary_site(hash, _format);
+    hash = (hash ^ (uint32_t)_info->line) * 1099511628211ULL;
+
+    std::map<uint64_t, BinaryLogSite>::iterator site = sg_binary_log_sites.find(hash);
+    if (sg_binary_log_sites.end() == site) {
+        if (sg_binary_log_sites.size() >= kMaxBinaryLogSites) return false;
+
+        BinaryLogSite new_site = {(uint32_t)sg_binary_log_sites.size(), NULL, 0};
+        site = sg_binary_log_sites.insert(std::make_pair(hash, new_site)).first;
+    }
+
+    char temp[16 * 1024];
+    XLoggerBinaryWriter record(temp, sizeof(temp));
+
+    // an empty buffer starts a new block on the next Write.
+    bool defined = site->second.defined_buff == sg_log_buff && site->second.defined_block == sg_log_buff->BlockSeq() && 0 != sg_log_buff->GetData().Length();
+    if (!defined) {
+        char func_name[128] = {0};
+        if (NULL != _info->func_name) ExtractFunctionName(_info->func_name, func_name, sizeof(func_name));
+
+        char body_buff[4 * 1024];
+        XLoggerBinaryWriter body(body_buff, sizeof(body_buff));
+        if (!(body.PutVarint(site->second.id) && body.PutVarint((uint32_t)_info->line)
+              && body.PutString(tag, strlen(tag)) && body.PutString(filename, strlen(filename))
+              && body.PutString(func_name, strlen(func_name)) && body.PutString(_format, strlen(_format))
+              && __write_binary_record(record, kXLoggerBinaryRecordSite, body))) {
+            return false;
+        }
+    }
+
+    char body_buff[8 * 1024];
+    XLoggerBinaryWriter body(body_buff, sizeof(body_buff));
+    uint8_t flags = _info->tid == _info->maintid ? 1 : 0;
+    if (!(body.PutVarint(site->second.id) && body.Put((uint8_t)_info->level) && body.Put(flags)
+          && body.PutSigned(_info->timeval.tv_sec) && body.PutVarint(_info->timeval.tv_usec / 1000)
+          && body.PutSigned(__get_gmtoff(_info->timeval.tv_sec)) && body.PutSigned(_info->pid) && body.PutSigned(_info->tid)
+          && body.PutBytes(_args, _len)
+          && __write_binary_record(record, kXLoggerBinaryRecordLog, body) && record.Put('\n'))) {
+        return false;
+    }
 
+    if (!sg_log_buff->Write(record.Ptr(), record.Length(), _info->level, _info->timeval.tv_sec)) return false;
+
+    site->second.defined_buff = sg_log_buff;
+    site->second.defined_block = sg_log_buff->BlockSeq();
+    return true;
+}
+
+static void __appender_async_binary(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len) {
+    ScopedLock lock(sg_mutex_buffer_async);
+    if (NULL == sg_log_buff) return;
+
+    if (sg_thread_staging) __drain_staging_rings();
+
+    if (!__make_buffer_space(lock, _info->level)) {
+        ++sg_dropped_lines;
+        return;
+    }
+
+    if (!__write_binary_log(_info, _format, _args, _len)) {
+        ++sg_dropped_lines;
+        return;
+    }
+
+    if (sg_log_buff->GetData().Length() >= kBufferBlockLength*1/3 || kLevelFatal == _info->level) {
+       sg_cond_buffer_async.notifyAll();
+    }
+}
+
+static void __appender_async_staging(const XLoggerInfo* _info, const char* _log) {
+    LogStagingRing* ring = __get_staging_ring();
+
+    PtrBuffer log_buff;
+    if (!ring->Reserve(sizeof(StagedLineInfo) + kStagingReserveLength, log_buff)) {
+        // ring is full, the locked path drains all rings first, so the order of this thread is kept.
+        sg_cond_buffer_async.notifyAll();
+        __appender_async(_info, _log);
+        return;
+    }
+
+    StagedLineInfo line_info = {NULL != _info ? _info->timeval.tv_sec : 0, NULL != _info ? (int)_info->level : -1};
+    log_buff.Write(&line_info, sizeof(line_info));
+
+    log_formater(_info, _log, log_buff);
+    if (sizeof(line_info) == log_buff.Length()) return;
+
+    ring->Commit(log_buff.Length());
+
+    if (ring->Length() >= ring->Capacity()*1/3 || (NULL!=_info && kLevelFatal == _info->level)) {
+        sg_cond_buffer_async.notifyAll();
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -716,11 +1127,26 @@ void xlogger_appender(const XLoggerInfo* _info, const char* _log) {
 
         if (kAppednerSync == sg_mode)
             __appender_sync(_info, _log);
+        else if (sg_thread_staging)
+            __appender_async_staging(_info, _log);
         else
             __appender_async(_info, _log);
     }
 }
 
+void xlogger_binary_appender(const XLoggerInfo* _info, const char* _format, const void* _args, size_t _len) {
+    if (sg_log_close) return;
+
+    SCOPE_ERRNO();
+    __appender_async_binary(_info, _format, _args, _len);
+}
+
+static void __update_binary_appender() {
+    // records are only understood by the decoder, so text is kept for sync mode and console output.
+    bool enable = sg_binary_log && !sg_log_close && kAppednerAsync == sg_mode && !sg_consolelog_open;
+    xlogger_SetBinaryAppender(enable ? &xlogger_binary_appender : NULL);
+}
+
 #define HEX_STRING  "0123456789abcdef"
 static unsigned int to_string(const void* signature, int len, char* str) {
     char* str_p = str;
@@ -866,6 +1292,27 @@ const char* xlogger_memory_dump(const void* _dumpbuffer, size_t _len) {
     return (const char*)sg_tss_dumpfile.get();
 }
 
+static void __close_log_buff_segments() {
+    for (int i = 0; i < kBufferSegmentCount; ++i) {
+        if (NULL == sg_log_buff_segments[i]) continue;
+
+        if (sg_mmmap_files[i].is_open()) {
+            if (!sg_mmmap_files[i].operator !()) memset(sg_mmmap_files[i].data(), 0, kBufferBlockLength);
+
+            CloseMmapFile(sg_mmmap_files[i]);
+        } else {
+            delete[] (char*)((sg_log_buff_segments[i]->GetData()).Ptr());
+        }
+
+        delete sg_log_buff_segments[i];
+        sg_log_buff_segments[i] = NULL;
+    }
+
+    sg_log_buff = NULL;
+    sg_pending_blocks.Reset();
+    sg_pending_block_stats.clear();
+}
+
 static void get_mark_info(char* _info, size_t _infoLen) {
     struct timeval tv;
     gettimeofday(&tv, 0);
@@ -898,27 +1345,41 @@ void appender_open(TAppenderMode _mode, const char* _dir, const char* _nameprefi
     setAttrProtectionNone(_dir);
 #endif
 
-    char mmap_file_path[512] = {0};
-    snprintf(mmap_file_path, sizeof(mmap_file_path), "%s/%s.mmap3", sg_cache_logdir.empty()?_dir:sg_cache_logdir.c_str(), _nameprefix);
+    bool use_mmap = true;
+    for (int i = 0; i < kBufferSegmentCount; ++i) {
+        // the first segment keeps the old name, so a cache left by an older version is still recovered.
+        char mmap_file_path[512] = {0};
+        if (0 == i) {
+            snprintf(mmap_file_path, sizeof(mmap_file_path), "%s/%s.mmap3", sg_cache_logdir.empty()?_dir:sg_cache_logdir.c_str(), _nameprefix);
+        } else {
+            snprintf(mmap_file_path, sizeof(mmap_file_path), "%s/%s.mmap3.%d", sg_cache_logdir.empty()?_dir:sg_cache_logdir.c_str(), _nameprefix, i);
+        }
 
-    bool use_mmap = false;
-    if (OpenMmapFile(mmap_file_path, kBufferBlockLength, sg_mmmap_file))  {
-        sg_log_buff = new LogBuffer(sg_mmmap_file.data(), kBufferBlockLength, true, _pub_key);
-        use_mmap = true;
-    } else {
-        char* buffer = new char[kBufferBlockLength];
-        sg_log_buff = new LogBuffer(buffer, kBufferBlockLength, true, _pub_key);
-        use_mmap = false;
-    }
+        if (OpenMmapFile(mmap_file_path, kBufferBlockLength, sg_mmmap_files[i]))  {
+            sg_log_buff_segments[i] = new LogBuffer(sg_mmmap_files[i].data(), kBufferBlockLength, kLogCompressNone != sg_compress_mode, _pub_key, sg_compress_level, sg_crypt_mode);
+        } else {
+            char* buffer = new char[kBufferBlockLength];
+            sg_log_buff_segments[i] = new LogBuffer(buffer, kBufferBlockLength, kLogCompressNone != sg_compress_mode, _pub_key, sg_compress_level, sg_crypt_mode);
+            use_mmap = false;
+        }
 
-    if (NULL == sg_log_buff->GetData().Ptr()) {
-        if (use_mmap && sg_mmmap_file.is_open())  CloseMmapFile(sg_mmmap_file);
-        return;
+        if (NULL == sg_log_buff_segments[i]->GetData().Ptr()) {
+            __close_log_buff_segments();
+            return;
+        }
     }
 
-
+    // a segment is emptied as soon as its flush starts, so at most one of them holds logs not written to file.
     AutoBuffer buffer;
-    sg_log_buff->Flush(buffer);
+    std::vector<LogBlockStat> block_stats;
+    for (int i = 0; i < kBufferSegmentCount; ++i) {
+        sg_log_buff_segments[i]->Flush(buffer, block_stats);
+    }
+
+    ScopedLock lock_buffer(sg_mutex_buffer_async);
+    sg_log_buff_index = 0;
+    sg_log_buff = sg_log_buff_segments[0];
+    lock_buffer.unlock();
 
     ScopedLock lock(sg_mutex_log_file);
     sg_logdir = _dir;
@@ -932,7 +1393,7 @@ void appender_open(TAppenderMode _mode, const char* _dir, const char* _nameprefi
 
     if (buffer.Ptr()) {
         __writetips2file("~~~~~ begin of mmap ~~~~~\n");
-        __log2file(buffer.Ptr(), buffer.Length(), false);
+        __log2file(buffer.Ptr(), buffer.Length(), false, block_stats);
         __writetips2file("~~~~~ end of mmap ~~~~~%s\n", mark_info);
     }
 
@@ -952,7 +1413,8 @@ void appender_open(TAppenderMode _mode, const char* _dir, const char* _nameprefi
     xlogger_appender(NULL, "MARS_BUILD_TIME: " MARS_BUILD_TIME);
     xlogger_appender(NULL, "MARS_BUILD_JOB: " MARS_TAG);
 
-    snprintf(logmsg, sizeof(logmsg), "log appender mode:%d, use mmap:%d", (int)_mode, use_mmap);
+    snprintf(logmsg, sizeof(logmsg), "log appender mode:%d, use mmap:%d, compress mode:%d, compress level:%d, crypt mode:%d",
+             (int)_mode, use_mmap, (int)sg_compress_mode, sg_compress_level, (int)sg_crypt_mode);
     xlogger_appender(NULL, logmsg);
     
     if (!sg_cache_logdir.empty()) {
@@ -1003,16 +1465,19 @@ void appender_flush_sync() {
         return;
     }
 
+    ScopedLock lock_flush(sg_mutex_buffer_flush);
     ScopedLock lock_buffer(sg_mutex_buffer_async);
     
     if (NULL == sg_log_buff) return;
 
     AutoBuffer tmp;
-    sg_log_buff->Flush(tmp);
+    std::vector<LogBlockStat> tmp_stats;
+    LogBuffer* full = __switch_log_buff(tmp, tmp_stats);
 
     lock_buffer.unlock();
 
-    if (tmp.Ptr())  __log2file(tmp.Ptr(), tmp.Length(), false);
+    full->Flush(tmp, tmp_stats);
+    if (tmp.Ptr())  __log2file(tmp.Ptr(), tmp.Length(), false, tmp_stats);
 
 }
 
@@ -1026,27 +1491,28 @@ void appender_close() {
     xlogger_appender(NULL, appender_info);
 
     sg_log_close = true;
+    __update_binary_appender();
 
     sg_cond_buffer_async.notifyAll();
+    sg_cond_buffer_space.notifyAll();
 
     if (sg_thread_async.isruning())
         sg_thread_async.join();
 
     
+    ScopedLock flush_lock(sg_mutex_buffer_flush);
     ScopedLock buffer_lock(sg_mutex_buffer_async);
-    if (sg_mmmap_file.is_open()) {
-        if (!sg_mmmap_file.operator !()) memset(sg_mmmap_file.data(), 0, kBufferBlockLength);
-
-        CloseMmapFile(sg_mmmap_file);
-    } else {
-      if (sg_log_buff!=nullptr){
-        delete[] (char*)((sg_log_buff->GetData()).Ptr());
-      }
+    if (NULL != sg_log_buff) {
+        AutoBuffer tmp;
+        std::vector<LogBlockStat> tmp_stats;
+        LogBuffer* full = __switch_log_buff(tmp, tmp_stats);
+        full->Flush(tmp, tmp_stats);
+        if (tmp.Ptr())  __log2file(tmp.Ptr(), tmp.Length(), false, tmp_stats);
     }
 
-    delete sg_log_buff;
-    sg_log_buff = NULL;
+    __close_log_buff_segments();
     buffer_lock.unlock();
+    flush_lock.unlock();
 
     ScopedLock lock(sg_mutex_log_file);
     __closelogfile();
@@ -1054,6 +1520,7 @@ void appender_close() {
 
 void appender_setmode(TAppenderMode _mode) {
     sg_mode = _mode;
+    __update_binary_appender();
 
     sg_cond_buffer_async.notifyAll();
 
@@ -1083,6 +1550,39 @@ bool appender_get_current_log_cache_path(char* _logPath, unsigned int _len) {
 
 void appender_set_console_log(bool _is_open) {
     sg_consolelog_open = _is_open;
+    __update_binary_appender();
+}
+
+void appender_set_binary_log(bool _enable) {
+    sg_binary_log = _enable;
+    __update_binary_appender();
+}
+
+void appender_set_buffer_full_policy(TAppenderBufferFullPolicy _policy, int _drop_level) {
+    ScopedLock lock(sg_mutex_buffer_async);
+    sg_buffer_full_policy = _policy;
+    sg_buffer_drop_level = _drop_level;
+}
+
+void appender_set_buffer_grow_limit(size_t _max_bytes) {
+    ScopedLock lock(sg_mutex_buffer_async);
+    sg_pending_blocks_limit = _max_bytes;
+}
+
+void appender_get_buffer_stat(uint64_t& _dropped_lines, uint64_t& _stalled_lines) {
+    ScopedLock lock(sg_mutex_buffer_async);
+    _dropped_lines = sg_dropped_lines;
+    _stalled_lines = sg_stalled_lines;
+}
+
+void appender_set_thread_staging(bool _enable) {
+    sg_thread_staging = _enable;
+}
+
+void appender_set_codec(TLogCompressMode _compress_mode, int _compress_level, TLogCryptMode _crypt_mode) {
+    sg_compress_mode = _compress_mode;
+    sg_compress_level = (Z_BEST_SPEED <= _compress_level && _compress_level <= Z_BEST_COMPRESSION) ? _compress_level : Z_BEST_COMPRESSION;
+    sg_crypt_mode = _crypt_mode;
 }
 
 void appender_set_max_file_size(uint64_t _max_byte_size) {
@@ -1111,6 +1611,29 @@ bool appender_getfilepath_from_timespan(int _timespan, const char* _prefix, std:
     return true;
 }
 
+bool appender_get_period_logs(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                              const char* _out_path, std::string& _err_msg) {
+    if (NULL == _log_path || NULL == _out_path) return false;
+
+    // the file being written may still have blocks or index entries in the stdio buffers.
+    ScopedLock lock_file(sg_mutex_log_file);
+    if (NULL != sg_logfile) fflush(sg_logfile);
+    if (NULL != sg_logindexfile) fflush(sg_logindexfile);
+    lock_file.unlock();
+
+    FILE* out_file = fopen(_out_path, "wb");
+    if (NULL == out_file) {
+        char msg[256] = {0};
+        snprintf(msg, sizeof(msg), "open out file fail:%s", strerror(errno));
+        _err_msg += msg;
+        return false;
+    }
+
+    bool ret = LogIndex::CopyPeriodLogs(_log_path, _begin_time, _end_time, _min_level, out_file, _err_msg);
+    fclose(out_file);
+    return ret;
+}
+
 bool appender_make_logfile_name(int _timespan, const char* _prefix, std::vector<std::string>& _filepath_vec) {
     if (sg_logdir.empty()) return false;
     
@@ -21,12 +21,15 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <algorithm>
 
 #include "mars/comm/xlogger/xloggerbase.h"
 #include "mars/comm/xlogger/loginfo_extract.h"
 #include "mars/comm/ptrbuffer.h"
+#include "mars/comm/thread/tss.h"
 
 #ifdef _WIN32
 #define PRIdMAX "lld"
@@ -36,6 +39,140 @@
 #include <inttypes.h>
 #endif
 
+static const size_t kMaxHeaderLen = 1024;
+static const size_t kMaxFuncNameLen = 128;
+
+namespace {
+// "2013-03-08 +8.0 12:34:56" of the second last formatted by this thread.
+struct TimeCache {
+    time_t sec;
+    size_t len;
+    char prefix[64];
+};
+}
+
+static Tss sg_tss_time_cache(&free);
+
+static const TimeCache* __get_time_cache(time_t _sec) {
+    TimeCache* cache = (TimeCache*)sg_tss_time_cache.get();
+
+    if (NULL == cache) {
+        cache = (TimeCache*)calloc(1, sizeof(TimeCache));
+        if (NULL == cache) return NULL;
+        sg_tss_time_cache.set(cache);
+    }
+
+    if (0 != cache->len && cache->sec == _sec) return cache;
+
+    tm tm = *localtime((const time_t*)&_sec);
+#ifdef ANDROID
+    int ret = snprintf(cache->prefix, sizeof(cache->prefix), "%d-%02d-%02d %+.1f %02d:%02d:%02d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
+                       tm.tm_gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec);
+#elif _WIN32
+    int ret = snprintf(cache->prefix, sizeof(cache->prefix), "%d-%02d-%02d %+.1f %02d:%02d:%02d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
+                       (-_timezone) / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec);
+#else
+    int ret = snprintf(cache->prefix, sizeof(cache->prefix), "%d-%02d-%02d %+.1f %02d:%02d:%02d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
+                       tm.tm_gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec);
+#endif
+
+    if (ret <= 0 || (size_t)ret >= sizeof(cache->prefix)) return NULL;
+
+    cache->sec = _sec;
+    cache->len = (size_t)ret;
+    return cache;
+}
+
+// the caller guarantees 21 bytes at _out.
+static char* __format_int(intmax_t _value, char* _out) {
+    char temp[24];
+    char* pos = temp + sizeof(temp);
+    uintmax_t value = _value < 0 ? (uintmax_t)0 - (uintmax_t)_value : (uintmax_t)_value;
+
+    do {
+        *--pos = (char)('0' + value % 10);
+        value /= 10;
+    } while (0 != value);
+
+    if (_value < 0) *--pos = '-';
+
+    size_t len = temp + sizeof(temp) - pos;
+    memcpy(_out, pos, len);
+    return _out + len;
+}
+
+static char* __append(char* _pos, const char* _end, const char* _str, size_t _len) {
+    if (_pos >= _end) return _pos;
+
+    size_t len = std::min(_len, (size_t)(_end - _pos));
+    memcpy(_pos, _str, len);
+    return _pos + len;
+}
+
+static char* __append(char* _pos, const char* _end, const char* _str) {
+    if (_pos >= _end) return _pos;
+
+    return __append(_pos, _end, _str, strnlen(_str, _end - _pos));
+}
+
+/*
+ * Same output as "[%s][%s][%" PRIdMAX ", %" PRIdMAX "%s][%s][%s, %s, %d][" with the time part
+ * "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d", but localtime and snprintf only run once per second per thread,
+ * everything else is copied straight into _dst. Returns the header length, never more than kMaxHeaderLen.
+ */
+static size_t __format_header(const XLoggerInfo* _info, const char* _level, char* _dst) {
+    // keeps room for the integers and separators below, strings are cut at this point.
+    const char* end = _dst + kMaxHeaderLen - 64;
+    char* pos = _dst;
+
+    *pos++ = '[';
+    pos = __append(pos, end, _level);
+    *pos++ = ']';
+    *pos++ = '[';
+
+    if (0 != _info->timeval.tv_sec) {
+        const TimeCache* cache = __get_time_cache(_info->timeval.tv_sec);
+        if (NULL != cache) {
+            pos = __append(pos, end, cache->prefix, cache->len);
+
+            int msec = (int)(_info->timeval.tv_usec / 1000);
+            *pos++ = '.';
+            *pos++ = (char)('0' + msec / 100 % 10);
+            *pos++ = (char)('0' + msec / 10 % 10);
+            *pos++ = (char)('0' + msec % 10);
+        }
+    }
+
+    *pos++ = ']';
+    *pos++ = '[';
+    pos = __format_int(_info->pid, pos);
+    *pos++ = ',';
+    *pos++ = ' ';
+    pos = __format_int(_info->tid, pos);
+    if (_info->tid == _info->maintid) *pos++ = '*';
+    *pos++ = ']';
+    *pos++ = '[';
+    pos = __append(pos, end, _info->tag ? _info->tag : "");
+    *pos++ = ']';
+    *pos++ = '[';
+    pos = __append(pos, end, ExtractFileName(_info->filename));
+    *pos++ = ',';
+    *pos++ = ' ';
+
+    if (NULL != _info->func_name && (size_t)(end - pos) >= kMaxFuncNameLen) {
+        ExtractFunctionName(_info->func_name, pos, (int)kMaxFuncNameLen);
+        pos += strnlen(pos, kMaxFuncNameLen);
+    }
+
+    *pos++ = ',';
+    *pos++ = ' ';
+    pos = __format_int(_info->line, pos);
+    *pos++ = ']';
+    *pos++ = '[';
+
+    return pos - _dst;
+}
+
 void log_formater(const XLoggerInfo* _info, const char* _logbody, PtrBuffer& _log) {
     static const char* levelStrings[] = {
         "V",
@@ -69,36 +206,8 @@ void log_formater(const XLoggerInfo* _info, const char* _logbody, PtrBuffer& _lo
     }
 
     if (NULL != _info) {
-        const char* filename = ExtractFileName(_info->filename);
-        char strFuncName [128] = {0};
-        ExtractFunctionName(_info->func_name, strFuncName, sizeof(strFuncName));
-
-        char temp_time[64] = {0};
-
-        if (0 != _info->timeval.tv_sec) {
-            time_t sec = _info->timeval.tv_sec;
-            tm tm = *localtime((const time_t*)&sec);
-#ifdef ANDROID
-            snprintf(temp_time, sizeof(temp_time), "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3ld", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
-                     tm.tm_gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, _info->timeval.tv_usec / 1000);
-#elif _WIN32
-            snprintf(temp_time, sizeof(temp_time), "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
-                     (-_timezone) / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, _info->timeval.tv_usec / 1000);
-#else
-            snprintf(temp_time, sizeof(temp_time), "%d-%02d-%02d %+.1f %02d:%02d:%02d.%.3d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
-                     tm.tm_gmtoff / 3600.0, tm.tm_hour, tm.tm_min, tm.tm_sec, _info->timeval.tv_usec / 1000);
-#endif
-        }
-
-        // _log.AllocWrite(30*1024, false);
-        int ret = snprintf((char*)_log.PosPtr(), 1024, "[%s][%s][%" PRIdMAX ", %" PRIdMAX "%s][%s][%s, %s, %d][",  // **CPPLINT SKIP**
-                           _logbody ? levelStrings[_info->level] : levelStrings[kLevelFatal], temp_time,
-                           _info->pid, _info->tid, _info->tid == _info->maintid ? "*" : "", _info->tag ? _info->tag : "",
-                           filename, strFuncName, _info->line);
-
-        assert(0 <= ret);
-        _log.Length(_log.Pos() + ret, _log.Length() + ret);
-        //      memcpy((char*)_log.PosPtr() + 1, "\0", 1);
+        size_t len = __format_header(_info, _logbody ? levelStrings[_info->level] : levelStrings[kLevelFatal], (char*)_log.PosPtr());
+        _log.Length(_log.Pos() + len, _log.Length() + len);
 
         assert((unsigned int)_log.Pos() == _log.Length());
     }
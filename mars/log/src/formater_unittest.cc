@@ -0,0 +1,51 @@
+#include "mars/comm/xlogger/xloggerbase.h"
+#include "mars/comm/ptrbuffer.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+using namespace testing;
+
+void log_formater(const XLoggerInfo* _info, const char* _logbody, PtrBuffer& _log);
+
+static std::string format_line(const XLoggerInfo& _info, const char* _body) {
+    char buffer[16 * 1024];
+    PtrBuffer log(buffer, 0, sizeof(buffer));
+    log_formater(&_info, _body, log);
+    return std::string(buffer, log.Length());
+}
+
+TEST(formater, header) {
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    XLoggerInfo info;
+    memset(&info, 0, sizeof(info));
+    info.level = kLevelWarn;
+    info.tag = "stn";
+    info.filename = "/mars/stn/src/longlink.cc";
+    info.func_name = "void mars::stn::LongLink::__Run()";
+    info.line = 42;
+    info.pid = 123;
+    info.tid = -7;
+    info.maintid = -7;
+    info.timeval.tv_sec = 1792224059;   // 2026-10-17 08:00:59 UTC
+    info.timeval.tv_usec = 5999;
+
+    EXPECT_EQ("[W][2026-10-17 +0.0 08:00:59.005][123, -7*][stn][longlink.cc, __Run, 42][hello\n", format_line(info, "hello"));
+
+    // the cached second must not leak into the next one.
+    info.timeval.tv_sec += 1;
+    info.timeval.tv_usec = 999999;
+    info.maintid = 0;
+    info.tag = NULL;
+    EXPECT_EQ("[W][2026-10-17 +0.0 08:01:00.999][123, -7][][longlink.cc, __Run, 42][hello\n", format_line(info, "hello\n"));
+
+    info.timeval.tv_sec = 0;
+    EXPECT_EQ("[F][][123, -7][][longlink.cc, __Run, 42][error!! NULL==_logbody\n", format_line(info, NULL));
+}
+
+EXPORT_GTEST_SYMBOLS(log_export_formater_unittest)
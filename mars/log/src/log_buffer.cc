@@ -34,13 +34,16 @@
 #define snprintf _snprintf
 #endif
 
+static const size_t kWriteReserveLength = 64;   // a sync flush of deflate and the cipher's unaligned remainder
+
 
 bool LogBuffer::GetPeriodLogs(const char* _log_path, int _begin_hour, int _end_hour, unsigned long& _begin_pos, unsigned long& _end_pos, std::string& _err_msg) {
     return LogCrypt::GetPeriodLogs(_log_path, _begin_hour, _end_hour, _begin_pos, _end_pos, _err_msg);
 }
 
-LogBuffer::LogBuffer(void* _pbuffer, size_t _len, bool _isCompress, const char* _pubkey)
-: is_compress_(_isCompress), log_crypt_(new LogCrypt(_pubkey)), remain_nocrypt_len_(0) {
+LogBuffer::LogBuffer(void* _pbuffer, size_t _len, bool _isCompress, const char* _pubkey, int _compress_level, TLogCryptMode _crypt_mode)
+: is_compress_(_isCompress), compress_level_(_compress_level), log_crypt_(new LogCrypt(_pubkey, _crypt_mode)), remain_nocrypt_len_(0), block_seq_(0) {
+    memset(&block_stat_, 0, sizeof(block_stat_));
     buff_.Attach(_pbuffer, _len);
     __Fix();
 
@@ -62,7 +65,7 @@ PtrBuffer& LogBuffer::GetData() {
 }
 
 
-void LogBuffer::Flush(AutoBuffer& _buff) {
+void LogBuffer::Flush(AutoBuffer& _buff, std::vector<LogBlockStat>& _block_stats) {
     
     if (is_compress_ && Z_NULL != cstream_.state) {
         deflateEnd(&cstream_);
@@ -75,6 +78,7 @@ void LogBuffer::Flush(AutoBuffer& _buff) {
     
     __Flush();
     _buff.Write(buff_.Ptr(), buff_.Length());
+    _block_stats.push_back(block_stat_);
     __Clear();
 }
 
@@ -89,7 +93,7 @@ bool LogBuffer::Write(const void* _data, size_t _inputlen, AutoBuffer& _out_buff
 }
 
 
-bool LogBuffer::Write(const void* _data, size_t _length) {
+bool LogBuffer::Write(const void* _data, size_t _length, int _level, time_t _time) {
     if (NULL == _data || 0 == _length) {
         return false;
     }
@@ -98,6 +102,11 @@ bool LogBuffer::Write(const void* _data, size_t _length) {
         if (!__Reset()) return false;
     }
 
+    // the line is refused whole unless it fits with deflate's worst case and the tailer Flush() adds, a partial one breaks the block.
+    if (buff_.Length() + _length + _length / 1024 + kWriteReserveLength + log_crypt_->GetTailerLen() > buff_.MaxLength()) {
+        return false;
+    }
+
     size_t before_len = buff_.Length();
     size_t write_len = _length;
     
@@ -131,6 +140,12 @@ bool LogBuffer::Write(const void* _data, size_t _length) {
    
     log_crypt_->UpdateLogLen((char*)buff_.Ptr(), (uint32_t)(out_buffer.Length() - last_remain_len));
 
+    if (0 <= _level && _level < kLogBlockLevelCount) ++block_stat_.level_count[_level];
+    if (0 < _time) {
+        if (0 == block_stat_.begin_time || _time < block_stat_.begin_time) block_stat_.begin_time = _time;
+        if (_time > block_stat_.end_time) block_stat_.end_time = _time;
+    }
+
     return true;
 }
 
@@ -143,14 +158,16 @@ bool LogBuffer::__Reset() {
         cstream_.zfree = Z_NULL;
         cstream_.opaque = Z_NULL;
         
-        if (Z_OK != deflateInit2(&cstream_, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY)) {
+        if (Z_OK != deflateInit2(&cstream_, compress_level_, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY)) {
             return false;
         }
         
     }
     
-    log_crypt_->SetHeaderInfo((char*)buff_.Ptr(), is_compress_);
-    buff_.Length(log_crypt_->GetHeaderLen(), log_crypt_->GetHeaderLen());
+    log_crypt_->SetHeaderInfo((char*)buff_.Ptr(), true, is_compress_);
+    // the crypt stage may put a prefix (e.g. chacha20 nonce) in front of the data.
+    size_t len = log_crypt_->GetHeaderLen() + log_crypt_->GetLogLen((char*)buff_.Ptr(), buff_.MaxLength());
+    buff_.Length(len, len);
 
     return true;
 }
@@ -168,6 +185,8 @@ void LogBuffer::__Clear() {
     memset(buff_.Ptr(), 0, buff_.Length());
     buff_.Length(0, 0);
     remain_nocrypt_len_ = 0;
+    ++block_seq_;
+    memset(&block_stat_, 0, sizeof(block_stat_));
 }
 
 
@@ -23,15 +23,20 @@
 #include <zlib.h>
 #include <string>
 #include <stdint.h>
+#include <time.h>
+#include <vector>
 
 #include "mars/comm/ptrbuffer.h"
 #include "mars/comm/autobuffer.h"
+#include "mars/log/appender.h"
+#include "log_index.h"
 
 class LogCrypt;
 
 class LogBuffer {
 public:
-    LogBuffer(void* _pbuffer, size_t _len, bool _is_compress, const char* _pubkey);
+    LogBuffer(void* _pbuffer, size_t _len, bool _is_compress, const char* _pubkey,
+              int _compress_level = Z_BEST_COMPRESSION, TLogCryptMode _crypt_mode = kLogCryptTea);
     ~LogBuffer();
     
 public:
@@ -39,10 +44,14 @@ public:
 
 public:
     PtrBuffer& GetData();
+    // changes every time the buffer is flushed, so the next Write starts a new block.
+    uint32_t BlockSeq() const { return block_seq_; }
     
-    void Flush(AutoBuffer& _buff);
+    // the stat of the flushed block (if any) is appended to _block_stats.
+    void Flush(AutoBuffer& _buff, std::vector<LogBlockStat>& _block_stats);
     bool Write(const void* _data, size_t _inputlen, AutoBuffer& _out_buff);
-    bool Write(const void* _data, size_t _length);
+    // _level and _time only go to the stat of the block, pass -1 and 0 for lines without them.
+    bool Write(const void* _data, size_t _length, int _level, time_t _time);
 
 private:
     
@@ -55,10 +64,13 @@ private:
 private:
     PtrBuffer buff_;
     bool is_compress_;
+    int compress_level_;
     z_stream cstream_;
     
     class LogCrypt* log_crypt_;
     size_t remain_nocrypt_len_;
+    uint32_t block_seq_;
+    LogBlockStat block_stat_;
 
 };
 
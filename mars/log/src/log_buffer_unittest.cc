@@ -0,0 +1,68 @@
+#include "log_buffer.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "log/crypt/log_crypt.h"
+
+using namespace testing;
+
+static const size_t kTestBufferLength = 8 * 1024;
+static const size_t kGuardLength = 256;
+
+// lines that don't compress, so a block fills in a handful of them.
+static std::string random_line(unsigned int _seed, size_t _len) {
+    std::string line(_len, '\0');
+    for (size_t i = 0; i < _len; ++i) {
+        _seed = _seed * 1103515245 + 12345;
+        line[i] = (char)(_seed >> 16);
+    }
+    return line;
+}
+
+static void fill_until_refused(bool _compress) {
+    std::vector<char> memory(kTestBufferLength + kGuardLength, (char)0x5a);
+    {
+        LogBuffer buffer(&memory[0], kTestBufferLength, _compress, "", 6);
+
+        size_t written = 0;
+        for (unsigned int i = 0; i < 64; ++i) {
+            if (!buffer.Write(random_line(i, 700).data(), 700, 2, 1)) break;
+            ++written;
+            EXPECT_GE(kTestBufferLength, buffer.GetData().Length());
+        }
+        EXPECT_LT(0u, written);
+        EXPECT_GT(64u, written);
+
+        // a refused line leaves the block whole, and the tailer still fits.
+        size_t length = buffer.GetData().Length();
+        EXPECT_FALSE(buffer.Write(random_line(99, 700).data(), 700, 2, 1));
+        EXPECT_EQ(length, buffer.GetData().Length());
+
+        AutoBuffer flushed;
+        std::vector<LogBlockStat> stats;
+        buffer.Flush(flushed, stats);
+        EXPECT_EQ(length + LogCrypt::GetTailerLen(), flushed.Length());
+        ASSERT_EQ(1u, stats.size());
+        EXPECT_EQ(written, (size_t)stats[0].level_count[2]);
+
+        // the next block starts over empty.
+        EXPECT_TRUE(buffer.Write(random_line(100, 700).data(), 700, 2, 1));
+    }
+
+    for (size_t i = kTestBufferLength; i < memory.size(); ++i) {
+        ASSERT_EQ((char)0x5a, memory[i]) << "written past the buffer at " << i;
+    }
+}
+
+TEST(log_buffer, full_refuses_whole_line_compress) {
+    fill_until_refused(true);
+}
+
+TEST(log_buffer, full_refuses_whole_line_nocompress) {
+    fill_until_refused(false);
+}
+
+EXPORT_GTEST_SYMBOLS(log_export_log_buffer_unittest)
@@ -0,0 +1,291 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_index.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "log_index.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log/crypt/log_crypt.h"
+
+#ifdef WIN32
+#define snprintf _snprintf
+#endif
+
+static const uint32_t kIndexMagic = 0x58444958;     // "XIDX"
+static const uint32_t kIndexVersion = 1;
+static const long kIndexHeaderLen = sizeof(kIndexMagic) + sizeof(kIndexVersion);
+static const char* const kLogExt = ".xlog";
+static const char* const kIndexExt = ".xidx";
+
+static bool __read_entry(FILE* _file, long _index, LogIndexEntry& _entry) {
+    if (0 != fseek(_file, kIndexHeaderLen + _index * (long)sizeof(LogIndexEntry), SEEK_SET)) return false;
+    return 1 == fread(&_entry, sizeof(_entry), 1, _file);
+}
+
+static bool __is_selected(const LogIndexEntry& _entry, time_t _begin_time, time_t _end_time, int _min_level) {
+    if (0 != _entry.stat.begin_time && (_entry.stat.end_time < _begin_time || _entry.stat.begin_time > _end_time)) {
+        return false;
+    }
+
+    if (_min_level <= 0) return true;
+
+    bool has_level = false;
+    for (int i = 0; i < kLogBlockLevelCount; ++i) {
+        if (0 == _entry.stat.level_count[i]) continue;
+        if (i >= _min_level) return true;
+        has_level = true;
+    }
+
+    // levels are unknown when no line was counted.
+    return !has_level;
+}
+
+static bool __check_block(FILE* _file, const LogIndexEntry& _entry) {
+    char header[128];
+    uint32_t header_len = LogCrypt::GetHeaderLen();
+    if (header_len > sizeof(header)) return false;
+
+    if (0 != fseek(_file, (long)_entry.offset, SEEK_SET)) return false;
+    if (header_len != fread(header, 1, header_len, _file)) return false;
+
+    uint32_t log_len = LogCrypt::GetLogLen(header, header_len);
+    return 0 != log_len && _entry.length == header_len + log_len + LogCrypt::GetTailerLen()
+        && _entry.seq == LogCrypt::GetLogSeq(header, header_len);
+}
+
+static void __add_range(std::vector<std::pair<uint64_t, uint64_t> >& _ranges, uint64_t _begin, uint64_t _end) {
+    if (_begin >= _end) return;
+
+    if (!_ranges.empty() && _ranges.back().second == _begin) {
+        _ranges.back().second = _end;
+        return;
+    }
+    _ranges.push_back(std::make_pair(_begin, _end));
+}
+
+std::string LogIndex::GetIndexPath(const std::string& _log_path) {
+    size_t ext_len = strlen(kLogExt);
+    if (_log_path.size() > ext_len && 0 == _log_path.compare(_log_path.size() - ext_len, ext_len, kLogExt)) {
+        return _log_path.substr(0, _log_path.size() - ext_len) + kIndexExt;
+    }
+    return _log_path + kIndexExt;
+}
+
+FILE* LogIndex::Open(const std::string& _log_path, uint64_t _log_size) {
+    std::string index_path = GetIndexPath(_log_path);
+
+    FILE* file = fopen(index_path.c_str(), "rb+");
+    if (NULL == file) file = fopen(index_path.c_str(), "wb+");
+    if (NULL == file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+
+    uint32_t header[2] = {0};
+    bool valid = file_size >= kIndexHeaderLen && 0 == fseek(file, 0, SEEK_SET) && 1 == fread(header, sizeof(header), 1, file)
+                 && kIndexMagic == header[0] && kIndexVersion == header[1];
+
+    long count = valid ? (file_size - kIndexHeaderLen) / (long)sizeof(LogIndexEntry) : 0;
+
+    // the xlog file may have been removed and written again, entries beyond it are stale.
+    LogIndexEntry entry;
+    while (count > 0 && (!__read_entry(file, count - 1, entry) || entry.offset + entry.length > _log_size)) {
+        --count;
+    }
+
+    long len = kIndexHeaderLen + count * (long)sizeof(LogIndexEntry);
+    if (!valid || len != file_size) {
+        if (0 != ftruncate(fileno(file), valid ? len : 0)) {
+            fclose(file);
+            return NULL;
+        }
+    }
+
+    if (!valid) {
+        header[0] = kIndexMagic;
+        header[1] = kIndexVersion;
+        fseek(file, 0, SEEK_SET);
+        if (1 != fwrite(header, sizeof(header), 1, file)) {
+            fclose(file);
+            return NULL;
+        }
+    }
+
+    fseek(file, 0, SEEK_END);
+    return file;
+}
+
+bool LogIndex::Append(FILE* _index_file, const void* _data, size_t _len, uint64_t _offset,
+                      const LogBlockStat* _stats, size_t _stat_count) {
+    if (NULL == _index_file || NULL == _data) return false;
+
+    const char* data = (const char*)_data;
+    size_t header_len = LogCrypt::GetHeaderLen();
+    size_t tailer_len = LogCrypt::GetTailerLen();
+    size_t pos = 0;
+    size_t stat_index = 0;
+
+    while (pos + header_len + tailer_len <= _len) {
+        uint32_t log_len = LogCrypt::GetLogLen(data + pos, _len - pos);
+        size_t block_len = header_len + log_len + tailer_len;
+        if (0 == log_len || pos + block_len > _len) break;
+
+        LogIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.offset = _offset + pos;
+        entry.length = (uint32_t)block_len;
+        entry.seq = LogCrypt::GetLogSeq(data + pos, _len - pos);
+        if (stat_index < _stat_count) entry.stat = _stats[stat_index++];
+
+        if (1 != fwrite(&entry, sizeof(entry), 1, _index_file)) return false;
+        pos += block_len;
+    }
+
+    return true;
+}
+
+bool LogIndex::Merge(const std::string& _src_log_path, const std::string& _dst_log_path, uint64_t _dst_log_size) {
+    std::vector<LogIndexEntry> entries;
+    bool ret = Load(_src_log_path, entries);
+    remove(GetIndexPath(_src_log_path).c_str());
+    if (!ret || entries.empty()) return ret;
+
+    FILE* file = Open(_dst_log_path, _dst_log_size);
+    if (NULL == file) return false;
+
+    for (std::vector<LogIndexEntry>::iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+        iter->offset += _dst_log_size;
+    }
+
+    ret = entries.size() == fwrite(&entries[0], sizeof(LogIndexEntry), entries.size(), file);
+    fclose(file);
+    return ret;
+}
+
+bool LogIndex::Load(const std::string& _log_path, std::vector<LogIndexEntry>& _entries) {
+    FILE* file = fopen(GetIndexPath(_log_path).c_str(), "rb");
+    if (NULL == file) return false;
+
+    uint32_t header[2] = {0};
+    if (1 != fread(header, sizeof(header), 1, file) || kIndexMagic != header[0] || kIndexVersion != header[1]) {
+        fclose(file);
+        return false;
+    }
+
+    LogIndexEntry entries[256];
+    size_t count = 0;
+    while (0 < (count = fread(entries, sizeof(LogIndexEntry), sizeof(entries) / sizeof(entries[0]), file))) {
+        _entries.insert(_entries.end(), entries, entries + count);
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool LogIndex::GetPeriodBlocks(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                               std::vector<std::pair<uint64_t, uint64_t> >& _ranges, std::string& _err_msg) {
+    char msg[1024] = {0};
+
+    if (NULL == _log_path || _end_time < _begin_time) {
+        snprintf(msg, sizeof(msg), "NULL == _log_path || _end_time < _begin_time, %ld, %ld", (long)_begin_time, (long)_end_time);
+        _err_msg += msg;
+        return false;
+    }
+
+    FILE* file = fopen(_log_path, "rb");
+    if (NULL == file) {
+        snprintf(msg, sizeof(msg), "open file fail:%s", strerror(errno));
+        _err_msg += msg;
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    uint64_t file_size = (uint64_t)ftell(file);
+
+    std::vector<LogIndexEntry> entries;
+    Load(_log_path, entries);
+
+    // skipped entries are trusted, the ones to copy are checked against the block header.
+    uint64_t pos = 0;
+    for (std::vector<LogIndexEntry>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+        const LogIndexEntry& entry = *iter;
+        if (entry.offset < pos || entry.offset + entry.length > file_size) continue;
+
+        if (!__is_selected(entry, _begin_time, _end_time, _min_level)) {
+            __add_range(_ranges, pos, entry.offset);
+            pos = entry.offset + entry.length;
+            continue;
+        }
+
+        // an unexpected block is left to the range before the next valid entry.
+        if (!__check_block(file, entry)) continue;
+
+        __add_range(_ranges, pos, entry.offset + entry.length);
+        pos = entry.offset + entry.length;
+    }
+    __add_range(_ranges, pos, file_size);
+
+    fclose(file);
+    return true;
+}
+
+bool LogIndex::CopyPeriodLogs(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                              FILE* _out_file, std::string& _err_msg) {
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;
+    if (NULL == _out_file || !GetPeriodBlocks(_log_path, _begin_time, _end_time, _min_level, ranges, _err_msg)) {
+        return false;
+    }
+
+    FILE* file = fopen(_log_path, "rb");
+    if (NULL == file) {
+        char msg[256] = {0};
+        snprintf(msg, sizeof(msg), "open file fail:%s", strerror(errno));
+        _err_msg += msg;
+        return false;
+    }
+
+    char buffer[16 * 1024];
+    bool ret = true;
+    for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator iter = ranges.begin(); ret && iter != ranges.end(); ++iter) {
+        if (0 != fseek(file, (long)iter->first, SEEK_SET)) {
+            ret = false;
+            break;
+        }
+
+        uint64_t remain = iter->second - iter->first;
+        while (remain > 0) {
+            size_t len = remain < sizeof(buffer) ? (size_t)remain : sizeof(buffer);
+            if (len != fread(buffer, 1, len, file) || len != fwrite(buffer, 1, len, _out_file)) {
+                ret = false;
+                break;
+            }
+            remain -= len;
+        }
+    }
+
+    fclose(file);
+
+    if (!ret) {
+        char msg[256] = {0};
+        snprintf(msg, sizeof(msg), "copy period logs error:%s", strerror(errno));
+        _err_msg += msg;
+    }
+    return ret;
+}
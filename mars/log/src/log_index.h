@@ -0,0 +1,83 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_index.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef LOG_INDEX_H_
+#define LOG_INDEX_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+static const int kLogBlockLevelCount = 6;  // kLevelVerbose ~ kLevelFatal
+
+/*
+ * What a block holds, collected by LogBuffer while the block is being written.
+ * begin_time is 0 when no line of the block had a time (e.g. tips, blocks recovered from mmap).
+ */
+struct LogBlockStat {
+    int64_t begin_time;
+    int64_t end_time;
+    uint32_t level_count[kLogBlockLevelCount];
+};
+
+/*
+ * One entry of the sidecar index, written in file order as blocks are appended to the xlog file.
+ */
+struct LogIndexEntry {
+    uint64_t offset;        // of the block header in the xlog file
+    uint32_t length;        // header + data + tailer
+    uint16_t seq;
+    uint16_t reserved;
+    LogBlockStat stat;
+};
+
+/*
+ * Sidecar index of an xlog file, "xxx_20261017.xlog" is indexed by "xxx_20261017.xidx".
+ *  |magic(uint32_t)|version(uint32_t)|LogIndexEntry|LogIndexEntry|...
+ * The index is only a hint: entries are checked against the block headers before use,
+ * and any part of the xlog file not covered by a valid entry is treated as matching every query.
+ */
+class LogIndex {
+  public:
+    static std::string GetIndexPath(const std::string& _log_path);
+
+    // opens the index of _log_path for appending, entries past _log_size are from an older file and dropped.
+    static FILE* Open(const std::string& _log_path, uint64_t _log_size);
+    // appends an entry for every complete block in _data, which is written at _offset, _stats are in block order.
+    static bool Append(FILE* _index_file, const void* _data, size_t _len, uint64_t _offset,
+                       const LogBlockStat* _stats, size_t _stat_count);
+    // appends the entries of _src_log_path to the index of _dst_log_path, _dst_log_size is its size before the copy.
+    static bool Merge(const std::string& _src_log_path, const std::string& _dst_log_path, uint64_t _dst_log_size);
+
+    static bool Load(const std::string& _log_path, std::vector<LogIndexEntry>& _entries);
+
+    /*
+     * Find the byte ranges [first, second) of _log_path which may hold logs between _begin_time and _end_time
+     * with at least one line at or above _min_level. Adjacent ranges are merged.
+     */
+    static bool GetPeriodBlocks(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                                std::vector<std::pair<uint64_t, uint64_t> >& _ranges, std::string& _err_msg);
+    // copies the ranges found by GetPeriodBlocks to _out_file, the result is a regular xlog file.
+    static bool CopyPeriodLogs(const char* _log_path, time_t _begin_time, time_t _end_time, int _min_level,
+                               FILE* _out_file, std::string& _err_msg);
+};
+
+#endif /* LOG_INDEX_H_ */
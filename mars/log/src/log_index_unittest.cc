@@ -0,0 +1,124 @@
+#include "log_index.h"
+#include "log_buffer.h"
+#include "mars/comm/xlogger/xloggerbase.h"
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+static const char* kLogPath = "./log_index_unittest.xlog";
+
+static void write_block(LogBuffer& _log_buff, FILE* _file, FILE* _index_file, const char* _line, int _level, time_t _time) {
+    ASSERT_TRUE(_log_buff.Write(_line, strlen(_line), _level, _time));
+
+    AutoBuffer block;
+    std::vector<LogBlockStat> stats;
+    _log_buff.Flush(block, stats);
+    ASSERT_EQ(1u, stats.size());
+
+    uint64_t offset = (uint64_t)ftell(_file);
+    ASSERT_EQ(1u, fwrite(block.Ptr(), block.Length(), 1, _file));
+    ASSERT_TRUE(LogIndex::Append(_index_file, block.Ptr(), block.Length(), offset, &stats[0], stats.size()));
+}
+
+TEST(log_index, period_blocks) {
+    remove(kLogPath);
+    remove(LogIndex::GetIndexPath(kLogPath).c_str());
+    EXPECT_EQ("./log_index_unittest.xidx", LogIndex::GetIndexPath(kLogPath));
+
+    char buffer[16 * 1024];
+    LogBuffer log_buff(buffer, sizeof(buffer), false, "");
+
+    FILE* file = fopen(kLogPath, "wb");
+    FILE* index_file = LogIndex::Open(kLogPath, 0);
+    ASSERT_TRUE(NULL != file && NULL != index_file);
+
+    write_block(log_buff, file, index_file, "[I] first\n", kLevelInfo, 100);
+    write_block(log_buff, file, index_file, "[E] second\n", kLevelError, 200);
+    write_block(log_buff, file, index_file, "[I] third\n", kLevelInfo, 300);
+    uint64_t file_size = (uint64_t)ftell(file);
+    fclose(index_file);
+    fclose(file);
+
+    std::vector<LogIndexEntry> entries;
+    ASSERT_TRUE(LogIndex::Load(kLogPath, entries));
+    ASSERT_EQ(3u, entries.size());
+    EXPECT_EQ(200, entries[1].stat.begin_time);
+    EXPECT_EQ(1u, entries[1].stat.level_count[kLevelError]);
+
+    std::string err;
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;
+    ASSERT_TRUE(LogIndex::GetPeriodBlocks(kLogPath, 150, 250, kLevelAll, ranges, err));
+    ASSERT_EQ(1u, ranges.size());
+    EXPECT_EQ(entries[1].offset, ranges[0].first);
+    EXPECT_EQ(entries[2].offset, ranges[0].second);
+
+    ranges.clear();
+    ASSERT_TRUE(LogIndex::GetPeriodBlocks(kLogPath, 0, 1000, kLevelWarn, ranges, err));
+    ASSERT_EQ(1u, ranges.size());
+    EXPECT_EQ(entries[1].offset, ranges[0].first);
+
+    // the log file is shorter than the index says, the entries past it are stale.
+    index_file = LogIndex::Open(kLogPath, entries[1].offset);
+    ASSERT_TRUE(NULL != index_file);
+    fclose(index_file);
+    std::vector<LogIndexEntry> left_entries;
+    ASSERT_TRUE(LogIndex::Load(kLogPath, left_entries));
+    EXPECT_EQ(1u, left_entries.size());
+
+    // not covered by the index any more, so always included.
+    ranges.clear();
+    ASSERT_TRUE(LogIndex::GetPeriodBlocks(kLogPath, 150, 250, kLevelAll, ranges, err));
+    ASSERT_EQ(1u, ranges.size());
+    EXPECT_EQ(entries[1].offset, ranges[0].first);
+    EXPECT_EQ(file_size, ranges[0].second);
+
+    remove(kLogPath);
+    remove(LogIndex::GetIndexPath(kLogPath).c_str());
+}
+
+// sync mode doesn't index its blocks, such a gap is copied with whatever range is next to it.
+TEST(log_index, unindexed_gap) {
+    remove(kLogPath);
+    remove(LogIndex::GetIndexPath(kLogPath).c_str());
+
+    char buffer[16 * 1024];
+    LogBuffer log_buff(buffer, sizeof(buffer), false, "");
+
+    FILE* file = fopen(kLogPath, "wb");
+    FILE* index_file = LogIndex::Open(kLogPath, 0);
+    ASSERT_TRUE(NULL != file && NULL != index_file);
+
+    write_block(log_buff, file, index_file, "[I] async\n", kLevelInfo, 100);
+    uint64_t gap_begin = (uint64_t)ftell(file);
+
+    ASSERT_TRUE(log_buff.Write("[I] sync\n", strlen("[I] sync\n"), kLevelInfo, 200));
+    AutoBuffer block;
+    std::vector<LogBlockStat> stats;
+    log_buff.Flush(block, stats);
+    ASSERT_EQ(1u, fwrite(block.Ptr(), block.Length(), 1, file));
+
+    write_block(log_buff, file, index_file, "[I] async again\n", kLevelInfo, 300);
+    uint64_t file_size = (uint64_t)ftell(file);
+    fclose(index_file);
+    fclose(file);
+
+    std::vector<LogIndexEntry> entries;
+    ASSERT_TRUE(LogIndex::Load(kLogPath, entries));
+    ASSERT_EQ(2u, entries.size());
+
+    std::string err;
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;
+    ASSERT_TRUE(LogIndex::GetPeriodBlocks(kLogPath, 250, 350, kLevelAll, ranges, err));
+    ASSERT_EQ(1u, ranges.size());
+    EXPECT_EQ(gap_begin, ranges[0].first);
+    EXPECT_EQ(file_size, ranges[0].second);
+
+    remove(kLogPath);
+    remove(LogIndex::GetIndexPath(kLogPath).c_str());
+}
+
+EXPORT_GTEST_SYMBOLS(log_export_log_index_unittest)
@@ -0,0 +1,131 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_staging_ring.cc
+ *
+ *  Created on: 2026-10-17
+ */
+
+#include "log_staging_ring.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include "mars/comm/thread/atomic_oper.h"
+
+static const uint32_t kRecordHeaderLen = sizeof(uint32_t);
+static const uint32_t kWrapMarker = 0xFFFFFFFF;
+
+static uint32_t __align4(size_t _len) {
+    return (uint32_t)((_len + 3) & ~(size_t)3);
+}
+
+static uint32_t __round_capacity(size_t _capacity) {
+    uint32_t capacity = 1024;
+    while (capacity < _capacity && capacity < (1U << 30)) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+LogStagingRing::LogStagingRing(size_t _capacity)
+: buffer_(NULL), capacity_(__round_capacity(_capacity))
+, head_(0), tail_(0), orphaned_(0)
+, reserved_offset_(0), reserved_skip_(0) {
+    buffer_ = new char[capacity_];
+}
+
+LogStagingRing::~LogStagingRing() {
+    delete[] buffer_;
+}
+
+bool LogStagingRing::Reserve(size_t _max_len, PtrBuffer& _out) {
+    uint32_t need = kRecordHeaderLen + __align4(_max_len);
+    if (need > capacity_ / 2) return false;
+
+    uint32_t head = head_;
+    uint32_t used = head - atomic_read32(&tail_);
+    uint32_t offset = head & (capacity_ - 1);
+    uint32_t to_end = capacity_ - offset;
+
+    reserved_skip_ = 0;
+    if (to_end < need) {
+        if (capacity_ - used < to_end + need) return false;
+
+        memcpy(buffer_ + offset, &kWrapMarker, sizeof(kWrapMarker));
+        reserved_skip_ = to_end;
+        offset = 0;
+    } else if (capacity_ - used < need) {
+        return false;
+    }
+
+    reserved_offset_ = offset;
+    _out.Attach(buffer_ + offset + kRecordHeaderLen, 0, need - kRecordHeaderLen);
+    return true;
+}
+
+void LogStagingRing::Commit(size_t _len) {
+    assert(0 < _len && kRecordHeaderLen + __align4(_len) <= capacity_ / 2);
+
+    uint32_t len = (uint32_t)_len;
+    memcpy(buffer_ + reserved_offset_, &len, sizeof(len));
+    // atomic_write32 issues a full barrier before the store, so the record is visible before head_ moves.
+    atomic_write32(&head_, head_ + reserved_skip_ + kRecordHeaderLen + __align4(_len));
+    reserved_skip_ = 0;
+}
+
+bool LogStagingRing::Front(const void*& _data, size_t& _len) {
+    uint32_t head = atomic_read32(&head_);
+    uint32_t tail = tail_;
+
+    while (tail != head) {
+        uint32_t offset = tail & (capacity_ - 1);
+        uint32_t len = 0;
+        memcpy(&len, buffer_ + offset, sizeof(len));
+
+        if (kWrapMarker == len) {
+            tail += capacity_ - offset;
+            atomic_write32(&tail_, tail);
+            continue;
+        }
+
+        _data = buffer_ + offset + kRecordHeaderLen;
+        _len = len;
+        return true;
+    }
+
+    return false;
+}
+
+void LogStagingRing::Pop() {
+    uint32_t tail = tail_;
+    uint32_t len = 0;
+    memcpy(&len, buffer_ + (tail & (capacity_ - 1)), sizeof(len));
+    assert(kWrapMarker != len);
+
+    atomic_write32(&tail_, tail + kRecordHeaderLen + __align4(len));
+}
+
+size_t LogStagingRing::Length() const {
+    uint32_t tail = atomic_read32(const_cast<volatile uint32_t*>(&tail_));
+    uint32_t head = atomic_read32(const_cast<volatile uint32_t*>(&head_));
+    return head - tail;
+}
+
+void LogStagingRing::Orphan() {
+    atomic_write32(&orphaned_, 1);
+}
+
+bool LogStagingRing::IsOrphaned() const {
+    return 0 != atomic_read32(const_cast<volatile uint32_t*>(&orphaned_));
+}
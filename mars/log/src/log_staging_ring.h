@@ -0,0 +1,71 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * log_staging_ring.h
+ *
+ *  Created on: 2026-10-17
+ */
+
+#ifndef LOG_STAGING_RING_H_
+#define LOG_STAGING_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mars/comm/ptrbuffer.h"
+
+/*
+ * Single-producer/single-consumer byte ring holding formatted log lines of one thread.
+ *
+ * The owner thread formats straight into the ring (Reserve/Commit) without taking any lock,
+ * the consumer (whoever holds sg_mutex_buffer_async) drains it record by record (Front/Pop).
+ * Every record is |length(uint32_t)|data|, padded to 4 bytes, and never wraps around the end.
+ */
+class LogStagingRing {
+  public:
+    explicit LogStagingRing(size_t _capacity);
+    ~LogStagingRing();
+
+  public:
+    // producer side
+    bool Reserve(size_t _max_len, PtrBuffer& _out);
+    void Commit(size_t _len);
+
+    // consumer side
+    bool Front(const void*& _data, size_t& _len);
+    void Pop();
+
+    size_t Length() const;
+    size_t Capacity() const { return capacity_; }
+    bool Empty() const { return 0 == Length(); }
+
+    void Orphan();
+    bool IsOrphaned() const;
+
+  private:
+    LogStagingRing(const LogStagingRing&);
+    LogStagingRing& operator=(const LogStagingRing&);
+
+  private:
+    char* buffer_;
+    uint32_t capacity_;
+
+    volatile uint32_t head_;      // written by producer only
+    volatile uint32_t tail_;      // written by consumer only
+    volatile uint32_t orphaned_;  // set when the owner thread has exited
+
+    uint32_t reserved_offset_;
+    uint32_t reserved_skip_;
+};
+
+#endif /* LOG_STAGING_RING_H_ */
@@ -0,0 +1,63 @@
+#include "log_staging_ring.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+
+using namespace testing;
+
+static bool push_line(LogStagingRing& _ring, const std::string& _line) {
+    PtrBuffer buff;
+    if (!_ring.Reserve(_line.size(), buff)) return false;
+    buff.Write(_line.data(), _line.size());
+    _ring.Commit(buff.Length());
+    return true;
+}
+
+static std::string pop_line(LogStagingRing& _ring) {
+    const void* data = NULL;
+    size_t len = 0;
+    if (!_ring.Front(data, len)) return "";
+    std::string line((const char*)data, len);
+    _ring.Pop();
+    return line;
+}
+
+TEST(log_staging_ring, order_and_wrap) {
+    LogStagingRing ring(1024);
+    EXPECT_EQ(1024u, ring.Capacity());
+    EXPECT_TRUE(ring.Empty());
+
+    std::string line(301, 'a');
+    for (int round = 0; round < 16; ++round) {
+        line[0] = (char)('a' + round);
+        ASSERT_TRUE(push_line(ring, line));
+        line[1] = 'x';
+        ASSERT_TRUE(push_line(ring, line));
+        line[1] = 'a';
+
+        line[0] = (char)('a' + round);
+        EXPECT_EQ(line, pop_line(ring));
+        line[1] = 'x';
+        EXPECT_EQ(line, pop_line(ring));
+        line[1] = 'a';
+        EXPECT_TRUE(ring.Empty());
+    }
+}
+
+TEST(log_staging_ring, full) {
+    LogStagingRing ring(1024);
+    std::string line(200, 'b');
+
+    int pushed = 0;
+    while (push_line(ring, line)) ++pushed;
+    EXPECT_EQ(5, pushed);
+
+    EXPECT_EQ(line, pop_line(ring));
+    EXPECT_TRUE(push_line(ring, line));
+
+    PtrBuffer buff;
+    EXPECT_FALSE(ring.Reserve(ring.Capacity(), buff));
+}
+
+EXPORT_GTEST_SYMBOLS(log_export_log_staging_ring_unittest)
@@ -95,6 +95,12 @@ const static int kDynTimeTaskBiggerPkgMeetExpectTag = 4;
 
 //longlink_task_manager
 const static unsigned int kFastSendUseLonglinkTaskCntLimit = 0;
+const static unsigned int kLonglinkGroupSmallTaskSize = 16 * 1024;   // kPlaceBySize, up to it on the main link
+const static unsigned int kLonglinkGroupReconnectInterval = 5 * 1000;   // other links of the group
+
+//longlink send, what one round writes and what the kernel may hold unsent (TCP_NOTSENT_LOWAT)
+const static unsigned int kLonglinkSendFrameSize = 32 * 1024;
+const static unsigned int kLonglinkNotSentLowat = 32 * 1024;
 
 //longlink connect params
 const static unsigned int kLonglinkConnTimeout = 10 * 1000;
@@ -0,0 +1,213 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * coro_link.cc
+ *
+ *  Created on: 2026-10-18
+ */
+
+#include "coro_link.h"
+
+#include "boost/bind.hpp"
+#include "boost/make_shared.hpp"
+
+#include "mars/comm/coroutine/coroutine.h"
+#include "mars/comm/coroutine/coro_async.h"
+#include "mars/comm/coroutine/coro_socket.h"
+#include "mars/comm/xlogger/xlogger.h"
+#include "mars/stn/config.h"
+
+#include "net_channel_factory.h"
+
+using namespace mars::stn;
+
+static const int kBlockingThreads = 4;
+
+CoroutineWorker::CoroutineWorker(const boost::function<void ()>& _func)
+    : func_(_func), running_(false) {}
+
+CoroutineWorker::~CoroutineWorker() {
+    Join();
+}
+
+void CoroutineWorker::Start(bool* _newone) {
+    ScopedLock lock(mutex_);
+
+    if (_newone) *_newone = !running_;
+    if (running_) return;
+
+    running_ = true;
+    coroutine_.reset(new coroutine::Coroutine(boost::bind(&CoroutineWorker::__Run, this), Handler()));
+    coroutine_->Start();
+}
+
+bool CoroutineWorker::IsRunning() {
+    ScopedLock lock(mutex_);
+    return running_;
+}
+
+void CoroutineWorker::Join() {
+    ScopedLock lock(mutex_);
+    if (!running_) return;
+
+    // the coroutine thread can't wait for a coroutine of its own.
+    xassert2(MessageQueue::CurrentThreadMessageQueue() != MessageQueue::Handler2Queue(Handler()));
+    while (running_) cond_.wait(lock);
+}
+
+const mq::MessageHandler_t& CoroutineWorker::Handler() {
+    static mq::MessageHandler_t s_handler = mq::DefAsyncInvokeHandler(
+        mq::MessageQueueCreater::CreateNewMessageQueue(boost::make_shared<coroutine::RunloopCond>(), XLOGGER_TAG "::coroutine"));
+    return s_handler;
+}
+
+const mq::MessageHandler_t& CoroutineWorker::BlockingHandler() {
+    static mq::MessageHandler_t s_handler = mq::DefAsyncInvokeHandler(mq::CreateTaskPool(kBlockingThreads, XLOGGER_TAG "::coroutine_blocking"));
+    return s_handler;
+}
+
+void CoroutineWorker::__Run() {
+    func_();
+
+    // the last touch of this, Join returns once it is out.
+    ScopedLock lock(mutex_);
+    running_ = false;
+    cond_.notifyAll(lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+CoroShortLink::CoroShortLink(MessageQueue::MessageQueue_t _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy)
+    : ShortLink(_messagequeueid, _netsource, _task, _use_proxy)
+    , worker_(boost::bind(&CoroShortLink::__Run, this)) {
+}
+
+CoroShortLink::~CoroShortLink() {
+    xinfo_function(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
+
+    if (!worker_.IsRunning()) return;
+
+    breaker_.Break();
+    dns_util_.Cancel();
+    worker_.Join();
+}
+
+void CoroShortLink::SendRequest(AutoBuffer& _buf_req, AutoBuffer& _buffer_extend) {
+    xverbose_function();
+    xdebug2(XTHIS)(TSF"bufReq.size:%_", _buf_req.Length());
+    send_body_.Attach(_buf_req);
+    send_extend_.Attach(_buffer_extend);
+    worker_.Start();
+}
+
+SOCKET CoroShortLink::__RunConnect(ConnectProfile& _conn_profile) {
+    std::vector<socket_address> vecaddr;
+    socket_address* proxy_addr = NULL;
+    SOCKET cached_sock = INVALID_SOCKET;
+
+    // dns may block, it runs on the pool while the other coroutines go on.
+    bool connect = coroutine::MessageInvoke([&]() {
+        return __PrepareConnect(_conn_profile, vecaddr, proxy_addr, cached_sock);
+    }, CoroutineWorker::BlockingHandler());
+
+    if (!connect) return cached_sock;
+
+    ShortLinkConnectObserver connect_observer(*this);
+    coroutine::ComplexConnectObserver observer(connect_observer);
+
+    coroutine::ComplexConnect::EachIPConnectTimoutMode timoutMode = coroutine::ComplexConnect::MODE_FIXED;
+    bool contain_v6 = __ContainIPv6(vecaddr);
+    if (contain_v6) timoutMode = coroutine::ComplexConnect::MODE_INCREASE;
+
+    coroutine::ComplexConnect conn(kShortlinkConnTimeout, kShortlinkConnInterval, timoutMode);
+
+    SOCKET sock = conn.ConnectImpatient(vecaddr, breaker_, &observer, _conn_profile.proxy_info.type, proxy_addr, _conn_profile.proxy_info.username, _conn_profile.proxy_info.password);
+    delete proxy_addr;
+
+    return __ConnectFinished(_conn_profile, sock, conn.Index(), conn.IndexRtt(), conn.TotalCost(), conn.ErrorCode(), connect_observer.ConnectingIndex, contain_v6);
+}
+
+int CoroShortLink::__BlockSend(SOCKET _socket, const void* _buffer, size_t _len, int& _err_code) {
+    return coroutine::block_socket_send(_socket, _buffer, _len, breaker_, _err_code);
+}
+
+int CoroShortLink::__BlockRecv(SOCKET _socket, AutoBuffer& _buffer, size_t _max_size, int& _err_code, int _timeout) {
+    return coroutine::block_socket_recv(_socket, _buffer, _max_size, breaker_, _err_code, _timeout);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+CoroLongLink::CoroLongLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource)
+    : LongLink(_messagequeueid, _netsource)
+    , worker_(boost::bind(&CoroLongLink::__Run, this)) {
+}
+
+CoroLongLink::~CoroLongLink() {
+    // while the worker hooks are still ours, ~LongLink finds nothing running.
+    Disconnect(kReset);
+}
+
+SOCKET CoroLongLink::__RunConnect(ConnectProfile& _conn_profile) {
+    std::vector<socket_address> vecaddr;
+    socket_address* proxy_addr = NULL;
+
+    bool connect = coroutine::MessageInvoke([&]() {
+        return __PrepareConnect(_conn_profile, vecaddr, proxy_addr);
+    }, CoroutineWorker::BlockingHandler());
+
+    if (!connect) return INVALID_SOCKET;
+
+    LongLinkConnectObserver connect_observer(*this, _conn_profile.ip_items);
+    coroutine::ComplexConnectObserver observer(connect_observer);
+    coroutine::ComplexConnect com_connect(kLonglinkConnTimeout, kLonglinkConnInteral, kLonglinkConnInteral, kLonglinkConnMax);
+
+    SOCKET sock = com_connect.ConnectImpatient(vecaddr, connectbreak_, &observer, _conn_profile.proxy_info.type, proxy_addr, _conn_profile.proxy_info.username, _conn_profile.proxy_info.password);
+
+    delete proxy_addr;
+
+    return __ConnectFinished(_conn_profile, sock, com_connect.Index(), com_connect.ErrorCode(), com_connect.IndexRtt(), com_connect.IndexTotalCost(),
+                             com_connect.TotalCost(), com_connect.TryCount(), connect_observer.connecting_index_);
+}
+
+void CoroLongLink::__StartWorker(bool* _newone) {
+    worker_.Start(_newone);
+}
+
+bool CoroLongLink::__IsWorkerRunning() {
+    return worker_.IsRunning();
+}
+
+void CoroLongLink::__JoinWorker() {
+    worker_.Join();
+}
+
+SocketSelect* CoroLongLink::__CreateSelect(SocketBreaker& _breaker) {
+    return new coroutine::SocketSelect(_breaker, true);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+namespace mars {
+namespace stn {
+
+ShortLinkInterface* ShortLinkChannelFactory::CreateCoroShortLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy) {
+    return new CoroShortLink(_messagequeueid, _netsource, _task, _use_proxy);
+}
+
+LongLink* LongLinkChannelFactory::CreateCoroLongLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource) {
+    return new CoroLongLink(_messagequeueid, _netsource);
+}
+
+}
+}
@@ -0,0 +1,117 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * coro_link.h
+ *
+ *  Created on: 2026-10-18
+ */
+
+#ifndef STN_SRC_CORO_LINK_H_
+#define STN_SRC_CORO_LINK_H_
+
+#include "boost/function.hpp"
+#include "boost/scoped_ptr.hpp"
+
+#include "mars/comm/thread/condition.h"
+#include "mars/comm/thread/lock.h"
+#include "mars/comm/messagequeue/message_queue.h"
+
+#include "longlink.h"
+#include "shortlink.h"
+
+namespace coroutine {
+class Coroutine;
+}
+
+namespace mars {
+namespace stn {
+
+/*
+ * Runs a function as a coroutine on the one thread shared by all coroutine links, in place of a Thread.
+ * That thread multiplexes the sockets every coroutine waits on (coroutine::RunloopCond), a waiting coroutine
+ * costs its stack only, which comes from coroutine::StackPool.
+ */
+class CoroutineWorker {
+  public:
+    CoroutineWorker(const boost::function<void ()>& _func);
+    ~CoroutineWorker();
+
+    void Start(bool* _newone = NULL);   // as Thread::start, nothing new while one is running
+    bool IsRunning();
+    void Join();    // not from the coroutine thread
+
+    static const mq::MessageHandler_t& Handler();
+    // for what blocks other than a socket (dns), the coroutine waits on it with coroutine::MessageInvoke.
+    static const mq::MessageHandler_t& BlockingHandler();
+
+  private:
+    void __Run();
+
+  private:
+    CoroutineWorker(const CoroutineWorker&);
+    CoroutineWorker& operator=(const CoroutineWorker&);
+
+  private:
+    boost::function<void ()> func_;
+    Mutex mutex_;
+    Condition cond_;
+    bool running_;
+    boost::scoped_ptr<coroutine::Coroutine> coroutine_;
+};
+
+/*
+ * A ShortLink whose __Run is a coroutine: the connect race, send and recv yield on the socket instead of blocking a thread.
+ * Set ShortLinkChannelFactory::Create to CreateCoroShortLink to have ShortLinkTaskManager use it.
+ */
+class CoroShortLink : public ShortLink {
+  public:
+    CoroShortLink(MessageQueue::MessageQueue_t _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy);
+    virtual ~CoroShortLink();
+
+  protected:
+    virtual void     SendRequest(AutoBuffer& _buffer_req, AutoBuffer& _task_extend);
+
+    virtual SOCKET   __RunConnect(ConnectProfile& _conn_profile);
+    virtual int      __BlockSend(SOCKET _socket, const void* _buffer, size_t _len, int& _err_code);
+    virtual int      __BlockRecv(SOCKET _socket, AutoBuffer& _buffer, size_t _max_size, int& _err_code, int _timeout);
+
+  private:
+    CoroutineWorker worker_;
+};
+
+/*
+ * A LongLink whose __Run is a coroutine, on the same thread as the CoroShortLink.
+ * Set LongLinkChannelFactory::Create to CreateCoroLongLink to use it.
+ */
+class CoroLongLink : public LongLink {
+  public:
+    CoroLongLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource);
+    virtual ~CoroLongLink();
+
+  protected:
+    virtual SOCKET   __RunConnect(ConnectProfile& _conn_profile);
+
+    virtual void     __StartWorker(bool* _newone);
+    virtual bool     __IsWorkerRunning();
+    virtual void     __JoinWorker();
+    virtual SocketSelect* __CreateSelect(SocketBreaker& _breaker);
+
+  private:
+    CoroutineWorker worker_;
+};
+
+}
+}
+
+#endif // STN_SRC_CORO_LINK_H_
@@ -20,7 +20,8 @@
 
 #include "frequency_limit.h"
 
-#include "mars/comm/adler32.h"
+#include <string.h>
+
 #include "mars/comm/time_utils.h"
 #include "mars/comm/xlogger/xlogger.h"
 #include "mars/stn/stn.h"
@@ -32,11 +33,103 @@
 #define NOT_CLEAR_INTERCEPT_COUNT (75)
 #define NOT_CLEAR_INTERCEPT_INTERVAL_MINUTE (10*60*1000)
 #define RUN_CLEAR_RECORDS_INTERVAL_MINUTE  (60*60*1000)
+#define INDEX_SLOT_COUNT (64)   // a power of 2, twice MAX_RECORD_COUNT at least
 
 using namespace mars::stn;
 
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t __Rotl64(uint64_t _x, int _r) {
+    return (_x << _r) | (_x >> (64 - _r));
+}
+
+static inline uint64_t __Read64(const uint8_t* _p) {
+    uint64_t v;
+    memcpy(&v, _p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t __Read32(const uint8_t* _p) {
+    uint32_t v;
+    memcpy(&v, _p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t __Round(uint64_t _acc, uint64_t _input) {
+    _acc += _input * kPrime2;
+    _acc = __Rotl64(_acc, 31);
+    return _acc * kPrime1;
+}
+
+static inline uint64_t __MergeRound(uint64_t _acc, uint64_t _val) {
+    _acc ^= __Round(0, _val);
+    return _acc * kPrime1 + kPrime4;
+}
+
+// xxHash64: four lanes of 8 bytes a step, several times the speed of adler32 on a big body.
+// it is only kept in memory, the byte order of the host doesn't matter.
+uint64_t FrequencyLimit::__Hash64(const void* _buffer, size_t _len, uint64_t _seed) {
+    const uint8_t* p = (const uint8_t*)_buffer;
+    const uint8_t* end = p + _len;
+    uint64_t h;
+
+    if (32 <= _len) {
+        const uint8_t* limit = end - 32;
+        uint64_t v1 = _seed + kPrime1 + kPrime2;
+        uint64_t v2 = _seed + kPrime2;
+        uint64_t v3 = _seed;
+        uint64_t v4 = _seed - kPrime1;
+
+        do {
+            v1 = __Round(v1, __Read64(p));
+            v2 = __Round(v2, __Read64(p + 8));
+            v3 = __Round(v3, __Read64(p + 16));
+            v4 = __Round(v4, __Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = __Rotl64(v1, 1) + __Rotl64(v2, 7) + __Rotl64(v3, 12) + __Rotl64(v4, 18);
+        h = __MergeRound(h, v1);
+        h = __MergeRound(h, v2);
+        h = __MergeRound(h, v3);
+        h = __MergeRound(h, v4);
+    } else {
+        h = _seed + kPrime5;
+    }
+
+    h += (uint64_t)_len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= __Round(0, __Read64(p));
+        h = __Rotl64(h, 27) * kPrime1 + kPrime4;
+    }
+
+    if (p + 4 <= end) {
+        h ^= (uint64_t)__Read32(p) * kPrime1;
+        h = __Rotl64(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+
+    for (; p < end; ++p) {
+        h ^= (*p) * kPrime5;
+        h = __Rotl64(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
 FrequencyLimit::FrequencyLimit()
-    : itime_record_clear_(::gettickcount())
+    : index_(INDEX_SLOT_COUNT, -1)
+    , itime_record_clear_(::gettickcount())
 {}
 
 FrequencyLimit::~FrequencyLimit()
@@ -57,7 +150,7 @@ bool FrequencyLimit::Check(const mars::stn::Task& _task, const void* _buffer, in
         __ClearRecord();
     }
 
-    unsigned long hash = ::adler32(0, (const unsigned char*)_buffer, _len);
+    uint64_t hash = __Hash64(_buffer, (size_t)_len);
     int find_index = __LocateIndex(hash);
 
     if (0 <= find_index) {
@@ -88,9 +181,10 @@ void FrequencyLimit::__ClearRecord() {
 
     unsigned long time_cur = ::gettickcount();
 
-    std::vector<STAvalancheRecord>::iterator first = iarr_record_.begin();
+    int i = 0;
 
-    while (first != iarr_record_.end()) {
+    while (i < (int)iarr_record_.size()) {
+        STAvalancheRecord* first = &iarr_record_[i];
         xassert2(time_cur >= first->time_last_update_);
         unsigned long interval = time_cur - first->time_last_update_;
 
@@ -100,23 +194,29 @@ void FrequencyLimit::__ClearRecord() {
             if (NOT_CLEAR_INTERCEPT_COUNT_RETRY < first->count_) first->count_ = NOT_CLEAR_INTERCEPT_COUNT_RETRY;
 
             xwarn2(TSF"timeCur:%_,  first->timeLastUpdate:%_, interval:%_, Hash:%_, oldcount:%_, Count:%_", time_cur, first->time_last_update_, interval, first->hash_, oldcount, first->count_);
-            ++first;
+            ++i;
         } else {
-            first = iarr_record_.erase(first);
+            // the last record moves in, look at the same index again.
+            __RemoveRecord(i);
         }
     }
 }
 
-int FrequencyLimit::__LocateIndex(unsigned long _hash) const {
-    for (int i = (int)iarr_record_.size() - 1; i >= 0; --i) {
-        if (iarr_record_[i].hash_ == _hash)
-            return i;
+int FrequencyLimit::__LocateSlot(uint64_t _hash) const {
+    int slot = (int)(_hash & (INDEX_SLOT_COUNT - 1));
+
+    while (0 <= index_[slot] && iarr_record_[index_[slot]].hash_ != _hash) {
+        slot = (slot + 1) & (INDEX_SLOT_COUNT - 1);
     }
 
-    return -1;
+    return slot;
 }
 
-void FrequencyLimit::__InsertRecord(unsigned long _hash) {
+int FrequencyLimit::__LocateIndex(uint64_t _hash) const {
+    return index_[__LocateSlot(_hash)];
+}
+
+void FrequencyLimit::__InsertRecord(uint64_t _hash) {
     if (MAX_RECORD_COUNT < iarr_record_.size()) {
         xassert2(false);
         return;
@@ -136,14 +236,44 @@ void FrequencyLimit::__InsertRecord(unsigned long _hash) {
             }
         }
 
-        std::vector<STAvalancheRecord>::iterator it = iarr_record_.begin();
-        it += del_index;
-        iarr_record_.erase(it);
+        __RemoveRecord((int)del_index);
     }
 
+    index_[__LocateSlot(_hash)] = (int)iarr_record_.size();
     iarr_record_.push_back(temp);
 }
 
+void FrequencyLimit::__RemoveRecord(int _index) {
+    xassert2(0 <= _index && (unsigned int)_index < iarr_record_.size());
+
+    // backward shift: a later record of the probe chain moves up, unless that would put it before its home slot.
+    int slot = __LocateSlot(iarr_record_[_index].hash_);
+    int next = slot;
+
+    while (true) {
+        next = (next + 1) & (INDEX_SLOT_COUNT - 1);
+        if (0 > index_[next]) break;
+
+        int home = (int)(iarr_record_[index_[next]].hash_ & (INDEX_SLOT_COUNT - 1));
+        if (((next - home) & (INDEX_SLOT_COUNT - 1)) >= ((next - slot) & (INDEX_SLOT_COUNT - 1))) {
+            index_[slot] = index_[next];
+            slot = next;
+        }
+    }
+
+    index_[slot] = -1;
+
+    // the last record takes the place, nothing in the middle of the vector is erased.
+    int last = (int)iarr_record_.size() - 1;
+
+    if (_index != last) {
+        index_[__LocateSlot(iarr_record_[last].hash_)] = _index;
+        iarr_record_[_index] = iarr_record_[last];
+    }
+
+    iarr_record_.pop_back();
+}
+
 void FrequencyLimit::__UpdateRecord(int _index) {
     xassert2(0 <= _index && (unsigned int)_index < iarr_record_.size());
 
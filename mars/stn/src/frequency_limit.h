@@ -21,6 +21,9 @@
 #ifndef STN_SRC_FREQUENCY_LIMIT_H_
 #define STN_SRC_FREQUENCY_LIMIT_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <vector>
 
 namespace mars {
@@ -30,7 +33,7 @@ struct Task;
 struct STAvalancheRecord;
 
 struct STAvalancheRecord {
-    unsigned long hash_;
+    uint64_t hash_;
     int count_;
     unsigned long time_last_update_;
 };
@@ -43,15 +46,22 @@ class FrequencyLimit {
     bool Check(const mars::stn::Task& _task, const void* _buffer, int _len, unsigned int& _span);
 
   private:
+    friend class FrequencyLimitTest;
+
+    static uint64_t __Hash64(const void* _buffer, size_t _len, uint64_t _seed = 0);
+
     void __ClearRecord();
-    void __InsertRecord(unsigned long _hash);
+    void __InsertRecord(uint64_t _hash);
+    void __RemoveRecord(int _index);
     bool __CheckRecord(int _index) const;
     void __UpdateRecord(int _index);
     unsigned int __GetLastUpdateTillNow(int _index);
-    int __LocateIndex(unsigned long _hash) const;
+    int __LocateIndex(uint64_t _hash) const;
+    int __LocateSlot(uint64_t _hash) const;
 
   private:
     std::vector<STAvalancheRecord> iarr_record_;
+    std::vector<int> index_;    // open addressing by hash, an index into iarr_record_ or -1
     unsigned long itime_record_clear_;
 };
 
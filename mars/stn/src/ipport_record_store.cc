@@ -0,0 +1,300 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ *   ipport_record_store.cc
+ *   network
+ *
+ *   Created on: 2026-10-18
+ */
+
+#include "ipport_record_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "boost/filesystem.hpp"
+
+#include "mars/comm/adler32.h"
+#include "mars/comm/mmap_util.h"
+#include "mars/comm/tinyxml2.h"
+#include "mars/comm/xlogger/xlogger.h"
+
+static const uint32_t kMagic = 0x5250494d;     // "MIPR"
+static const uint16_t kVersion = 1;
+static const uint32_t kRecordCount = 4096;     // a power of 2
+static const uint32_t kProbeLength = 16;
+
+// ipportrecords2.xml: <record netinfo="" time=""><item ip="" port="" historyresult=""/>...</record>...
+static const char* const kXmlRecord = "record";
+static const char* const kXmlItem = "item";
+static const char* const kXmlTime = "time";
+static const char* const kXmlNetInfo = "netinfo";
+static const char* const kXmlIP = "ip";
+static const char* const kXmlPort = "port";
+static const char* const kXmlHistoryResult = "historyresult";
+
+enum {
+    kSlotFree = 0,      // never written, ends a probe
+    kSlotUsed,
+    kSlotDeleted,
+};
+
+namespace mars { namespace stn {
+
+struct IPPortDiskHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t record_count;
+    uint8_t  reserved[52];
+};
+
+struct IPPortDiskRecord {
+    uint32_t checksum;          // adler32 of the rest of the record
+    uint8_t  state;
+    uint8_t  reserved;
+    uint16_t port;
+    uint32_t time;              // seconds, when the record was added
+    uint32_t reserved2;
+    uint64_t netinfo_hash;
+    uint64_t history_result;
+    char     ip[48];            // an IPv6 text fits, NUL terminated
+};
+
+}}
+
+using namespace mars::stn;
+
+static_assert(sizeof(IPPortDiskHeader) == 64, "IPPortDiskHeader is 64 bytes on disk");
+static_assert(sizeof(IPPortDiskRecord) == 80, "IPPortDiskRecord is 80 bytes on disk");
+
+static const size_t kFileSize = sizeof(IPPortDiskHeader) + kRecordCount * sizeof(IPPortDiskRecord);
+
+// FNV-1a, the index is on disk and has to hash the same in every build.
+static uint64_t __Hash(uint64_t _hash, const void* _data, size_t _len) {
+    const uint8_t* data = (const uint8_t*)_data;
+    for (size_t i = 0; i < _len; ++i) {
+        _hash ^= data[i];
+        _hash *= 0x100000001b3ULL;
+    }
+    return _hash;
+}
+
+static uint64_t __NetinfoHash(const std::string& _netinfo) {
+    return __Hash(0xcbf29ce484222325ULL, _netinfo.data(), _netinfo.size());
+}
+
+static uint32_t __SlotIndex(uint64_t _netinfo_hash, const std::string& _ip, uint16_t _port) {
+    uint64_t hash = __Hash(_netinfo_hash, _ip.data(), _ip.size());
+    hash = __Hash(hash, &_port, sizeof(_port));
+    return (uint32_t)(hash ^ (hash >> 32)) & (kRecordCount - 1);
+}
+
+static uint32_t __Checksum(const IPPortDiskRecord& _record) {
+    const size_t offset = sizeof(_record.checksum);
+    return (uint32_t)adler32(1, (const unsigned char*)&_record + offset, (unsigned int)(sizeof(_record) - offset));
+}
+
+static bool __IsLive(const IPPortDiskRecord& _record) {
+    return kSlotUsed == _record.state && __Checksum(_record) == _record.checksum;
+}
+
+static bool __IsKey(const IPPortDiskRecord& _record, uint64_t _netinfo_hash, const std::string& _ip, uint16_t _port) {
+    return _record.netinfo_hash == _netinfo_hash && _record.port == _port
+            && 0 == strncmp(_record.ip, _ip.c_str(), sizeof(_record.ip));
+}
+
+static uint32_t __Now() {
+    struct timeval now = {0};
+    gettimeofday(&now, NULL);
+    return (uint32_t)now.tv_sec;
+}
+
+IPPortRecordStore::IPPortRecordStore()
+: records_(NULL) {}
+
+IPPortRecordStore::~IPPortRecordStore() {
+    Close();
+}
+
+bool IPPortRecordStore::Open(const std::string& _path) {
+    Close();
+
+    boost::system::error_code ec;
+    if (boost::filesystem::exists(_path, ec) && kFileSize != boost::filesystem::file_size(_path, ec)) {
+        xwarn2(TSF"%_ size mismatch, start over", _path);
+        boost::filesystem::remove(_path, ec);
+    }
+
+    if (!OpenMmapFile(_path.c_str(), (unsigned int)kFileSize, mmap_file_)) {
+        xerror2(TSF"open %_ fail", _path);
+        return false;
+    }
+
+    IPPortDiskHeader* header = (IPPortDiskHeader*)mmap_file_.data();
+    if (kMagic != header->magic || kVersion != header->version
+            || sizeof(IPPortDiskRecord) != header->record_size || kRecordCount != header->record_count) {
+        xwarn2(TSF"%_ header mismatch, magic:%_, version:%_, start over", _path, header->magic, header->version);
+        memset(mmap_file_.data(), 0, kFileSize);
+        header->version = kVersion;
+        header->record_size = sizeof(IPPortDiskRecord);
+        header->record_count = kRecordCount;
+        header->magic = kMagic;
+    }
+
+    records_ = mmap_file_.data() + sizeof(IPPortDiskHeader);
+    return true;
+}
+
+void IPPortRecordStore::Close() {
+    records_ = NULL;
+    CloseMmapFile(mmap_file_);
+}
+
+bool IPPortRecordStore::IsOpen() const {
+    return NULL != records_;
+}
+
+void IPPortRecordStore::Update(const std::string& _netinfo, const std::string& _ip, uint16_t _port, bool _is_success) {
+    if (!IsOpen() || _ip.size() >= sizeof(((IPPortDiskRecord*)0)->ip)) return;
+
+    uint64_t netinfo_hash = __NetinfoHash(_netinfo);
+    IPPortDiskRecord* free_slot = NULL;
+    IPPortDiskRecord* slot = __Find(netinfo_hash, _ip, _port, free_slot);
+
+    if (NULL != slot) {
+        __Write(slot, netinfo_hash, slot->time, _ip, _port, (slot->history_result << 1) | (_is_success ? 0 : 1));
+    } else {
+        __Write(free_slot, netinfo_hash, __Now(), _ip, _port, _is_success ? 0 : 1);
+    }
+}
+
+void IPPortRecordStore::Import(const std::string& _netinfo, time_t _time, const std::string& _ip, uint16_t _port, uint64_t _history_result) {
+    if (!IsOpen() || _ip.size() >= sizeof(((IPPortDiskRecord*)0)->ip)) return;
+
+    uint64_t netinfo_hash = __NetinfoHash(_netinfo);
+    IPPortDiskRecord* free_slot = NULL;
+    if (NULL != __Find(netinfo_hash, _ip, _port, free_slot)) return;
+
+    __Write(free_slot, netinfo_hash, (uint32_t)_time, _ip, _port, _history_result);
+}
+
+int IPPortRecordStore::ImportXml(const std::string& _path) {
+    tinyxml2::XMLDocument recordsxml;
+    if (tinyxml2::XML_SUCCESS != recordsxml.LoadFile(_path.c_str())) return -1;
+
+    int count = 0;
+    for (const tinyxml2::XMLElement* record = recordsxml.FirstChildElement(kXmlRecord);
+            NULL != record; record = record->NextSiblingElement(kXmlRecord)) {
+        const char* netinfo_chr = record->Attribute(kXmlNetInfo);
+        const char* lasttime_chr = record->Attribute(kXmlTime);
+        if (NULL == netinfo_chr || NULL == lasttime_chr) continue;
+
+        time_t lasttime = (time_t)strtoul(lasttime_chr, NULL, 10);
+
+        for (const tinyxml2::XMLElement* item = record->FirstChildElement(kXmlItem); NULL != item; item = item->NextSiblingElement(kXmlItem)) {
+            const char* ip = item->Attribute(kXmlIP);
+            if (NULL == ip) continue;
+
+            Import(netinfo_chr, lasttime, ip, (uint16_t)item->UnsignedAttribute(kXmlPort), (uint64_t)item->Int64Attribute(kXmlHistoryResult));
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+void IPPortRecordStore::GetRecords(const std::string& _netinfo, std::vector<Record>& _records) const {
+    _records.clear();
+    if (!IsOpen()) return;
+
+    uint64_t netinfo_hash = __NetinfoHash(_netinfo);
+    for (uint32_t i = 0; i < kRecordCount; ++i) {
+        const IPPortDiskRecord& slot = *__Slot(i);
+        if (slot.netinfo_hash != netinfo_hash || !__IsLive(slot)) continue;
+
+        Record record;
+        record.ip.assign(slot.ip, strnlen(slot.ip, sizeof(slot.ip)));
+        record.port = slot.port;
+        record.history_result = slot.history_result;
+        _records.push_back(record);
+    }
+}
+
+void IPPortRecordStore::RemoveTimeout(time_t _timeout) {
+    if (!IsOpen()) return;
+
+    uint32_t now = __Now();
+    for (uint32_t i = 0; i < kRecordCount; ++i) {
+        IPPortDiskRecord& slot = *__Slot(i);
+        if (kSlotUsed != slot.state) continue;
+
+        // a record torn by a crash goes the same way.
+        if (!__IsLive(slot) || now < slot.time || now - slot.time >= _timeout) {
+            slot.state = kSlotDeleted;
+        }
+    }
+}
+
+IPPortDiskRecord* IPPortRecordStore::__Slot(uint32_t _index) const {
+    return (IPPortDiskRecord*)records_ + _index;
+}
+
+IPPortDiskRecord* IPPortRecordStore::__Find(uint64_t _netinfo_hash, const std::string& _ip, uint16_t _port, IPPortDiskRecord*& _free) const {
+    uint32_t start = __SlotIndex(_netinfo_hash, _ip, _port);
+    IPPortDiskRecord* oldest = NULL;
+    _free = NULL;
+
+    for (uint32_t i = 0; i < kProbeLength; ++i) {
+        IPPortDiskRecord* slot = __Slot((start + i) & (kRecordCount - 1));
+
+        if (kSlotFree == slot->state) {
+            if (NULL == _free) _free = slot;
+            return NULL;
+        }
+
+        if (kSlotUsed == slot->state && __IsKey(*slot, _netinfo_hash, _ip, _port)) {
+            if (__IsLive(*slot)) return slot;
+            if (NULL == _free) _free = slot;
+            continue;
+        }
+
+        if (kSlotDeleted == slot->state) {
+            if (NULL == _free) _free = slot;
+            continue;
+        }
+
+        if (NULL == oldest || slot->time < oldest->time) oldest = slot;
+    }
+
+    if (NULL == _free) _free = oldest;
+    return NULL;
+}
+
+void IPPortRecordStore::__Write(IPPortDiskRecord* _slot, uint64_t _netinfo_hash, uint32_t _time, const std::string& _ip, uint16_t _port, uint64_t _history_result) {
+    IPPortDiskRecord record;
+    memset(&record, 0, sizeof(record));
+    record.state = kSlotUsed;
+    record.port = _port;
+    record.time = _time;
+    record.netinfo_hash = _netinfo_hash;
+    record.history_result = _history_result;
+    strncpy(record.ip, _ip.c_str(), sizeof(record.ip) - 1);
+    record.checksum = __Checksum(record);
+
+    // the slot keeps its old state until the record is whole.
+    record.state = _slot->state;
+    memcpy(_slot, &record, sizeof(record));
+    _slot->state = kSlotUsed;
+}
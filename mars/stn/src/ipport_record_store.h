@@ -0,0 +1,81 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ *   ipport_record_store.h
+ *   network
+ *
+ *   Created on: 2026-10-18
+ */
+
+#ifndef STN_SRC_IPPORT_RECORD_STORE_H_
+#define STN_SRC_IPPORT_RECORD_STORE_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "boost/iostreams/device/mapped_file.hpp"
+
+namespace mars {
+namespace stn {
+
+struct IPPortDiskRecord;
+
+/*
+ * The connect history of SimpleIPPortSort, fixed records in a memory-mapped file.
+ * The file is its own hash index: a record sits within kProbeLength slots of the hash of netinfo, ip and port,
+ * a full window gives up its oldest record. A record is checksummed and made visible by its state byte last,
+ * one torn by a crash reads as a deleted slot.
+ */
+class IPPortRecordStore {
+  public:
+    struct Record {
+        std::string ip;
+        uint16_t port;
+        uint64_t history_result;    // a bit per connect, 1 for a failure, the latest in the lowest bit
+    };
+
+    IPPortRecordStore();
+    ~IPPortRecordStore();
+
+    bool Open(const std::string& _path);
+    void Close();
+    bool IsOpen() const;
+
+    void Update(const std::string& _netinfo, const std::string& _ip, uint16_t _port, bool _is_success);
+    // for the records of an old file: kept as they are, unless the store has _ip:_port under _netinfo already.
+    void Import(const std::string& _netinfo, time_t _time, const std::string& _ip, uint16_t _port, uint64_t _history_result);
+    // imports the items of an ipportrecords2.xml, returns how many were read, -1 if the file doesn't parse.
+    int ImportXml(const std::string& _path);
+
+    void GetRecords(const std::string& _netinfo, std::vector<Record>& _records) const;
+    void RemoveTimeout(time_t _timeout);
+
+  private:
+    IPPortDiskRecord* __Slot(uint32_t _index) const;
+    IPPortDiskRecord* __Find(uint64_t _netinfo_hash, const std::string& _ip, uint16_t _port, IPPortDiskRecord*& _free) const;
+    void __Write(IPPortDiskRecord* _slot, uint64_t _netinfo_hash, uint32_t _time, const std::string& _ip, uint16_t _port, uint64_t _history_result);
+
+  private:
+    IPPortRecordStore(const IPPortRecordStore&);
+    IPPortRecordStore& operator=(const IPPortRecordStore&);
+
+  private:
+    boost::iostreams::mapped_file mmap_file_;
+    char* records_;
+};
+
+}}
+#endif // STN_SRC_IPPORT_RECORD_STORE_H_
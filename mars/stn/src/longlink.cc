@@ -22,6 +22,10 @@
 
 #include <algorithm>
 
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
 #include "boost/bind.hpp"
 
 #include "mars/app/app.h"
@@ -53,81 +57,67 @@
 using namespace mars::stn;
 using namespace mars::app;
 
-namespace {
-class LongLinkConnectObserver : public MComplexConnect {
-  public:
-    LongLinkConnectObserver(LongLink& _longlink, const std::vector<IPPortItem>& _iplist): longlink_(_longlink), ip_items_(_iplist) {
-    	memset(connecting_index_, 0, sizeof(connecting_index_));
-    };
-
-    virtual void OnCreated(unsigned int _index, const socket_address& _addr, SOCKET _socket) {}
-    virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket)  {
-    	connecting_index_[_index] = 1;
-    }
-    virtual void OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt) {
-        if (0 == _error) {
-            if (!OnShouldVerify(_index, _addr)) {
-                connecting_index_[_index] = 0;
-            }
-        } else {
-            xwarn2(TSF"index:%_, connnet fail host:%_, iptype:%_", _index, ip_items_[_index].str_host, ip_items_[_index].source_type);
-            //xassert2(longlink_.fun_network_report_);
+
+LongLinkConnectObserver::LongLinkConnectObserver(LongLink& _longlink, const std::vector<IPPortItem>& _iplist): longlink_(_longlink), ip_items_(_iplist) {
+    memset(connecting_index_, 0, sizeof(connecting_index_));
+}
+
+void LongLinkConnectObserver::OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket)  {
+    connecting_index_[_index] = 1;
+}
+
+void LongLinkConnectObserver::OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt) {
+    if (0 == _error) {
+        if (!OnShouldVerify(_index, _addr)) {
             connecting_index_[_index] = 0;
+        }
+    } else {
+        xwarn2(TSF"index:%_, connnet fail host:%_, iptype:%_", _index, ip_items_[_index].str_host, ip_items_[_index].source_type);
+        //xassert2(longlink_.fun_network_report_);
+        connecting_index_[_index] = 0;
 
-            if (longlink_.fun_network_report_) {
-                longlink_.fun_network_report_(__LINE__, kEctSocket, _error, _addr.ip(), _addr.port());
-            }
+        if (longlink_.fun_network_report_) {
+            longlink_.fun_network_report_(__LINE__, kEctSocket, _error, _addr.ip(), _addr.port());
         }
     }
+}
 
-    virtual bool OnShouldVerify(unsigned int _index, const socket_address& _addr) {
-        return longlink_complexconnect_need_verify();
-    }
-    
-    virtual bool OnVerifySend(unsigned int _index, const socket_address& _addr, SOCKET _socket, AutoBuffer& _buffer_send) {
-        AutoBuffer body;
-        AutoBuffer extension;
-        longlink_noop_req_body(body, extension);
-        longlink_pack(longlink_noop_cmdid(), Task::kNoopTaskID, body, extension, _buffer_send, NULL);
-        return true;
-    }
+bool LongLinkConnectObserver::OnShouldVerify(unsigned int _index, const socket_address& _addr) {
+    return longlink_complexconnect_need_verify();
+}
 
-    virtual bool OnVerifyRecv(unsigned int _index, const socket_address& _addr, SOCKET _socket, const AutoBuffer& _buffer_recv) {
-        
-        connecting_index_[_index] = 0;
-        
-        uint32_t cmdid = 0;
-        uint32_t  taskid = Task::kInvalidTaskID;
-        size_t pack_len = 0;
-        AutoBuffer bufferbody;
-        AutoBuffer extension;
-        int ret = longlink_unpack(_buffer_recv, cmdid, taskid, pack_len, bufferbody, extension, NULL);
-
-        if (LONGLINK_UNPACK_OK != ret) {
-            xerror2(TSF"0>ret, index:%_, sock:%_, %_, ret:%_, cmdid:%_, taskid:%_, pack_len:%_, recv_len:%_", _index, _socket, _addr.url(), ret, cmdid, taskid, pack_len, _buffer_recv.Length());
-            if (longlink_.fun_network_report_) {
-                longlink_.fun_network_report_(__LINE__, kEctSocket, EBADMSG, _addr.ip(), _addr.port());
-            }
-            return false;
-        }
+bool LongLinkConnectObserver::OnVerifySend(unsigned int _index, const socket_address& _addr, SOCKET _socket, AutoBuffer& _buffer_send) {
+    AutoBuffer body;
+    AutoBuffer extension;
+    longlink_noop_req_body(body, extension);
+    longlink_pack(longlink_noop_cmdid(), Task::kNoopTaskID, body, extension, _buffer_send, NULL);
+    return true;
+}
 
-        if (!longlink_noop_isresp(taskid, cmdid, taskid, bufferbody, extension)) {
-            xwarn2(TSF"index:%_, sock:%_, %_, ret:%_, cmdid:%_, taskid:%_, pack_len:%_, recv_len:%_", _index, _socket, _addr.url(), ret, cmdid, taskid, pack_len, _buffer_recv.Length());
-        }
+bool LongLinkConnectObserver::OnVerifyRecv(unsigned int _index, const socket_address& _addr, SOCKET _socket, const AutoBuffer& _buffer_recv) {
+    
+    connecting_index_[_index] = 0;
+    
+    uint32_t cmdid = 0;
+    uint32_t  taskid = Task::kInvalidTaskID;
+    size_t pack_len = 0;
+    AutoBuffer bufferbody;
+    AutoBuffer extension;
+    int ret = longlink_unpack(_buffer_recv, cmdid, taskid, pack_len, bufferbody, extension, NULL);
 
-        return true;
+    if (LONGLINK_UNPACK_OK != ret) {
+        xerror2(TSF"0>ret, index:%_, sock:%_, %_, ret:%_, cmdid:%_, taskid:%_, pack_len:%_, recv_len:%_", _index, _socket, _addr.url(), ret, cmdid, taskid, pack_len, _buffer_recv.Length());
+        if (longlink_.fun_network_report_) {
+            longlink_.fun_network_report_(__LINE__, kEctSocket, EBADMSG, _addr.ip(), _addr.port());
+        }
+        return false;
     }
-    char connecting_index_[32];
 
-  private:
-    LongLinkConnectObserver(const LongLinkConnectObserver&);
-    LongLinkConnectObserver& operator=(const LongLinkConnectObserver&);
-
-  public:
-    LongLink& longlink_;
-    const std::vector<IPPortItem>& ip_items_;
-};
+    if (!longlink_noop_isresp(taskid, cmdid, taskid, bufferbody, extension)) {
+        xwarn2(TSF"index:%_, sock:%_, %_, ret:%_, cmdid:%_, taskid:%_, pack_len:%_, recv_len:%_", _index, _socket, _addr.url(), ret, cmdid, taskid, pack_len, _buffer_recv.Length());
+    }
 
+    return true;
 }
 
 LongLink::LongLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource)
@@ -167,9 +157,9 @@ bool LongLink::Send(const AutoBuffer& _body, const AutoBuffer& _extension, const
 
     xassert2(tracker_.get());
     
-    lstsenddata_.push_back(std::make_pair(_task, move_wrapper<AutoBuffer>(AutoBuffer())));
-    longlink_pack(_task.cmdid, _task.taskid, _body, _extension, lstsenddata_.back().second, tracker_.get());
-    lstsenddata_.back().second->Seek(0, AutoBuffer::ESeekStart);
+    AutoBuffer& packed = sendqueue_.Push(_task);
+    longlink_pack(_task.cmdid, _task.taskid, _body, _extension, packed, tracker_.get());
+    packed.Seek(0, AutoBuffer::ESeekStart);
 
     readwritebreak_.Break();
     return true;
@@ -179,7 +169,7 @@ bool LongLink::SendWhenNoData(const AutoBuffer& _body, const AutoBuffer& _extens
     ScopedLock lock(mutex_);
 
     if (kConnected != connectstatus_) return false;
-    if (!lstsenddata_.empty()) return false;
+    if (!sendqueue_.Empty()) return false;
 
     xassert2(tracker_.get());
     
@@ -187,9 +177,9 @@ bool LongLink::SendWhenNoData(const AutoBuffer& _body, const AutoBuffer& _extens
     task.send_only = true;
     task.cmdid = _cmdid;
     task.taskid = _taskid;
-    lstsenddata_.push_back(std::make_pair(task, move_wrapper<AutoBuffer>(AutoBuffer())));
-    longlink_pack(_cmdid, _taskid, _body, _extension, lstsenddata_.back().second, tracker_.get());
-    lstsenddata_.back().second->Seek(0, AutoBuffer::ESeekStart);
+    AutoBuffer& packed = sendqueue_.Push(task);
+    longlink_pack(_cmdid, _taskid, _body, _extension, packed, tracker_.get());
+    packed.Seek(0, AutoBuffer::ESeekStart);
     
     readwritebreak_.Break();
     return true;
@@ -204,15 +194,7 @@ bool LongLink::__SendNoopWhenNoData() {
 
 bool LongLink::Stop(uint32_t _taskid) {
     ScopedLock lock(mutex_);
-
-    for (auto it = lstsenddata_.begin(); it != lstsenddata_.end(); ++it) {
-        if (_taskid == it->first.taskid && 0 == it->second->Pos()) {
-            lstsenddata_.erase(it);
-            return true;
-        }
-    }
-
-    return false;
+    return sendqueue_.Stop(_taskid);
 }
 
 
@@ -225,7 +207,7 @@ bool LongLink::MakeSureConnected(bool* _newone) {
     if (kConnected == ConnectStatus()) return true;
 
     bool newone = false;
-    thread_.start(&newone);
+    __StartWorker(&newone);
 
     if (newone) {
         connectstatus_ = kConnectIdle;
@@ -234,7 +216,7 @@ bool LongLink::MakeSureConnected(bool* _newone) {
         disconnectinternalcode_ = kNone;
         readwritebreak_.Clear();
         connectbreak_.Clear();
-        lstsenddata_.clear();
+        sendqueue_.Clear();
     }
 
     if (_newone) *_newone = newone;
@@ -247,7 +229,7 @@ void LongLink::Disconnect(TDisconnectInternalCode _scene) {
     
     ScopedLock lock(mutex_);
 
-    if (!thread_.isruning()) return;
+    if (!__IsWorkerRunning()) return;
 
     disconnectinternalcode_ = _scene;
 
@@ -262,7 +244,7 @@ void LongLink::Disconnect(TDisconnectInternalCode _scene) {
     lock.unlock();
     
     dns_util_.Cancel();
-    thread_.join();
+    __JoinWorker();
 
     if (recreate) {
         connectbreak_.ReCreate();
@@ -270,6 +252,23 @@ void LongLink::Disconnect(TDisconnectInternalCode _scene) {
     }
 }
 
+SocketSelect* LongLink::__CreateSelect(SocketBreaker& _breaker) {
+    // the same socket every round, keep it registered rather than handing the set to the kernel each time.
+    return new SocketSelect(_breaker, true, true);
+}
+
+void LongLink::__StartWorker(bool* _newone) {
+    thread_.start(_newone);
+}
+
+bool LongLink::__IsWorkerRunning() {
+    return thread_.isruning();
+}
+
+void LongLink::__JoinWorker() {
+    thread_.join();
+}
+
 bool LongLink::__NoopReq(XLogger& _log, Alarm& _alarm, bool need_active_timeout) {
     AutoBuffer buffer;
     uint32_t req_cmdid = 0;
@@ -341,6 +340,11 @@ void LongLink::__RunResponseError(ErrCmdType _error_type, int _error_code, Conne
     if (_networkreport && fun_network_report_) fun_network_report_(__LINE__, _error_type, _error_code, _profile.ip, _profile.port);
 }
 
+void LongLink::DetachSmartHeartbeat() {
+    xassert2(!__IsWorkerRunning());
+    delete smartheartbeat_, smartheartbeat_ = NULL;
+}
+
 LongLink::TLongLinkStatus LongLink::ConnectStatus() const {
     return connectstatus_;
 }
@@ -430,13 +434,31 @@ void LongLink::__Run() {
 }
 
 SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
+    std::vector<socket_address> vecaddr;
+    socket_address* proxy_addr = NULL;
+
+    if (!__PrepareConnect(_conn_profile, vecaddr, proxy_addr)) return INVALID_SOCKET;
+    
+    LongLinkConnectObserver connect_observer(*this, _conn_profile.ip_items);
+    ComplexConnect com_connect(kLonglinkConnTimeout, kLonglinkConnInteral, kLonglinkConnInteral, kLonglinkConnMax);
+
+    SOCKET sock = com_connect.ConnectImpatient(vecaddr, connectbreak_, &connect_observer, _conn_profile.proxy_info.type, proxy_addr, _conn_profile.proxy_info.username, _conn_profile.proxy_info.password);
+
+    delete proxy_addr;
+
+    return __ConnectFinished(_conn_profile, sock, com_connect.Index(), com_connect.ErrorCode(), com_connect.IndexRtt(), com_connect.IndexTotalCost(),
+                             com_connect.TotalCost(), com_connect.TryCount(), connect_observer.connecting_index_);
+}
+
+bool LongLink::__PrepareConnect(ConnectProfile& _conn_profile, std::vector<socket_address>& _vecaddr, socket_address*& _proxy_addr) {
     
     __ConnectStatus(kConnecting);
     _conn_profile.dns_time = ::gettickcount();
      __UpdateProfile(_conn_profile);
     
     std::vector<IPPortItem> ip_items;
-    std::vector<socket_address> vecaddr;
+    std::vector<socket_address>& vecaddr = _vecaddr;
+    _proxy_addr = NULL;
 
     netsource_.GetLongLinkItems(ip_items, dns_util_);
     mars::comm::ProxyInfo proxy_info = mars::app::GetProxyInfo("");
@@ -461,7 +483,7 @@ SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
         xerror2("task socket close sock:-1 vecaddr empty");
         __ConnectStatus(kConnectFailed);
         __RunResponseError(kEctDns, kEctDnsMakeSocketPrepared, _conn_profile);
-        return INVALID_SOCKET;
+        return false;
     }
     
     _conn_profile.proxy_info = proxy_info;
@@ -474,8 +496,6 @@ SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
     _conn_profile.dns_endtime = ::gettickcount();
     __UpdateProfile(_conn_profile);
     
-    socket_address* proxy_addr = NULL;
-    
     if (use_proxy) {
         std::string proxy_ip = proxy_info.ip;
         if (proxy_info.ip.empty() && !proxy_info.host.empty()) {
@@ -484,13 +504,13 @@ SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
                 xwarn2(TSF"dns %_ error", proxy_info.host);
                 __ConnectStatus(kConnectFailed);
                 __RunResponseError(kEctDns, kEctDnsMakeSocketPrepared, _conn_profile);
-                return INVALID_SOCKET;
+                return false;
             }
             
-			proxy_addr = &((new socket_address(ips.front().c_str(), proxy_info.port))->v4tov6_address(isnat64));
+			_proxy_addr = &((new socket_address(ips.front().c_str(), proxy_info.port))->v4tov6_address(isnat64));
 
         } else {
-			proxy_addr = &((new socket_address(proxy_ip.c_str(), proxy_info.port))->v4tov6_address(isnat64));
+			_proxy_addr = &((new socket_address(proxy_ip.c_str(), proxy_info.port))->v4tov6_address(isnat64));
         }
         
         _conn_profile.ip_type = kIPSourceProxy;
@@ -498,23 +518,23 @@ SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
     }
     
     // set the first ip info to the profiler, after connect, the ip info will be overwrriten by the real one
-    
-    LongLinkConnectObserver connect_observer(*this, ip_items);
-    ComplexConnect com_connect(kLonglinkConnTimeout, kLonglinkConnInteral, kLonglinkConnInteral, kLonglinkConnMax);
-
-    SOCKET sock = com_connect.ConnectImpatient(vecaddr, connectbreak_, &connect_observer, proxy_info.type, proxy_addr, proxy_info.username, proxy_info.password);
+    return true;
+}
 
-    delete proxy_addr;
+SOCKET LongLink::__ConnectFinished(ConnectProfile& _conn_profile, SOCKET _sock, int _index, int _errcode, unsigned int _index_rtt, unsigned int _index_total_cost,
+                                   unsigned int _total_cost, unsigned int _try_count, const char* _connecting) {
+    SOCKET sock = _sock;
+    const std::vector<IPPortItem>& ip_items = _conn_profile.ip_items;
  
     _conn_profile.conn_time = gettickcount();
-    _conn_profile.conn_errcode = com_connect.ErrorCode();
-    _conn_profile.conn_rtt = com_connect.IndexRtt();
-    _conn_profile.conn_cost = com_connect.TotalCost();
-    _conn_profile.tryip_count = com_connect.TryCount();
+    _conn_profile.conn_errcode = _errcode;
+    _conn_profile.conn_rtt = _index_rtt;
+    _conn_profile.conn_cost = _total_cost;
+    _conn_profile.tryip_count = _try_count;
     __UpdateProfile(_conn_profile);
     
     if (INVALID_SOCKET == sock) {
-        xwarn2(TSF"task socket connect fail sock:-1, costtime:%0", com_connect.TotalCost());
+        xwarn2(TSF"task socket connect fail sock:-1, costtime:%0", _total_cost);
         
         __ConnectStatus(kConnectFailed);
         
@@ -523,25 +543,25 @@ SOCKET LongLink::__RunConnect(ConnectProfile& _conn_profile) {
         return INVALID_SOCKET;
     }
     
-    xassert2(0 <= com_connect.Index() && (unsigned int)com_connect.Index() < ip_items.size());
+    xassert2(0 <= _index && (unsigned int)_index < ip_items.size());
     
     if (fun_network_report_) {
-        for (int i = 0; i < com_connect.Index(); ++i) {
-            if (1 == connect_observer.connecting_index_[i])
+        for (int i = 0; i < _index; ++i) {
+            if (1 == _connecting[i])
                 fun_network_report_(__LINE__, kEctSocket, SOCKET_ERRNO(ETIMEDOUT), ip_items[i].str_ip, ip_items[i].port);
         }
     }
     
-    _conn_profile.ip_index = com_connect.Index();
-    _conn_profile.host = ip_items[com_connect.Index()].str_host;
-    _conn_profile.ip_type = ip_items[com_connect.Index()].source_type;
-    _conn_profile.ip = ip_items[com_connect.Index()].str_ip;
-    _conn_profile.port = ip_items[com_connect.Index()].port;
+    _conn_profile.ip_index = _index;
+    _conn_profile.host = ip_items[_index].str_host;
+    _conn_profile.ip_type = ip_items[_index].source_type;
+    _conn_profile.ip = ip_items[_index].str_ip;
+    _conn_profile.port = ip_items[_index].port;
     _conn_profile.local_ip = socket_address::getsockname(sock).ip();
     _conn_profile.local_port = socket_address::getsockname(sock).port();
     
     xinfo2(TSF"task socket connect suc sock:%_, host:%_, ip:%_, port:%_, local_ip:%_, local_port:%_, iptype:%_, costtime:%_, rtt:%_, totalcost:%_, index:%_, net:%_",
-           sock, _conn_profile.host, _conn_profile.ip, _conn_profile.port, _conn_profile.local_ip, _conn_profile.local_port, IPSourceTypeString[_conn_profile.ip_type], com_connect.TotalCost(), com_connect.IndexRtt(), com_connect.IndexTotalCost(), com_connect.Index(), ::getNetInfo());
+           sock, _conn_profile.host, _conn_profile.ip, _conn_profile.port, _conn_profile.local_ip, _conn_profile.local_port, IPSourceTypeString[_conn_profile.ip_type], _total_cost, _index_rtt, _index_total_cost, _index, ::getNetInfo());
     __ConnectStatus(kConnected);
     __UpdateProfile(_conn_profile);
     
@@ -570,6 +590,17 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
     bool nooping = false;
     xgroup2_define(close_log);
     
+    boost::scoped_ptr<SocketSelect> sel_holder(__CreateSelect(readwritebreak_));
+    SocketSelect& sel = *sel_holder;
+
+#ifdef TCP_NOTSENT_LOWAT
+    // what the kernel holds unsent can't be reordered any more, the rest waits in sendqueue_ by priority.
+    int notsent_lowat = kLonglinkNotSentLowat;
+    if (0 != setsockopt(_sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &notsent_lowat, sizeof(notsent_lowat))) {
+        xwarn2(TSF"sock:%_, TCP_NOTSENT_LOWAT errno:%_", _sock, socket_errno);
+    }
+#endif
+    
     while (true) {
         if (!alarmnoopinterval.IsWaiting()) {
             if (first_noop_sent && alarmnoopinterval.Status() != Alarm::kOnAlarm) {
@@ -604,14 +635,13 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
             goto End;
         }
         
-        SocketSelect sel(readwritebreak_, true);
         sel.PreSelect();
         sel.Read_FD_SET(_sock);
         sel.Exception_FD_SET(_sock);
         
         ScopedLock lock(mutex_);
         
-        if (!lstsenddata_.empty()) sel.Write_FD_SET(_sock);
+        if (!sendqueue_.Empty()) sel.Write_FD_SET(_sock);
         
         lock.unlock();
         
@@ -659,28 +689,21 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
             nsent_datas.clear();
         }
         
-        if (sel.Write_FD_ISSET(_sock) && !lstsenddata_.empty()) {
+        if (sel.Write_FD_ISSET(_sock) && !sendqueue_.Empty()) {
+            // a send is one grouped text line, or one binary record per piece when binary logs are on.
+            const bool binary_log = xlogger_IsBinaryEnabled();
             xgroup2_define(xlog_group);
-            xinfo2(TSF"task socket send sock:%0, ", _sock) >> xlog_group;
-            
-#ifndef WIN32
-            iovec* vecwrite = (iovec*)calloc(lstsenddata_.size(), sizeof(iovec));
-            unsigned int offset = 0;
-            
-            for (auto it = lstsenddata_.begin(); it != lstsenddata_.end(); ++it) {
-                vecwrite[offset].iov_base = it->second->PosPtr();
-                vecwrite[offset].iov_len = it->second->PosLength();
-                
-                ++offset;
+            if (!binary_log) {
+                xinfo2(TSF"task socket send sock:%0, ", _sock) >> xlog_group;
             }
             
-            ssize_t writelen = writev(_sock, vecwrite, (int)lstsenddata_.size());
-            
-            free(vecwrite);
+#ifndef WIN32
+            iovec* vecwrite = NULL;
+            int veccount = sendqueue_.Gather(kLonglinkSendFrameSize, vecwrite);
+            ssize_t writelen = writev(_sock, vecwrite, veccount);
 #else
-
-            //ssize_t writelen = ::send(_sock, lstsenddata_.begin()->data.PosPtr(), lstsenddata_.begin()->data.PosLength(), 0);
-			ssize_t writelen = ::send(_sock, lstsenddata_.begin()->second->PosPtr(), lstsenddata_.begin()->second->PosLength(), 0);
+            LongLinkSendQueue::Packet& front = sendqueue_.Front();
+			ssize_t writelen = ::send(_sock, front.second->PosPtr(), std::min(front.second->PosLength(), (size_t)kLonglinkSendFrameSize), 0);
 #endif
             
             if (0 == writelen || (0 > writelen && !IS_NOBLOCK_SEND_ERRNO(socket_errno))) {
@@ -698,27 +721,39 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
             alarmnoopinterval.Cancel();
             alarmnoopinterval.Start((int)lastheartbeat_);
             
-            xinfo2(TSF"all send:%_, count:%_, ", writelen, lstsenddata_.size()) >> xlog_group;
+            if (binary_log) {
+                xinfo2_bin(TSF"task socket send sock:%_, all send:%_, count:%_", _sock, writelen, sendqueue_.Count());
+            } else {
+                xinfo2(TSF"all send:%_, count:%_, ", writelen, sendqueue_.Count()) >> xlog_group;
+            }
             
             GetSignalOnNetworkDataChange()(XLOGGER_TAG, writelen, 0);
             
-            auto it = lstsenddata_.begin();
-            
-            while (it != lstsenddata_.end() && 0 < writelen) {
-                if (0 == it->second->Pos() && OnSend) OnSend(it->first.taskid);
+            while (!sendqueue_.Empty() && 0 < writelen) {
+                LongLinkSendQueue::Packet& packet = sendqueue_.Front();
+                if (0 == packet.second->Pos() && OnSend) OnSend(packet.first.taskid);
                 
-                if ((size_t)writelen >= it->second->PosLength()) {
-                    xinfo2(TSF"sub send taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_), ", it->first.taskid, it->first.cmdid, it->first.cgi, it->second->PosLength(), it->second->PosLength(), it->second->Length()) >> xlog_group;
-                    writelen -= it->second->PosLength();
-                    if (!it->first.send_only) { sent_taskids[it->first.taskid].task = it->first; }
+                if ((size_t)writelen >= packet.second->PosLength()) {
+                    if (binary_log) {
+                        xinfo2_bin(TSF"sub send sock:%_, taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_)", _sock, packet.first.taskid, packet.first.cmdid, packet.first.cgi, packet.second->PosLength(), packet.second->PosLength(), packet.second->Length());
+                    } else {
+                        xinfo2(TSF"sub send taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_), ", packet.first.taskid, packet.first.cmdid, packet.first.cgi, packet.second->PosLength(), packet.second->PosLength(), packet.second->Length()) >> xlog_group;
+                    }
+                    writelen -= packet.second->PosLength();
+                    if (!packet.first.send_only) { sent_taskids[packet.first.taskid].task = packet.first; }
                     
-                    LongLinkNWriteData nwrite(it->second->Length(), it->first);
+                    LongLinkNWriteData nwrite(packet.second->Length(), packet.first);
                     nsent_datas.push_back(nwrite);
                     
-                    it = lstsenddata_.erase(it);
+                    sendqueue_.Pop();
                 } else {
-                    xinfo2(TSF"sub send taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_), ", it->first.taskid, it->first.cmdid, it->first.cgi, writelen, it->second->PosLength(), it->second->Length()) >> xlog_group;
-                    it->second->Seek(writelen, AutoBuffer::ESeekCur);
+                    if (binary_log) {
+                        xinfo2_bin(TSF"sub send sock:%_, taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_)", _sock, packet.first.taskid, packet.first.cmdid, packet.first.cgi, writelen, packet.second->PosLength(), packet.second->Length());
+                    } else {
+                        xinfo2(TSF"sub send taskid:%_, cmdid:%_, %_, len(S:%_, %_/%_), ", packet.first.taskid, packet.first.cmdid, packet.first.cgi, writelen, packet.second->PosLength(), packet.second->Length()) >> xlog_group;
+                    }
+                    packet.second->Seek(writelen, AutoBuffer::ESeekCur);
+                    sendqueue_.Started();
                     writelen = 0;
                 }
             }
@@ -749,7 +784,7 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
             GetSignalOnNetworkDataChange()(XLOGGER_TAG, 0, recvlen);
             
             bufrecv.Length(bufrecv.Pos() + recvlen, bufrecv.Length() + recvlen);
-            xinfo2(TSF"task socket recv sock:%_, recv len:%_, buff len:%_", _sock, recvlen, bufrecv.Length());
+            xinfo2_bin(TSF"task socket recv sock:%_, recv len:%_, buff len:%_", _sock, recvlen, bufrecv.Length());
             
             while (0 < bufrecv.Length()) {
                 uint32_t cmdid = 0;
@@ -768,7 +803,7 @@ void LongLink::__RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode,
                 }
                 
                 StreamResp& stream_resp = sent_taskids[taskid];
-                xinfo2(TSF"task socket recv sock:%_, pack recv %_ taskid:%_, cmdid:%_, %_, packlen:(%_/%_)", _sock, LONGLINK_UNPACK_CONTINUE == unpackret ? "continue" : "finish", taskid, cmdid, stream_resp.task.cgi, LONGLINK_UNPACK_CONTINUE == unpackret ? bufrecv.Length() : packlen, packlen);
+                xinfo2_bin(TSF"task socket recv sock:%_, pack recv %_ taskid:%_, cmdid:%_, %_, packlen:(%_/%_)", _sock, LONGLINK_UNPACK_CONTINUE == unpackret ? "continue" : "finish", taskid, cmdid, stream_resp.task.cgi, LONGLINK_UNPACK_CONTINUE == unpackret ? bufrecv.Length() : packlen, packlen);
                 lastrecvtime_.gettickcount();
                 
                 if (LONGLINK_UNPACK_CONTINUE == unpackret) {
@@ -34,12 +34,14 @@
 #include "mars/comm/move_wrapper.h"
 #include "mars/comm/messagequeue/message_queue.h"
 #include "mars/comm/socket/socketselect.h"
+#include "mars/comm/socket/complexconnect.h"
 
 #include "mars/stn/stn.h"
 #include "mars/stn/task_profile.h"
 
 #include "mars/stn/src/net_source.h"
 #include "mars/stn/src/longlink_identify_checker.h"
+#include "mars/stn/src/longlink_send_queue.h"
 
 class AutoBuffer;
 class XLogger;
@@ -130,6 +132,10 @@ class LongLink {
 
     ConnectProfile  Profile() const   { return conn_profile_; }
     tickcount_t&    GetLastRecvTime() { return lastrecvtime_; }
+
+    // the link keeps a noop interval of its own and stops feeding SmartHeartbeat, whose state is per network
+    // and shared by the process. for a link beside the main one, before it connects.
+    void            DetachSmartHeartbeat();
     
   private:
     LongLink(const LongLink&);
@@ -148,6 +154,20 @@ class LongLink {
     virtual void     __Run();
     virtual SOCKET   __RunConnect(ConnectProfile& _conn_profile);
     virtual void     __RunReadWrite(SOCKET _sock, ErrCmdType& _errtype, int& _errcode, ConnectProfile& _profile);
+
+    // the steps of __RunConnect around the connect race, shared with the links that don't run a thread each.
+    // false if there is nothing to connect to, the failure is reported already.
+    bool             __PrepareConnect(ConnectProfile& _conn_profile, std::vector<socket_address>& _vecaddr, socket_address*& _proxy_addr);
+    // _connecting: per address, whether it was still connecting when _index got through.
+    SOCKET           __ConnectFinished(ConnectProfile& _conn_profile, SOCKET _sock, int _index, int _errcode, unsigned int _index_rtt, unsigned int _index_total_cost,
+                                       unsigned int _total_cost, unsigned int _try_count, const char* _connecting);
+
+    // what runs __Run, a thread of its own here. a link overriding them calls Disconnect in its own destructor.
+    virtual void     __StartWorker(bool* _newone);
+    virtual bool     __IsWorkerRunning();
+    virtual void     __JoinWorker();
+    // the select __RunReadWrite waits on, owned by the caller.
+    virtual SocketSelect* __CreateSelect(SocketBreaker& _breaker);
   protected:
     
     uint32_t   __GetNextHeartbeatInterval();
@@ -172,13 +192,36 @@ class LongLink {
     
     SocketBreaker                                        readwritebreak_;
     LongLinkIdentifyChecker                              identifychecker_;
-    std::list<std::pair<Task, move_wrapper<AutoBuffer>>> lstsenddata_;
+    LongLinkSendQueue                                    sendqueue_;
     tickcount_t                                          lastrecvtime_;
     
     SmartHeartbeat*                              smartheartbeat_;
     WakeUpLock*                                  wakelock_;
     unsigned long long              lastheartbeat_;
 };
+
+class LongLinkConnectObserver : public MComplexConnect {
+  public:
+    LongLinkConnectObserver(LongLink& _longlink, const std::vector<IPPortItem>& _iplist);
+
+    virtual void OnCreated(unsigned int _index, const socket_address& _addr, SOCKET _socket) {}
+    virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket);
+    virtual void OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt);
+
+    virtual bool OnShouldVerify(unsigned int _index, const socket_address& _addr);
+    virtual bool OnVerifySend(unsigned int _index, const socket_address& _addr, SOCKET _socket, AutoBuffer& _buffer_send);
+    virtual bool OnVerifyRecv(unsigned int _index, const socket_address& _addr, SOCKET _socket, const AutoBuffer& _buffer_recv);
+
+    char connecting_index_[32];
+
+  private:
+    LongLinkConnectObserver(const LongLinkConnectObserver&);
+    LongLinkConnectObserver& operator=(const LongLinkConnectObserver&);
+
+  public:
+    LongLink& longlink_;
+    const std::vector<IPPortItem>& ip_items_;
+};
         
 }}
 
@@ -0,0 +1,109 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in 
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * longlink_send_queue.cc
+ *
+ *  Created on: 2026-10-18
+ */
+
+#include "longlink_send_queue.h"
+
+#include <algorithm>
+
+#include "mars/comm/xlogger/xlogger.h"
+
+using namespace mars::stn;
+
+static const int kQueueCount = Task::kTaskPriorityLowest + 1;
+
+LongLinkSendQueue::LongLinkSendQueue(): count_(0) {}
+
+AutoBuffer& LongLinkSendQueue::Push(const Task& _task) {
+    int priority = std::min(std::max((int)_task.priority, (int)Task::kTaskPriorityHighest), (int)Task::kTaskPriorityLowest);
+
+    std::list<Packet>& queue = queues_[priority];
+    queue.push_back(std::make_pair(_task, move_wrapper<AutoBuffer>(AutoBuffer())));
+    ++count_;
+    return queue.back().second;
+}
+
+bool LongLinkSendQueue::Stop(uint32_t _taskid) {
+    for (int i = 0; i < kQueueCount; ++i) {
+        for (std::list<Packet>::iterator it = queues_[i].begin(); it != queues_[i].end(); ++it) {
+            if (_taskid != it->first.taskid) continue;
+
+            xassert2(0 == it->second->Pos());
+            queues_[i].erase(it);
+            --count_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void LongLinkSendQueue::Clear() {
+    started_.clear();
+    for (int i = 0; i < kQueueCount; ++i) queues_[i].clear();
+    count_ = 0;
+}
+
+LongLinkSendQueue::Packet& LongLinkSendQueue::Front() {
+    return __FrontQueue().front();
+}
+
+void LongLinkSendQueue::Started() {
+    if (!started_.empty()) return;
+
+    std::list<Packet>& queue = __FrontQueue();
+    started_.splice(started_.end(), queue, queue.begin());
+}
+
+void LongLinkSendQueue::Pop() {
+    __FrontQueue().pop_front();
+    --count_;
+}
+
+#ifndef _WIN32
+int LongLinkSendQueue::Gather(size_t _max_len, iovec*& _vec) {
+    int count = 0;
+    size_t len = 0;
+
+    std::list<Packet>* queues[kQueueCount + 1] = {&started_};
+    for (int i = 0; i < kQueueCount; ++i) queues[i + 1] = &queues_[i];
+
+    for (int i = 0; i < kQueueCount + 1 && count < kMaxIov && len < _max_len; ++i) {
+        for (std::list<Packet>::iterator it = queues[i]->begin(); it != queues[i]->end() && count < kMaxIov && len < _max_len; ++it) {
+            vec_[count].iov_base = it->second->PosPtr();
+            vec_[count].iov_len = std::min(it->second->PosLength(), _max_len - len);
+            len += vec_[count].iov_len;
+            ++count;
+        }
+    }
+
+    _vec = vec_;
+    return count;
+}
+#endif
+
+std::list<LongLinkSendQueue::Packet>& LongLinkSendQueue::__FrontQueue() {
+    xassert2(!Empty());
+    if (!started_.empty()) return started_;
+
+    for (int i = 0; i < kQueueCount; ++i) {
+        if (!queues_[i].empty()) return queues_[i];
+    }
+
+    return started_;
+}
@@ -0,0 +1,95 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in 
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * longlink_send_queue.h
+ *
+ *  Created on: 2026-10-18
+ */
+
+#ifndef STN_SRC_LONGLINK_SEND_QUEUE_H_
+#define STN_SRC_LONGLINK_SEND_QUEUE_H_
+
+#include <limits.h>
+#include <stddef.h>
+#include <list>
+#include <utility>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+#include "mars/comm/autobuffer.h"
+#include "mars/comm/move_wrapper.h"
+#include "mars/stn/stn.h"
+
+namespace mars {
+namespace stn {
+
+/*
+ * What LongLink has to write, a queue for each Task::priority.
+ * The longlink packets go out whole, one after the other: the packet started goes on until it is written,
+ * the next is the first of the highest priority. Each round hands out one frame (_max_len bytes),
+ * so a packet of a higher priority queued meanwhile goes before the rest of the lower ones.
+ */
+class LongLinkSendQueue {
+  public:
+    typedef std::pair<Task, move_wrapper<AutoBuffer> > Packet;
+
+#ifndef _WIN32
+#if defined(IOV_MAX) && IOV_MAX < 64
+    static const int kMaxIov = IOV_MAX;
+#else
+    static const int kMaxIov = 64;
+#endif
+#endif
+
+  public:
+    LongLinkSendQueue();
+
+    AutoBuffer& Push(const Task& _task);    // to pack the packet into
+    bool        Stop(uint32_t _taskid);     // only what isn't started
+    void        Clear();
+
+    bool        Empty() const { return 0 == count_; }
+    size_t      Count() const { return count_; }
+
+    Packet&     Front();    // the next to write, not Empty()
+    void        Started();  // Front() is written in part, it stays in front
+    void        Pop();      // Front() is all written
+
+#ifndef _WIN32
+    // the next frame from Front() on, in an array kept by the queue. returns the count of _vec.
+    int         Gather(size_t _max_len, iovec*& _vec);
+#endif
+
+  private:
+    std::list<Packet>& __FrontQueue();
+
+  private:
+    LongLinkSendQueue(const LongLinkSendQueue&);
+    LongLinkSendQueue& operator=(const LongLinkSendQueue&);
+
+  private:
+    std::list<Packet>   started_;   // one at most
+    std::list<Packet>   queues_[Task::kTaskPriorityLowest + 1];
+    size_t              count_;
+#ifndef _WIN32
+    iovec               vec_[kMaxIov];
+#endif
+};
+
+}
+}
+
+#endif // STN_SRC_LONGLINK_SEND_QUEUE_H_
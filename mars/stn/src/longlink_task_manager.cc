@@ -53,29 +53,32 @@ LongLinkTaskManager::LongLinkTaskManager(NetSource& _netsource, ActiveLogic& _ac
     , lastbatcherrortime_(0)
     , retry_interval_(0)
     , tasks_continuous_fail_count_(0)
-    , longlink_(LongLinkChannelFactory::Create(_messagequeue_id, _netsource))
-    , longlinkconnectmon_(new LongLinkConnectMonitor(_activelogic, *longlink_, _messagequeue_id))
+    , netsource_(_netsource)
+    , longlinks_(1, __CreateLink(0))
+    , link_connect_time_(1, 0)
+    , placement_(kPlaceBySize)
+    , longlinkconnectmon_(new LongLinkConnectMonitor(_activelogic, *longlinks_.front(), _messagequeue_id))
     , dynamic_timeout_(_dynamictimeout)
 #ifdef ANDROID
     , wakeup_lock_(new WakeUpLock())
 #endif
 {
     xinfo_function(TSF"handler:(%_,%_)", asyncreg_.Get().queue, asyncreg_.Get().seq);
-    longlink_->OnSend = boost::bind(&LongLinkTaskManager::__OnSend, this, _1);
-    longlink_->OnRecv = boost::bind(&LongLinkTaskManager::__OnRecv, this, _1, _2, _3);
-    longlink_->OnResponse = boost::bind(&LongLinkTaskManager::__OnResponse, this, _1, _2, _3, _4, _5, _6, _7);
-    longlink_->SignalConnection.connect(boost::bind(&LongLinkTaskManager::__SignalConnection, this, _1));
 }
 
 LongLinkTaskManager::~LongLinkTaskManager() {
     xinfo_function();
-    longlink_->SignalConnection.disconnect(boost::bind(&LongLinkTaskManager::__SignalConnection, this, _1));
+    for (size_t i = 0; i < longlinks_.size(); ++i) {
+        longlinks_[i]->SignalConnection.disconnect(boost::bind(&LongLinkTaskManager::__SignalConnection, this, _1));
+    }
     asyncreg_.CancelAndWait();
     
-    __BatchErrorRespHandle(kEctLocal, kEctLocalReset, kTaskFailHandleTaskEnd, Task::kInvalidTaskID, longlink_->Profile(), false);
+    __BatchErrorRespHandle(kEctLocal, kEctLocalReset, kTaskFailHandleTaskEnd, Task::kInvalidTaskID, LongLinkChannel().Profile(), false);
     
     delete longlinkconnectmon_;
-    LongLinkChannelFactory::Destory(longlink_);
+    for (size_t i = 0; i < longlinks_.size(); ++i) {
+        __DestroyLink(longlinks_[i]);
+    }
 #ifdef ANDROID
     delete wakeup_lock_;
 #endif
@@ -105,7 +108,7 @@ bool LongLinkTaskManager::StopTask(uint32_t _taskid) {
         if (_taskid == first->task.taskid) {
             xinfo2(TSF"find the task taskid:%0", _taskid);
 
-            longlink_->Stop(first->task.taskid);
+            longlinks_[first->link_index]->Stop(first->task.taskid);
             lst_cmd_.erase(first);
             return true;
         }
@@ -134,7 +137,7 @@ bool LongLinkTaskManager::HasTask(uint32_t _taskid) const {
 
 void LongLinkTaskManager::ClearTasks() {
     xverbose_function();
-    longlink_->Disconnect(LongLink::kReset);
+    __DisconnectLinks(-1, LongLink::kReset);
     MessageQueue::CancelMessage(asyncreg_.Get(), 0);
     lst_cmd_.clear();
 }
@@ -160,12 +163,17 @@ void LongLinkTaskManager::RedoTasks() {
         first->last_failed_dyntime_status = 0;
         if (first->running_id) {
             xinfo2(TSF "task redo, taskid:%_", first->task.taskid);
-            __SingleRespHandle(first, kEctLocal, kEctLocalCancel, kTaskFailHandleDefault, longlink_->Profile());
+            __SingleRespHandle(first, kEctLocal, kEctLocalCancel, kTaskFailHandleDefault, longlinks_[first->link_index]->Profile());
         }
 
         first = next;
     }
 
+    // the main link is left to NetCore, the others connect again on the next tasks.
+    for (size_t i = 1; i < longlinks_.size(); ++i) {
+        longlinks_[i]->Disconnect(LongLink::kReset);
+    }
+
     retry_interval_ = 0;
 
     MessageQueue::CancelMessage(asyncreg_.Get(), 0);
@@ -174,10 +182,34 @@ void LongLinkTaskManager::RedoTasks() {
 
 void LongLinkTaskManager::RetryTasks(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid) {
     xverbose_function();
-    __BatchErrorRespHandle(_err_type, _err_code, _fail_handle, _src_taskid, longlink_->Profile());
+    __BatchErrorRespHandle(_err_type, _err_code, _fail_handle, _src_taskid, LongLinkChannel().Profile());
     __RunLoop();
 }
 
+void LongLinkTaskManager::SetLinkGroup(size_t _count, TLinkPlacement _placement) {
+    xinfo2(TSF"links:%_->%_, placement:%_->%_", longlinks_.size(), _count, placement_, _placement);
+    xassert2(0 < _count);
+    if (0 == _count) _count = 1;
+
+    placement_ = _placement;
+
+    while (longlinks_.size() > _count) {
+        int index = (int)longlinks_.size() - 1;
+        // its tasks start again on the links left.
+        __BatchErrorRespHandle(kEctLocal, kEctLocalCancel, kTaskFailHandleDefault, Task::kInvalidTaskID, longlinks_[index]->Profile(), true, index);
+
+        LongLink* longlink = longlinks_.back();
+        longlinks_.pop_back();
+        link_connect_time_.pop_back();
+        __DestroyLink(longlink);
+    }
+
+    while (longlinks_.size() < _count) {
+        longlinks_.push_back(__CreateLink((int)longlinks_.size()));
+        link_connect_time_.push_back(0);
+    }
+}
+
 
 void LongLinkTaskManager::__RunLoop() {
     
@@ -213,8 +245,10 @@ void LongLinkTaskManager::__RunOnTimeout() {
 
     uint64_t cur_time = ::gettickcount();
     int socket_timeout_code = 0;
+    int socket_timeout_link = 0;
     uint32_t src_taskid = Task::kInvalidTaskID;
     bool istasktimeout = false;
+    int task_timeout_link = 0;
 
     while (first != last) {
         std::list<TaskProfile>::iterator next = first;
@@ -225,6 +259,7 @@ void LongLinkTaskManager::__RunOnTimeout() {
                 xerror2(TSF"task first-pkg timeout taskid:%_,  nStartSendTime=%_, nfirstpkgtimeout=%_",
                         first->task.taskid, first->transfer_profile.start_send_time / 1000, first->transfer_profile.first_pkg_timeout / 1000);
                 socket_timeout_code = kEctLongFirstPkgTimeout;
+                socket_timeout_link = first->link_index;
                 src_taskid = first->task.taskid;
                 __SetLastFailedStatus(first);
             }
@@ -233,6 +268,7 @@ void LongLinkTaskManager::__RunOnTimeout() {
                 xerror2(TSF"task pkg-pkg timeout, taskid:%_, nLastRecvTime=%_, pkg-pkg timeout=%_",
                         first->task.taskid, first->transfer_profile.last_receive_pkg_time / 1000, ((kMobile != getNetInfo()) ? kWifiPackageInterval : kGPRSPackageInterval) / 1000);
                 socket_timeout_code = kEctLongPkgPkgTimeout;
+                socket_timeout_link = first->link_index;
                 src_taskid = first->task.taskid;
             }
             
@@ -240,6 +276,7 @@ void LongLinkTaskManager::__RunOnTimeout() {
                 xerror2(TSF"task read-write timeout, taskid:%_, , nStartSendTime=%_, nReadWriteTimeOut=%_",
                         first->task.taskid, first->transfer_profile.start_send_time / 1000, first->transfer_profile.read_write_timeout / 1000);
                 socket_timeout_code = kEctLongReadWriteTimeout;
+                socket_timeout_link = first->link_index;
                 src_taskid = first->task.taskid;
             }
         }
@@ -247,7 +284,8 @@ void LongLinkTaskManager::__RunOnTimeout() {
         if (cur_time - first->start_task_time >= first->task_timeout) {
             xerror2(TSF"task timeout, taskid:%_, nStartSendTime=%_, cur_time=%_, timeout:%_",
                     first->task.taskid, first->transfer_profile.start_send_time / 1000, cur_time / 1000, first->task_timeout / 1000);
-            __SingleRespHandle(first, kEctLocal, kEctLocalTaskTimeout, kTaskFailHandleTaskTimeout, longlink_->Profile());
+            task_timeout_link = first->link_index;
+            __SingleRespHandle(first, kEctLocal, kEctLocalTaskTimeout, kTaskFailHandleTaskTimeout, longlinks_[task_timeout_link]->Profile());
             istasktimeout = true;
         }
 
@@ -255,12 +293,13 @@ void LongLinkTaskManager::__RunOnTimeout() {
     }
 
     if (0 != socket_timeout_code) {
+        ConnectProfile profile = longlinks_[socket_timeout_link]->Profile();
         dynamic_timeout_.CgiTaskStatistic("", kDynTimeTaskFailedPkgLen, 0);
-        __BatchErrorRespHandle(kEctNetMsgXP, socket_timeout_code, kTaskFailHandleDefault, src_taskid, longlink_->Profile());
+        __BatchErrorRespHandle(kEctNetMsgXP, socket_timeout_code, kTaskFailHandleDefault, src_taskid, profile, true, socket_timeout_link);
         xassert2(fun_notify_network_err_);
-        fun_notify_network_err_(__LINE__, kEctNetMsgXP, socket_timeout_code, longlink_->Profile().ip,  longlink_->Profile().port);
+        fun_notify_network_err_(__LINE__, kEctNetMsgXP, socket_timeout_code, profile.ip,  profile.port);
     } else if (istasktimeout) {
-        __BatchErrorRespHandle(kEctNetMsgXP, kEctLocalTaskTimeout, kTaskFailHandleDefault, src_taskid, longlink_->Profile());
+        __BatchErrorRespHandle(kEctNetMsgXP, kEctLocalTaskTimeout, kTaskFailHandleDefault, src_taskid, longlinks_[task_timeout_link]->Profile(), true, task_timeout_link);
     }
 }
 
@@ -328,14 +367,14 @@ void LongLinkTaskManager::__RunOnStartTask() {
 
         if (!first->antiavalanche_checked) {
 			if (!Req2Buf(first->task.taskid, first->task.user_context, bufreq, buffer_extension, error_code, Task::kChannelLong, host)) {
-				__SingleRespHandle(first, kEctEnDecode, error_code, kTaskFailHandleTaskEnd, longlink_->Profile());
+				__SingleRespHandle(first, kEctEnDecode, error_code, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
 				first = next;
 				continue;
 			}
 			// 雪崩检测
 			xassert2(fun_anti_avalanche_check_);
 			if (!fun_anti_avalanche_check_(first->task, bufreq.Ptr(), (int)bufreq.Length())) {
-				__SingleRespHandle(first, kEctLocal, kEctLocalAntiAvalanche, kTaskFailHandleTaskEnd, longlink_->Profile());
+				__SingleRespHandle(first, kEctLocal, kEctLocalAntiAvalanche, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
 				first = next;
 				continue;
 			}
@@ -345,15 +384,20 @@ void LongLinkTaskManager::__RunOnStartTask() {
         xassert2(first->antiavalanche_checked);
 		if (!longlinkconnectmon_->MakeSureConnected()) {
             if (0 != first->task.channel_id) {
-                __SingleRespHandle(first, kEctLocal, kEctLocalChannelID, kTaskFailHandleTaskEnd, longlink_->Profile());
+                __SingleRespHandle(first, kEctLocal, kEctLocalChannelID, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
             }
             
             first = next;
             continue;
 		}
 
-        if (0 != first->task.channel_id && longlink_->Profile().start_time != first->task.channel_id) {
-            __SingleRespHandle(first, kEctLocal, kEctLocalChannelID, kTaskFailHandleTaskEnd, longlink_->Profile());
+        if (0 != first->task.channel_id && LongLinkChannel().Profile().start_time != first->task.channel_id) {
+            __SingleRespHandle(first, kEctLocal, kEctLocalChannelID, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
+            first = next;
+            continue;
+        }
+
+        if (0 == first->task.channel_id && __WaitForLink(first->task)) {
             first = next;
             continue;
         }
@@ -361,14 +405,14 @@ void LongLinkTaskManager::__RunOnStartTask() {
 		if (0 == bufreq.Length()) {
 
 			if (!Req2Buf(first->task.taskid, first->task.user_context, bufreq, buffer_extension, error_code, Task::kChannelLong, host)) {
-				__SingleRespHandle(first, kEctEnDecode, error_code, kTaskFailHandleTaskEnd, longlink_->Profile());
+				__SingleRespHandle(first, kEctEnDecode, error_code, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
 				first = next;
 				continue;
 			}
 			// 雪崩检测
 			xassert2(fun_anti_avalanche_check_);
 			if (!fun_anti_avalanche_check_(first->task, bufreq.Ptr(), (int)bufreq.Length())) {
-				__SingleRespHandle(first, kEctLocal, kEctLocalAntiAvalanche, kTaskFailHandleTaskEnd, longlink_->Profile());
+				__SingleRespHandle(first, kEctLocal, kEctLocalAntiAvalanche, kTaskFailHandleTaskEnd, LongLinkChannel().Profile());
 				first = next;
 				continue;
 			}
@@ -379,20 +423,22 @@ void LongLinkTaskManager::__RunOnStartTask() {
         first->current_dyntime_status = (first->task.server_process_cost <= 0) ? dynamic_timeout_.GetStatus() : kEValuating;
         first->transfer_profile.read_write_timeout = __ReadWriteTimeout(first->transfer_profile.first_pkg_timeout);
         first->transfer_profile.send_data_size = bufreq.Length();
-        first->running_id = longlink_->Send(bufreq, buffer_extension, first->task);
+        int link_index = (0 == first->task.channel_id) ? __PlaceTask(first->task, bufreq.Length()) : 0;
+        first->running_id = longlinks_[link_index]->Send(bufreq, buffer_extension, first->task);
 
         if (!first->running_id) {
-            xwarn2(TSF"task add into longlink readwrite fail cgi:%_, cmdid:%_, taskid:%_", first->task.cgi, first->task.cmdid, first->task.taskid);
+            xwarn2(TSF"task add into longlink readwrite fail cgi:%_, cmdid:%_, taskid:%_, link:%_", first->task.cgi, first->task.cmdid, first->task.taskid, link_index);
             first = next;
             continue;
         }
+        first->link_index = link_index;
 
-        xinfo2(TSF"task add into longlink readwrite suc cgi:%_, cmdid:%_, taskid:%_, size:%_, timeout(firstpkg:%_, rw:%_, task:%_), retry:%_, curtime:%_, start_send_time:%_,",
+        xinfo2(TSF"task add into longlink readwrite suc cgi:%_, cmdid:%_, taskid:%_, size:%_, timeout(firstpkg:%_, rw:%_, task:%_), retry:%_, curtime:%_, start_send_time:%_, link:%_",
                first->task.cgi, first->task.cmdid, first->task.taskid, first->transfer_profile.send_data_size, first->transfer_profile.first_pkg_timeout / 1000,
-               first->transfer_profile.read_write_timeout / 1000, first->task_timeout / 1000, first->remain_retry_count, curtime, first->start_task_time);
+               first->transfer_profile.read_write_timeout / 1000, first->task_timeout / 1000, first->remain_retry_count, curtime, first->start_task_time, link_index);
 
         if (first->task.send_only) {
-            __SingleRespHandle(first, kEctOK, 0, kTaskFailHandleNoError, longlink_->Profile());
+            __SingleRespHandle(first, kEctOK, 0, kTaskFailHandleNoError, longlinks_[link_index]->Profile());
         }
 
         ++sent_count;
@@ -466,7 +512,7 @@ bool LongLinkTaskManager::__SingleRespHandle(std::list<TaskProfile>::iterator _i
     return false;
 }
 
-void LongLinkTaskManager::__BatchErrorRespHandle(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid, const ConnectProfile& _connect_profile, bool _callback_runing_task_only) {
+void LongLinkTaskManager::__BatchErrorRespHandle(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid, const ConnectProfile& _connect_profile, bool _callback_runing_task_only, int _link_index) {
     xassert2(kEctOK != _err_type);
     xassert2(kTaskFailHandleTaskTimeout != _fail_handle);
 
@@ -481,6 +527,11 @@ void LongLinkTaskManager::__BatchErrorRespHandle(ErrCmdType _err_type, int _err_
             first = next;
             continue;
         }
+
+        if (0 <= _link_index && _link_index != first->link_index) {
+            first = next;
+            continue;
+        }
         
         if (_src_taskid == Task::kInvalidTaskID || _src_taskid == first->task.taskid)
             __SingleRespHandle(first, _err_type, _err_code, _fail_handle, _connect_profile);
@@ -489,6 +540,19 @@ void LongLinkTaskManager::__BatchErrorRespHandle(ErrCmdType _err_type, int _err_
 
         first = next;
     }
+
+    if (0 < _link_index) {
+        // the main link is still up, the tasks of this one go on it without waiting for the retry interval.
+        if (kEctNetMsgXP == _err_type) {
+            longlinks_[_link_index]->Disconnect(LongLink::kTaskTimeout);
+        } else if (kTaskFailHandleDefault == _fail_handle && kEctDns != _err_type && kEctSocket != _err_type) {
+            longlinks_[_link_index]->Disconnect(LongLink::kDecodeErr);
+        }
+        MessageQueue::FasterMessage(asyncreg_.Get(),
+                                    MessageQueue::Message((MessageQueue::MessageTitle_t)this, boost::bind(&LongLinkTaskManager::__RunLoop, this), "LongLinkTaskManager::__RunLoop"),
+                                    MessageQueue::MessageTiming(0));
+        return;
+    }
     
     lastbatcherrortime_ = ::gettickcount();
     
@@ -497,20 +561,20 @@ void LongLinkTaskManager::__BatchErrorRespHandle(ErrCmdType _err_type, int _err_
     }
     
     if (kTaskFailHandleSessionTimeout == _fail_handle || kTaskFailHandleRetryAllTasks == _fail_handle) {
-        longlink_->Disconnect(LongLink::kDecodeErr);
+        __DisconnectLinks(-1, LongLink::kDecodeErr);
         MessageQueue::CancelMessage(asyncreg_.Get(), 0);
         retry_interval_ = 0;
     }
     
     if (kTaskFailHandleDefault == _fail_handle) {
         if (kEctDns != _err_type && kEctSocket != _err_type) {  // not longlink callback
-            longlink_->Disconnect(LongLink::kDecodeErr);
+            __DisconnectLinks(_link_index, LongLink::kDecodeErr);
         }
         MessageQueue::CancelMessage(asyncreg_.Get(), 0);
     }
     
     if (kEctNetMsgXP == _err_type) {
-        longlink_->Disconnect(LongLink::kTaskTimeout);
+        __DisconnectLinks(_link_index, LongLink::kTaskTimeout);
         MessageQueue::CancelMessage(asyncreg_.Get(), 0);
     }
 }
@@ -533,10 +597,82 @@ std::list<TaskProfile>::iterator LongLinkTaskManager::__Locate(uint32_t _taskid)
     return it;
 }
 
-void LongLinkTaskManager::__OnResponse(ErrCmdType _error_type, int _error_code, uint32_t _cmdid, uint32_t _taskid, AutoBuffer& _body, AutoBuffer& _extension, const ConnectProfile& _connect_profile) {
+LongLink* LongLinkTaskManager::__CreateLink(int _index) {
+    LongLink* longlink = LongLinkChannelFactory::Create(asyncreg_.Get().queue, netsource_);
+    if (0 != _index) longlink->DetachSmartHeartbeat();
+
+    longlink->OnSend = boost::bind(&LongLinkTaskManager::__OnSend, this, _1);
+    longlink->OnRecv = boost::bind(&LongLinkTaskManager::__OnRecv, this, _1, _2, _3);
+    longlink->OnResponse = boost::bind(&LongLinkTaskManager::__OnResponse, this, _index, _1, _2, _3, _4, _5, _6, _7);
+    longlink->SignalConnection.connect(boost::bind(&LongLinkTaskManager::__SignalConnection, this, _1));
+    return longlink;
+}
+
+void LongLinkTaskManager::__DestroyLink(LongLink* _longlink) {
+    _longlink->SignalConnection.disconnect(boost::bind(&LongLinkTaskManager::__SignalConnection, this, _1));
+    LongLinkChannelFactory::Destory(_longlink);
+}
+
+void LongLinkTaskManager::__DisconnectLinks(int _link_index, LongLink::TDisconnectInternalCode _scene) {
+    for (size_t i = 0; i < longlinks_.size(); ++i) {
+        if (0 <= _link_index && (int)i != _link_index) continue;
+        longlinks_[i]->Disconnect(_scene);
+    }
+}
+
+int LongLinkTaskManager::__PlaceTask(const Task& _task, size_t _send_size) {
+    if (1 == longlinks_.size()) return 0;
+
+    size_t others = longlinks_.size() - 1;
+    int index = 0;
+
+    switch (placement_) {
+        case kPlaceByPriority:
+            if (Task::kTaskPriorityNormal < _task.priority) index = 1 + (int)(_task.taskid % others);
+            break;
+        case kPlaceBySize:
+            if (kLonglinkGroupSmallTaskSize < _send_size) index = 1 + (int)(_task.taskid % others);
+            break;
+        case kPlaceByCmdid:
+            index = (int)(_task.cmdid % longlinks_.size());
+            break;
+        default:
+            xassert2(false, TSF"placement:%_", placement_);
+            break;
+    }
+
+    // a task of a cmdid on another link could overtake the ones before it, if its link was lost since __WaitForLink the send fails and it waits.
+    if (0 == index || __ConnectLink(index) || kPlaceByCmdid == placement_) return index;
+
+    // the main link takes its tasks until it is connected.
+    return 0;
+}
+
+// under kPlaceByCmdid a task is only started once the link of its cmdid is connected.
+bool LongLinkTaskManager::__WaitForLink(const Task& _task) {
+    if (kPlaceByCmdid != placement_ || 1 == longlinks_.size()) return false;
+
+    int index = (int)(_task.cmdid % longlinks_.size());
+    return 0 != index && !__ConnectLink(index);
+}
+
+// true when the link is connected, otherwise it is connected again at most every kLonglinkGroupReconnectInterval.
+bool LongLinkTaskManager::__ConnectLink(int _index) {
+    if (LongLink::kConnected == longlinks_[_index]->ConnectStatus()) return true;
+
+    uint64_t curtime = ::gettickcount();
+    if (curtime - link_connect_time_[_index] >= kLonglinkGroupReconnectInterval) {
+        xinfo2(TSF"connect link:%_, status:%_", _index, longlinks_[_index]->ConnectStatus());
+        link_connect_time_[_index] = curtime;
+        longlinks_[_index]->MakeSureConnected();
+    }
+    return false;
+}
+
+void LongLinkTaskManager::__OnResponse(int _link_index, ErrCmdType _error_type, int _error_code, uint32_t _cmdid, uint32_t _taskid, AutoBuffer& _body, AutoBuffer& _extension, const ConnectProfile& _connect_profile) {
     move_wrapper<AutoBuffer> body(_body);
     move_wrapper<AutoBuffer> extension(_extension);
-    RETURN_LONKLINK_SYNC2ASYNC_FUNC(boost::bind(&LongLinkTaskManager::__OnResponse, this, _error_type, _error_code, _cmdid, _taskid, body, extension, _connect_profile));
+    RETURN_LONKLINK_SYNC2ASYNC_FUNC(boost::bind(&LongLinkTaskManager::__OnResponse, this, _link_index, _error_type, _error_code, _cmdid, _taskid, body, extension, _connect_profile));
     // svr push notify
     
     if (kEctOK == _error_type && ::longlink_ispush(_cmdid, _taskid, body, extension))  {
@@ -551,7 +687,7 @@ void LongLinkTaskManager::__OnResponse(ErrCmdType _error_type, int _error_code,
     
     if (kEctOK != _error_type) {
         xwarn2(TSF"task error, taskid:%_, cmdid:%_, error_type:%_, error_code:%_", _taskid, _cmdid, _error_type, _error_code);
-        __BatchErrorRespHandle(_error_type, _error_code, kTaskFailHandleDefault, 0, _connect_profile);
+        __BatchErrorRespHandle(_error_type, _error_code, kTaskFailHandleDefault, 0, _connect_profile, true, _link_index);
         return;
     }
     
@@ -602,7 +738,7 @@ void LongLinkTaskManager::__OnResponse(ErrCmdType _error_type, int _error_code,
         case kTaskFailHandleDefault:
         {
             xerror2(TSF"task decode error taskid:%_, handle_type:%_, err_code:%_, body dump:%_", it->task.taskid, handle_type, err_code, xdump(body->Ptr(), body->Length()));
-            __BatchErrorRespHandle(kEctEnDecode, err_code, handle_type, it->task.taskid, _connect_profile);
+            __BatchErrorRespHandle(kEctEnDecode, err_code, handle_type, it->task.taskid, _connect_profile, true, _link_index);
             xassert2(fun_notify_network_err_);
             fun_notify_network_err_(__LINE__, kEctEnDecode, err_code, _connect_profile.ip, _connect_profile.port);
         }
@@ -610,7 +746,7 @@ void LongLinkTaskManager::__OnResponse(ErrCmdType _error_type, int _error_code,
         default:
         {
 			xassert2(false, TSF"task decode error fail_handle:%_, taskid:%_", handle_type, it->task.taskid);
-			__BatchErrorRespHandle(kEctEnDecode, err_code, handle_type, it->task.taskid, _connect_profile);
+			__BatchErrorRespHandle(kEctEnDecode, err_code, handle_type, it->task.taskid, _connect_profile, true, _link_index);
 			xassert2(fun_notify_network_err_);
 			fun_notify_network_err_(__LINE__, kEctEnDecode, handle_type, _connect_profile.ip, _connect_profile.port);
 			break;
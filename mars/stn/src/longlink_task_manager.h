@@ -22,6 +22,7 @@
 #define STN_SRC_LONGLINK_TASK_MANAGER_H_
 
 #include <list>
+#include <vector>
 #include <stdint.h>
 
 #include "boost/function.hpp"
@@ -49,6 +50,14 @@ class DynamicTimeout;
 class LongLinkConnectMonitor;
 
 class LongLinkTaskManager {
+  public:
+    // how the tasks are placed on the links of the group, see SetLinkGroup.
+    enum TLinkPlacement {
+        kPlaceByPriority,   // below kTaskPriorityNormal on the other links, the rest on the main one
+        kPlaceBySize,       // requests over kLonglinkGroupSmallTaskSize on the other links, the rest on the main one
+        kPlaceByCmdid,      // by cmdid over all the links, the tasks of a cmdid keep their order and wait while their link connects
+    };
+
   public:
     boost::function<int (ErrCmdType _err_type, int _err_code, int _fail_handle, const Task& _task, unsigned int _taskcosttime)> fun_callback_;
 
@@ -71,7 +80,12 @@ class LongLinkTaskManager {
     void RedoTasks();
     void RetryTasks(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid);
 
-    LongLink& LongLinkChannel() { return *longlink_; }
+    // _count links for the channel, the first is LongLinkChannel() which the rest of stn watches and keeps connected.
+    // the others connect once a task is placed on them, meanwhile and while they are lost their tasks go on the main link,
+    // except under kPlaceByCmdid where they wait for their own link.
+    void SetLinkGroup(size_t _count, TLinkPlacement _placement);
+
+    LongLink& LongLinkChannel() { return *longlinks_.front(); }
     LongLinkConnectMonitor& getLongLinkConnectMonitor() { return *longlinkconnectmon_; }
 
     unsigned int GetTaskCount();
@@ -79,7 +93,7 @@ class LongLinkTaskManager {
 
   private:
     // from ILongLinkObserver
-    void __OnResponse(ErrCmdType _error_type, int _error_code, uint32_t _cmdid, uint32_t _taskid, AutoBuffer& _body, AutoBuffer& _extension, const ConnectProfile& _connect_profile);
+    void __OnResponse(int _link_index, ErrCmdType _error_type, int _error_code, uint32_t _cmdid, uint32_t _taskid, AutoBuffer& _body, AutoBuffer& _extension, const ConnectProfile& _connect_profile);
     void __OnSend(uint32_t _taskid);
     void __OnRecv(uint32_t _taskid, size_t _cachedsize, size_t _totalsize);
     void __SignalConnection(LongLink::TLongLinkStatus _connect_status);
@@ -88,11 +102,19 @@ class LongLinkTaskManager {
     void __RunOnTimeout();
     void __RunOnStartTask();
 
-    void __BatchErrorRespHandle(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid, const ConnectProfile& _connect_profile, bool _callback_runing_task_only = true);
+    // _link_index: only the tasks running on that link and that link disconnected, -1 for all.
+    void __BatchErrorRespHandle(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid, const ConnectProfile& _connect_profile, bool _callback_runing_task_only = true, int _link_index = -1);
     bool __SingleRespHandle(std::list<TaskProfile>::iterator _it, ErrCmdType _err_type, int _err_code, int _fail_handle, const ConnectProfile& _connect_profile);
 
     std::list<TaskProfile>::iterator __Locate(uint32_t  _taskid);
 
+    LongLink* __CreateLink(int _index);
+    void __DestroyLink(LongLink* _longlink);
+    void __DisconnectLinks(int _link_index, LongLink::TDisconnectInternalCode _scene);
+    bool __WaitForLink(const Task& _task);
+    int  __PlaceTask(const Task& _task, size_t _send_size);
+    bool __ConnectLink(int _index);
+
   private:
     MessageQueue::ScopeRegister     asyncreg_;
     std::list<TaskProfile>          lst_cmd_;
@@ -100,7 +122,10 @@ class LongLinkTaskManager {
     unsigned long                   retry_interval_;	//ms
     unsigned int                    tasks_continuous_fail_count_;
 
-    LongLink*                       longlink_;
+    NetSource&                      netsource_;
+    std::vector<LongLink*>          longlinks_;     // the group, the main link first
+    std::vector<uint64_t>           link_connect_time_;  // ms, the last try to connect each
+    TLinkPlacement                  placement_;
     LongLinkConnectMonitor*         longlinkconnectmon_;
     DynamicTimeout&                 dynamic_timeout_;
 
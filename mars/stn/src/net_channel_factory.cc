@@ -24,6 +24,9 @@
 
 #include "longlink.h"
 #include "shortlink.h"
+#ifndef _WIN32
+#include "shortlink_reactor.h"
+#endif
 
 namespace mars {
 namespace stn {
@@ -42,6 +45,12 @@ void (*Destory)(ShortLinkInterface* _short_link_channel)
     delete _short_link_channel;
     _short_link_channel = NULL;
 };
+
+#ifndef _WIN32
+ShortLinkInterface* CreateReactorShortLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy) {
+    return new ReactorShortLink(_messagequeueid, _netsource, _task, _use_proxy);
+}
+#endif
     
 }
 
@@ -40,6 +40,15 @@ extern ShortLinkInterface* (*Create)(const mq::MessageQueue_t& _messagequeueid,
 
 extern void (*Destory)(ShortLinkInterface* _short_link_channel);
 
+#ifndef _WIN32
+// the links run on the shared ShortLinkReactor thread instead of a thread each, assign it to Create to use them.
+ShortLinkInterface* CreateReactorShortLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy);
+#endif
+#if defined(__ANDROID__) || (defined(__unix__) && !defined(__APPLE__))
+// the links run as coroutines on one shared thread, defined in coro_link.cc, built where comm/coroutine is.
+ShortLinkInterface* CreateCoroShortLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy);
+#endif
+
 }
 
 namespace LongLinkChannelFactory {
@@ -48,6 +57,11 @@ extern LongLink* (*Create)(const mq::MessageQueue_t& _messagequeueid, NetSource&
 
 extern void (*Destory)(LongLink* _long_link_channel);
 
+#if defined(__ANDROID__) || (defined(__unix__) && !defined(__APPLE__))
+// the link runs as a coroutine on the thread of the CoroShortLink, defined in coro_link.cc.
+LongLink* CreateCoroLongLink(const mq::MessageQueue_t& _messagequeueid, NetSource& _netsource);
+#endif
+
 }
 
 }
@@ -518,6 +518,14 @@ void NetCore::MakeSureLongLinkConnect() {
 #endif
 }
 
+void NetCore::SetLongLinkGroup(int _count, int _placement) {
+#ifdef USE_LONG_LINK
+    ASYNC_BLOCK_START
+    longlink_task_manager_->SetLinkGroup((size_t)_count, (LongLinkTaskManager::TLinkPlacement)_placement);
+    ASYNC_BLOCK_END
+#endif
+}
+
 bool NetCore::LongLinkIsConnected() {
 #ifdef USE_LONG_LINK
     return LongLink::kConnected == longlink_task_manager_->LongLinkChannel().ConnectStatus();
@@ -80,6 +80,7 @@ class NetCore {
     void    RetryTasks(ErrCmdType _err_type, int _err_code, int _fail_handle, uint32_t _src_taskid);
 
     void    MakeSureLongLinkConnect();
+    void    SetLongLinkGroup(int _count, int _placement);
     bool    LongLinkIsConnected();
     void    OnNetworkChange();
 
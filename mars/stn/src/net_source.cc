@@ -30,6 +30,7 @@
 
 #include "mars/comm/marcotoolkit.h"
 #include "mars/comm/socket/unix_socket.h"
+#include "mars/comm/socket/complexconnect.h"
 #include "mars/comm/xlogger/xlogger.h"
 #include "mars/comm/time_utils.h"
 #include "mars/comm/strutil.h"
@@ -489,6 +490,8 @@ void NetSource::ReportShortIP(bool _is_success, const std::string& _ip, const st
 void NetSource::ClearCache() {
     xinfo_function();
     ipportstrategy_.InitHistory2BannedList(true);
+    DNS::ClearCache();
+    ComplexConnect::ClearHistory();
 }
 
 std::string NetSource::DumpTable(const std::vector<IPPortItem>& _ipport_items) {
@@ -67,46 +67,25 @@ bool CheckKeepAlive(const Task& _task) {
     return false;
 }
 
-class ShortLinkConnectObserver : public MComplexConnect {
-  public:
-    ShortLinkConnectObserver(ShortLink& _shortlink): shortlink_(_shortlink), rtt_(0), last_err_(-1) {
-        memset(ConnectingIndex, 0, sizeof(ConnectingIndex));
-    };
-
-    virtual void OnCreated(unsigned int _index, const socket_address& _addr, SOCKET _socket) {}
-    virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket) {
-        ConnectingIndex[_index] = 1;
-    }
-    virtual void OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt) {
-        ConnectingIndex[_index] = 0;
+ShortLinkConnectObserver::ShortLinkConnectObserver(ShortLink& _shortlink): shortlink_(_shortlink), rtt_(0), last_err_(-1) {
+    memset(ConnectingIndex, 0, sizeof(ConnectingIndex));
+}
 
-        if (0 != _error) {
-//            xassert2(shortlink_.func_network_report);
+void ShortLinkConnectObserver::OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt) {
+    ConnectingIndex[_index] = 0;
 
-            if (_index < shortlink_.Profile().ip_items.size() && shortlink_.func_network_report)
-                shortlink_.func_network_report(__LINE__, kEctSocket, _error, _addr.ip(), shortlink_.Profile().ip_items[_index].str_host, _addr.port());
-        }
+    if (0 != _error) {
+//        xassert2(shortlink_.func_network_report);
 
-        if (last_err_ != 0) {
-            last_err_ = _error;
-            rtt_ = _rtt;
-        }
+        if (_index < shortlink_.Profile().ip_items.size() && shortlink_.func_network_report)
+            shortlink_.func_network_report(__LINE__, kEctSocket, _error, _addr.ip(), shortlink_.Profile().ip_items[_index].str_host, _addr.port());
     }
 
-    int LastErrorCode() const {return last_err_;}
-    int Rtt() const {return rtt_;}
-
-    char ConnectingIndex[32];
-
-  private:
-    ShortLinkConnectObserver(const ShortLinkConnectObserver&);
-    ShortLinkConnectObserver& operator=(const ShortLinkConnectObserver&);
-
-  private:
-    ShortLink& shortlink_;
-    int rtt_;
-    int last_err_;
-};
+    if (last_err_ != 0) {
+        last_err_ = _error;
+        rtt_ = _rtt;
+    }
+}
 
 }}
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -171,9 +150,42 @@ void ShortLink::__Run() {
 }
 
 SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
+    std::vector<socket_address> vecaddr;
+    socket_address* proxy_addr = NULL;
+    SOCKET cached_sock = INVALID_SOCKET;
+
+    if (!__PrepareConnect(_conn_profile, vecaddr, proxy_addr, cached_sock)) return cached_sock;
+
+    return __RunComplexConnect(_conn_profile, vecaddr, proxy_addr);
+}
+
+SOCKET ShortLink::__RunComplexConnect(ConnectProfile& _conn_profile, const std::vector<socket_address>& _vecaddr, socket_address* _proxy_addr) {
+    const std::vector<socket_address>& vecaddr = _vecaddr;
+    socket_address* proxy_addr = _proxy_addr;
+
+    ShortLinkConnectObserver connect_observer(*this);
+
+    ComplexConnect::EachIPConnectTimoutMode timoutMode = ComplexConnect::EachIPConnectTimoutMode::MODE_FIXED;
+    bool contain_v6 = __ContainIPv6(vecaddr);
+    if (contain_v6) {
+        timoutMode = ComplexConnect::EachIPConnectTimoutMode::MODE_INCREASE;
+    } else {
+        xinfo2(TSF"address vector has no ipv6");
+    }
+	ComplexConnect conn(kShortlinkConnTimeout, kShortlinkConnInterval, timoutMode);
+    
+    SOCKET sock = conn.ConnectImpatient(vecaddr, breaker_, &connect_observer, _conn_profile.proxy_info.type, proxy_addr, _conn_profile.proxy_info.username, _conn_profile.proxy_info.password);
+    delete proxy_addr;
+
+    return __ConnectFinished(_conn_profile, sock, conn.Index(), conn.IndexRtt(), conn.TotalCost(), conn.ErrorCode(), connect_observer.ConnectingIndex, contain_v6);
+}
+
+bool ShortLink::__PrepareConnect(ConnectProfile& _conn_profile, std::vector<socket_address>& _vecaddr, socket_address*& _proxy_addr, SOCKET& _cached_sock) {
     xmessage2_define(message)(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
 
-    std::vector<socket_address> vecaddr;
+    std::vector<socket_address>& vecaddr = _vecaddr;
+    _proxy_addr = NULL;
+    _cached_sock = INVALID_SOCKET;
 
     _conn_profile.dns_time = ::gettickcount();
     __UpdateProfile(_conn_profile);
@@ -218,7 +230,7 @@ SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
         if (_conn_profile.proxy_info.ip.empty() && !_conn_profile.proxy_info.host.empty()) {
             if (!dns_util_.GetDNS().GetHostByName(_conn_profile.proxy_info.host, proxy_ips) || proxy_ips.empty()) {
                 xwarn2(TSF"dns %_ error", _conn_profile.proxy_info.host);
-                return INVALID_SOCKET;
+                return false;
             }
 			proxy_ip = proxy_ips.front();
         } else {
@@ -250,7 +262,7 @@ SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
         xerror2(TSF"task socket connect fail %_ vecaddr empty", message.String());
         __RunResponseError(kEctDns, kEctDnsMakeSocketPrepared, _conn_profile, false);
         delete proxy_addr;
-        return INVALID_SOCKET;
+        return false;
     }
 
     if(_conn_profile.ip_type != kIPSourceProxy && is_keep_alive_) {
@@ -273,7 +285,9 @@ SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
                 _conn_profile.is_reused_fd = true;
                 __UpdateProfile(_conn_profile);
                 xinfo2(TSF"reused socket:%_", fd);
-                return fd;
+                delete proxy_addr;
+                _cached_sock = fd;
+                return false;
             }
         }
     }
@@ -288,32 +302,25 @@ SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
     __UpdateProfile(_conn_profile);
 
     // set the first ip info to the profiler, after connect, the ip info will be overwrriten by the real one
+    _proxy_addr = proxy_addr;
+    return true;
+}
 
-    ShortLinkConnectObserver connect_observer(*this);
-
-    ComplexConnect::EachIPConnectTimoutMode timoutMode = ComplexConnect::EachIPConnectTimoutMode::MODE_FIXED;
-    bool contain_v6 = __ContainIPv6(vecaddr);
-    if (contain_v6) {
-        timoutMode = ComplexConnect::EachIPConnectTimoutMode::MODE_INCREASE;
-    } else {
-        xinfo2(TSF"address vector has no ipv6");
-    }
-	ComplexConnect conn(kShortlinkConnTimeout, kShortlinkConnInterval, timoutMode);
-    
-    SOCKET sock = conn.ConnectImpatient(vecaddr, breaker_, &connect_observer, _conn_profile.proxy_info.type, proxy_addr, _conn_profile.proxy_info.username, _conn_profile.proxy_info.password);
-    delete proxy_addr;
+SOCKET ShortLink::__ConnectFinished(ConnectProfile& _conn_profile, SOCKET _sock, int _index, unsigned int _index_rtt, unsigned int _total_cost, int _errcode, const char* _connecting, bool _contain_v6) {
+    xmessage2_define(message)(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
+    SOCKET sock = _sock;
 
-    _conn_profile.conn_rtt = conn.IndexRtt();
-    _conn_profile.ip_index = conn.Index();
-    _conn_profile.conn_cost = conn.TotalCost();
+    _conn_profile.conn_rtt = _index_rtt;
+    _conn_profile.ip_index = _index;
+    _conn_profile.conn_cost = _total_cost;
 
     __UpdateProfile(_conn_profile);
     
-    WeakNetworkLogic::Singleton::Instance()->OnConnectEvent(sock!=INVALID_SOCKET, conn.IndexRtt(), conn.Index());
+    WeakNetworkLogic::Singleton::Instance()->OnConnectEvent(sock!=INVALID_SOCKET, _index_rtt, _index);
 
     if (INVALID_SOCKET == sock) {
         xwarn2(TSF"task socket connect fail sock %_, net:%_", message.String(), getNetInfo());
-        _conn_profile.conn_errcode = conn.ErrorCode();
+        _conn_profile.conn_errcode = _errcode;
 
         if (!breaker_.IsBreak()) {
             __RunResponseError(kEctSocket, kEctSocketMakeSocketPrepared, _conn_profile, false);
@@ -326,21 +333,21 @@ SOCKET ShortLink::__RunConnect(ConnectProfile& _conn_profile) {
         return INVALID_SOCKET;
     }
 
-    xassert2(0 <= conn.Index() && (unsigned int)conn.Index() < _conn_profile.ip_items.size());
+    xassert2(0 <= _index && (unsigned int)_index < _conn_profile.ip_items.size());
 
-    for (int i = 0; i < conn.Index(); ++i) {
-        if (1 == connect_observer.ConnectingIndex[i] && func_network_report)
+    for (int i = 0; i < _index; ++i) {
+        if (1 == _connecting[i] && func_network_report)
             func_network_report(__LINE__, kEctSocket, SOCKET_ERRNO(ETIMEDOUT), _conn_profile.ip_items[i].str_ip, _conn_profile.ip_items[i].str_host, _conn_profile.ip_items[i].port);
     }
 
-    _conn_profile.host = _conn_profile.ip_items[conn.Index()].str_host;
-    _conn_profile.ip_type = _conn_profile.ip_items[conn.Index()].source_type;
-    _conn_profile.ip = _conn_profile.ip_items[conn.Index()].str_ip;
+    _conn_profile.host = _conn_profile.ip_items[_index].str_host;
+    _conn_profile.ip_type = _conn_profile.ip_items[_index].source_type;
+    _conn_profile.ip = _conn_profile.ip_items[_index].str_ip;
     _conn_profile.conn_time = gettickcount();
     _conn_profile.local_ip = socket_address::getsockname(sock).ip();
     _conn_profile.local_port = socket_address::getsockname(sock).port();
 
-    if (contain_v6 && conn.Index() > 0) {
+    if (_contain_v6 && _index > 0) {
         _conn_profile.ipv6_connect_failed = true;
     }
 
@@ -369,9 +376,7 @@ bool ShortLink::__ContainIPv6(const std::vector<socket_address>& _vecaddr) {
     return false;
 }
 
-void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, ConnectProfile& _conn_profile) {
-	xmessage2_define(message)(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
-
+void ShortLink::__PackRequest(const ConnectProfile& _conn_profile, AutoBuffer& _out_buff) {
 	std::string url;
 	std::map<std::string, std::string> headers;
 #ifdef WIN32
@@ -422,15 +427,20 @@ void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, C
         }
     }
 
-	AutoBuffer out_buff;
+    shortlink_pack(url, headers, send_body_, send_extend_, _out_buff, tracker_.get());
+}
+
+void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, ConnectProfile& _conn_profile) {
+	xmessage2_define(message)(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
 
-    shortlink_pack(url, headers, send_body_, send_extend_, out_buff, tracker_.get());
+	AutoBuffer out_buff;
+	__PackRequest(_conn_profile, out_buff);
 
 	// send request
 	xgroup2_define(group_send);
 	xinfo2(TSF"task socket send sock:%_, %_ http len:%_, ", _socket, message.String(), out_buff.Length()) >> group_send;
 
-	int send_ret = block_socket_send(_socket, (const unsigned char*)out_buff.Ptr(), (unsigned int)out_buff.Length(), breaker_, _err_code);
+	int send_ret = __BlockSend(_socket, (const unsigned char*)out_buff.Ptr(), (unsigned int)out_buff.Length(), _err_code);
 
 	if (send_ret < 0) {
 		xerror2(TSF"Send Request Error, ret:%0, errno:%1, nread:%_, nwrite:%_", send_ret, strerror(_err_code), socket_nread(_socket), socket_nwrite(_socket)) >> group_send;
@@ -463,7 +473,7 @@ void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, C
 	http::Parser parser(receiver, true);
 
 	while (true) {
-		int recv_ret = block_socket_recv(_socket, recv_buf, KBufferSize, breaker_, _err_code, 5000);
+		int recv_ret = __BlockRecv(_socket, recv_buf, KBufferSize, _err_code, 5000);
 
 		if (recv_ret < 0) {
 			xerror2(TSF"read block socket return false, error:%0, nread:%_, nwrite:%_", strerror(_err_code), socket_nread(_socket), socket_nwrite(_socket)) >> group_close;
@@ -487,63 +497,7 @@ void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, C
 			break;
 		}
 
-		if (recv_ret > 0) {
-            GetSignalOnNetworkDataChange()(XLOGGER_TAG, 0, recv_ret);
-            
-			xinfo2(TSF"recv len:%_ ", recv_ret) >> group_recv;
-            if (OnRecv)
-                OnRecv(this, (unsigned int)(recv_buf.Length() - recv_pos), (unsigned int)recv_buf.Length());
-            else
-                xwarn2(TSF"OnRecv NULL.");
-			recv_pos = recv_buf.Pos();
-		}
-
-		Parser::TRecvStatus parse_status = parser.Recv(recv_buf.Ptr(recv_buf.Length() - recv_ret), recv_ret);
-        if (parser.FirstLineReady()) {
-            status_code = parser.Status().StatusCode();
-        }
-
-		if (parse_status == http::Parser::kFirstLineError) {
-			xerror2(TSF"http head not receive yet,but socket closed, length:%0, nread:%_, nwrite:%_ ", recv_buf.Length(), socket_nread(_socket), socket_nwrite(_socket)) >> group_close;
-			__RunResponseError(kEctHttp, kEctHttpParseStatusLine, _conn_profile, true);
-			break;
-		}
-		else if (parse_status == http::Parser::kHeaderFieldsError) {
-			xerror2(TSF"parse http head failed, but socket closed, length:%0, nread:%_, nwrite:%_ ", recv_buf.Length(), socket_nread(_socket), socket_nwrite(_socket)) >> group_close;
-			__RunResponseError(kEctHttp, kEctHttpSplitHttpHeadAndBody, _conn_profile, true);
-			break;
-		}
-		else if (parse_status == http::Parser::kBodyError) {
-			xerror2(TSF"content_length_ != body.Lenght(), Head:%0, http dump:%1 \n headers size:%2" , parser.Fields().ContentLength(), xdump(recv_buf.Ptr(), recv_buf.Length()), parser.Fields().GetHeaders().size()) >> group_close;
-			__RunResponseError(kEctHttp, kEctHttpSplitHttpHeadAndBody, _conn_profile, true);
-			break;
-		}
-		else if (parse_status == http::Parser::kEnd) {
-            if(is_keep_alive_) {    //parse server keep-alive config
-                bool isKeepAlive = parser.Fields().IsConnectionKeepAlive();
-                xwarn2_if(!isKeepAlive, "request keep-alive, but server return close");
-                if(isKeepAlive) {
-                    uint32_t timeout = parser.Fields().KeepAliveTimeout();
-                    _conn_profile.keepalive_timeout = timeout;
-                    _conn_profile.socket_fd = _socket;
-                } else {
-                    is_keep_alive_ = false;
-                }
-            }
-
-			if (status_code != 200) {
-				xerror2(TSF"@%0, status_code != 200, code:%1, http dump:%2 \n headers size:%3", this, status_code, xdump(recv_buf.Ptr(), recv_buf.Length()), parser.Fields().GetHeaders().size()) >> group_close;
-				__RunResponseError(kEctHttp, status_code, _conn_profile, true);
-			}
-			else {
-				xinfo2(TSF"@%0, headers size:%_, ", this, parser.Fields().GetHeaders().size()) >> group_recv;
-				__OnResponse(kEctOK, status_code, body, extension, _conn_profile, true);
-			}
-			break;
-		}
-		else {
-			xdebug2(TSF"http parser status:%_ ", parse_status);
-		}
+		if (__OnRecvData(_socket, parser, recv_buf, recv_ret, recv_pos, status_code, body, extension, _conn_profile, group_recv, group_close)) break;
 	}
 
 	xdebug2(TSF"read with nonblock socket http response, length:%_, ", recv_buf.Length()) >> group_recv;
@@ -559,6 +513,75 @@ void ShortLink::__RunReadWrite(SOCKET _socket, int& _err_type, int& _err_code, C
 	xgroup2() << group_close;
 }
 
+int ShortLink::__BlockSend(SOCKET _socket, const void* _buffer, size_t _len, int& _err_code) {
+    return block_socket_send(_socket, _buffer, _len, breaker_, _err_code);
+}
+
+int ShortLink::__BlockRecv(SOCKET _socket, AutoBuffer& _buffer, size_t _max_size, int& _err_code, int _timeout) {
+    return block_socket_recv(_socket, _buffer, _max_size, breaker_, _err_code, _timeout);
+}
+
+bool ShortLink::__OnRecvData(SOCKET _socket, http::Parser& _parser, AutoBuffer& _recv_buf, int _recv_ret, off_t& _recv_pos, int& _status_code, AutoBuffer& _body, AutoBuffer& _extension, ConnectProfile& _conn_profile, XLogger& _group_recv, XLogger& _group_close) {
+	if (_recv_ret > 0) {
+        GetSignalOnNetworkDataChange()(XLOGGER_TAG, 0, _recv_ret);
+        
+		xinfo2(TSF"recv len:%_ ", _recv_ret) >> _group_recv;
+        if (OnRecv)
+            OnRecv(this, (unsigned int)(_recv_buf.Length() - _recv_pos), (unsigned int)_recv_buf.Length());
+        else
+            xwarn2(TSF"OnRecv NULL.");
+		_recv_pos = _recv_buf.Pos();
+	}
+
+	Parser::TRecvStatus parse_status = _parser.Recv(_recv_buf.Ptr(_recv_buf.Length() - _recv_ret), _recv_ret);
+    if (_parser.FirstLineReady()) {
+        _status_code = _parser.Status().StatusCode();
+    }
+
+	if (parse_status == http::Parser::kFirstLineError) {
+		xerror2(TSF"http head not receive yet,but socket closed, length:%0, nread:%_, nwrite:%_ ", _recv_buf.Length(), socket_nread(_socket), socket_nwrite(_socket)) >> _group_close;
+		__RunResponseError(kEctHttp, kEctHttpParseStatusLine, _conn_profile, true);
+		return true;
+	}
+	else if (parse_status == http::Parser::kHeaderFieldsError) {
+		xerror2(TSF"parse http head failed, but socket closed, length:%0, nread:%_, nwrite:%_ ", _recv_buf.Length(), socket_nread(_socket), socket_nwrite(_socket)) >> _group_close;
+		__RunResponseError(kEctHttp, kEctHttpSplitHttpHeadAndBody, _conn_profile, true);
+		return true;
+	}
+	else if (parse_status == http::Parser::kBodyError) {
+		xerror2(TSF"content_length_ != body.Lenght(), Head:%0, http dump:%1 \n headers size:%2" , _parser.Fields().ContentLength(), xdump(_recv_buf.Ptr(), _recv_buf.Length()), _parser.Fields().GetHeaders().size()) >> _group_close;
+		__RunResponseError(kEctHttp, kEctHttpSplitHttpHeadAndBody, _conn_profile, true);
+		return true;
+	}
+	else if (parse_status == http::Parser::kEnd) {
+        if(is_keep_alive_) {    //parse server keep-alive config
+            bool isKeepAlive = _parser.Fields().IsConnectionKeepAlive();
+            xwarn2_if(!isKeepAlive, "request keep-alive, but server return close");
+            if(isKeepAlive) {
+                uint32_t timeout = _parser.Fields().KeepAliveTimeout();
+                _conn_profile.keepalive_timeout = timeout;
+                _conn_profile.socket_fd = _socket;
+            } else {
+                is_keep_alive_ = false;
+            }
+        }
+
+		if (_status_code != 200) {
+			xerror2(TSF"@%0, status_code != 200, code:%1, http dump:%2 \n headers size:%3", this, _status_code, xdump(_recv_buf.Ptr(), _recv_buf.Length()), _parser.Fields().GetHeaders().size()) >> _group_close;
+			__RunResponseError(kEctHttp, _status_code, _conn_profile, true);
+		}
+		else {
+			xinfo2(TSF"@%0, headers size:%_, ", this, _parser.Fields().GetHeaders().size()) >> _group_recv;
+			__OnResponse(kEctOK, _status_code, _body, _extension, _conn_profile, true);
+		}
+		return true;
+	}
+	else {
+		xdebug2(TSF"http parser status:%_ ", parse_status);
+	}
+	return false;
+}
+
 void ShortLink::__UpdateProfile(const ConnectProfile& _conn_profile) {
 	STATIC_RETURN_SYNC2ASYNC_FUNC(boost::bind(&ShortLink::__UpdateProfile, this, _conn_profile));
 	conn_profile_ = _conn_profile;
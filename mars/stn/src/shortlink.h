@@ -32,6 +32,7 @@
 #include "mars/comm/autobuffer.h"
 #include "mars/comm/http.h"
 #include "mars/comm/socket/socketselect.h"
+#include "mars/comm/socket/complexconnect.h"
 #include "mars/comm/messagequeue/message_queue.h"
 #include "mars/stn/stn.h"
 #include "mars/stn/task_profile.h"
@@ -40,6 +41,8 @@
 #include "net_source.h"
 #include "shortlink_interface.h"
 
+class XLogger;
+
 namespace mars {
 namespace stn {
     
@@ -62,13 +65,27 @@ class ShortLink : public ShortLinkInterface {
     virtual SOCKET   __RunConnect(ConnectProfile& _conn_profile);
     virtual void     __RunReadWrite(SOCKET _sock, int& _errtype, int& _errcode, ConnectProfile& _conn_profile);
     void             __CancelAndWaitWorkerThread();
+    // the blocking socket calls of __RunReadWrite, on breaker_.
+    virtual int      __BlockSend(SOCKET _socket, const void* _buffer, size_t _len, int& _err_code);
+    virtual int      __BlockRecv(SOCKET _socket, AutoBuffer& _buffer, size_t _max_size, int& _err_code, int _timeout);
+
+    // the steps of __RunConnect and __RunReadWrite that don't block on the socket, shared with the links that don't run a thread each.
+    // false if there is nothing to connect: the task is answered already, or a cached keep-alive socket is in _cached_sock.
+    bool             __PrepareConnect(ConnectProfile& _conn_profile, std::vector<socket_address>& _vecaddr, socket_address*& _proxy_addr, SOCKET& _cached_sock);
+    // the connect race of __RunConnect, takes _proxy_addr.
+    SOCKET           __RunComplexConnect(ConnectProfile& _conn_profile, const std::vector<socket_address>& _vecaddr, socket_address* _proxy_addr);
+    // _connecting: per address, whether it was still connecting when _index got through.
+    SOCKET           __ConnectFinished(ConnectProfile& _conn_profile, SOCKET _sock, int _index, unsigned int _index_rtt, unsigned int _total_cost, int _errcode, const char* _connecting, bool _contain_v6);
+    void             __PackRequest(const ConnectProfile& _conn_profile, AutoBuffer& _out_buff);
+    // _recv_ret new bytes at the end of _recv_buf, true once the response is complete or broken and the task answered.
+    bool             __OnRecvData(SOCKET _socket, http::Parser& _parser, AutoBuffer& _recv_buf, int _recv_ret, off_t& _recv_pos, int& _status_code,
+                                  AutoBuffer& _body, AutoBuffer& _extension, ConnectProfile& _conn_profile, XLogger& _group_recv, XLogger& _group_close);
 
     void			 __UpdateProfile(const ConnectProfile& _conn_profile);
 
     void 			 __RunResponseError(ErrCmdType _type, int _errcode, ConnectProfile& _conn_profile, bool _report = true);
     void 			 __OnResponse(ErrCmdType _err_type, int _status, AutoBuffer& _body, AutoBuffer& _extension, ConnectProfile& _conn_profile, bool _report = true);
 
-  private:
     bool       __ContainIPv6(const std::vector<socket_address>& _vecaddr);
     
   protected:
@@ -89,6 +106,31 @@ class ShortLink : public ShortLinkInterface {
     boost::scoped_ptr<shortlink_tracker> tracker_;
     bool                            is_keep_alive_;
 };
+
+class ShortLinkConnectObserver : public MComplexConnect {
+  public:
+    ShortLinkConnectObserver(ShortLink& _shortlink);
+
+    virtual void OnCreated(unsigned int _index, const socket_address& _addr, SOCKET _socket) {}
+    virtual void OnConnect(unsigned int _index, const socket_address& _addr, SOCKET _socket) {
+        ConnectingIndex[_index] = 1;
+    }
+    virtual void OnConnected(unsigned int _index, const socket_address& _addr, SOCKET _socket, int _error, int _rtt);
+
+    int LastErrorCode() const {return last_err_;}
+    int Rtt() const {return rtt_;}
+
+    char ConnectingIndex[32];
+
+  private:
+    ShortLinkConnectObserver(const ShortLinkConnectObserver&);
+    ShortLinkConnectObserver& operator=(const ShortLinkConnectObserver&);
+
+  private:
+    ShortLink& shortlink_;
+    int rtt_;
+    int last_err_;
+};
         
 }}
 
@@ -0,0 +1,566 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * shortlink_reactor.cc
+ *
+ *  Created on: 2026-10-18
+ */
+
+#include "shortlink_reactor.h"
+
+#include <algorithm>
+#include <limits.h>
+
+#include "boost/bind.hpp"
+
+#include "mars/comm/xlogger/xlogger.h"
+#include "mars/comm/socket/unix_socket.h"
+#include "mars/comm/time_utils.h"
+#include "mars/comm/platform_comm.h"
+#include "mars/baseevent/baseprjevent.h"
+
+using namespace mars::stn;
+
+static const unsigned int kBufferSize = 8 * 1024;
+static const unsigned int kMaxConnecting = 3;               // as ComplexConnect
+static const unsigned int kIncreaseModeInterval = 1000;     // as ComplexConnect's kTimeoutModeIncreaseInterval
+static const int kPrepareThreads = 4;
+
+static MessageQueue::MessageQueue_t __PreparePool() {
+    static MessageQueue::MessageQueue_t s_pool = MessageQueue::CreateTaskPool(kPrepareThreads, "shortlink_prepare");
+    return s_pool;
+}
+
+ShortLinkReactor& ShortLinkReactor::Instance() {
+    static ShortLinkReactor* s_instance = new ShortLinkReactor;
+    return *s_instance;
+}
+
+ShortLinkReactor::ShortLinkReactor()
+    : select_(breaker_, false, true)
+    , running_(NULL)
+    , thread_(boost::bind(&ShortLinkReactor::__Run, this), XLOGGER_TAG "::shortlink_reactor") {
+    xassert2(breaker_.IsCreateSuc(), "Create Breaker Fail!!!");
+    thread_.start();
+}
+
+ShortLinkReactor::~ShortLinkReactor() {
+    ASSERT(false);  // lives until exit
+}
+
+void ShortLinkReactor::Start(Handler* _handler) {
+    ScopedLock lock(mutex_);
+    xassert2(handlers_.end() == handlers_.find(_handler));
+    handlers_[_handler];
+    starting_.push_back(_handler);
+    lock.unlock();
+
+    breaker_.Break();
+}
+
+void ShortLinkReactor::Stop(Handler* _handler) {
+    ScopedLock lock(mutex_);
+    xassert2(ThreadUtil::currentthreadid() != thread_.tid(), "a handler can't stop itself");
+
+    while (running_ == _handler) cond_.wait(lock);
+
+    std::map<Handler*, Entry>::iterator it = handlers_.find(_handler);
+    if (handlers_.end() == it) return;
+
+    bool wakeup = !it->second.fds.empty();
+    closing_.insert(closing_.end(), it->second.fds.begin(), it->second.fds.end());
+    if (0 != it->second.deadline) deadlines_.erase(std::make_pair(it->second.deadline, _handler));
+    starting_.erase(std::remove(starting_.begin(), starting_.end(), _handler), starting_.end());
+    handlers_.erase(it);
+    lock.unlock();
+
+    if (wakeup) breaker_.Break();
+}
+
+void ShortLinkReactor::Watch(Handler* _handler, SOCKET _fd, bool _read, bool _write) {
+    ScopedLock lock(mutex_);
+    std::map<Handler*, Entry>::iterator it = handlers_.find(_handler);
+    xassert2(handlers_.end() != it);
+    if (handlers_.end() == it) return;
+
+    std::vector<SOCKET>& fds = it->second.fds;
+    if (fds.end() == std::find(fds.begin(), fds.end(), _fd)) fds.push_back(_fd);
+    lock.unlock();
+
+    select_.Poll().AddEvent(_fd, _read, _write, _handler);
+}
+
+void ShortLinkReactor::Unwatch(Handler* _handler, SOCKET _fd) {
+    ScopedLock lock(mutex_);
+    std::map<Handler*, Entry>::iterator it = handlers_.find(_handler);
+    if (handlers_.end() == it) return;
+
+    std::vector<SOCKET>& fds = it->second.fds;
+    std::vector<SOCKET>::iterator fd_it = std::find(fds.begin(), fds.end(), _fd);
+    if (fds.end() == fd_it) return;
+    fds.erase(fd_it);
+    lock.unlock();
+
+    select_.Poll().DelEvent(_fd);
+}
+
+void ShortLinkReactor::Close(Handler* _handler, SOCKET _fd) {
+    Unwatch(_handler, _fd);
+    socket_close(_fd);
+}
+
+void ShortLinkReactor::SetTimeout(Handler* _handler, uint64_t _deadline) {
+    ScopedLock lock(mutex_);
+    std::map<Handler*, Entry>::iterator it = handlers_.find(_handler);
+    if (handlers_.end() == it) return;
+
+    if (0 != it->second.deadline) deadlines_.erase(std::make_pair(it->second.deadline, _handler));
+    it->second.deadline = _deadline;
+    if (0 != _deadline) deadlines_.insert(std::make_pair(_deadline, _handler));
+}
+
+size_t ShortLinkReactor::Size() {
+    ScopedLock lock(mutex_);
+    return handlers_.size();
+}
+
+void ShortLinkReactor::__Run() {
+    SocketPoll& poll = select_.Poll();
+    std::vector<SOCKET> closing;
+    std::vector<Handler*> starting;
+    std::vector<PollEvent> events;
+
+    ScopedLock lock(mutex_);
+
+    while (true) {
+        closing.swap(closing_);
+        starting.swap(starting_);
+
+        if (!closing.empty()) {
+            lock.unlock();
+            for (std::vector<SOCKET>::iterator it = closing.begin(); it != closing.end(); ++it) {
+                poll.DelEvent(*it);
+                socket_close(*it);
+            }
+            closing.clear();
+            lock.lock();
+        }
+
+        for (std::vector<Handler*>::iterator it = starting.begin(); it != starting.end(); ++it) {
+            __Call(lock, *it, kCallStart);
+        }
+        starting.clear();
+
+        int timeout = -1;
+        if (!deadlines_.empty()) {
+            uint64_t now = ::gettickcount();
+            uint64_t deadline = deadlines_.begin()->first;
+            timeout = deadline <= now ? 0 : (int)std::min(deadline - now, (uint64_t)INT_MAX);
+        }
+        if (!starting_.empty() || !closing_.empty()) timeout = 0;
+
+        lock.unlock();
+
+        int ret = poll.Poll(timeout);
+        if (0 > ret) {
+            xerror2(TSF"poll ret:%_, errno:(%_, %_)", ret, poll.Errno(), socket_strerror(poll.Errno()));
+        }
+        if (poll.BreakerIsBreak()) breaker_.Clear();
+        events = poll.TriggeredEvents();
+
+        lock.lock();
+
+        // a handler whose socket shows up here may have been stopped meanwhile, __Call checks it's still there.
+        for (std::vector<PollEvent>::iterator it = events.begin(); it != events.end(); ++it) {
+            __Call(lock, (Handler*)it->UserData(), kCallEvent, &(*it));
+        }
+        events.clear();
+
+        uint64_t now = ::gettickcount();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            Handler* handler = deadlines_.begin()->second;
+            deadlines_.erase(deadlines_.begin());
+            handlers_[handler].deadline = 0;
+            __Call(lock, handler, kCallTimeout);
+        }
+    }
+}
+
+void ShortLinkReactor::__Call(ScopedLock& _lock, Handler* _handler, CallType _type, PollEvent* _event) {
+    std::map<Handler*, Entry>::iterator it = handlers_.find(_handler);
+    if (handlers_.end() == it) return;
+
+    if (kCallEvent == _type) {
+        const std::vector<SOCKET>& fds = it->second.fds;
+        if (fds.end() == std::find(fds.begin(), fds.end(), _event->FD())) return;
+    }
+
+    running_ = _handler;
+    _lock.unlock();
+
+    switch (_type) {
+    case kCallStart:
+        _handler->OnStart();
+        break;
+    case kCallEvent:
+        _handler->OnEvent(_event->FD(), _event->Readable() || _event->HangUp(), _event->Writealbe(), _event->Error() || _event->Invalid());
+        break;
+    case kCallTimeout:
+        _handler->OnTimeout();
+        break;
+    }
+
+    _lock.lock();
+    running_ = NULL;
+    cond_.notifyAll(_lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+ReactorShortLink::ReactorShortLink(MessageQueue::MessageQueue_t _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy)
+    : ShortLink(_messagequeueid, _netsource, _task, _use_proxy)
+    , state_(kStateInit)
+    , prepare_post_(MessageQueue::KNullPost)
+    , contain_v6_(false)
+    , next_index_(0)
+    , connect_start_(0)
+    , last_start_(0)
+    , last_error_(0)
+    , sock_(INVALID_SOCKET)
+    , sent_len_(0)
+    , status_code_(-1)
+    , recv_pos_(0)
+    , parser_(new http::MemoryBodyReceiver(body_), true) {
+}
+
+ReactorShortLink::~ReactorShortLink() {
+    xinfo_function(TSF"taskid:%_, cgi:%_, @%_", task_.taskid, task_.cgi, this);
+
+    // a prepare still waiting for dns or a proxy gives up, then nothing can hand the link to the reactor any more.
+    breaker_.Break();
+    dns_util_.Cancel();
+    if (MessageQueue::KNullPost != prepare_post_) {
+        MessageQueue::CancelMessage(prepare_post_);
+        MessageQueue::WaitMessage(prepare_post_);
+    }
+
+    ShortLinkReactor::Instance().Stop(this);
+}
+
+void ReactorShortLink::SendRequest(AutoBuffer& _buf_req, AutoBuffer& _buffer_extend) {
+    xverbose_function();
+    xdebug2(XTHIS)(TSF"bufReq.size:%_", _buf_req.Length());
+    send_body_.Attach(_buf_req);
+    send_extend_.Attach(_buffer_extend);
+
+    prepare_post_ = MessageQueue::AsyncInvoke(boost::bind(&ReactorShortLink::__RunPrepare, this),
+                                              MessageQueue::DefAsyncInvokeHandler(__PreparePool()), "ReactorShortLink::__RunPrepare");
+}
+
+void ReactorShortLink::__RunPrepare() {
+    xinfo_function(TSF"taskid:%_, cgi:%_, @%_, net:%_", task_.taskid, task_.cgi, this, getNetInfo());
+
+    getCurrNetLabel(profile_.net_type);
+    profile_.start_time = ::gettickcount();
+    profile_.tid = xlogger_tid();
+    __UpdateProfile(profile_);
+
+    socket_address* proxy_addr = NULL;
+    SOCKET cached_sock = INVALID_SOCKET;
+
+    if (!__PrepareConnect(profile_, vecaddr_, proxy_addr, cached_sock)) {
+        if (INVALID_SOCKET == cached_sock) return;
+
+        sock_ = cached_sock;
+        state_ = kStateSend;
+    } else if (NULL != proxy_addr) {
+        // the handshake with the proxy stays with ComplexConnect, on this thread
+        sock_ = __RunComplexConnect(profile_, vecaddr_, proxy_addr);
+        if (INVALID_SOCKET == sock_) return;
+
+        state_ = kStateSend;
+    } else {
+        contain_v6_ = __ContainIPv6(vecaddr_);
+        state_ = kStateConnect;
+    }
+
+    if (breaker_.IsBreak()) {
+        if (INVALID_SOCKET != sock_) socket_close(sock_);
+        sock_ = INVALID_SOCKET;
+        return;
+    }
+
+    ShortLinkReactor::Instance().Start(this);
+}
+
+void ReactorShortLink::OnStart() {
+    if (kStateSend == state_) {
+        __StartSend();
+        return;
+    }
+
+    xassert2(kStateConnect == state_, "%_", state_);
+    attempts_.resize(vecaddr_.size());
+    connecting_.assign(vecaddr_.size(), 0);
+    connect_start_ = ::gettickcount();
+
+    xinfo2(TSF"taskid:%_, connect %_ addresses, @%_", task_.taskid, vecaddr_.size(), this);
+    __ConnectNext(connect_start_);
+    __ConnectCheck(::gettickcount());
+}
+
+void ReactorShortLink::OnEvent(SOCKET _fd, bool _readable, bool _writable, bool _error) {
+    switch (state_) {
+    case kStateConnect: {
+        for (size_t i = 0; i < attempts_.size(); ++i) {
+            if (attempts_[i].sock != _fd) continue;
+
+            int error = socket_error(_fd);
+            if (0 == error && (_writable || _readable) && !_error) {
+                __Connected(i, ::gettickcount());
+                return;
+            }
+
+            __ConnectFailed(i, 0 != error ? error : SOCKET_ERRNO(ECONNREFUSED));
+            break;
+        }
+        __ConnectCheck(::gettickcount());
+        break;
+    }
+    case kStateSend:
+        __OnWritable();
+        break;
+    case kStateRecv:
+        __OnReadable();
+        break;
+    default:
+        xassert2(false, "state:%_, fd:%_", state_, _fd);
+        break;
+    }
+}
+
+void ReactorShortLink::OnTimeout() {
+    if (kStateConnect != state_) return;
+
+    uint64_t now = ::gettickcount();
+    for (size_t i = 0; i < attempts_.size(); ++i) {
+        if (INVALID_SOCKET == attempts_[i].sock) continue;
+        if (now < attempts_[i].start_time + kShortlinkConnTimeout) continue;
+
+        __ConnectFailed(i, SOCKET_ERRNO(ETIMEDOUT));
+    }
+
+    __ConnectCheck(now);
+}
+
+uint64_t ReactorShortLink::__NextConnectTime() const {
+    if (!contain_v6_) return last_start_ + kShortlinkConnInterval;
+
+    // ComplexConnect's MODE_INCREASE: 1s, 2s, 4s... capped by the interval
+    unsigned int interval = kIncreaseModeInterval << std::min(next_index_, (size_t)16);
+    return last_start_ + std::min(interval, kShortlinkConnInterval);
+}
+
+void ReactorShortLink::__ConnectNext(uint64_t _now) {
+    while (next_index_ < vecaddr_.size()) {
+        size_t index = next_index_++;
+        const socket_address& addr = vecaddr_[index];
+        last_start_ = _now;
+
+        SOCKET sock = socket(addr.address().sa_family, SOCK_STREAM, IPPROTO_TCP);
+        if (INVALID_SOCKET == sock) {
+            int error = socket_errno;
+            xerror2(TSF"index:%_, socket err:(%_, %_)", index, error, socket_strerror(error));
+            last_error_ = error;
+            continue;
+        }
+
+        if (::getNetInfo() == kWifi && socket_fix_tcp_mss(sock) < 0) {
+            xinfo2(TSF"wifi set tcp mss error:%_", socket_strerror(socket_errno));
+        }
+
+        if (0 != socket_set_nobio(sock) || (0 != ::connect(sock, &addr.address(), addr.address_length()) && !IS_NOBLOCK_CONNECT_ERRNO(socket_errno))) {
+            int error = socket_errno;
+            xwarn2(TSF"index:%_, addr:%_, connect err:(%_, %_)", index, addr.url(), error, socket_strerror(error));
+            socket_close(sock);
+            last_error_ = error;
+            if (index < profile_.ip_items.size() && func_network_report)
+                func_network_report(__LINE__, kEctSocket, error, addr.ip(), profile_.ip_items[index].str_host, addr.port());
+            continue;
+        }
+
+        xinfo2(TSF"index:%_, sock:%_, connect %_", index, sock, addr.url());
+        attempts_[index].sock = sock;
+        attempts_[index].start_time = _now;
+        connecting_[index] = 1;
+        ShortLinkReactor::Instance().Watch(this, sock, false, true);
+        return;
+    }
+}
+
+void ReactorShortLink::__ConnectFailed(size_t _index, int _error) {
+    Attempt& attempt = attempts_[_index];
+    const socket_address& addr = vecaddr_[_index];
+
+    xwarn2(TSF"index:%_, sock:%_, addr:%_, connect err:(%_, %_), cost:%_", _index, attempt.sock, addr.url(), _error, socket_strerror(_error), ::gettickcount() - attempt.start_time);
+
+    ShortLinkReactor::Instance().Close(this, attempt.sock);
+    attempt.sock = INVALID_SOCKET;
+    connecting_[_index] = 0;
+    last_error_ = _error;
+
+    if (_index < profile_.ip_items.size() && func_network_report)
+        func_network_report(__LINE__, kEctSocket, _error, addr.ip(), profile_.ip_items[_index].str_host, addr.port());
+}
+
+// starts what is due, answers the task if there's nothing left to try, else sets the timer for the next step.
+void ReactorShortLink::__ConnectCheck(uint64_t _now) {
+    size_t running = 0;
+    uint64_t deadline = 0;
+
+    for (size_t i = 0; i < attempts_.size(); ++i) {
+        if (INVALID_SOCKET == attempts_[i].sock) continue;
+
+        ++running;
+        uint64_t timeout = attempts_[i].start_time + kShortlinkConnTimeout;
+        if (0 == deadline || timeout < deadline) deadline = timeout;
+    }
+
+    // nothing left running, the next address goes right away
+    if (next_index_ < vecaddr_.size() && running < kMaxConnecting && (0 == running || __NextConnectTime() <= _now)) {
+        __ConnectNext(_now);
+        __ConnectCheck(_now);
+        return;
+    }
+
+    if (0 == running) {
+        SOCKET sock = __ConnectFinished(profile_, INVALID_SOCKET, -1, 0, (unsigned int)(_now - connect_start_), last_error_, &connecting_[0], contain_v6_);
+        xassert2(INVALID_SOCKET == sock);
+        state_ = kStateEnd;
+        ShortLinkReactor::Instance().SetTimeout(this, 0);
+        return;
+    }
+
+    if (next_index_ < vecaddr_.size() && running < kMaxConnecting) deadline = std::min(deadline, __NextConnectTime());
+    ShortLinkReactor::Instance().SetTimeout(this, deadline);
+}
+
+void ReactorShortLink::__Connected(size_t _index, uint64_t _now) {
+    SOCKET sock = attempts_[_index].sock;
+    unsigned int rtt = (unsigned int)(_now - attempts_[_index].start_time);
+    attempts_[_index].sock = INVALID_SOCKET;
+
+    for (size_t i = 0; i < attempts_.size(); ++i) {
+        if (INVALID_SOCKET == attempts_[i].sock) continue;
+        ShortLinkReactor::Instance().Close(this, attempts_[i].sock);
+        attempts_[i].sock = INVALID_SOCKET;
+    }
+    ShortLinkReactor::Instance().SetTimeout(this, 0);
+
+    xinfo2(TSF"index:%_, sock:%_, connected %_, rtt:%_", _index, sock, vecaddr_[_index].url(), rtt);
+
+    connecting_[_index] = 0;
+    sock_ = __ConnectFinished(profile_, sock, (int)_index, rtt, (unsigned int)(_now - connect_start_), 0, &connecting_[0], contain_v6_);
+    state_ = kStateSend;
+    __StartSend();
+}
+
+void ReactorShortLink::__StartSend() {
+    if (OnSend) {
+        OnSend(this);
+    } else {
+        xwarn2(TSF"OnSend NULL.");
+    }
+
+    if (0 != socket_set_nobio(sock_)) {
+        xwarn2(TSF"sock:%_, socket_set_nobio:(%_, %_)", sock_, socket_errno, socket_strerror(socket_errno));
+    }
+
+    __PackRequest(profile_, out_buff_);
+    sent_len_ = 0;
+    xinfo2(TSF"task socket send sock:%_, taskid:%_, cgi:%_, @%_ http len:%_, ", sock_, task_.taskid, task_.cgi, this, out_buff_.Length());
+
+    ShortLinkReactor::Instance().Watch(this, sock_, false, true);
+    __OnWritable();
+}
+
+void ReactorShortLink::__OnWritable() {
+    while (sent_len_ < out_buff_.Length()) {
+        ssize_t nwrite = ::send(sock_, (const char*)out_buff_.Ptr() + sent_len_, out_buff_.Length() - sent_len_, 0);
+
+        if (0 < nwrite) {
+            sent_len_ += nwrite;
+            continue;
+        }
+
+        int error = socket_errno;
+        if (0 > nwrite && IS_NOBLOCK_SEND_ERRNO(error)) return;
+
+        xerror2(TSF"Send Request Error, ret:%_, errno:%_, nread:%_, nwrite:%_", nwrite, socket_strerror(error), socket_nread(sock_), socket_nwrite(sock_));
+        __RunResponseError(kEctSocket, (0 == error) ? kEctSocketWritenWithNonBlock : error, profile_, true);
+        __Finish();
+        return;
+    }
+
+    GetSignalOnNetworkDataChange()(XLOGGER_TAG, sent_len_, 0);
+
+    state_ = kStateRecv;
+    ShortLinkReactor::Instance().Watch(this, sock_, true, false);
+}
+
+void ReactorShortLink::__OnReadable() {
+    if (recv_buf_.Capacity() - recv_buf_.Length() < kBufferSize) {
+        recv_buf_.AddCapacity(kBufferSize - (recv_buf_.Capacity() - recv_buf_.Length()));
+    }
+
+    ssize_t nrecv = ::recv(sock_, recv_buf_.Ptr(recv_buf_.Length()), kBufferSize, 0);
+    int error = socket_errno;
+
+    if (0 > nrecv && IS_NOBLOCK_READ_ERRNO(error)) return;
+
+    xgroup2_define(group_recv);
+    xgroup2_define(group_close);
+    bool done = true;
+
+    if (0 > nrecv) {
+        xerror2(TSF"read socket error:%_, nread:%_, nwrite:%_", socket_strerror(error), socket_nread(sock_), socket_nwrite(sock_)) >> group_close;
+        __RunResponseError(kEctSocket, (0 == error) ? kEctSocketReadOnce : error, profile_, true);
+    } else if (0 == nrecv) {
+        xerror2(TSF"remote disconnect, nread:%_, nwrite:%_", socket_nread(sock_), socket_nwrite(sock_)) >> group_close;
+        __RunResponseError(kEctSocket, kEctSocketShutdown, profile_, true);
+    } else {
+        recv_buf_.Length(recv_buf_.Pos(), recv_buf_.Length() + nrecv);
+        done = __OnRecvData(sock_, parser_, recv_buf_, (int)nrecv, recv_pos_, status_code_, body_, extension_, profile_, group_recv, group_close);
+    }
+
+    xgroup2_if(!group_recv.Empty(), TSF"task socket recv sock:%_, taskid:%_, @%_, ", sock_, task_.taskid, this) << group_recv;
+    xgroup2_if(!group_close.Empty(), TSF"task socket close sock:%_, taskid:%_, @%_, ", sock_, task_.taskid, this) << group_close;
+
+    if (done) __Finish();
+}
+
+void ReactorShortLink::__Finish() {
+    profile_.disconn_signal = ::getSignal(::getNetInfo() == kWifi);
+    __UpdateProfile(profile_);
+
+    if (!is_keep_alive_) {
+        ShortLinkReactor::Instance().Close(this, sock_);
+    } else {
+        xinfo2(TSF"keep alive, do not close socket:%_", sock_);
+        ShortLinkReactor::Instance().Unwatch(this, sock_);
+    }
+
+    sock_ = INVALID_SOCKET;
+    state_ = kStateEnd;
+}
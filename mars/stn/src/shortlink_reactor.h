@@ -0,0 +1,180 @@
+// Tencent is pleased to support the open source community by making Mars available.
+// Copyright (C) 2016 THL A29 Limited, a Tencent company. All rights reserved.
+
+// Licensed under the MIT License (the "License"); you may not use this file except in
+// compliance with the License. You may obtain a copy of the License at
+// http://opensource.org/licenses/MIT
+
+// Unless required by applicable law or agreed to in writing, software distributed under the License is
+// distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/*
+ * shortlink_reactor.h
+ *
+ *  Created on: 2026-10-18
+ */
+
+#ifndef STN_SRC_SHORTLINK_REACTOR_H_
+#define STN_SRC_SHORTLINK_REACTOR_H_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "mars/comm/thread/condition.h"
+#include "mars/comm/thread/lock.h"
+#include "mars/comm/thread/thread.h"
+#include "mars/comm/socket/socketselect.h"
+
+#include "shortlink.h"
+
+namespace mars {
+namespace stn {
+
+/*
+ * One thread running the sockets of all ReactorShortLink, in place of a thread per link.
+ *
+ * A Handler's callbacks run on that thread, one at a time, and must not block.
+ * Watch/Unwatch/Close/SetTimeout are for those callbacks only, Start and Stop can be called from anywhere.
+ */
+class ShortLinkReactor {
+  public:
+    class Handler {
+      public:
+        virtual ~Handler() {}
+
+        virtual void OnStart() = 0;
+        virtual void OnEvent(SOCKET _fd, bool _readable, bool _writable, bool _error) = 0;
+        virtual void OnTimeout() = 0;
+    };
+
+    static ShortLinkReactor& Instance();
+
+  public:
+    void Start(Handler* _handler);
+    // no callback runs after it returns. the sockets the handler still watches are closed.
+    void Stop(Handler* _handler);
+
+    void Watch(Handler* _handler, SOCKET _fd, bool _read, bool _write);
+    void Unwatch(Handler* _handler, SOCKET _fd);    // the socket is the caller's again
+    void Close(Handler* _handler, SOCKET _fd);
+    void SetTimeout(Handler* _handler, uint64_t _deadline);   // OnTimeout() at that tick, 0 for none
+
+    size_t Size();
+
+  private:
+    struct Entry {
+        Entry(): deadline(0) {}
+        std::vector<SOCKET> fds;
+        uint64_t deadline;
+    };
+
+    enum CallType {
+        kCallStart,
+        kCallEvent,
+        kCallTimeout,
+    };
+
+    ShortLinkReactor();
+    ~ShortLinkReactor();
+
+    void __Run();
+    void __Call(ScopedLock& _lock, Handler* _handler, CallType _type, PollEvent* _event = NULL);
+
+  private:
+    ShortLinkReactor(const ShortLinkReactor&);
+    ShortLinkReactor& operator=(const ShortLinkReactor&);
+
+  private:
+    Mutex mutex_;
+    Condition cond_;
+    SocketBreaker breaker_;
+    SocketSelect select_;   // persistent, the poll set stays across rounds
+
+    std::map<Handler*, Entry> handlers_;
+    std::vector<Handler*> starting_;
+    std::set<std::pair<uint64_t, Handler*> > deadlines_;
+    std::vector<SOCKET> closing_;   // of stopped handlers, closed by the thread once they are off the poll set
+    Handler* running_;
+
+    Thread thread_;
+};
+
+/*
+ * A ShortLink whose connect race, send and response parsing run as a state machine on ShortLinkReactor.
+ * What may block, dns and the handshake with a tunnel or socks5 proxy, runs on a small task pool first.
+ * Set ShortLinkChannelFactory::Create to CreateReactorShortLink to have ShortLinkTaskManager use it.
+ */
+class ReactorShortLink : public ShortLink, private ShortLinkReactor::Handler {
+  public:
+    ReactorShortLink(MessageQueue::MessageQueue_t _messagequeueid, NetSource& _netsource, const Task& _task, bool _use_proxy);
+    virtual ~ReactorShortLink();
+
+  protected:
+    virtual void SendRequest(AutoBuffer& _buffer_req, AutoBuffer& _task_extend);
+
+  private:
+    enum State {
+        kStateInit,
+        kStateConnect,
+        kStateSend,
+        kStateRecv,
+        kStateEnd,
+    };
+
+    struct Attempt {
+        Attempt(): sock(INVALID_SOCKET), start_time(0) {}
+        SOCKET sock;
+        uint64_t start_time;
+    };
+
+    void __RunPrepare();
+
+    virtual void OnStart();
+    virtual void OnEvent(SOCKET _fd, bool _readable, bool _writable, bool _error);
+    virtual void OnTimeout();
+
+    void __ConnectNext(uint64_t _now);
+    void __ConnectFailed(size_t _index, int _error);
+    void __ConnectCheck(uint64_t _now);
+    uint64_t __NextConnectTime() const;
+    void __Connected(size_t _index, uint64_t _now);
+
+    void __StartSend();
+    void __OnWritable();
+    void __OnReadable();
+    void __Finish();
+
+  private:
+    State state_;
+    ConnectProfile profile_;
+    MessageQueue::MessagePost_t prepare_post_;
+
+    std::vector<socket_address> vecaddr_;
+    bool contain_v6_;
+    std::vector<Attempt> attempts_;
+    std::vector<char> connecting_;     // per address, as ShortLinkConnectObserver keeps it
+    size_t next_index_;
+    uint64_t connect_start_;
+    uint64_t last_start_;
+    int last_error_;
+
+    SOCKET sock_;
+    AutoBuffer out_buff_;
+    size_t sent_len_;
+
+    AutoBuffer body_;
+    AutoBuffer recv_buf_;
+    AutoBuffer extension_;
+    int status_code_;
+    off_t recv_pos_;
+    http::Parser parser_;
+};
+
+}
+}
+
+#endif // STN_SRC_SHORTLINK_REACTOR_H_
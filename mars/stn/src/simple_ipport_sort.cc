@@ -24,6 +24,7 @@
 #include <math.h>
 #include <deque>
 #include <algorithm>
+#include <functional>
 
 #include "boost/filesystem.hpp"
 #include "boost/bind.hpp"
@@ -37,20 +38,11 @@
 
 #include "mars/app/app.h"
 
-#define IPPORT_RECORDS_FILENAME "/ipportrecords2.xml"
+#define IPPORT_RECORDS_FILENAME "/ipportrecords3.dat"
+#define IPPORT_XML_RECORDS_FILENAME "/ipportrecords2.xml"   // before ipportrecords3.dat, migrated on load
 
 static const time_t kRecordTimeout = 60 * 60 * 24;
 static const char* const kFolderName = "host";
-// const static char* const RECORDS = "records";
-static const char* const kRecord = "record";
-static const char* const kItem = "item";
-static const char* const kTime = "time";
-static const char* const kNetInfo = "netinfo";
-static const char* const kIP = "ip";
-static const char* const kPort = "port";
-//static const char* const kSuccess = "succ";
-//static const char* const kTotal = "total";
-static const char* const kHistoryResult = "historyresult";
 
 static const unsigned int kBanTime = 6 * 60 * 1000;  // 6 min
 static const unsigned int kMaxBanTime = 30 * 60 * 1000; // 30 min
@@ -102,6 +94,7 @@ using namespace mars::stn;
 
 SimpleIPPortSort::SimpleIPPortSort()
 : hostpath_(mars::app::GetAppFilePath() + "/" + kFolderName)
+, ban_fail_count_(0)
 , IPv6_ban_flag_(0)
 , IPv4_ban_flag_(0) 
 , ban_v6_(false) {
@@ -111,103 +104,65 @@ SimpleIPPortSort::SimpleIPPortSort()
     }
         
     ScopedLock lock(mutex_);
-    __LoadXml();
+    __LoadRecords();
     lock.unlock();
     InitHistory2BannedList(false);
 }
 
 SimpleIPPortSort::~SimpleIPPortSort() {
     ScopedLock lock(mutex_);
-    __SaveXml();
+    records_.Close();
 }
 
-void SimpleIPPortSort::__SaveXml() {
-    __RemoveTimeoutXml();
-    recordsxml_.SaveFile((hostpath_ + IPPORT_RECORDS_FILENAME).c_str());
+void SimpleIPPortSort::__LoadRecords() {
+    if (!records_.Open(hostpath_ + IPPORT_RECORDS_FILENAME)) return;
+    __MigrateXml();
+    records_.RemoveTimeout(kRecordTimeout);
 }
 
-void SimpleIPPortSort::__LoadXml() {
-    tinyxml2::XMLError error = recordsxml_.LoadFile((hostpath_ + IPPORT_RECORDS_FILENAME).c_str());
-    if (tinyxml2::XML_SUCCESS != error) return;
-    __RemoveTimeoutXml();
-}
-
-void SimpleIPPortSort::__RemoveTimeoutXml() {
-    std::vector<tinyxml2::XMLElement*> remove_ele_ptr_list;
-
-    for (tinyxml2::XMLElement* record = recordsxml_.FirstChildElement(kRecord);
-            NULL != record; record = record->NextSiblingElement(kRecord)) {
-        const char* lasttime_chr = record->Attribute(kTime);
-
-        if (lasttime_chr) {
-            struct timeval now = {0};
-            gettimeofday(&now, NULL);
-            time_t lasttime = (time_t)strtoul(lasttime_chr, NULL, 10);
-
-            if (now.tv_sec < lasttime || now.tv_sec - lasttime >= kRecordTimeout) {
-                remove_ele_ptr_list.push_back(record);
-            }
-        } else {
-            remove_ele_ptr_list.push_back(record);
-        }
-    }
+void SimpleIPPortSort::__MigrateXml() {
+    std::string xml_path = hostpath_ + IPPORT_XML_RECORDS_FILENAME;
+    if (!boost::filesystem::exists(xml_path)) return;
 
-    for (std::vector<tinyxml2::XMLElement*>::iterator iter = remove_ele_ptr_list.begin();
-            iter != remove_ele_ptr_list.end(); ++iter) {
-        recordsxml_.DeleteChild(*iter);
-    }
+    int count = records_.ImportXml(xml_path);
+    xinfo2(TSF"migrate %_ items from %_", count, xml_path);
+    boost::filesystem::remove(xml_path);
 }
 
-void SimpleIPPortSort::InitHistory2BannedList(bool _savexml) {
+void SimpleIPPortSort::InitHistory2BannedList(bool _remove_timeout) {
     ScopedLock lock(mutex_);
-    if (_savexml) __SaveXml();
+    if (_remove_timeout) records_.RemoveTimeout(kRecordTimeout);
     
     _ban_fail_list_.clear();
+    ban_fail_count_ = 0;
     
     std::string curr_netinfo;
     if (kNoNet == getCurrNetLabel(curr_netinfo)) return;
 
-    const tinyxml2::XMLElement* record = NULL;
+    std::vector<IPPortRecordStore::Record> records;
+    records_.GetRecords(curr_netinfo, records);
 
-    for (record = recordsxml_.FirstChildElement(kRecord);
-            NULL != record; record = record->NextSiblingElement(kRecord)) {
-        const char* netinfoChr = record->Attribute(kNetInfo);
-
-        if (netinfoChr && (0 == strcmp(netinfoChr, curr_netinfo.c_str()))) {
-            xwarn2(TSF"netinfoChr:%_, curr_netinfo.c_str():%_", netinfoChr, curr_netinfo.c_str());
-            break;
-        }
-    }
-
-    if (NULL == record) { return; }
-
-    for (const tinyxml2::XMLElement* item = record->FirstChildElement(kItem); NULL != item; item = item->NextSiblingElement(kItem)) {
-        const char* ip = item->Attribute(kIP);
-        uint32_t    port = item->UnsignedAttribute(kPort);
-        uint64_t    historyresult = (uint64_t)item->Int64Attribute(kHistoryResult);
+    for (std::vector<IPPortRecordStore::Record>::const_iterator iter = records.begin(); iter != records.end(); ++iter) {
+        uint64_t historyresult = iter->history_result;
         
-        struct BanItem banitem;
-        if(ip) banitem.ip = ip;
-        banitem.port = port;
+        BanItem& banitem = __InsertBanned(iter->ip, iter->port);
         banitem.records = 0;
         //8 in 1
         for (int i = 0; i < 8; ++i) {
             SET_BIT(historyresult & 0xFF, banitem.records);
             historyresult >>= 8;
         }
-        _ban_fail_list_.push_back(banitem);
     }
 }
 
 void SimpleIPPortSort::RemoveBannedList(const std::string& _ip) {
     ScopedLock lock(mutex_);
 
-    for (std::vector<BanItem>::iterator iter = _ban_fail_list_.begin(); iter != _ban_fail_list_.end();) {
-        if (iter->ip == _ip)
-            iter = _ban_fail_list_.erase(iter);
-        else
-            ++iter;
+    for (std::vector<BanItem>::iterator iter = _ban_fail_list_.begin(); iter != _ban_fail_list_.end(); ++iter) {
+        if (iter->ip == _ip) iter->ip.clear();
     }
+    // the cleared slots break the probe chains, put the rest again.
+    __RehashBanned(_ban_fail_list_.size());
 }
 
 void SimpleIPPortSort::Update(const std::string& _ip, uint16_t _port, bool _is_success) {
@@ -219,82 +174,74 @@ void SimpleIPPortSort::Update(const std::string& _ip, uint16_t _port, bool _is_s
     if (!__CanUpdate(_ip, _port, _is_success)) return;
     
     __UpdateBanList(_is_success,  _ip,  _port);
+    records_.Update(curr_net_info, _ip, _port, _is_success);
+}
 
-    tinyxml2::XMLElement* record = NULL;
+static size_t __BanHash(const std::string& _ip, uint16_t _port) {
+    return std::hash<std::string>()(_ip) ^ ((size_t)_port * 0x9e3779b9);
+}
 
-    for (record = recordsxml_.FirstChildElement(kRecord);
-            NULL != record; record = record->NextSiblingElement(kRecord)) {
-        const char* netinfo_chr = record->Attribute(kNetInfo);
-        if (netinfo_chr && (0 == strcmp(netinfo_chr, curr_net_info.c_str()))) break;
-    }
+BanItem* SimpleIPPortSort::__FindBanned(const std::string& _ip, uint16_t _port) const {
+    if (_ban_fail_list_.empty()) return NULL;
 
-    if (NULL == record) {
-        struct timeval timeval = {0};
-        gettimeofday(&timeval, NULL);
-        char timebuf[128] = {0};
-        snprintf(timebuf, sizeof(timebuf), "%ld", timeval.tv_sec);
-        
-        record = recordsxml_.NewElement(kRecord);
-        record->SetAttribute(kNetInfo, curr_net_info.c_str());
-        record->SetAttribute(kTime, timebuf);
-        recordsxml_.InsertEndChild(record);
+    size_t mask = _ban_fail_list_.size() - 1;
+    for (size_t i = __BanHash(_ip, _port) & mask; ; i = (i + 1) & mask) {
+        BanItem& item = _ban_fail_list_[i];
+        if (item.ip.empty()) return NULL;
+        if (item.port == _port && item.ip == _ip) return &item;
     }
+}
 
-    tinyxml2::XMLElement* item = NULL;
-
-    for (item = record->FirstChildElement(kItem);
-            NULL != item; item = item->NextSiblingElement(kItem)) {
-        const char* ip = item->Attribute(kIP);
-        uint32_t port = item->UnsignedAttribute(kPort);
-
-        if (ip && (0 == strcmp(ip, _ip.c_str())) && port == _port) break;
+BanItem& SimpleIPPortSort::__InsertBanned(const std::string& _ip, uint16_t _port) {
+    // no more than half full, a probe always ends at an empty slot.
+    if ((ban_fail_count_ + 1) * 2 > _ban_fail_list_.size()) {
+        __RehashBanned(std::max<size_t>(16, _ban_fail_list_.size() * 2));
     }
 
-    if (NULL == item) {
-        item = recordsxml_.NewElement(kItem);
-        item->SetAttribute(kIP, _ip.c_str());
-        item->SetAttribute(kPort, _port);
-        record->InsertEndChild(item);
+    size_t mask = _ban_fail_list_.size() - 1;
+    for (size_t i = __BanHash(_ip, _port) & mask; ; i = (i + 1) & mask) {
+        BanItem& item = _ban_fail_list_[i];
+        if (item.ip.empty()) {
+            item.ip = _ip;
+            item.port = _port;
+            ++ban_fail_count_;
+            return item;
+        }
+        if (item.port == _port && item.ip == _ip) return item;
     }
-
-    uint64_t history_result = item->Int64Attribute(kHistoryResult);
-    SET_BIT(!_is_success, history_result);
-    item->SetAttribute(kHistoryResult, (int64_t)history_result);
 }
 
-std::vector<BanItem>::iterator  SimpleIPPortSort::__FindBannedIter(const std::string& _ip, unsigned short _port) const {
-    std::vector<BanItem>::iterator iter;
+void SimpleIPPortSort::__RehashBanned(size_t _capacity) {
+    std::vector<BanItem> slots(_capacity);
+    slots.swap(_ban_fail_list_);
+    ban_fail_count_ = 0;
 
-    for (iter = _ban_fail_list_.begin(); iter != _ban_fail_list_.end(); ++iter) {
-        if (iter->ip == _ip && iter->port == _port) {
-            return iter;
-        }
+    for (std::vector<BanItem>::const_iterator iter = slots.begin(); iter != slots.end(); ++iter) {
+        if (!iter->ip.empty()) __InsertBanned(iter->ip, iter->port) = *iter;
     }
-
-    return iter;
 }
 
 bool SimpleIPPortSort::__IsBanned(const std::string& _ip, unsigned short _port) const {
-    return __IsBanned(__FindBannedIter(_ip, _port));
+    return __IsBanned(__FindBanned(_ip, _port));
 }
 
-bool SimpleIPPortSort::__IsBanned(std::vector<BanItem>::iterator _iter) const {
-    if (_iter == _ban_fail_list_.end()) return false;
+bool SimpleIPPortSort::__IsBanned(const BanItem* _item) const {
+    if (NULL == _item) return false;
 
-    bool baned =  CAL_BIT_COUNT(_iter->records) >= kBanFailCount;
+    bool baned =  CAL_BIT_COUNT(_item->records) >= kBanFailCount;
     if (!baned) return false;
     
-    uint32_t last_continuous_cnt = CAL_LAST_CONTINUOUS_BIT_COUNT(_iter->records);
+    uint32_t last_continuous_cnt = CAL_LAST_CONTINUOUS_BIT_COUNT(_item->records);
     int64_t ban_time = kBanTime;
     if (last_continuous_cnt > kBanFailCount) {
         ban_time += (last_continuous_cnt - kBanFailCount) * kBanTime;
         if (ban_time > kMaxBanTime) {
             ban_time = kMaxBanTime;
         }
-        xinfo2(TSF"%_:%_ ban time:%_", _iter->ip, _iter->port, ban_time);
+        xinfo2(TSF"%_:%_ ban time:%_", _item->ip, _item->port, ban_time);
     }
     
-    if (_iter->last_fail_time.gettickspan() < ban_time) {
+    if (_item->last_fail_time.gettickspan() < ban_time) {
         return true;
     }
 
@@ -303,28 +250,14 @@ bool SimpleIPPortSort::__IsBanned(std::vector<BanItem>::iterator _iter) const {
 
 void SimpleIPPortSort::__UpdateBanList(bool _is_success, const std::string& _ip, unsigned short _port) {
     __UpdateBanFlagAndTime(_ip, _is_success);
-    for (std::vector<BanItem>::iterator iter = _ban_fail_list_.begin(); iter != _ban_fail_list_.end(); ++iter) {
-        if (iter->ip == _ip && iter->port == _port) {
-            SET_BIT(!_is_success, iter->records);
-            if (_is_success)
-                iter->last_suc_time.gettickcount();
-            else
-                iter->last_fail_time.gettickcount();
-            return;
-        }
-    }
 
-    BanItem item;
-    item.ip = _ip;
-    item.port = _port;
+    BanItem& item = __InsertBanned(_ip, _port);
     SET_BIT(!_is_success, item.records);
     
     if (_is_success)
         item.last_suc_time.gettickcount();
     else
         item.last_fail_time.gettickcount();
-    
-    _ban_fail_list_.push_back(item);
 }
 
 
@@ -384,17 +317,14 @@ bool SimpleIPPortSort::__IsIPv6(const std::string& _ip) {
 }
 
 bool SimpleIPPortSort::__CanUpdate(const std::string& _ip, uint16_t _port, bool _is_success) const {
-    for (std::vector<BanItem>::iterator iter = _ban_fail_list_.begin(); iter != _ban_fail_list_.end(); ++iter) {
-        if (iter->ip == _ip && iter->port == _port) {
-            if (_is_success) {
-                return kSuccessUpdateInterval < iter->last_suc_time.gettickspan();
-            } else {
-                return kFailUpdateInterval < iter->last_fail_time.gettickspan();
-            }
-        }
+    const BanItem* item = __FindBanned(_ip, _port);
+    if (NULL == item) return true;
+
+    if (_is_success) {
+        return kSuccessUpdateInterval < item->last_suc_time.gettickspan();
+    } else {
+        return kFailUpdateInterval < item->last_fail_time.gettickspan();
     }
-    
-    return true;
 }
 
 void SimpleIPPortSort::__FilterbyBanned(std::vector<IPPortItem>& _items) const {
@@ -454,12 +384,7 @@ void SimpleIPPortSort::__SortbyBanned(std::vector<IPPortItem>& _items, bool _use
     std::deque<IPPortItem> items_history(_items.size());
     std::deque<IPPortItem> items_new(_items.size());
     auto find_lambda = [&](const IPPortItem& _v) {
-        for (std::vector<BanItem>::const_iterator it_banned = _ban_fail_list_.begin(); it_banned != _ban_fail_list_.end(); ++it_banned) {
-            if (it_banned->ip == _v.str_ip && it_banned->port == _v.port) {
-                return true;
-            }
-        }
-        return false;
+        return NULL != __FindBanned(_v.str_ip, _v.port);
     };
     
     items_history.erase(std::remove_copy_if(_items.begin(), _items.end(), items_history.begin(), !boost::bind<bool>(find_lambda, _1)), items_history.end());
@@ -469,17 +394,13 @@ void SimpleIPPortSort::__SortbyBanned(std::vector<IPPortItem>& _items, bool _use
     //sort history
     std::sort(items_history.begin(), items_history.end(),
               [&](const IPPortItem& _l, const IPPortItem& _r){
-                  auto find_lr_lambda  = [](const BanItem& _v, const IPPortItem& _find) {
-                      return _v.ip == _find.str_ip && _v.port == _find.port;
-                  };
-                      
-                  std::vector<BanItem>::const_iterator  l = std::find_if(_ban_fail_list_.begin(), _ban_fail_list_.end(), boost::bind<bool>(find_lr_lambda, _1, _l));
-                  std::vector<BanItem>::const_iterator  r = std::find_if(_ban_fail_list_.begin(), _ban_fail_list_.end(), boost::bind<bool>(find_lr_lambda, _1, _r));
+                  const BanItem* l = __FindBanned(_l.str_ip, _l.port);
+                  const BanItem* r = __FindBanned(_r.str_ip, _r.port);
                       
-                  xassert2(l != _ban_fail_list_.end());
-                  xassert2(r != _ban_fail_list_.end());
+                  xassert2(NULL != l);
+                  xassert2(NULL != r);
                   
-                 if(l == _ban_fail_list_.end() || r == _ban_fail_list_.end())
+                 if(NULL == l || NULL == r)
                   return false;
                  
                  if (CAL_BIT_COUNT(l->records) != CAL_BIT_COUNT(r->records))
@@ -27,10 +27,11 @@
 #include <deque>
 
 #include "mars/comm/thread/lock.h"
-#include "mars/comm/tinyxml2.h"
 #include "mars/comm/tickcount.h"
 #include "mars/stn/stn.h"
 
+#include "ipport_record_store.h"
+
 namespace mars {
 namespace stn {
 
@@ -41,7 +42,7 @@ class SimpleIPPortSort {
     SimpleIPPortSort();
     ~SimpleIPPortSort();
 
-    void InitHistory2BannedList(bool _savexml);
+    void InitHistory2BannedList(bool _remove_timeout);
     void RemoveBannedList(const std::string& _ip);
     void Update(const std::string& _ip, uint16_t _port, bool _is_success);
 
@@ -51,12 +52,13 @@ class SimpleIPPortSort {
     bool CanUseIPv6();
     
   private:
-    void __LoadXml();
-    void __SaveXml();
-    void __RemoveTimeoutXml();
+    void __LoadRecords();
+    void __MigrateXml();
 
-    std::vector<BanItem>::iterator __FindBannedIter(const std::string& _ip, uint16_t _port) const;
-    bool __IsBanned(std::vector<BanItem>::iterator _iter) const;
+    BanItem* __FindBanned(const std::string& _ip, uint16_t _port) const;
+    BanItem& __InsertBanned(const std::string& _ip, uint16_t _port);
+    void __RehashBanned(size_t _capacity);
+    bool __IsBanned(const BanItem* _item) const;
     bool __IsBanned(const std::string& _ip, uint16_t _port) const;
     void __UpdateBanList(bool _isSuccess, const std::string& _ip, uint16_t _port);
     bool __CanUpdate(const std::string& _ip, uint16_t _port, bool _is_success) const;
@@ -76,10 +78,11 @@ class SimpleIPPortSort {
 
   private:
     std::string hostpath_;
-    tinyxml2::XMLDocument recordsxml_;
+    IPPortRecordStore records_;
 
     mutable Mutex mutex_;
-    mutable std::vector<BanItem> _ban_fail_list_;
+    mutable std::vector<BanItem> _ban_fail_list_;    // open addressing by ip:port, a power of 2 slots
+    size_t ban_fail_count_;
     mutable std::map<std::string, uint64_t> _server_bans_;
 
     uint8_t IPv6_ban_flag_;
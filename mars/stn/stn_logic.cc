@@ -203,6 +203,11 @@ void (*MakesureLonglinkConnected)()
    STN_WEAK_CALL(MakeSureLongLinkConnect());
 };
 
+void (*SetLongLinkGroup)(int _count, int _placement)
+= [](int _count, int _placement) {
+    STN_WEAK_CALL(SetLongLinkGroup(_count, _placement));
+};
+
 bool (*LongLinkIsConnected)()
 = []() {
     bool connected = false;
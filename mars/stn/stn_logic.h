@@ -129,6 +129,10 @@ namespace stn{
     
     // connect quickly if longlink is not connected.
 	extern void (*MakesureLonglinkConnected)();
+
+    // spread the longlink tasks over _count connections, 1 by default.
+    // _placement: 0 by priority, 1 by size (default), 2 by cmdid, see LongLinkTaskManager::TLinkPlacement.
+	extern void (*SetLongLinkGroup)(int _count, int _placement);
     
 	extern bool (*LongLinkIsConnected)();
     
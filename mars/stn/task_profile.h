@@ -251,6 +251,7 @@ struct TaskProfile {
         force_no_retry = false;
         
         running_id = 0;
+        link_index = 0;
         
         end_task_time = 0;
         retry_start_time = 0;
@@ -272,6 +273,7 @@ struct TaskProfile {
     void InitSendParam() {
         transfer_profile.Reset();
         running_id = 0;
+        link_index = 0;
     }
     
     void PushHistory() {
@@ -293,6 +295,7 @@ struct TaskProfile {
     const Task task;
     TransferProfile transfer_profile;
     intptr_t running_id;
+    int link_index;     // long link, which link of the group it runs on
     
     const uint64_t task_timeout;
     const uint64_t start_task_time;  // ms
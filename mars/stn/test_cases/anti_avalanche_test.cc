@@ -143,3 +143,107 @@ PUBC_TEST(MMAntiAvalanche_test, test2)
 #endif
 
 #endif
+
+//-------------------------------FrequencyLimit internals--------------------------------
+#include <string.h>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "mars/stn/src/frequency_limit.h"
+
+namespace mars {
+namespace stn {
+
+class FrequencyLimitTest : public ::testing::Test {
+  protected:
+    static const int kSlotCount = 64;   // INDEX_SLOT_COUNT of frequency_limit.cc
+
+    static uint64_t Hash64(const void* _buffer, size_t _len, uint64_t _seed = 0) { return FrequencyLimit::__Hash64(_buffer, _len, _seed); }
+
+    void InsertRecord(uint64_t _hash) { limit_.__InsertRecord(_hash); }
+    void RemoveRecord(int _index) { limit_.__RemoveRecord(_index); }
+    int LocateIndex(uint64_t _hash) const { return limit_.__LocateIndex(_hash); }
+    int RecordCount() const { return (int)limit_.iarr_record_.size(); }
+    uint64_t RecordHash(int _index) const { return limit_.iarr_record_[_index].hash_; }
+
+    // every record is found through its hash, and no slot of a probe chain is empty before the record's slot.
+    void ExpectIndexConsistent() const {
+        int used = 0;
+        for (int slot = 0; slot < kSlotCount; ++slot) {
+            int index = limit_.index_[slot];
+            if (0 > index) continue;
+
+            ++used;
+            ASSERT_LT(index, RecordCount());
+            for (int s = (int)(RecordHash(index) & (kSlotCount - 1)); s != slot; s = (s + 1) & (kSlotCount - 1)) {
+                EXPECT_LE(0, limit_.index_[s]) << "hole at slot " << s << " before slot " << slot;
+            }
+        }
+        EXPECT_EQ(RecordCount(), used);
+
+        for (int i = 0; i < RecordCount(); ++i) {
+            EXPECT_EQ(i, LocateIndex(RecordHash(i)));
+        }
+    }
+
+    FrequencyLimit limit_;
+};
+
+// the published XXH64 vectors, and a 103-byte input (three stripes and every tail step) from the reference algorithm.
+TEST_F(FrequencyLimitTest, Hash64_KnownAnswers) {
+    EXPECT_EQ(0xef46db3751d8e999ULL, Hash64("", 0));
+    EXPECT_EQ(0xd5afba1336a3be4bULL, Hash64("", 0, 1));
+    EXPECT_EQ(0x44bc2cf5ad770999ULL, Hash64("abc", 3));
+
+    const char* text = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(0xfbcea83c8a378bf1ULL, Hash64(text, strlen(text)));
+
+    unsigned char buffer[103];
+    for (size_t i = 0; i < sizeof(buffer); ++i) buffer[i] = (unsigned char)(i * 7 + 3);
+    EXPECT_EQ(0x9ce1e302796dfbc9ULL, Hash64(buffer, sizeof(buffer)));
+    EXPECT_EQ(0xfdfad59b445652faULL, Hash64(buffer, sizeof(buffer), 0x9e3779b97f4a7c15ULL));
+
+    // unaligned input hashes the same.
+    unsigned char shifted[sizeof(buffer) + 1];
+    memcpy(shifted + 1, buffer, sizeof(buffer));
+    EXPECT_EQ(Hash64(buffer, sizeof(buffer)), Hash64(shifted + 1, sizeof(buffer)));
+}
+
+// hashes crowd a few home slots around the wrap of the table, so removals shift long probe chains back.
+TEST_F(FrequencyLimitTest, LocateSlot_RandomInsertRemove) {
+    const int kMaxRecords = 30;     // MAX_RECORD_COUNT, inserts stay below it so nothing is evicted
+    static const uint64_t kHomes[] = {61, 62, 63, 0, 1, 2, 17};
+
+    std::mt19937_64 rng(20261018);
+    std::set<uint64_t> model;
+
+    for (int op = 0; op < 20000; ++op) {
+        bool insert = model.empty() || (RecordCount() < kMaxRecords - 1 && 0 == rng() % 2);
+
+        if (insert) {
+            uint64_t hash = (rng() & ~(uint64_t)(kSlotCount - 1)) | kHomes[rng() % (sizeof(kHomes) / sizeof(kHomes[0]))];
+            if (model.count(hash)) continue;
+            EXPECT_EQ(-1, LocateIndex(hash));
+            InsertRecord(hash);
+            model.insert(hash);
+        } else {
+            int index = (int)(rng() % RecordCount());
+            uint64_t hash = RecordHash(index);
+            RemoveRecord(index);
+            model.erase(hash);
+            EXPECT_EQ(-1, LocateIndex(hash));
+        }
+
+        ASSERT_EQ((int)model.size(), RecordCount());
+        ExpectIndexConsistent();
+        if (HasFailure()) FAIL() << "at op " << op;
+    }
+
+    for (std::set<uint64_t>::const_iterator it = model.begin(); it != model.end(); ++it) {
+        EXPECT_LE(0, LocateIndex(*it));
+    }
+}
+
+}
+}
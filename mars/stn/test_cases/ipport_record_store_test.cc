@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "boost/filesystem.hpp"
+
+#include "mars/stn/src/ipport_record_store.h"
+
+using namespace mars::stn;
+
+namespace {
+
+class IPPortRecordStoreTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "ipport_record_store_test_%d", (int)getpid());
+        dir_ = (boost::filesystem::temp_directory_path() / dir).string();
+        boost::filesystem::create_directories(dir_);
+        path_ = dir_ + "/ipportrecords3.dat";
+    }
+
+    virtual void TearDown() {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dir_, ec);
+    }
+
+    static const IPPortRecordStore::Record* Find(const std::vector<IPPortRecordStore::Record>& _records, const std::string& _ip, uint16_t _port) {
+        for (size_t i = 0; i < _records.size(); ++i) {
+            if (_records[i].ip == _ip && _records[i].port == _port) return &_records[i];
+        }
+        return NULL;
+    }
+
+    // flips a byte of the record that holds _ip, bypassing the store.
+    void CorruptRecord(const std::string& _ip, long _offset_from_ip) {
+        FILE* file = fopen(path_.c_str(), "r+b");
+        ASSERT_TRUE(NULL != file);
+
+        std::vector<char> data((size_t)boost::filesystem::file_size(path_));
+        ASSERT_EQ(1u, fread(&data[0], data.size(), 1, file));
+
+        std::vector<char>::iterator it = std::search(data.begin(), data.end(), _ip.begin(), _ip.end());
+        ASSERT_TRUE(data.end() != it);
+
+        long pos = (long)(it - data.begin()) + _offset_from_ip;
+        char byte = data[pos] ^ 0x01;
+        fseek(file, pos, SEEK_SET);
+        fwrite(&byte, 1, 1, file);
+        fclose(file);
+    }
+
+    std::string dir_;
+    std::string path_;
+};
+
+}
+
+TEST_F(IPPortRecordStoreTest, UpdateReopen) {
+    {
+        IPPortRecordStore store;
+        ASSERT_TRUE(store.Open(path_));
+
+        store.Update("wifi_a", "10.0.0.1", 80, true);
+        store.Update("wifi_a", "10.0.0.1", 80, false);
+        store.Update("wifi_a", "10.0.0.1", 80, false);
+        store.Update("wifi_a", "10.0.0.2", 443, false);
+        store.Update("wifi_a", "2001:db8::1", 8080, true);
+        store.Update("mobile", "10.0.0.1", 80, false);
+        store.Close();
+        EXPECT_FALSE(store.IsOpen());
+    }
+
+    IPPortRecordStore store;
+    ASSERT_TRUE(store.Open(path_));
+
+    std::vector<IPPortRecordStore::Record> records;
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(3u, records.size());
+
+    const IPPortRecordStore::Record* record = Find(records, "10.0.0.1", 80);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(0x3u, record->history_result);     // success, fail, fail: the latest in the lowest bit
+    record = Find(records, "10.0.0.2", 443);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(0x1u, record->history_result);
+    record = Find(records, "2001:db8::1", 8080);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(0x0u, record->history_result);
+
+    store.GetRecords("mobile", records);
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ("10.0.0.1", records[0].ip);
+    EXPECT_EQ(0x1u, records[0].history_result);
+
+    store.GetRecords("wifi_b", records);
+    EXPECT_TRUE(records.empty());
+
+    // an update after the reopen goes on with the same record.
+    store.Update("wifi_a", "10.0.0.2", 443, true);
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(3u, records.size());
+    record = Find(records, "10.0.0.2", 443);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(0x2u, record->history_result);
+}
+
+TEST_F(IPPortRecordStoreTest, ChecksumMismatch) {
+    {
+        IPPortRecordStore store;
+        ASSERT_TRUE(store.Open(path_));
+        store.Update("wifi_a", "10.0.0.1", 80, false);
+        store.Update("wifi_a", "10.0.0.2", 80, false);
+    }
+
+    // the byte after the ip's NUL terminator is covered by the checksum but read by nothing else.
+    CorruptRecord("10.0.0.1", (long)strlen("10.0.0.1") + 1);
+
+    IPPortRecordStore store;
+    ASSERT_TRUE(store.Open(path_));
+
+    std::vector<IPPortRecordStore::Record> records;
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ("10.0.0.2", records[0].ip);
+
+    // the torn record is replaced, not continued.
+    store.Update("wifi_a", "10.0.0.1", 80, true);
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(2u, records.size());
+    const IPPortRecordStore::Record* record = Find(records, "10.0.0.1", 80);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(0x0u, record->history_result);
+
+    // RemoveTimeout drops torn records too.
+    store.Close();
+    CorruptRecord("10.0.0.2", (long)strlen("10.0.0.2") + 1);
+    ASSERT_TRUE(store.Open(path_));
+    store.RemoveTimeout(60 * 60 * 24);
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ("10.0.0.1", records[0].ip);
+}
+
+TEST_F(IPPortRecordStoreTest, BadFileStartsOver) {
+    FILE* file = fopen(path_.c_str(), "wb");
+    ASSERT_TRUE(NULL != file);
+    fputs("not a record file", file);
+    fclose(file);
+
+    IPPortRecordStore store;
+    ASSERT_TRUE(store.Open(path_));
+    std::vector<IPPortRecordStore::Record> records;
+    store.GetRecords("wifi_a", records);
+    EXPECT_TRUE(records.empty());
+
+    store.Update("wifi_a", "10.0.0.1", 80, true);
+    store.Close();
+    ASSERT_TRUE(store.Open(path_));
+    store.GetRecords("wifi_a", records);
+    EXPECT_EQ(1u, records.size());
+}
+
+static const char* const kXmlFixture =
+    "<record netinfo=\"wifi_a\" time=\"%u\">\n"
+    "    <item ip=\"10.0.0.1\" port=\"80\" historyresult=\"5\"/>\n"
+    "    <item ip=\"10.0.0.2\" port=\"8080\" historyresult=\"0\"/>\n"
+    "    <item port=\"443\" historyresult=\"1\"/>\n"
+    "</record>\n"
+    "<record netinfo=\"mobile\" time=\"%u\">\n"
+    "    <item ip=\"2001:db8::1\" port=\"443\" historyresult=\"3\"/>\n"
+    "</record>\n"
+    "<record time=\"%u\">\n"
+    "    <item ip=\"10.0.0.9\" port=\"80\" historyresult=\"1\"/>\n"
+    "</record>\n";
+
+TEST_F(IPPortRecordStoreTest, ImportXml) {
+    std::string xml_path = dir_ + "/ipportrecords2.xml";
+    unsigned int now = (unsigned int)time(NULL);
+
+    FILE* file = fopen(xml_path.c_str(), "w");
+    ASSERT_TRUE(NULL != file);
+    fprintf(file, kXmlFixture, now, now - 2 * 60 * 60 * 24, now);
+    fclose(file);
+
+    IPPortRecordStore store;
+    ASSERT_TRUE(store.Open(path_));
+    store.Update("wifi_a", "10.0.0.2", 8080, false);   // the store's own record wins over the old file
+
+    EXPECT_EQ(3, store.ImportXml(xml_path));
+    EXPECT_EQ(-1, store.ImportXml(dir_ + "/no_such_file.xml"));
+
+    std::vector<IPPortRecordStore::Record> records;
+    store.GetRecords("wifi_a", records);
+    ASSERT_EQ(2u, records.size());
+    const IPPortRecordStore::Record* record = Find(records, "10.0.0.1", 80);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(5u, record->history_result);
+    record = Find(records, "10.0.0.2", 8080);
+    ASSERT_TRUE(NULL != record);
+    EXPECT_EQ(1u, record->history_result);
+
+    store.GetRecords("mobile", records);
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ("2001:db8::1", records[0].ip);
+    EXPECT_EQ(3u, records[0].history_result);
+
+    // imported records survive a reopen and keep the time of the old file, the mobile one is two days old.
+    store.Close();
+    ASSERT_TRUE(store.Open(path_));
+    store.RemoveTimeout(60 * 60 * 24);
+    store.GetRecords("wifi_a", records);
+    EXPECT_EQ(2u, records.size());
+    store.GetRecords("mobile", records);
+    EXPECT_TRUE(records.empty());
+}
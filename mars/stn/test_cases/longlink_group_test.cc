@@ -0,0 +1,408 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "boost/bind.hpp"
+#include "boost/filesystem.hpp"
+
+#include "mars/app/app_logic.h"
+#include "mars/baseevent/active_logic.h"
+#include "mars/comm/messagequeue/message_queue.h"
+#include "mars/comm/thread/condition.h"
+#include "mars/comm/thread/lock.h"
+#include "mars/comm/thread/thread.h"
+#include "mars/comm/time_utils.h"
+#include "mars/stn/config.h"
+#include "mars/stn/proto/longlink_packer.h"
+#include "mars/stn/src/dynamic_timeout.h"
+#include "mars/stn/src/longlink_task_manager.h"
+#include "mars/stn/src/net_source.h"
+
+using namespace mars::stn;
+
+namespace {
+
+static const size_t kHeaderLen = 20;
+static const uint32_t kNoopCmdid = 6;
+
+class TestAppCallback : public mars::app::Callback {
+  public:
+    virtual std::string GetAppFilePath() { return boost::filesystem::temp_directory_path().string(); }
+    virtual mars::app::AccountInfo GetAccountInfo() { return mars::app::AccountInfo(); }
+    virtual unsigned int GetClientVersion() { return 1; }
+    virtual mars::app::DeviceInfo GetDeviceInfo() { return mars::app::DeviceInfo(); }
+};
+
+static void __Traffic(ssize_t _send, ssize_t _recv) {}
+static bool __Authed(const std::string& _host) { return true; }
+static void __ReportTaskProfile(const TaskProfile& _task_profile) {}
+static bool __NoVerify() { return false; }
+static int __NoIdentify(AutoBuffer& _identify_buffer, AutoBuffer& _buffer_hash, int32_t& _cmdid) { return IdentifyMode::kCheckNever; }
+
+// the body size of a task is its user_context.
+static bool __Req2Buf(uint32_t _taskid, void* const _user_context, AutoBuffer& _outbuffer, AutoBuffer& _extend, int& _error_code, const int _channel_select, const std::string& _host) {
+    size_t size = (size_t)_user_context;
+    _outbuffer.AllocWrite(size);
+    memset(_outbuffer.Ptr(), 'q', size);
+    _outbuffer.Length(0, size);
+    return true;
+}
+
+static int __Buf2Resp(uint32_t _taskid, void* const _user_context, const AutoBuffer& _inbuffer, const AutoBuffer& _extend, int& _error_code, const int _channel_select) {
+    return kTaskFailHandleNoError;
+}
+
+struct Packet {
+    Packet(int _conn, uint32_t _cmdid, uint32_t _taskid): conn(_conn), cmdid(_cmdid), taskid(_taskid) {}
+    int conn;   // the order the connection was accepted in, the main link connects first
+    uint32_t cmdid;
+    uint32_t taskid;
+};
+
+// takes the connections of all the links on 127.0.0.1 and answers every request on the connection it came on.
+class GroupServer {
+  public:
+    GroupServer()
+        : fd_(-1), port_(0), running_(true), close_cmdid_(0)
+        , thread_(boost::bind(&GroupServer::__Run, this)) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd_, (sockaddr*)&addr, sizeof(addr));
+        listen(fd_, 16);
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, (sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        thread_.start();
+    }
+
+    ~GroupServer() {
+        {
+            ScopedLock lock(mutex_);
+            running_ = false;
+        }
+        thread_.join();
+        for (size_t i = 0; i < conns_.size(); ++i) {
+            if (0 <= conns_[i].fd) close(conns_[i].fd);
+        }
+        close(fd_);
+    }
+
+    uint16_t Port() const { return port_; }
+
+    // the first request of _cmdid on a link other than the main one drops its connection instead of an answer.
+    void CloseOnCmdid(uint32_t _cmdid) {
+        ScopedLock lock(mutex_);
+        close_cmdid_ = _cmdid;
+    }
+
+    size_t Connections() {
+        ScopedLock lock(mutex_);
+        return conns_.size();
+    }
+
+    std::vector<Packet> Packets() {
+        ScopedLock lock(mutex_);
+        return packets_;
+    }
+
+  private:
+    struct Conn {
+        int fd;
+        std::string in;
+    };
+
+    void __Run() {
+        while (true) {
+            {
+                ScopedLock lock(mutex_);
+                if (!running_) return;
+            }
+
+            std::vector<pollfd> fds(1);
+            fds[0].fd = fd_;
+            fds[0].events = POLLIN;
+            for (size_t i = 0; i < conns_.size(); ++i) {
+                pollfd pfd = {conns_[i].fd, POLLIN, 0};
+                fds.push_back(pfd);
+            }
+            if (0 >= poll(&fds[0], fds.size(), 20)) continue;
+
+            if (fds[0].revents & POLLIN) {
+                Conn conn;
+                conn.fd = accept(fd_, NULL, NULL);
+                ScopedLock lock(mutex_);
+                if (0 <= conn.fd) conns_.push_back(conn);
+            }
+
+            for (size_t i = 1; i < fds.size(); ++i) {
+                if (0 == fds[i].revents) continue;
+                __Read(i - 1);
+            }
+        }
+    }
+
+    void __Read(size_t _index) {
+        Conn& conn = conns_[_index];
+        char buf[64 * 1024];
+        ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+        if (0 >= n) {
+            close(conn.fd);
+            conn.fd = -1;
+            return;
+        }
+        conn.in.append(buf, n);
+
+        size_t off = 0;
+        while (conn.in.size() - off >= kHeaderLen) {
+            uint32_t head[5];
+            memcpy(head, conn.in.data() + off, kHeaderLen);
+            size_t len = ntohl(head[0]) + ntohl(head[4]);
+            if (conn.in.size() - off < len) break;
+            off += len;
+
+            uint32_t cmdid = ntohl(head[2]);
+            if (kNoopCmdid == cmdid) continue;
+
+            ScopedLock lock(mutex_);
+            if (0 != _index && cmdid == close_cmdid_) {
+                close_cmdid_ = 0;
+                close(conn.fd);
+                conn.fd = -1;
+                return;
+            }
+            packets_.push_back(Packet((int)_index, cmdid, ntohl(head[3])));
+            lock.unlock();
+
+            uint32_t resp[5] = {htonl(kHeaderLen), head[1], head[2], head[3], htonl(4)};
+            char out[kHeaderLen + 4];
+            memcpy(out, resp, kHeaderLen);
+            memcpy(out + kHeaderLen, "resp", 4);
+            send(conn.fd, out, sizeof(out), MSG_NOSIGNAL);
+        }
+        conn.in.erase(0, off);
+    }
+
+  private:
+    int fd_;
+    uint16_t port_;
+
+    Mutex mutex_;
+    bool running_;
+    uint32_t close_cmdid_;
+    std::vector<Conn> conns_;
+    std::vector<Packet> packets_;
+    Thread thread_;
+};
+
+class LongLinkGroupTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        static TestAppCallback s_callback;
+        mars::app::SetCallback(&s_callback);
+        mars::stn::TrafficData = &__Traffic;
+        mars::stn::MakesureAuthed = &__Authed;
+        mars::stn::Req2Buf = &__Req2Buf;
+        mars::stn::Buf2Resp = &__Buf2Resp;
+        mars::stn::ReportTaskProfile = &__ReportTaskProfile;
+        mars::stn::GetLonglinkIdentifyCheckBuffer = &__NoIdentify;
+        longlink_complexconnect_need_verify = &__NoVerify;
+
+        NetSource::SetLongLink(std::vector<std::string>(1, "longlink.group.test"), std::vector<uint16_t>(1, server_.Port()), "127.0.0.1");
+        active_logic_ = new ActiveLogic;
+        net_source_ = new NetSource(*active_logic_);
+        manager_ = new LongLinkTaskManager(*net_source_, *active_logic_, dynamic_timeout_, MessageQueue::GetDefMessageQueue());
+        manager_->fun_callback_ = boost::bind(&LongLinkGroupTest::__OnTaskEnd, this, _1, _2, _3, _4, _5);
+        manager_->fun_anti_avalanche_check_ = boost::bind(&LongLinkGroupTest::__AntiAvalanche, _1, _2, _3);
+        manager_->fun_notify_network_err_ = boost::bind(&LongLinkGroupTest::__NetworkErr, _1, _2, _3, _4, _5);
+    }
+
+    virtual void TearDown() {
+        MessageQueue::WaitInvoke(boost::bind(&LongLinkTaskManager::ClearTasks, manager_), MessageQueue::DefAsyncInvokeHandler(MessageQueue::GetDefMessageQueue()));
+        delete manager_;
+        delete net_source_;
+        delete active_logic_;
+    }
+
+    void SetLinkGroup(size_t _count, LongLinkTaskManager::TLinkPlacement _placement) {
+        MessageQueue::WaitInvoke(boost::bind(&LongLinkTaskManager::SetLinkGroup, manager_, _count, _placement), MessageQueue::DefAsyncInvokeHandler(MessageQueue::GetDefMessageQueue()));
+    }
+
+    void StartTask(uint32_t _taskid, uint32_t _cmdid, int _priority, size_t _size) {
+        Task task(_taskid);
+        task.cmdid = _cmdid;
+        task.priority = _priority;
+        task.retry_count = 3;
+        task.user_context = (void*)_size;
+        MessageQueue::WaitInvoke(boost::bind(&LongLinkTaskManager::StartTask, manager_, task), MessageQueue::DefAsyncInvokeHandler(MessageQueue::GetDefMessageQueue()));
+    }
+
+    bool WaitConnections(size_t _count, long _timeout) {
+        uint64_t start = ::gettickcount();
+        while (server_.Connections() < _count) {
+            if (::gettickcount() - start >= (uint64_t)_timeout) return false;
+            ::usleep(10 * 1000);
+        }
+        ::usleep(100 * 1000);
+        return true;
+    }
+
+    bool WaitTasks(size_t _count, long _timeout) {
+        ScopedLock lock(mutex_);
+        uint64_t start = ::gettickcount();
+        while (ended_.size() < _count) {
+            uint64_t cost = ::gettickcount() - start;
+            if (cost >= (uint64_t)_timeout) return false;
+            cond_.wait(lock, (long)(_timeout - cost));
+        }
+        return true;
+    }
+
+    // the connection of every request of _cmdid, in the order they came.
+    std::vector<int> ConnsOf(uint32_t _cmdid, std::vector<uint32_t>* _taskids = NULL) {
+        std::vector<Packet> packets = server_.Packets();
+        std::vector<int> conns;
+        for (size_t i = 0; i < packets.size(); ++i) {
+            if (_cmdid != packets[i].cmdid) continue;
+            conns.push_back(packets[i].conn);
+            if (NULL != _taskids) _taskids->push_back(packets[i].taskid);
+        }
+        return conns;
+    }
+
+    // the main link is connected first, the others once tasks were placed on them.
+    void ConnectGroup(size_t _connections, uint32_t _cmdid, int _priority, size_t _size) {
+        StartTask(1, 1, Task::kTaskPriorityHighest, 16);
+        ASSERT_TRUE(WaitConnections(1, 5000));
+        StartTask(2, _cmdid, _priority, _size);
+        StartTask(3, _cmdid, _priority, _size);
+        ASSERT_TRUE(WaitConnections(_connections, 5000));
+        ASSERT_TRUE(WaitTasks(3, 5000));
+    }
+
+    std::map<uint32_t, int> Ended() {
+        ScopedLock lock(mutex_);
+        return ended_;
+    }
+
+  private:
+    int __OnTaskEnd(ErrCmdType _err_type, int _err_code, int _fail_handle, const Task& _task, unsigned int _taskcosttime) {
+        ScopedLock lock(mutex_);
+        ended_[_task.taskid] = _err_type;
+        cond_.notifyAll(lock);
+        return 0;
+    }
+
+    static bool __AntiAvalanche(const Task& _task, const void* _buffer, int _len) { return true; }
+    static void __NetworkErr(int _line, ErrCmdType _err_type, int _err_code, const std::string& _ip, uint16_t _port) {}
+
+  protected:
+    GroupServer server_;
+    ActiveLogic* active_logic_;
+    NetSource* net_source_;
+    DynamicTimeout dynamic_timeout_;
+    LongLinkTaskManager* manager_;
+
+  private:
+    Mutex mutex_;
+    Condition cond_;
+    std::map<uint32_t, int> ended_;
+};
+
+}
+
+TEST_F(LongLinkGroupTest, PlaceByPriority) {
+    SetLinkGroup(3, LongLinkTaskManager::kPlaceByPriority);
+    ASSERT_NO_FATAL_FAILURE(ConnectGroup(3, 10, Task::kTaskPriorityLowest, 16));
+
+    for (uint32_t taskid = 100; taskid < 120; ++taskid) {
+        bool low = 2 > taskid % 4;
+        StartTask(taskid, low ? 10 : 20, low ? Task::kTaskPriorityLowest : Task::kTaskPriorityNormal, 16);
+    }
+    ASSERT_TRUE(WaitTasks(23, 5000));
+
+    std::vector<int> low = ConnsOf(10);
+    std::vector<int> normal = ConnsOf(20);
+    ASSERT_EQ(12u, low.size());
+    ASSERT_EQ(10u, normal.size());
+    for (size_t i = 2; i < low.size(); ++i) EXPECT_NE(0, low[i]);
+    for (size_t i = 0; i < normal.size(); ++i) EXPECT_EQ(0, normal[i]);
+    EXPECT_NE(low[2], low[3]);
+}
+
+TEST_F(LongLinkGroupTest, PlaceBySize) {
+    SetLinkGroup(3, LongLinkTaskManager::kPlaceBySize);
+    ASSERT_NO_FATAL_FAILURE(ConnectGroup(3, 10, Task::kTaskPriorityNormal, kLonglinkGroupSmallTaskSize + 1));
+
+    for (uint32_t taskid = 100; taskid < 120; ++taskid) {
+        bool large = 2 > taskid % 4;
+        StartTask(taskid, large ? 10 : 20, Task::kTaskPriorityNormal, large ? kLonglinkGroupSmallTaskSize + 1 : kLonglinkGroupSmallTaskSize);
+    }
+    ASSERT_TRUE(WaitTasks(23, 5000));
+
+    std::vector<int> large = ConnsOf(10);
+    std::vector<int> small = ConnsOf(20);
+    ASSERT_EQ(12u, large.size());
+    ASSERT_EQ(10u, small.size());
+    for (size_t i = 2; i < large.size(); ++i) EXPECT_NE(0, large[i]);
+    for (size_t i = 0; i < small.size(); ++i) EXPECT_EQ(0, small[i]);
+    EXPECT_NE(large[2], large[3]);
+}
+
+// the link of cmdid 4 connects only once its first task is there, the tasks wait for it instead of going on the main link.
+TEST_F(LongLinkGroupTest, PlaceByCmdid_WaitsForItsLink) {
+    SetLinkGroup(3, LongLinkTaskManager::kPlaceByCmdid);
+    StartTask(1, 3, Task::kTaskPriorityNormal, 16);
+    ASSERT_TRUE(WaitConnections(1, 5000));
+
+    for (uint32_t taskid = 100; taskid < 120; ++taskid) {
+        StartTask(taskid, 0 == taskid % 2 ? 4 : 3, Task::kTaskPriorityNormal, 16);
+    }
+    ASSERT_TRUE(WaitTasks(21, 5000));
+
+    std::vector<uint32_t> taskids;
+    std::vector<int> conns = ConnsOf(4, &taskids);
+    ASSERT_EQ(10u, conns.size());
+    for (size_t i = 0; i < conns.size(); ++i) {
+        EXPECT_EQ(conns[0], conns[i]);
+        EXPECT_EQ(100 + 2 * i, taskids[i]);
+    }
+    EXPECT_NE(0, conns[0]);
+
+    std::vector<int> main = ConnsOf(3);
+    ASSERT_EQ(11u, main.size());
+    for (size_t i = 0; i < main.size(); ++i) EXPECT_EQ(0, main[i]);
+}
+
+// the link of cmdid 4 is lost with a task on it, its tasks wait for the reconnect and are never run on the main link.
+TEST_F(LongLinkGroupTest, PlaceByCmdid_Failover) {
+    SetLinkGroup(3, LongLinkTaskManager::kPlaceByCmdid);
+    ASSERT_NO_FATAL_FAILURE(ConnectGroup(2, 4, Task::kTaskPriorityNormal, 16));
+
+    server_.CloseOnCmdid(4);
+    for (uint32_t taskid = 100; taskid < 110; ++taskid) {
+        StartTask(taskid, 4, Task::kTaskPriorityNormal, 16);
+        StartTask(taskid + 100, 3, Task::kTaskPriorityNormal, 16);
+    }
+    ASSERT_TRUE(WaitTasks(23, kLonglinkGroupReconnectInterval + 10 * 1000));
+
+    std::vector<uint32_t> taskids;
+    std::vector<int> conns = ConnsOf(4, &taskids);
+    ASSERT_LE(12u, conns.size());
+    for (size_t i = 0; i < conns.size(); ++i) EXPECT_NE(0, conns[i]);
+    EXPECT_NE(conns.front(), conns.back());
+
+    std::map<uint32_t, int> ended = Ended();
+    for (uint32_t taskid = 100; taskid < 110; ++taskid) EXPECT_EQ(kEctOK, ended[taskid]);
+    for (size_t i = 2; i + 1 < taskids.size(); ++i) EXPECT_LT(taskids[i], taskids[i + 1]);
+}
@@ -0,0 +1,165 @@
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "mars/stn/config.h"
+#include "mars/stn/src/longlink_send_queue.h"
+
+using namespace mars::stn;
+
+namespace {
+
+class LongLinkSendQueueTest : public ::testing::Test {
+  protected:
+    // the body of a packet is its taskid over and over, so what was gathered tells where it came from.
+    void Push(uint32_t _taskid, int _priority, size_t _size) {
+        Task task(_taskid);
+        task.priority = _priority;
+        AutoBuffer& buffer = queue_.Push(task);
+        buffer.AllocWrite(_size);
+        memset(buffer.Ptr(), (int)_taskid, _size);
+        buffer.Length(0, _size);
+    }
+
+    // what LongLink does once writev took _len bytes of the frame, returns the taskids all written.
+    std::vector<uint32_t> Write(size_t _len) {
+        std::vector<uint32_t> written;
+        while (!queue_.Empty() && 0 < _len) {
+            LongLinkSendQueue::Packet& packet = queue_.Front();
+            if (_len >= packet.second->PosLength()) {
+                _len -= packet.second->PosLength();
+                written.push_back(packet.first.taskid);
+                queue_.Pop();
+            } else {
+                packet.second->Seek(_len, AutoBuffer::ESeekCur);
+                queue_.Started();
+                _len = 0;
+            }
+        }
+        return written;
+    }
+
+    // the frame gathered as the taskid of each of its bytes.
+    std::string Frame(size_t _max_len) {
+        iovec* vec = NULL;
+        int count = queue_.Gather(_max_len, vec);
+        std::string frame;
+        for (int i = 0; i < count; ++i) frame.append((const char*)vec[i].iov_base, vec[i].iov_len);
+        return frame;
+    }
+
+    // the taskids of a frame, in the order their pieces are in it.
+    static std::vector<uint32_t> Pieces(const std::string& _frame) {
+        std::vector<uint32_t> pieces;
+        for (size_t i = 0; i < _frame.size(); ++i) {
+            if (i == 0 || _frame[i] != _frame[i - 1]) pieces.push_back((uint8_t)_frame[i]);
+        }
+        return pieces;
+    }
+
+  protected:
+    LongLinkSendQueue queue_;
+};
+
+}
+
+TEST_F(LongLinkSendQueueTest, PriorityOrder) {
+    Push(1, Task::kTaskPriorityLowest, 10);
+    Push(2, Task::kTaskPriorityNormal, 10);
+    Push(3, Task::kTaskPriorityHighest, 10);
+    Push(4, Task::kTaskPriorityNormal, 10);
+    Push(5, Task::kTaskPriorityHighest, 10);
+    Push(6, Task::kTaskPriorityLowest + 1, 10);    // out of range, taken as the lowest
+    ASSERT_EQ(6u, queue_.Count());
+
+    std::vector<uint32_t> expect;
+    expect.push_back(3);
+    expect.push_back(5);
+    expect.push_back(2);
+    expect.push_back(4);
+    expect.push_back(1);
+    expect.push_back(6);
+
+    std::string frame = Frame(kLonglinkSendFrameSize);
+    EXPECT_EQ(60u, frame.size());
+    EXPECT_EQ(expect, Pieces(frame));
+    EXPECT_EQ(3u, queue_.Front().first.taskid);
+
+    EXPECT_EQ(expect, Write(frame.size()));
+    EXPECT_TRUE(queue_.Empty());
+}
+
+TEST_F(LongLinkSendQueueTest, GatherCap) {
+    Push(1, Task::kTaskPriorityNormal, 20 * 1024);
+    Push(2, Task::kTaskPriorityNormal, 20 * 1024);
+    Push(3, Task::kTaskPriorityNormal, 20 * 1024);
+
+    iovec* vec = NULL;
+    ASSERT_EQ(2, queue_.Gather(kLonglinkSendFrameSize, vec));
+    EXPECT_EQ(20u * 1024, vec[0].iov_len);
+    EXPECT_EQ(kLonglinkSendFrameSize - 20 * 1024, vec[1].iov_len);
+
+    // the rest of 2 is the start of the next frame.
+    EXPECT_EQ(std::vector<uint32_t>(1, 1), Write(kLonglinkSendFrameSize));
+    ASSERT_EQ(2, queue_.Gather(kLonglinkSendFrameSize, vec));
+    EXPECT_EQ(40u * 1024 - kLonglinkSendFrameSize, vec[0].iov_len);
+    EXPECT_EQ(20u * 1024, vec[1].iov_len);
+    EXPECT_EQ(0, memcmp(queue_.Front().second->PosPtr(), vec[0].iov_base, 1));
+
+    // no more than kMaxIov pieces, however small.
+    queue_.Clear();
+    for (uint32_t taskid = 1; taskid <= LongLinkSendQueue::kMaxIov + 10; ++taskid) Push(taskid, Task::kTaskPriorityNormal, 8);
+    EXPECT_EQ((int)LongLinkSendQueue::kMaxIov, queue_.Gather(kLonglinkSendFrameSize, vec));
+}
+
+// a packet of a higher priority goes before the lower ones not started, never into the middle of one.
+TEST_F(LongLinkSendQueueTest, PreemptAtPacketBoundary) {
+    Push(1, Task::kTaskPriorityLowest, 40 * 1024);
+    Push(2, Task::kTaskPriorityLowest, 40 * 1024);
+
+    EXPECT_TRUE(Write(kLonglinkSendFrameSize).empty());
+    Push(3, Task::kTaskPriorityHighest, 1024);
+    Push(4, Task::kTaskPriorityNormal, 1024);
+
+    std::vector<uint32_t> expect;
+    expect.push_back(1);
+    expect.push_back(3);
+    expect.push_back(4);
+    expect.push_back(2);
+
+    std::string frame = Frame(kLonglinkSendFrameSize);
+    EXPECT_EQ(expect, Pieces(frame));
+    EXPECT_EQ(40u * 1024 - kLonglinkSendFrameSize, frame.find((char)3));
+
+    expect.pop_back();
+    EXPECT_EQ(expect, Write(frame.size()));
+    EXPECT_EQ(2u, queue_.Front().first.taskid);
+}
+
+// a packet written in part stays in front until it is all written, whatever is queued meanwhile.
+TEST_F(LongLinkSendQueueTest, ResumeStarted) {
+    Push(1, Task::kTaskPriorityLowest, 100);
+    EXPECT_TRUE(Write(40).empty());
+
+    Push(2, Task::kTaskPriorityHighest, 100);
+    EXPECT_EQ(1u, queue_.Front().first.taskid);
+    EXPECT_EQ(60u, queue_.Front().second->PosLength());
+
+    // a started packet can't be stopped, the ones not started can.
+    EXPECT_FALSE(queue_.Stop(1));
+    Push(3, Task::kTaskPriorityHighest, 100);
+    EXPECT_TRUE(queue_.Stop(3));
+    EXPECT_EQ(2u, queue_.Count());
+
+    // short writes go on from where the last one stopped.
+    EXPECT_TRUE(Write(30).empty());
+    EXPECT_EQ(1u, queue_.Front().first.taskid);
+    EXPECT_EQ(std::string(30, (char)1) + std::string(100, (char)2), Frame(kLonglinkSendFrameSize));
+
+    EXPECT_EQ(std::vector<uint32_t>(1, 1), Write(30));
+    EXPECT_EQ(2u, queue_.Front().first.taskid);
+    EXPECT_EQ(100u, queue_.Front().second->PosLength());
+}
@@ -0,0 +1,290 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "boost/bind.hpp"
+#include "boost/filesystem.hpp"
+
+#include "mars/app/app_logic.h"
+#include "mars/baseevent/active_logic.h"
+#include "mars/comm/thread/condition.h"
+#include "mars/comm/thread/lock.h"
+#include "mars/comm/thread/thread.h"
+#include "mars/comm/time_utils.h"
+#include "mars/stn/config.h"
+#include "mars/stn/src/net_source.h"
+#include "mars/stn/src/shortlink_reactor.h"
+
+using namespace mars::stn;
+
+namespace {
+
+static const char* const kBody = "reactor response body";
+
+class TestAppCallback : public mars::app::Callback {
+  public:
+    virtual std::string GetAppFilePath() { return boost::filesystem::temp_directory_path().string(); }
+    virtual mars::app::AccountInfo GetAccountInfo() { return mars::app::AccountInfo(); }
+    virtual unsigned int GetClientVersion() { return 1; }
+    virtual mars::app::DeviceInfo GetDeviceInfo() { return mars::app::DeviceInfo(); }
+};
+
+static void __Traffic(ssize_t _send, ssize_t _recv) {}
+
+// one connection on 127.0.0.1: answers the request, or holds it until the client goes away.
+class LoopbackServer {
+  public:
+    LoopbackServer(bool _respond, int _backlog = 16)
+        : respond_(_respond), fd_(-1), port_(0), got_request_(false), client_closed_(false)
+        , thread_(boost::bind(&LoopbackServer::__Run, this)) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd_, (sockaddr*)&addr, sizeof(addr));
+        listen(fd_, _backlog);
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, (sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+    }
+
+    ~LoopbackServer() {
+        shutdown(fd_, SHUT_RDWR);
+        if (thread_.isruning()) thread_.join();
+        close(fd_);
+    }
+
+    void Start() { thread_.start(); }
+    uint16_t Port() const { return port_; }
+
+    bool WaitRequest(long _timeout) {
+        ScopedLock lock(mutex_);
+        if (!got_request_) cond_.wait(lock, _timeout);
+        return got_request_;
+    }
+
+    bool WaitClientClosed(long _timeout) {
+        ScopedLock lock(mutex_);
+        if (!client_closed_) cond_.wait(lock, _timeout);
+        return client_closed_;
+    }
+
+  private:
+    void __Run() {
+        int conn = accept(fd_, NULL, NULL);
+        if (0 > conn) return;
+
+        std::string request;
+        char buf[4096];
+        while (true) {
+            ssize_t n = recv(conn, buf, sizeof(buf), 0);
+            if (0 >= n) break;
+            request.append(buf, n);
+
+            size_t head_end = request.find("\r\n\r\n");
+            if (std::string::npos == head_end) continue;
+            const char* length = strcasestr(request.c_str(), "Content-Length:");
+            if (NULL != length && request.size() < head_end + 4 + (size_t)atoi(length + 15)) continue;
+
+            ScopedLock lock(mutex_);
+            got_request_ = true;
+            cond_.notifyAll(lock);
+            break;
+        }
+
+        if (respond_) {
+            char head[128];
+            int len = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", (int)strlen(kBody));
+            std::string response = std::string(head, len) + kBody;
+            send(conn, response.data(), response.size(), 0);
+        } else {
+            while (0 < recv(conn, buf, sizeof(buf), 0)) {}
+        }
+
+        close(conn);
+        ScopedLock lock(mutex_);
+        client_closed_ = true;
+        cond_.notifyAll(lock);
+    }
+
+  private:
+    bool respond_;
+    int fd_;
+    uint16_t port_;
+
+    Mutex mutex_;
+    Condition cond_;
+    bool got_request_;
+    bool client_closed_;
+    Thread thread_;
+};
+
+struct Response {
+    Response(): count(0), err_type(kEctOK), status(0), tick(0) {}
+
+    void OnResponse(ShortLinkInterface* _worker, ErrCmdType _err_type, int _status, AutoBuffer& _body, AutoBuffer& _extension, bool _cancel_retry, ConnectProfile& _conn_profile) {
+        ScopedLock lock(mutex);
+        ++count;
+        err_type = _err_type;
+        status = _status;
+        body.assign((const char*)_body.Ptr(), _body.Length());
+        tick = ::gettickcount();
+        cond.notifyAll(lock);
+    }
+
+    bool Wait(long _timeout) {
+        ScopedLock lock(mutex);
+        if (0 == count) cond.wait(lock, _timeout);
+        return 0 < count;
+    }
+
+    Mutex mutex;
+    Condition cond;
+    int count;
+    ErrCmdType err_type;
+    int status;
+    std::string body;
+    uint64_t tick;
+};
+
+class ShortLinkReactorTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        static TestAppCallback s_callback;
+        mars::app::SetCallback(&s_callback);
+        mars::stn::TrafficData = &__Traffic;
+        active_logic_ = new ActiveLogic;
+        net_source_ = new NetSource(*active_logic_);
+    }
+
+    virtual void TearDown() {
+        delete net_source_;
+        delete active_logic_;
+    }
+
+    ShortLinkInterface* NewLink(uint16_t _port, Response& _response) {
+        NetSource::SetShortlink(_port, "127.0.0.1");
+
+        Task task(1);
+        task.cgi = "/reactor_test";
+        task.shortlink_host_list.push_back("reactor.test.local");
+        ShortLinkInterface* link = new ReactorShortLink(MessageQueue::GetDefMessageQueue(), *net_source_, task, false);
+        link->OnResponse.set(boost::bind(&Response::OnResponse, &_response, _1, _2, _3, _4, _5, _6, _7), link);
+
+        AutoBuffer req;
+        req.Write("hello", 5);
+        AutoBuffer extend;
+        link->SendRequest(req, extend);
+        return link;
+    }
+
+    ActiveLogic* active_logic_;
+    NetSource* net_source_;
+};
+
+}
+
+TEST_F(ShortLinkReactorTest, Request_LoopbackServer) {
+    LoopbackServer server(true);
+    server.Start();
+
+    Response response;
+    size_t size = ShortLinkReactor::Instance().Size();
+    ShortLinkInterface* link = NewLink(server.Port(), response);
+
+    ASSERT_TRUE(response.Wait(5000));
+    EXPECT_EQ(kEctOK, response.err_type);
+    EXPECT_EQ(200, response.status);
+    EXPECT_EQ(kBody, response.body);
+    EXPECT_TRUE(server.WaitClientClosed(5000));
+
+    delete link;
+    EXPECT_EQ(size, ShortLinkReactor::Instance().Size());
+    EXPECT_EQ(1, response.count);
+}
+
+TEST_F(ShortLinkReactorTest, Cancel_WaitingResponse) {
+    LoopbackServer server(false);
+    server.Start();
+
+    Response response;
+    size_t size = ShortLinkReactor::Instance().Size();
+    ShortLinkInterface* link = NewLink(server.Port(), response);
+    ASSERT_TRUE(server.WaitRequest(5000));
+
+    // deleting the link is how the task manager cancels it: no answer after, and the socket is closed.
+    uint64_t start = ::gettickcount();
+    delete link;
+    EXPECT_GT((uint64_t)1000, ::gettickcount() - start);
+    EXPECT_EQ(size, ShortLinkReactor::Instance().Size());
+    EXPECT_TRUE(server.WaitClientClosed(5000));
+
+    ::usleep(100 * 1000);
+    EXPECT_EQ(0, response.count);
+}
+
+TEST_F(ShortLinkReactorTest, Cancel_BeforeConnect) {
+    LoopbackServer server(true);
+    server.Start();
+
+    Response response;
+    size_t size = ShortLinkReactor::Instance().Size();
+    for (int i = 0; i < 20; ++i) {
+        delete NewLink(server.Port(), response);
+    }
+    EXPECT_EQ(size, ShortLinkReactor::Instance().Size());
+
+    ::usleep(100 * 1000);
+    EXPECT_EQ(0, response.count);
+}
+
+TEST_F(ShortLinkReactorTest, ConnectRefused) {
+    uint16_t port = 0;
+    {
+        LoopbackServer closed(false);
+        port = closed.Port();
+    }
+
+    Response response;
+    ShortLinkInterface* link = NewLink(port, response);
+    ASSERT_TRUE(response.Wait(5000));
+    EXPECT_EQ(kEctSocket, response.err_type);
+    delete link;
+}
+
+// a listener that never accepts and whose backlog is full drops the SYN, the connect runs into kShortlinkConnTimeout.
+TEST_F(ShortLinkReactorTest, ConnectTimeout) {
+    LoopbackServer blackhole(false, 0);
+    std::vector<int> fillers;
+    for (int i = 0; i < 4; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(blackhole.Port());
+        struct timeval tv = {0, 200 * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        connect(fd, (sockaddr*)&addr, sizeof(addr));
+        fillers.push_back(fd);
+    }
+
+    Response response;
+    uint64_t start = ::gettickcount();
+    ShortLinkInterface* link = NewLink(blackhole.Port(), response);
+
+    ASSERT_TRUE(response.Wait(kShortlinkConnTimeout + 5000));
+    EXPECT_EQ(kEctSocket, response.err_type);
+    EXPECT_LE((uint64_t)kShortlinkConnTimeout, response.tick - start);
+    delete link;
+
+    for (size_t i = 0; i < fillers.size(); ++i) close(fillers[i]);
+}